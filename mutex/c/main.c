@@ -1,10 +1,14 @@
 /********************************************************************************
  * @brief Demonstration of mutex in C.
  ********************************************************************************/
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <unistd.h>
-#include <pthread.h>
+#include <sync/counter.h>
+#include <sync/logger.h>
+#include <sync/mutex.h>
+#include <sync/thread_pool.h>
 
 /********************************************************************************
  * @brief Structure containing thread arguments.
@@ -22,12 +26,19 @@ struct thread_args {
 /********************************************************************************
  * @brief Mutex used for synchronizing shared resources between threads.
  ********************************************************************************/
-static pthread_mutex_t mutex;
+static struct sync_mutex* mutex = 0;
 
 /********************************************************************************
- * @brief Stores the number of performed prints.
+ * @brief Logger writing the prints of all threads to the terminal. The threads
+ *        only enqueue their prints, so they never wait for the terminal.
  ********************************************************************************/
-static uint16_t num_prints = 0;
+static struct async_logger* logger = 0;
+
+/********************************************************************************
+ * @brief Stores the number of performed prints. The counter is sharded, so the
+ *        threads increment it without synchronization.
+ ********************************************************************************/
+static struct sharded_counter* num_prints = 0;
 
 /********************************************************************************
  * @brief Blocks the calling thread for specified delay time in milliseconds.
@@ -43,49 +54,54 @@ static inline void delay_ms(const uint16_t delay_time_ms) {
  * @brief Runs the calling thread continuously by printing the thread ID with
  *        specified frequency. 
  * 
- * @note  A mutex is used to make sure that only one thread has access to the
- *        terminal at any given time. We wait 10 ms after performing a print 
- *        before unlocking the mutex to make sure that the print is completed 
- *        before making the terminal accessible to other threads.
+ * @note  A mutex is used to make sure that only one thread at a time reads the
+ *        print counter and hands its print to the logger, so the prints appear
+ *        in the order of their counts. The logger only enqueues the print, so
+ *        the threads never hold the mutex while waiting for the terminal.
  * 
  * @param args
  *        Thread-specific arguments passed as a reference to a thread_args
  *        structure. 
- * @return 
- *        A nullptr, since thread functions in C need to return some kind of
- *        pointer.
  ********************************************************************************/
-static void* run_thread(void* args) {
+static void run_thread(void* args) {
     struct thread_args* self = (struct thread_args*)(args);
     while (1) {
-        pthread_mutex_lock(&mutex);
-        printf("--------------------------------------------------------------------------------\n");
-        printf("Running thread with ID %hu!\n", self->id);
-        printf("Number of performed prints: %hu\n", ++num_prints);
-        printf("--------------------------------------------------------------------------------\n\n");
-        delay_ms(10);
-        pthread_mutex_unlock(&mutex);
+        sharded_counter_increment(num_prints);
+        sync_mutex_lock(mutex);
+        async_logger_printf(logger,
+                            "--------------------------------------------------------------------------------\n"
+                            "Running thread with ID %hu!\n"
+                            "Number of performed prints: %" PRIu64 "\n"
+                            "--------------------------------------------------------------------------------\n\n",
+                            self->id, sharded_counter_read(num_prints));
+        sync_mutex_unlock(mutex);
         delay_ms(self->print_interval_ms);
     }
-    return 0;
 }
 
 /********************************************************************************
  * @brief Creates and runs two threads with different parameters.
  * 
- * @note  When creating threads, specify the starting routine and it's input
- *        arguments. Synchronize the threads by calling the join function.
+ * @note  The threads are workers of a thread pool, which runs each submitted
+ *        task with its input arguments. The pool gets one worker per task,
+ *        since the tasks never return. Deleting the pool waits for the tasks,
+ *        just like joining the threads.
  ********************************************************************************/
 int main(void) {
     struct thread_args args1 = {1, 1000}, args2 = {2, 1000};
-    pthread_t t1, t2;
+    const struct thread_pool_options options = {2, 0, false};
+    struct thread_pool* pool = thread_pool_new(&options);
 
-    pthread_mutex_init(&mutex, 0);
-    pthread_create(&t1, 0, run_thread, &args1);
-    pthread_create(&t2, 0, run_thread, &args2);
+    mutex = sync_mutex_new("mutex");
+    logger = async_logger_new(0);
+    num_prints = sharded_counter_new(0);
+    if (!pool || !mutex || !logger || !num_prints) return 1;
+    thread_pool_submit(pool, run_thread, &args1);
+    thread_pool_submit(pool, run_thread, &args2);
 
-    pthread_join(t1, 0);
-    pthread_join(t2, 0);
-    pthread_mutex_destroy(&mutex);
+    thread_pool_delete(&pool);
+    sync_mutex_delete(&mutex);
+    async_logger_delete(&logger);
+    sharded_counter_delete(&num_prints);
     return 0;
 }
\ No newline at end of file
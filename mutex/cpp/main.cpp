@@ -1,11 +1,15 @@
 /********************************************************************************
  * @brief Demonstration of mutex in C++.
  ********************************************************************************/
-#include <iostream>
 #include <thread>
 #include <chrono>
 #include <mutex>
+#include <cinttypes>
 #include <cstdint>
+#include <sync/counter.h>
+#include <sync/logger.h>
+#include <sync/mutex.h>
+#include <sync/thread_pool.h>
 
 /********************************************************************************
  * @note Anonymous namespaces provides static (internal) linkage, just like the
@@ -14,14 +18,23 @@
 namespace {
 
 /********************************************************************************
- * @brief Mutex used for synchronizing shared resources between threads.
+ * @brief Mutex used for synchronizing shared resources between threads. The
+ *        mutex records contention and hold times when the instrumentation is
+ *        enabled (SYNC_ENABLE_STATS).
  ********************************************************************************/
-std::mutex mutex{}; 
+sync_mutex mutex{"mutex"};
 
 /********************************************************************************
- * @brief Stores the number of performed prints.
+ * @brief Logger writing the prints of all threads to the terminal. The threads
+ *        only enqueue their prints, so they never wait for the terminal.
  ********************************************************************************/
-uint16_t num_prints{};
+async_logger* logger{};
+
+/********************************************************************************
+ * @brief Stores the number of performed prints. The counter is sharded, so the
+ *        threads increment it without synchronization.
+ ********************************************************************************/
+sharded_counter<> num_prints{};
 
 /********************************************************************************
  * @brief Blocks the calling thread for specified delay time in milliseconds.
@@ -37,10 +50,10 @@ inline void Delay_ms(const uint16_t delay_time_ms) {
  * @brief Runs the calling thread continuously by printing the thread ID with
  *        specified frequency. 
  * 
- * @note  A mutex is used to make sure that only one thread has access to the
- *        terminal at any given time. We wait 10 ms after performing a print 
- *        before unlocking the mutex to make sure that the print is completed 
- *        before making the terminal accessible to other threads.
+ * @note  A mutex is used to make sure that only one thread at a time reads the
+ *        print counter and hands its print to the logger, so the prints appear
+ *        in the order of their counts. The logger only enqueues the print, so
+ *        the threads never hold the mutex while waiting for the terminal.
  * 
  * @param thread_id
  *        Unique identifier of the thread.
@@ -49,13 +62,15 @@ inline void Delay_ms(const uint16_t delay_time_ms) {
  ********************************************************************************/
 void RunThread(const uint16_t thread_id, const uint16_t print_interval_ms) {
     while (1) {
-        mutex.lock();
-        std::cout << "--------------------------------------------------------------------------------\n";
-        std::cout << "Running thread with ID " << thread_id << "!\n";
-        std::cout << "Number of performed prints: " << ++num_prints << "\n";
-        std::cout << "--------------------------------------------------------------------------------\n\n";
-        Delay_ms(10);
-        mutex.unlock();
+        ++num_prints;
+        std::unique_lock<sync_mutex> lock{mutex};
+        async_logger_printf(logger,
+                            "--------------------------------------------------------------------------------\n"
+                            "Running thread with ID %hu!\n"
+                            "Number of performed prints: %" PRIu64 "\n"
+                            "--------------------------------------------------------------------------------\n\n",
+                            thread_id, num_prints.read());
+        lock.unlock();
         Delay_ms(print_interval_ms);
     }
 }
@@ -64,13 +79,18 @@ void RunThread(const uint16_t thread_id, const uint16_t print_interval_ms) {
 /********************************************************************************
  * @brief Creates and runs two threads with different parameters.
  * 
- * @note  When creating threads, specify the starting routine and it's input
- *        arguments. Synchronize the threads by calling the join function.
+ * @note  The threads are workers of a thread pool, which runs each submitted
+ *        task on a worker of its own. The pool gets one worker per task,
+ *        since the tasks never return. Waiting for the pool to become idle
+ *        corresponds to joining the threads.
  ********************************************************************************/
 int main(void) {
-    std::thread t1{RunThread, 1, 1000};
-    std::thread t2{RunThread, 2, 1000};
-    t1.join();
-    t2.join();
+    logger = async_logger_new(nullptr);
+    if (!logger) return 1;
+    thread_pool<> pool{2};
+    pool.submit([]() { RunThread(1, 1000); });
+    pool.submit([]() { RunThread(2, 1000); });
+    pool.wait_idle();
+    async_logger_delete(&logger);
     return 0;
 }
\ No newline at end of file
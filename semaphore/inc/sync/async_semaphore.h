@@ -0,0 +1,312 @@
+/********************************************************************************
+ * @brief Contains a coroutine-aware counting semaphore for usage in C++20.
+ *
+ * @note  Blocking in counting_semaphore::take stalls the whole thread, and
+ *        with it every coroutine an executor runs on that thread. The take
+ *        method of an async counting semaphore instead returns an awaitable:
+ *        if a resource is available, co_await completes immediately, else
+ *        the coroutine is suspended and the thread is free to run other work.
+ *
+ *        Suspended coroutines are linked into an intrusive waiter list. Each
+ *        waiter lives in the awaiter object, i.e. in the frame of the
+ *        suspended coroutine, so waiting allocates nothing and thousands of
+ *        waiters cost no threads. Waiters are pushed onto the list lock-free.
+ *        When release hands a resource to a waiter, it resumes the coroutine
+ *        either inline or on the executor the waiter was given, see take.
+ *        Only one thread at a time hands resources to waiters; a concurrent
+ *        release records the handover and returns immediately. A resource
+ *        may be owed to a waiter that is not pushed yet, in which case the
+ *        handover stays recorded and the waiter completes it once pushed, so
+ *        neither release nor take ever blocks or spins. Waiters are resumed
+ *        in FIFO order.
+ *
+ *        There is no C interface, since C has no coroutines.
+ ********************************************************************************/
+#pragma once
+
+#include <sync/stats.h>
+
+/********************************************************************************
+ * @note The following code is only available in C++.
+ ********************************************************************************/
+#ifdef __cplusplus
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+
+/********************************************************************************
+ * @brief Class for implementing coroutine-aware counting semaphores in C++20.
+ *
+ * @tparam num_resources
+ *         The number of resources of the semaphore.
+ ********************************************************************************/
+template <uint16_t num_resources>
+class async_counting_semaphore {
+    static_assert(num_resources > 0, "The number of resources for a counting semaphore cannot be 0!");
+  public:
+
+    /********************************************************************************
+     * @brief Awaitable returned by take. When awaited, a resource is reserved;
+     *        if none is available, the awaiting coroutine is suspended until
+     *        release hands a resource to it.
+     ********************************************************************************/
+    class [[nodiscard]] awaiter {
+      public:
+
+        /********************************************************************************
+         * @brief Reserves a resource if one is available.
+         *
+         * @return
+         *        True if a resource was reserved, false if the coroutine must
+         *        be suspended. In the latter case the resource is owed to the
+         *        awaiter by the next release.
+         ********************************************************************************/
+        bool await_ready(void) noexcept { return sem_.count_.fetch_sub(1, std::memory_order_acquire) > 0; }
+
+        /********************************************************************************
+         * @brief Suspends the awaiting coroutine by pushing the awaiter onto the
+         *        waiter list, then completes a handover released before the
+         *        push, if any. The coroutine may be resumed by another thread
+         *        before this method returns, so the awaiter isn't accessed after
+         *        the push.
+         *
+         * @param handle
+         *        The handle of the awaiting coroutine.
+         ********************************************************************************/
+        void await_suspend(const std::coroutine_handle<> handle) noexcept {
+            auto& sem{sem_};
+            handle_ = handle;
+            wait_start_ = sync_stats_now();
+            sync_stats_wait_begin(sem.stats_);
+            sem.push(this);
+            sem.hand_over_owed();
+        }
+
+        /********************************************************************************
+         * @brief Records the acquisition of the resource in the statistics.
+         ********************************************************************************/
+        void await_resume(void) noexcept {
+            if (wait_start_) sync_stats_wait_end(sem_.stats_);
+            sync_stats_acquired(sem_.stats_, wait_start_, 0);
+        }
+
+      private:
+        friend class async_counting_semaphore;
+
+        /********************************************************************************
+         * @brief Creates new awaiter.
+         *
+         * @param sem
+         *        Reference to the semaphore.
+         * @param executor
+         *        Reference to the executor to resume on, nullptr resumes inline.
+         * @param post
+         *        Function posting a resumption to the executor.
+         ********************************************************************************/
+        awaiter(async_counting_semaphore& sem, void* executor,
+                void (*post)(void* executor, std::coroutine_handle<> handle)) noexcept
+            : sem_{sem}, executor_{executor}, post_{post} {}
+
+        /********************************************************************************
+         * @brief Resumes the suspended coroutine, on the executor if any.
+         ********************************************************************************/
+        void resume(void) {
+            if (executor_) {
+                post_(executor_, handle_);
+            } else {
+                handle_.resume();
+            }
+        }
+
+        async_counting_semaphore& sem_;                            /* The semaphore. */
+        void* executor_;                                           /* The executor, nullptr for inline. */
+        void (*post_)(void* executor, std::coroutine_handle<> handle); /* Posts to the executor. */
+        std::coroutine_handle<> handle_{};                         /* The suspended coroutine. */
+        uint64_t wait_start_{};                                    /* Start time of the wait. */
+        awaiter* next_{};                                          /* The next waiter of the list. */
+    };
+
+    /********************************************************************************
+     * @brief Creates new async counting semaphore, where all resources are
+     *        available.
+     *
+     * @param name
+     *        The name of the semaphore in the statistics.
+     ********************************************************************************/
+    explicit async_counting_semaphore(const char* name = "async_counting_semaphore")
+        : stats_{sync_stats_new(name)} {}
+
+    /********************************************************************************
+     * @brief Deletes the semaphore and its statistics. No coroutine may be
+     *        suspended on the semaphore.
+     ********************************************************************************/
+    ~async_counting_semaphore(void) { sync_stats_delete(stats_); }
+
+    async_counting_semaphore(const async_counting_semaphore&) = delete;
+    async_counting_semaphore& operator=(const async_counting_semaphore&) = delete;
+
+    /********************************************************************************
+     * @brief Provides an awaitable reserving a resource. A coroutine suspended
+     *        by it is resumed inline by the thread calling release.
+     *
+     * @return
+     *        The awaitable, to be awaited via co_await.
+     ********************************************************************************/
+    awaiter take(void) noexcept { return awaiter{*this, nullptr, nullptr}; }
+
+    /********************************************************************************
+     * @brief Provides an awaitable reserving a resource. A coroutine suspended
+     *        by it is resumed on specified executor, so the thread calling
+     *        release doesn't run it.
+     *
+     * @tparam Executor
+     *         The type of the executor, which must provide a method submit
+     *         accepting a callable, such as thread_pool.
+     * @param executor
+     *        Reference to the executor, which must outlive the wait.
+     * @return
+     *        The awaitable, to be awaited via co_await.
+     ********************************************************************************/
+    template <typename Executor>
+    awaiter take(Executor& executor) noexcept { return awaiter{*this, &executor, &post<Executor>}; }
+
+    /********************************************************************************
+     * @brief Reserves a resource if one is available, without suspending.
+     *
+     * @return
+     *        True if a resource was reserved, else false.
+     ********************************************************************************/
+    bool try_take(void) {
+        auto count{count_.load(std::memory_order_relaxed)};
+        while (count > 0) {
+            if (count_.compare_exchange_weak(count, count - 1, std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                sync_stats_acquired(stats_, 0, 0);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /********************************************************************************
+     * @brief Releases a resource. If a coroutine waits for a resource, the
+     *        resource is handed to the first waiter, which is resumed.
+     *
+     * @note  A negative count means that resources are owed to waiters. The
+     *        releasing thread records the handover, then hands resources to
+     *        waiters unless another thread does, see hand_over_owed. If the
+     *        waiter owed the resource isn't pushed yet, the handover stays
+     *        recorded and we return.
+     ********************************************************************************/
+    void release(void) {
+        sync_stats_released(stats_);
+        if (count_.fetch_add(1, std::memory_order_release) >= 0) return;
+        num_owed_.fetch_add(1, std::memory_order_seq_cst);
+        hand_over_owed();
+    }
+
+    /********************************************************************************
+     * @brief Provides the number of available resources.
+     *
+     * @return
+     *        The number of available resources, 0 while coroutines wait.
+     ********************************************************************************/
+    uint16_t num_available_resources(void) const {
+        const auto count{count_.load(std::memory_order_relaxed)};
+        return count > 0 ? static_cast<uint16_t>(count) : 0;
+    }
+
+  private:
+
+    /********************************************************************************
+     * @brief Posts the resumption of specified coroutine to an executor.
+     *
+     * @tparam Executor
+     *         The type of the executor.
+     * @param executor
+     *        Reference to the executor.
+     * @param handle
+     *        The handle of the coroutine to resume.
+     ********************************************************************************/
+    template <typename Executor>
+    static void post(void* executor, const std::coroutine_handle<> handle) {
+        static_cast<Executor*>(executor)->submit([handle]() { handle.resume(); });
+    }
+
+    /********************************************************************************
+     * @brief Pushes specified awaiter onto the waiter list (lock-free).
+     *
+     * @param waiter
+     *        Reference to the awaiter.
+     ********************************************************************************/
+    void push(awaiter* waiter) noexcept {
+        auto head{waiters_.load(std::memory_order_relaxed)};
+        do {
+            waiter->next_ = head;
+        } while (!waiters_.compare_exchange_weak(head, waiter, std::memory_order_seq_cst, std::memory_order_relaxed));
+    }
+
+    /********************************************************************************
+     * @brief Indicates if a handover is pending, i.e. if a resource is owed and
+     *        a waiter is pushed to receive it.
+     *
+     * @return
+     *        True if a handover is pending, else false.
+     ********************************************************************************/
+    bool has_handover(void) const noexcept {
+        return num_owed_.load(std::memory_order_seq_cst) > 0 &&
+               (ready_.load(std::memory_order_seq_cst) || waiters_.load(std::memory_order_seq_cst));
+    }
+
+    /********************************************************************************
+     * @brief Hands owed resources to pushed waiters, unless another thread does.
+     *
+     * @note  Called after a handover was recorded or a waiter was pushed. We
+     *        try to become the thread handing resources to waiters; if another
+     *        thread already does, that thread performs the handover and we
+     *        return. The handing thread rechecks for handovers after it stepped
+     *        down, so that none recorded or pushed in between is lost.
+     ********************************************************************************/
+    void hand_over_owed(void) noexcept {
+        while (has_handover() && !handing_over_.exchange(true, std::memory_order_acquire)) {
+            hand_over();
+            handing_over_.store(false, std::memory_order_seq_cst);
+        }
+    }
+
+    /********************************************************************************
+     * @brief Hands owed resources to waiters, only called by one thread at a
+     *        time. The pushed waiters are taken at once and reversed into the
+     *        ready list, so that they are resumed in FIFO order. If a resource
+     *        is owed to a waiter that isn't pushed yet, we return, and the
+     *        waiter completes the handover once pushed.
+     ********************************************************************************/
+    void hand_over(void) {
+        while (num_owed_.load(std::memory_order_seq_cst) > 0) {
+            auto waiter{ready_.load(std::memory_order_relaxed)};
+            if (!waiter) {
+                auto pushed{waiters_.exchange(nullptr, std::memory_order_seq_cst)};
+                while (pushed) {
+                    auto next{pushed->next_};
+                    pushed->next_ = waiter;
+                    waiter = pushed;
+                    pushed = next;
+                }
+                if (!waiter) return;
+            }
+            ready_.store(waiter->next_, std::memory_order_seq_cst);
+            num_owed_.fetch_sub(1, std::memory_order_seq_cst);
+            waiter->resume();
+        }
+    }
+
+    std::atomic<int32_t> count_{num_resources};  /* Available resources, negative while owed to waiters. */
+    std::atomic<awaiter*> waiters_{};            /* Pushed waiters, newest first. */
+    std::atomic<awaiter*> ready_{};              /* Waiters taken from the list, oldest first. */
+    std::atomic<uint32_t> num_owed_{};           /* Resources released but not handed over yet. */
+    std::atomic<bool> handing_over_{};           /* Set while a thread hands resources over. */
+    sync_stats* stats_;                          /* Statistics, nullptr if disabled. */
+};
+
+#endif /* ifdef __cplusplus */
@@ -0,0 +1,59 @@
+/********************************************************************************
+ * @brief Spin-wait helpers shared by the synchronization primitives in C and
+ *        C++. Spinning threads use exponential backoff so that they neither
+ *        hammer the contended cache line nor starve the thread they wait for.
+ ********************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <sched.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif /* defined(__x86_64__) || defined(__i386__) */
+
+/********************************************************************************
+ * @brief Parameters for spin-wait backoff.
+ *
+ * @param BACKOFF_SPIN_LIMIT_DEFAULT
+ *        The default number of spin iterations before a waiting thread is
+ *        parked in the kernel (100).
+ * @param BACKOFF_PAUSE_LIMIT_LOG2
+ *        Logarithm of the maximum number of pause instructions executed per
+ *        spin iteration (2^6 = 64). When this limit is reached the waiting
+ *        thread also yields the processor on each iteration.
+ ********************************************************************************/
+#define BACKOFF_SPIN_LIMIT_DEFAULT (uint16_t)(100)
+#define BACKOFF_PAUSE_LIMIT_LOG2   (uint16_t)(6)
+
+/********************************************************************************
+ * @brief Hints the processor that the calling thread is busy-waiting, which
+ *        saves power and frees pipeline resources for a sibling hyper-thread.
+ ********************************************************************************/
+static inline void backoff_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/********************************************************************************
+ * @brief Performs one spin iteration with exponential backoff. The number of
+ *        pause instructions doubles for each iteration until the limit is
+ *        reached, after which the processor is also yielded to other threads.
+ *
+ * @param iteration
+ *        The number of spin iterations performed so far, starting from 0.
+ ********************************************************************************/
+static inline void backoff_pause(const uint16_t iteration) {
+    const uint16_t log2 = iteration < BACKOFF_PAUSE_LIMIT_LOG2 ? iteration : BACKOFF_PAUSE_LIMIT_LOG2;
+    for (uint16_t i = 0; i < (uint16_t)(1U << log2); ++i) {
+        backoff_cpu_relax();
+    }
+    if (iteration >= BACKOFF_PAUSE_LIMIT_LOG2) {
+        sched_yield();
+    }
+}
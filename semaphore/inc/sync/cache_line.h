@@ -0,0 +1,29 @@
+/********************************************************************************
+ * @brief Cache line parameters used to keep independently accessed data of
+ *        the synchronization primitives on separate cache lines, so that a
+ *        write to one of them doesn't invalidate the cache line of the others
+ *        (false sharing).
+ ********************************************************************************/
+#pragma once
+
+/********************************************************************************
+ * @brief The size of a cache line in bytes (64). Can be overridden at compile
+ *        time.
+ *
+ * @note  C has no equivalent to std::hardware_destructive_interference_size,
+ *        and the C++ constant may differ between compilers and flags, which
+ *        would break the layout of structures shared between C and C++.
+ *        Therefore a fixed value is used, matching x86-64 and most ARM cores.
+ ********************************************************************************/
+#ifndef SYNC_CACHE_LINE_SIZE
+#define SYNC_CACHE_LINE_SIZE 64
+#endif /* SYNC_CACHE_LINE_SIZE */
+
+/********************************************************************************
+ * @brief Aligns a structure member or variable to the start of a cache line.
+ ********************************************************************************/
+#ifdef __cplusplus
+#define SYNC_CACHE_ALIGNED alignas(SYNC_CACHE_LINE_SIZE)
+#else
+#define SYNC_CACHE_ALIGNED _Alignas(SYNC_CACHE_LINE_SIZE)
+#endif /* __cplusplus */
@@ -0,0 +1,321 @@
+/********************************************************************************
+ * @brief Contains a NUMA-aware cohort mutex for usage in C and C++. Separate
+ *        interfaces are implemented for C and C++.
+ *
+ * @note  On multi-socket systems, a flat lock word bounces between the
+ *        sockets on every handover, which costs a remote memory access each
+ *        time. A cohort mutex consists of a global lock plus one local lock
+ *        per NUMA node, each on a cache line of its own. A thread first locks
+ *        the local lock of its node and then the global lock. When unlocking,
+ *        the owner checks whether another thread of its node is waiting. If
+ *        so, it only unlocks the local lock and passes the global lock on to
+ *        that thread, so that ownership stays on the node without touching
+ *        the global lock.
+ *
+ *        To keep threads of other nodes from being starved, the global lock
+ *        is passed on locally at most the handoff limit times in a row, then
+ *        it is unlocked. Both the global and the local locks are three-state
+ *        futex locks, see sync/mutex.h. The number of nodes and the node of
+ *        each thread are detected at runtime, see sync/numa.h. On a system
+ *        with a single node, the cohort mutex behaves like a plain mutex
+ *        with an extra local lock.
+ ********************************************************************************/
+#pragma once
+
+#include <sync/cache_line.h>
+#include <sync/mutex.h>
+#include <sync/numa.h>
+#include <sync/stats.h>
+
+/********************************************************************************
+ * @brief The default number of times in a row the global lock of a cohort
+ *        mutex is passed on within a node before it is unlocked (64).
+ ********************************************************************************/
+#ifndef COHORT_MUTEX_HANDOFF_LIMIT
+#define COHORT_MUTEX_HANDOFF_LIMIT (uint16_t)(64)
+#endif /* COHORT_MUTEX_HANDOFF_LIMIT */
+
+/********************************************************************************
+ * @note The following code is only available in C.
+ ********************************************************************************/
+#ifndef __cplusplus
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/********************************************************************************
+ * @brief Predeclaration of cohort mutex. This structure is hidden in the
+ *        corresponding source file to make the lock words private.
+ ********************************************************************************/
+struct cohort_mutex;
+
+/********************************************************************************
+ * @brief Creates a new cohort mutex, initially unlocked, with one local lock
+ *        per detected NUMA node.
+ *
+ * @param name
+ *        The name of the mutex in the statistics, nullptr selects
+ *        "cohort_mutex".
+ * @param handoff_limit
+ *        The number of times in a row the global lock is passed on within a
+ *        node, 0 selects COHORT_MUTEX_HANDOFF_LIMIT.
+ * @return
+ *        A reference to the mutex, nullptr if the memory allocation failed.
+ ********************************************************************************/
+struct cohort_mutex* cohort_mutex_new(const char* name, const uint16_t handoff_limit);
+
+/********************************************************************************
+ * @brief Deletes cohort mutex by freeing allocated memory. The mutex pointer
+ *        is set to null after deallocation.
+ *
+ * @param self
+ *        Double pointer to the mutex.
+ ********************************************************************************/
+void cohort_mutex_delete(struct cohort_mutex** self);
+
+/********************************************************************************
+ * @brief Locks referenced cohort mutex. The calling thread will be
+ *        temporarily blocked until the mutex is unlocked or passed on to it.
+ *
+ * @param self
+ *        Reference to the mutex.
+ ********************************************************************************/
+void cohort_mutex_lock(struct cohort_mutex* self);
+
+/********************************************************************************
+ * @brief Locks referenced cohort mutex if it is unlocked, without blocking.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        True if the mutex was locked, false if it was already locked.
+ ********************************************************************************/
+bool cohort_mutex_try_lock(struct cohort_mutex* self);
+
+/********************************************************************************
+ * @brief Unlocks referenced cohort mutex, which must be owned by the calling
+ *        thread. If another thread of the same node waits, the mutex is
+ *        passed on to it, unless the handoff limit is reached.
+ *
+ * @param self
+ *        Reference to the mutex.
+ ********************************************************************************/
+void cohort_mutex_unlock(struct cohort_mutex* self);
+
+/********************************************************************************
+ * @brief Provides a snapshot of the statistics of referenced cohort mutex.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @param snapshot
+ *        Reference to the snapshot to fill.
+ * @return
+ *        True if the snapshot was filled, false if no statistics are available.
+ ********************************************************************************/
+bool cohort_mutex_stats(const struct cohort_mutex* self, struct sync_stats_snapshot* snapshot);
+
+/********************************************************************************
+ * @note The following code is only available in C++.
+ ********************************************************************************/
+#else
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/********************************************************************************
+ * @brief Class for implementing cohort mutexes in C++. The class meets the
+ *        Lockable requirements, so it can be used with std::lock_guard,
+ *        std::unique_lock and std::scoped_lock.
+ ********************************************************************************/
+class cohort_mutex {
+  public:
+
+    /********************************************************************************
+     * @brief Creates new cohort mutex, initially unlocked, with one local lock
+     *        per detected NUMA node.
+     *
+     * @param name
+     *        The name of the mutex in the statistics.
+     * @param handoff_limit
+     *        The number of times in a row the global lock is passed on within
+     *        a node (default = COHORT_MUTEX_HANDOFF_LIMIT).
+     ********************************************************************************/
+    explicit cohort_mutex(const char* name = "cohort_mutex",
+                          const uint16_t handoff_limit = COHORT_MUTEX_HANDOFF_LIMIT)
+        : num_nodes_{sync_numa_num_nodes()}, handoff_limit_{handoff_limit},
+          nodes_{new node[num_nodes_]}, stats_{sync_stats_new(name)} { sync_lockdep_register(this, name); }
+
+    /********************************************************************************
+     * @brief Deletes the mutex and its statistics.
+     ********************************************************************************/
+    ~cohort_mutex(void) {
+        sync_lockdep_forget(this);
+        sync_stats_delete(stats_);
+    }
+
+    cohort_mutex(const cohort_mutex&) = delete;
+    cohort_mutex& operator=(const cohort_mutex&) = delete;
+
+    /********************************************************************************
+     * @brief Locks the mutex. The calling thread will be temporarily blocked
+     *        until the mutex is unlocked or passed on to it.
+     *
+     * @note  Waiting threads of the node are registered before they lock the
+     *        local lock, so that the owner can tell whether to pass the global
+     *        lock on. A thread that finds the global lock passed on to its
+     *        node owns the mutex without touching the global lock.
+     ********************************************************************************/
+    void lock(void) {
+        sync_lockdep_acquire(this, true);
+        auto& local{nodes_[sync_numa_current_node() % num_nodes_]};
+        uint64_t wait_start{};
+        uint16_t spins{};
+        local.num_waiting.fetch_add(1, std::memory_order_relaxed);
+        lock_word(local.state, wait_start, spins);
+        local.num_waiting.fetch_sub(1, std::memory_order_relaxed);
+        if (local.global_passed) {
+            local.global_passed = false;
+        } else {
+            lock_word(global_, wait_start, spins);
+        }
+        owner_node_ = &local;
+        if (wait_start) sync_stats_wait_end(stats_);
+        sync_stats_acquired(stats_, wait_start, spins);
+    }
+
+    /********************************************************************************
+     * @brief Locks the mutex if it is unlocked, without blocking.
+     *
+     * @return
+     *        True if the mutex was locked, false if it was already locked.
+     ********************************************************************************/
+    bool try_lock(void) {
+        auto& local{nodes_[sync_numa_current_node() % num_nodes_]};
+        if (!try_lock_word(local.state)) return false;
+        if (local.global_passed) {
+            local.global_passed = false;
+        } else if (!try_lock_word(global_)) {
+            unlock_word(local.state);
+            return false;
+        }
+        owner_node_ = &local;
+        sync_stats_acquired(stats_, 0, 0);
+        sync_lockdep_acquire(this, false);
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Unlocks the mutex, which must be owned by the calling thread. If
+     *        another thread of the same node waits, the mutex is passed on to
+     *        it, unless the handoff limit is reached.
+     ********************************************************************************/
+    void unlock(void) {
+        auto& local{*owner_node_};
+        sync_stats_released(stats_);
+        sync_lockdep_release(this);
+        if (local.num_waiting.load(std::memory_order_relaxed) > 0 && local.num_handoffs < handoff_limit_) {
+            local.num_handoffs++;
+            local.global_passed = true;
+        } else {
+            local.num_handoffs = 0;
+            unlock_word(global_);
+        }
+        unlock_word(local.state);
+    }
+
+    /********************************************************************************
+     * @brief Provides a snapshot of the statistics of the mutex.
+     *
+     * @param snapshot
+     *        Reference to the snapshot to fill.
+     * @return
+     *        True if the snapshot was filled, false if no statistics are available.
+     ********************************************************************************/
+    bool stats(sync_stats_snapshot& snapshot) const { return sync_stats_read(stats_, &snapshot); }
+
+  private:
+
+    /********************************************************************************
+     * @brief Local lock of a node, placed on a cache line of its own. Apart
+     *        from the waiter count, the members are only accessed by the
+     *        thread holding the local lock.
+     ********************************************************************************/
+    struct SYNC_CACHE_ALIGNED node {
+        std::atomic<uint32_t> state{SYNC_MUTEX_UNLOCKED}; /* The futex word of the local lock. */
+        std::atomic<uint32_t> num_waiting{};               /* Threads of the node waiting for the mutex. */
+        bool global_passed{};                              /* Indicates if the global lock was passed on. */
+        uint16_t num_handoffs{};                           /* Local handoffs in a row. */
+    };
+
+    /********************************************************************************
+     * @brief Locks specified three-state futex word, see sync_mutex.
+     *
+     * @param word
+     *        Reference to the futex word.
+     * @param wait_start
+     *        Reference to the start time of the wait, 0 until the thread waits.
+     * @param spins
+     *        Reference to the number of spin iterations performed so far.
+     ********************************************************************************/
+    void lock_word(std::atomic<uint32_t>& word, uint64_t& wait_start, uint16_t& spins) {
+        auto state{SYNC_MUTEX_UNLOCKED};
+        if (word.compare_exchange_strong(state, SYNC_MUTEX_LOCKED, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+            return;
+        }
+        if (!wait_start) {
+            wait_start = sync_stats_now();
+            sync_stats_wait_begin(stats_);
+        }
+        for (uint16_t i{}; state != SYNC_MUTEX_CONTENDED && i < SYNC_MUTEX_SPIN_LIMIT; ++i) {
+            backoff_pause(i);
+            if (spins < UINT16_MAX) spins++;
+            state = SYNC_MUTEX_UNLOCKED;
+            if (word.compare_exchange_weak(state, SYNC_MUTEX_LOCKED, std::memory_order_acquire,
+                                           std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        while (word.exchange(SYNC_MUTEX_CONTENDED, std::memory_order_acquire) != SYNC_MUTEX_UNLOCKED) {
+            word.wait(SYNC_MUTEX_CONTENDED, std::memory_order_relaxed);
+        }
+    }
+
+    /********************************************************************************
+     * @brief Locks specified three-state futex word if it is unlocked.
+     *
+     * @param word
+     *        Reference to the futex word.
+     * @return
+     *        True if the word was locked, else false.
+     ********************************************************************************/
+    static bool try_lock_word(std::atomic<uint32_t>& word) {
+        auto state{SYNC_MUTEX_UNLOCKED};
+        return word.compare_exchange_strong(state, SYNC_MUTEX_LOCKED, std::memory_order_acquire,
+                                            std::memory_order_relaxed);
+    }
+
+    /********************************************************************************
+     * @brief Unlocks specified three-state futex word and wakes a parked thread
+     *        if the word was marked as contended.
+     *
+     * @param word
+     *        Reference to the futex word.
+     ********************************************************************************/
+    static void unlock_word(std::atomic<uint32_t>& word) {
+        if (word.exchange(SYNC_MUTEX_UNLOCKED, std::memory_order_release) == SYNC_MUTEX_CONTENDED) {
+            word.notify_one();
+        }
+    }
+
+    const uint16_t num_nodes_;                                       /* The number of local locks. */
+    const uint16_t handoff_limit_;                                   /* Local handoffs before unlocking. */
+    std::unique_ptr<node[]> nodes_;                                  /* The local locks. */
+    sync_stats* stats_;                                              /* Statistics, nullptr if disabled. */
+    node* owner_node_{};                                             /* Local lock of the owner. */
+    SYNC_CACHE_ALIGNED std::atomic<uint32_t> global_{SYNC_MUTEX_UNLOCKED}; /* The global lock word. */
+};
+
+#endif /* ifndef __cplusplus */
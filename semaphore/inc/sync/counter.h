@@ -0,0 +1,205 @@
+/********************************************************************************
+ * @brief Contains sharded event counters for usage in C and C++. Separate
+ *        interfaces are implemented: in C the counter is 64 bits wide, while
+ *        in C++ the counter is a class template over the counter type.
+ *
+ * @note  A counter incremented by many threads under a lock, or even via a
+ *        single atomic variable, makes every increment move the cache line of
+ *        the counter between the cores, so that the throughput decreases with
+ *        the number of threads. A sharded counter instead consists of slots
+ *        placed on cache lines of their own. Each thread increments the slot
+ *        it was assigned to with relaxed ordering, and a read sums all slots.
+ *
+ *        Increments are therefore cheap and scale over cores, while a read
+ *        costs one load per slot. A read is a snapshot: increments made during
+ *        the read may or may not be included. The counter is suited for
+ *        statistics such as the number of prints or requests, not for values
+ *        that control synchronization.
+ ********************************************************************************/
+#pragma once
+
+#include <sync/cache_line.h>
+
+/********************************************************************************
+ * @brief The default number of slots of a sharded counter (16). Threads are
+ *        assigned to slots round robin, so up to this number of threads never
+ *        share a slot.
+ ********************************************************************************/
+#define SHARDED_COUNTER_NUM_SLOTS (uint16_t)(16)
+
+/********************************************************************************
+ * @note The following code is only available in C.
+ ********************************************************************************/
+#ifndef __cplusplus
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/********************************************************************************
+ * @brief Predeclaration of sharded counter. This structure is hidden in the
+ *        corresponding source file to make the slots private.
+ ********************************************************************************/
+struct sharded_counter;
+
+/********************************************************************************
+ * @brief Creates a new dynamically allocated sharded counter, initialized to
+ *        zero.
+ *
+ * @param num_slots
+ *        The number of slots, 0 selects SHARDED_COUNTER_NUM_SLOTS.
+ * @return
+ *        A reference to the counter, nullptr if the memory allocation failed.
+ ********************************************************************************/
+struct sharded_counter* sharded_counter_new(const uint16_t num_slots);
+
+/********************************************************************************
+ * @brief Deletes sharded counter by freeing allocated memory. The counter
+ *        pointer is set to null after deallocation.
+ *
+ * @param self
+ *        Double pointer to the counter.
+ ********************************************************************************/
+void sharded_counter_delete(struct sharded_counter** self);
+
+/********************************************************************************
+ * @brief Adds specified value to the slot of the calling thread.
+ *
+ * @param self
+ *        Reference to the counter.
+ * @param value
+ *        The value to add.
+ ********************************************************************************/
+void sharded_counter_add(struct sharded_counter* self, const uint64_t value);
+
+/********************************************************************************
+ * @brief Increments the slot of the calling thread by one.
+ *
+ * @param self
+ *        Reference to the counter.
+ ********************************************************************************/
+void sharded_counter_increment(struct sharded_counter* self);
+
+/********************************************************************************
+ * @brief Provides the value of referenced counter, i.e. the sum of all slots.
+ *
+ * @param self
+ *        Reference to the counter.
+ * @return
+ *        The value of the counter.
+ ********************************************************************************/
+uint64_t sharded_counter_read(const struct sharded_counter* self);
+
+/********************************************************************************
+ * @brief Resets referenced counter to zero. Increments made during the reset
+ *        may be lost, so the counter should be reset while it isn't used.
+ *
+ * @param self
+ *        Reference to the counter.
+ ********************************************************************************/
+void sharded_counter_reset(struct sharded_counter* self);
+
+/********************************************************************************
+ * @note The following code is only available in C++.
+ ********************************************************************************/
+#else
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+/********************************************************************************
+ * @brief Class for implementing sharded counters in C++.
+ *
+ * @tparam T
+ *         The type of the counter, must be an unsigned integer type
+ *         (default = uint64_t).
+ * @tparam num_slots
+ *         The number of slots (default = SHARDED_COUNTER_NUM_SLOTS).
+ ********************************************************************************/
+template <typename T = uint64_t, uint16_t num_slots = SHARDED_COUNTER_NUM_SLOTS>
+class sharded_counter {
+    static_assert(std::is_integral_v<T> && std::is_unsigned_v<T>,
+                  "The type of a sharded counter must be an unsigned integer type!");
+    static_assert(num_slots > 0, "A sharded counter must have at least one slot!");
+  public:
+
+    /********************************************************************************
+     * @brief Creates new counter initialized to zero.
+     ********************************************************************************/
+    sharded_counter(void) = default;
+
+    sharded_counter(const sharded_counter&) = delete;
+    sharded_counter& operator=(const sharded_counter&) = delete;
+
+    /********************************************************************************
+     * @brief Adds specified value to the slot of the calling thread.
+     *
+     * @param value
+     *        The value to add (default = 1).
+     ********************************************************************************/
+    void add(const T value = 1) {
+        slot_of_thread().value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /********************************************************************************
+     * @brief Increments the slot of the calling thread by one.
+     *
+     * @return
+     *        Reference to the counter.
+     ********************************************************************************/
+    sharded_counter& operator++(void) {
+        add();
+        return *this;
+    }
+
+    /********************************************************************************
+     * @brief Provides the value of the counter, i.e. the sum of all slots.
+     *
+     * @return
+     *        The value of the counter.
+     ********************************************************************************/
+    T read(void) const {
+        T sum{};
+        for (const auto& slot : slots_) {
+            sum += slot.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    /********************************************************************************
+     * @brief Resets the counter to zero. Increments made during the reset may
+     *        be lost, so the counter should be reset while it isn't used.
+     ********************************************************************************/
+    void reset(void) {
+        for (auto& slot : slots_) {
+            slot.value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+  private:
+
+    /********************************************************************************
+     * @brief Slot of the counter, placed on a cache line of its own.
+     ********************************************************************************/
+    struct SYNC_CACHE_ALIGNED slot {
+        std::atomic<T> value{}; /* The increments of the threads assigned to the slot. */
+    };
+
+    /********************************************************************************
+     * @brief Provides the slot of the calling thread. Threads are assigned to
+     *        slots round robin on first use.
+     *
+     * @return
+     *        Reference to the slot of the calling thread.
+     ********************************************************************************/
+    slot& slot_of_thread(void) {
+        static std::atomic<uint32_t> num_threads{};
+        static thread_local const uint32_t index{num_threads.fetch_add(1, std::memory_order_relaxed) % num_slots};
+        return slots_[index];
+    }
+
+    slot slots_[num_slots]{}; /* The slots of the counter. */
+};
+
+#endif /* ifndef __cplusplus */
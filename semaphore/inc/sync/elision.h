@@ -0,0 +1,130 @@
+/********************************************************************************
+ * @brief Optional lock elision via hardware transactional memory (Intel TSX,
+ *        RTM) for the mutexes and binary semaphores in C and C++.
+ *
+ * @note  The elision is compiled in when SYNC_ELISION is defined, for instance
+ *        via the CMake option SYNC_ENABLE_ELISION, and is only used if the
+ *        processor supports RTM, which is detected at runtime via CPUID.
+ *        Otherwise all helpers are constant inline functions, which the
+ *        compiler removes entirely.
+ *
+ *        An elided acquisition starts a transaction and only reads the lock
+ *        word instead of writing it, so threads whose critical sections don't
+ *        access the same data run them at the same time. If they do conflict,
+ *        or the lock is held for real, the transaction is aborted, all of its
+ *        writes are discarded and the thread retries. After
+ *        SYNC_ELISION_MAX_ABORTS aborts, the thread acquires the lock normally.
+ *        Critical sections containing system calls, such as prints, abort in
+ *        any case, so elision only pays off for short critical sections.
+ ********************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************************************************
+ * @brief Parameters for lock elision. The number of aborts can be overridden
+ *        at compile time.
+ *
+ * @param SYNC_ELISION_ENABLED
+ *        Indicates if the elision is compiled in (1) or not (0). It requires
+ *        an x86 processor.
+ * @param SYNC_ELISION_MAX_ABORTS
+ *        The number of aborted transactions after which an acquisition falls
+ *        back to the normal lock (3 by default), 0 disables the elision.
+ * @param SYNC_ELISION_STARTED
+ *        Status of a started transaction.
+ * @param SYNC_ELISION_ABORT_BUSY
+ *        Abort code of a transaction that found the lock held for real.
+ ********************************************************************************/
+#if defined(SYNC_ELISION) && (defined(__x86_64__) || defined(__i386__))
+#define SYNC_ELISION_ENABLED 1
+#include <immintrin.h>
+#else
+#define SYNC_ELISION_ENABLED 0
+#endif /* defined(SYNC_ELISION) && (defined(__x86_64__) || defined(__i386__)) */
+
+#ifndef SYNC_ELISION_MAX_ABORTS
+#define SYNC_ELISION_MAX_ABORTS (uint16_t)(3)
+#endif /* SYNC_ELISION_MAX_ABORTS */
+
+#define SYNC_ELISION_STARTED    (~0U)
+#define SYNC_ELISION_ABORT_BUSY 0xff
+
+#if SYNC_ELISION_ENABLED
+
+/********************************************************************************
+ * @brief Indicates if the processor supports RTM. The CPUID result is read
+ *        once at program start, so the check is a single load.
+ *
+ * @return
+ *        True if transactions can be started, else false.
+ ********************************************************************************/
+static inline bool sync_elision_supported(void) {
+    return SYNC_ELISION_MAX_ABORTS > 0 && __builtin_cpu_supports("rtm");
+}
+
+/********************************************************************************
+ * @brief Starts a transaction. If the transaction is aborted, execution
+ *        continues here with the abort status, all of its writes discarded.
+ *
+ * @return
+ *        SYNC_ELISION_STARTED if the calling thread runs transactionally, else
+ *        the status of the aborted transaction.
+ ********************************************************************************/
+__attribute__((target("rtm"))) static inline unsigned sync_elision_begin(void) {
+    return _xbegin();
+}
+
+/********************************************************************************
+ * @brief Commits the transaction of the calling thread.
+ ********************************************************************************/
+__attribute__((target("rtm"))) static inline void sync_elision_end(void) {
+    _xend();
+}
+
+/********************************************************************************
+ * @brief Aborts the transaction of the calling thread, since the lock it
+ *        elides is held for real.
+ ********************************************************************************/
+__attribute__((target("rtm"))) static inline void sync_elision_abort_busy(void) {
+    _xabort(SYNC_ELISION_ABORT_BUSY);
+}
+
+/********************************************************************************
+ * @brief Indicates if the calling thread runs transactionally, i.e. within an
+ *        elided critical section.
+ *
+ * @return
+ *        True if the calling thread runs transactionally, else false.
+ ********************************************************************************/
+__attribute__((target("rtm"))) static inline bool sync_elision_active(void) {
+    return sync_elision_supported() && _xtest();
+}
+
+/********************************************************************************
+ * @brief Indicates if a transaction aborted with specified status may succeed
+ *        when retried. A transaction that found the lock held is retried
+ *        after the caller has backed off, one that exceeded the capacity of
+ *        the processor or executed an unsupported instruction is not.
+ *
+ * @param status
+ *        The status of the aborted transaction.
+ * @return
+ *        True if the transaction should be retried, else false.
+ ********************************************************************************/
+static inline bool sync_elision_retry(const unsigned status) {
+    if ((status & _XABORT_EXPLICIT) && _XABORT_CODE(status) == SYNC_ELISION_ABORT_BUSY) return true;
+    return (status & (_XABORT_RETRY | _XABORT_CONFLICT)) != 0;
+}
+
+#else
+
+static inline bool sync_elision_supported(void) { return false; }
+static inline unsigned sync_elision_begin(void) { return 0; }
+static inline void sync_elision_end(void) {}
+static inline void sync_elision_abort_busy(void) {}
+static inline bool sync_elision_active(void) { return false; }
+static inline bool sync_elision_retry(const unsigned status) { (void)status; return false; }
+
+#endif /* SYNC_ELISION_ENABLED */
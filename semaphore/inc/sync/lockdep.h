@@ -0,0 +1,123 @@
+/********************************************************************************
+ * @brief Opt-in lock-order checker for the synchronization primitives, usable
+ *        from C and C++.
+ *
+ * @note  The checker is compiled in when SYNC_LOCKDEP is defined, for instance
+ *        via the CMake option SYNC_ENABLE_LOCKDEP. Otherwise all recording
+ *        functions are empty inline functions, which the compiler removes
+ *        entirely, so release builds carry no overhead.
+ *
+ *        Each thread records the primitives it holds. When a thread blocks on
+ *        another primitive, an edge from each held primitive to the new one
+ *        is added to a global lock-order graph, together with the stack trace
+ *        of the acquisition. If a new edge closes a cycle, i.e. the primitives
+ *        have been acquired in the opposite order before, possibly by another
+ *        thread, the cycle is written to stderr with the stack trace of each
+ *        of its edges. Such an inversion can deadlock even if it didn't, so
+ *        it is reported as soon as both orders have been seen once.
+ *
+ *        Reservations that never block (try_take, try_lock) are recorded as
+ *        held but add no edges, since they cannot deadlock. A primitive that
+ *        is released by another thread than the one reserving it, such as a
+ *        semaphore used for signaling, counts as held by the reserving thread
+ *        until that thread has acquired SYNC_LOCKDEP_MAX_HELD other ones.
+ ********************************************************************************/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************************************************
+ * @brief Parameters for the lock-order checker.
+ *
+ * @param SYNC_LOCKDEP_ENABLED
+ *        Indicates if the checker is compiled in (1) or not (0).
+ * @param SYNC_LOCKDEP_MAX_HELD
+ *        The maximum number of primitives per thread that are tracked as held
+ *        at the same time (16). If a thread holds more primitives, the oldest
+ *        acquisition is no longer tracked.
+ * @param SYNC_LOCKDEP_STACK_DEPTH
+ *        The maximum number of frames of a recorded stack trace (16).
+ * @param SYNC_LOCKDEP_NAME_SIZE
+ *        The maximum length of a primitive name, including the terminator.
+ ********************************************************************************/
+#ifdef SYNC_LOCKDEP
+#define SYNC_LOCKDEP_ENABLED     1
+#else
+#define SYNC_LOCKDEP_ENABLED     0
+#endif /* SYNC_LOCKDEP */
+
+#define SYNC_LOCKDEP_MAX_HELD    16
+#define SYNC_LOCKDEP_STACK_DEPTH 16
+#define SYNC_LOCKDEP_NAME_SIZE   32
+
+/********************************************************************************
+ * @brief Provides the number of lock-order inversions reported so far.
+ *
+ * @return
+ *        The number of inversions, always 0 if the checker is disabled.
+ ********************************************************************************/
+uint32_t sync_lockdep_num_inversions(void);
+
+#ifdef SYNC_LOCKDEP
+
+/********************************************************************************
+ * @brief Names a primitive in the reports. A primitive that isn't named is
+ *        reported by its address.
+ *
+ * @param lock
+ *        Reference identifying the primitive.
+ * @param name
+ *        The name of the primitive, truncated to SYNC_LOCKDEP_NAME_SIZE - 1
+ *        characters.
+ ********************************************************************************/
+void sync_lockdep_register(const void* lock, const char* name);
+
+/********************************************************************************
+ * @brief Removes a primitive and all of its edges from the lock-order graph,
+ *        so that an unrelated primitive created at the same address later on
+ *        doesn't inherit them.
+ *
+ * @param lock
+ *        Reference identifying the primitive.
+ ********************************************************************************/
+void sync_lockdep_forget(const void* lock);
+
+/********************************************************************************
+ * @brief Records that the calling thread acquires a primitive. Blocking
+ *        acquisitions are recorded before the thread blocks, so that an
+ *        inversion is reported even if the thread deadlocks.
+ *
+ * @param lock
+ *        Reference identifying the primitive.
+ * @param blocking
+ *        True if the calling thread might block on the primitive, false if
+ *        the primitive has already been acquired without blocking.
+ ********************************************************************************/
+void sync_lockdep_acquire(const void* lock, const bool blocking);
+
+/********************************************************************************
+ * @brief Records that the calling thread releases a primitive. A primitive
+ *        that the calling thread doesn't hold is ignored.
+ *
+ * @param lock
+ *        Reference identifying the primitive.
+ ********************************************************************************/
+void sync_lockdep_release(const void* lock);
+
+#else
+
+static inline void sync_lockdep_register(const void* lock, const char* name) { (void)lock; (void)name; }
+static inline void sync_lockdep_forget(const void* lock) { (void)lock; }
+static inline void sync_lockdep_acquire(const void* lock, const bool blocking) { (void)lock; (void)blocking; }
+static inline void sync_lockdep_release(const void* lock) { (void)lock; }
+
+#endif /* SYNC_LOCKDEP */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
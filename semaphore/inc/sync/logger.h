@@ -0,0 +1,164 @@
+/********************************************************************************
+ * @brief Contains an asynchronous batched logger for usage in C and C++. The
+ *        interface is shared between C and C++.
+ *
+ * @note  Workers format each record into a buffer of the calling thread and
+ *        enqueue it in a lock-free MPMC queue, so logging costs a format and an
+ *        enqueue instead of a locked write system call. A background thread
+ *        drains the queue and writes the records in batches, one writev call
+ *        per batch. Records of the same thread are written in the order they
+ *        were logged.
+ *
+ *        The background thread waits for at most the flush interval between
+ *        batches, and is woken earlier when the queue fills up. When the queue
+ *        is full, the overflow policy decides whether the worker waits for
+ *        free space or the record is dropped.
+ ********************************************************************************/
+#pragma once
+
+/********************************************************************************
+ * @brief The code within the extern "C" directive is compiled as C code if
+ *        if a C++ compiler is used. This code is compatible with C and C++.
+ ********************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/********************************************************************************
+ * @brief Parameters for the asynchronous logger.
+ *
+ * @param ASYNC_LOGGER_RECORD_SIZE
+ *        The maximum size of a record in bytes, including the length header
+ *        (512). Longer records are truncated.
+ * @param ASYNC_LOGGER_BATCH_SIZE
+ *        The maximum number of records written per writev call (64).
+ * @param ASYNC_LOGGER_CAPACITY_DEFAULT
+ *        The default number of records the queue can hold (1024).
+ * @param ASYNC_LOGGER_FLUSH_INTERVAL_DEFAULT
+ *        The default flush interval, measured in milliseconds (10).
+ ********************************************************************************/
+#define ASYNC_LOGGER_RECORD_SIZE            (uint16_t)(512)
+#define ASYNC_LOGGER_BATCH_SIZE             (uint16_t)(64)
+#define ASYNC_LOGGER_CAPACITY_DEFAULT       (uint32_t)(1024)
+#define ASYNC_LOGGER_FLUSH_INTERVAL_DEFAULT (uint16_t)(10)
+
+/********************************************************************************
+ * @brief Policies for records logged while the queue is full.
+ *
+ * @param ASYNC_LOGGER_OVERFLOW_BLOCK
+ *        The worker waits until the background thread has made room.
+ * @param ASYNC_LOGGER_OVERFLOW_DROP
+ *        The record is dropped silently. Drops are still counted.
+ * @param ASYNC_LOGGER_OVERFLOW_COUNT
+ *        The record is dropped and counted, and the background thread writes
+ *        a line with the number of dropped records after the next batch.
+ ********************************************************************************/
+enum async_logger_overflow_policy {
+    ASYNC_LOGGER_OVERFLOW_BLOCK,
+    ASYNC_LOGGER_OVERFLOW_DROP,
+    ASYNC_LOGGER_OVERFLOW_COUNT,
+};
+
+/********************************************************************************
+ * @brief Creation-time options for the asynchronous logger. A zero-initialized
+ *        structure selects the default options.
+ *
+ * @param fd
+ *        The file descriptor the records are written to, 0 selects stdout.
+ * @param capacity
+ *        The number of records the queue can hold, rounded up to a power of
+ *        two. 0 selects ASYNC_LOGGER_CAPACITY_DEFAULT.
+ * @param flush_interval_ms
+ *        The longest time between two batches, measured in milliseconds.
+ *        0 makes every record wake the background thread.
+ * @param overflow_policy
+ *        The policy for records logged while the queue is full.
+ ********************************************************************************/
+struct async_logger_options {
+    int fd;
+    uint32_t capacity;
+    uint16_t flush_interval_ms;
+    enum async_logger_overflow_policy overflow_policy;
+};
+
+/********************************************************************************
+ * @brief Predeclaration of asynchronous logger. This structure is hidden in
+ *        the corresponding source file.
+ ********************************************************************************/
+struct async_logger;
+
+/********************************************************************************
+ * @brief Creates a new asynchronous logger and starts its background thread.
+ *
+ * @param options
+ *        Reference to creation-time options, nullptr selects the defaults
+ *        (stdout, ASYNC_LOGGER_CAPACITY_DEFAULT records, flush interval
+ *        ASYNC_LOGGER_FLUSH_INTERVAL_DEFAULT ms, blocking overflow policy).
+ * @return
+ *        A reference to the logger, nullptr if the memory allocation or the
+ *        creation of the background thread failed.
+ ********************************************************************************/
+struct async_logger* async_logger_new(const struct async_logger_options* options);
+
+/********************************************************************************
+ * @brief Writes all logged records, stops the background thread and deletes
+ *        the logger. The logger pointer is set to null after deallocation.
+ *
+ * @param self
+ *        Double pointer to the logger.
+ ********************************************************************************/
+void async_logger_delete(struct async_logger** self);
+
+/********************************************************************************
+ * @brief Logs a record formatted like printf.
+ *
+ * @param self
+ *        Reference to the logger.
+ * @param format
+ *        The format string, followed by its arguments.
+ * @return
+ *        True if the record was enqueued, false if it was dropped.
+ ********************************************************************************/
+bool async_logger_printf(struct async_logger* self, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/********************************************************************************
+ * @brief Logs specified text as a record.
+ *
+ * @param self
+ *        Reference to the logger.
+ * @param text
+ *        Reference to the text.
+ * @param length
+ *        The length of the text in bytes.
+ * @return
+ *        True if the record was enqueued, false if it was dropped.
+ ********************************************************************************/
+bool async_logger_write(struct async_logger* self, const char* text, const size_t length);
+
+/********************************************************************************
+ * @brief Blocks the calling thread until all records logged so far have been
+ *        written.
+ *
+ * @param self
+ *        Reference to the logger.
+ ********************************************************************************/
+void async_logger_flush(struct async_logger* self);
+
+/********************************************************************************
+ * @brief Provides the number of records dropped due to a full queue.
+ *
+ * @param self
+ *        Reference to the logger.
+ * @return
+ *        The number of dropped records.
+ ********************************************************************************/
+uint64_t async_logger_num_dropped(const struct async_logger* self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
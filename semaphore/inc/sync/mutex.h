@@ -0,0 +1,654 @@
+/********************************************************************************
+ * @brief Contains a lightweight owner-tracking mutex for usage in C and C++,
+ *        built on a futex word with three states (unlocked, locked and
+ *        contended). Separate interfaces are implemented for C and C++.
+ *
+ * @note  An uncontended lock is a single compare-and-swap and an uncontended
+ *        unlock a single exchange, no system call is made unless another
+ *        thread is parked on the mutex. A thread that finds the mutex locked
+ *        spins with exponential backoff for a bounded number of iterations
+ *        before it marks the mutex as contended and is parked in the kernel.
+ *
+ *        The mutex records its owner, so only the thread that locked the
+ *        mutex can unlock it.
+ *
+ *        The shared mutex is a variant placed in memory shared between
+ *        processes, which recovers from owners that die while holding it.
+ *
+ *        A priority-inheritance mutex is meant for real-time threads. It
+ *        never spins; a locking thread that finds it locked is queued in the
+ *        kernel by priority (PI futex), and the owner runs at the priority of
+ *        the highest waiter until it unlocks the mutex. A low-priority owner
+ *        therefore cannot block a high-priority thread for longer than its
+ *        own critical section.
+ *
+ *        If lock elision is compiled in (see sync/elision.h) and supported by
+ *        the processor, the other mutexes first try to run the critical
+ *        section as a hardware transaction without locking the mutex, so 
+ *        that non-conflicting critical sections run at the same time.
+ ********************************************************************************/
+#pragma once
+
+#include <sync/elision.h>
+#include <sync/lockdep.h>
+#include <sync/stats.h>
+
+/********************************************************************************
+ * @brief The code within the extern "C" directive is compiled as C code if
+ *        if a C++ compiler is used. This code is compatible with C and C++.
+ ********************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sync/backoff.h>
+
+/********************************************************************************
+ * @brief States of the futex word of a mutex.
+ *
+ * @param SYNC_MUTEX_UNLOCKED
+ *        The mutex is unlocked.
+ * @param SYNC_MUTEX_LOCKED
+ *        The mutex is locked and no thread is parked on it.
+ * @param SYNC_MUTEX_CONTENDED
+ *        The mutex is locked and threads might be parked on it, so the owner
+ *        must wake a thread when unlocking it.
+ * @param SYNC_MUTEX_SPIN_LIMIT
+ *        The number of spin iterations before a waiting thread is parked.
+ *
+ * @note  The futex word of a priority-inheritance mutex instead holds the
+ *        thread ID of the owner, as required by the kernel.
+ ********************************************************************************/
+#define SYNC_MUTEX_UNLOCKED   (uint32_t)(0)
+#define SYNC_MUTEX_LOCKED     (uint32_t)(1)
+#define SYNC_MUTEX_CONTENDED  (uint32_t)(2)
+#define SYNC_MUTEX_SPIN_LIMIT BACKOFF_SPIN_LIMIT_DEFAULT
+
+/********************************************************************************
+ * @brief Results of locking a shared mutex.
+ *
+ * @param SYNC_MUTEX_ACQUIRED
+ *        The mutex was locked.
+ * @param SYNC_MUTEX_BUSY
+ *        The mutex is locked by a living owner (try_lock only).
+ * @param SYNC_MUTEX_OWNER_DIED
+ *        The mutex was locked, but its previous owner died while holding it,
+ *        so the protected data might be inconsistent. The new owner repairs
+ *        the data and calls sync_shared_mutex_consistent before unlocking,
+ *        else the mutex becomes unrecoverable.
+ * @param SYNC_MUTEX_NOT_RECOVERABLE
+ *        The mutex wasn't locked, since an owner that recovered it unlocked it
+ *        without marking it consistent, or locking it failed otherwise, for
+ *        instance since the calling thread already owns it.
+ ********************************************************************************/
+enum sync_mutex_result {
+    SYNC_MUTEX_ACQUIRED,
+    SYNC_MUTEX_BUSY,
+    SYNC_MUTEX_OWNER_DIED,
+    SYNC_MUTEX_NOT_RECOVERABLE,
+};
+
+/********************************************************************************
+ * @brief Locks specified priority-inheritance futex word via the kernel, after
+ *        the fast path failed. Used by the C++ class sync_pi_mutex, so that it
+ *        shares the error handling of the C mutexes: an interrupted call is
+ *        retried, any other failure aborts.
+ *
+ * @param futex_word
+ *        Reference to the 32-bit atomic futex word, holding the thread ID of
+ *        the owner.
+ ********************************************************************************/
+void sync_pi_futex_lock(void* futex_word);
+
+/********************************************************************************
+ * @brief Unlocks specified priority-inheritance futex word via the kernel,
+ *        after the fast path failed since threads are waiting. Used by the
+ *        C++ class sync_pi_mutex, a failure aborts.
+ *
+ * @param futex_word
+ *        Reference to the 32-bit atomic futex word, holding the thread ID of
+ *        the caller.
+ ********************************************************************************/
+void sync_pi_futex_unlock(void* futex_word);
+
+/********************************************************************************
+ * @brief Predeclaration of shared mutex. A shared mutex lives in memory
+ *        provided by the user, such as a region mapped via shm_open and mmap,
+ *        so that threads of several processes can lock it. Parked threads are
+ *        parked via shared futexes.
+ *
+ * @note  The mutex is built on a robust, process-shared POSIX mutex. The
+ *        kernel keeps the mutexes a thread owns on its robust list and, when
+ *        the thread exits, marks them and wakes a parked thread, which takes
+ *        over the mutex and reports SYNC_MUTEX_OWNER_DIED.
+ ********************************************************************************/
+struct sync_shared_mutex;
+
+/********************************************************************************
+ * @brief Provides the size of a shared mutex.
+ *
+ * @return
+ *        The number of bytes to provide to sync_shared_mutex_init.
+ ********************************************************************************/
+size_t sync_shared_mutex_size(void);
+
+/********************************************************************************
+ * @brief Initializes a shared mutex in specified memory, initially unlocked.
+ *        Only one process initializes the mutex, before any process uses it.
+ *
+ * @param memory
+ *        Reference to the memory, at least sync_shared_mutex_size bytes large
+ *        and aligned to 8 bytes.
+ * @return
+ *        A reference to the mutex, nullptr if the system doesn't support
+ *        robust process-shared mutexes.
+ ********************************************************************************/
+struct sync_shared_mutex* sync_shared_mutex_init(void* memory);
+
+/********************************************************************************
+ * @brief Provides the shared mutex held by specified memory, which was
+ *        initialized via sync_shared_mutex_init, possibly by another process
+ *        and at another address.
+ *
+ * @param memory
+ *        Reference to the initialized memory.
+ * @return
+ *        A reference to the mutex.
+ ********************************************************************************/
+static inline struct sync_shared_mutex* sync_shared_mutex_from_memory(void* memory) {
+    return (struct sync_shared_mutex*)memory;
+}
+
+/********************************************************************************
+ * @brief Locks referenced shared mutex. The calling thread will be temporarily
+ *        blocked until the mutex is unlocked or its owner has died.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        SYNC_MUTEX_ACQUIRED or SYNC_MUTEX_OWNER_DIED if the mutex was locked,
+ *        SYNC_MUTEX_NOT_RECOVERABLE if it can no longer be locked.
+ ********************************************************************************/
+enum sync_mutex_result sync_shared_mutex_lock(struct sync_shared_mutex* self);
+
+/********************************************************************************
+ * @brief Locks referenced shared mutex if it is unlocked or its owner has
+ *        died, without blocking.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        SYNC_MUTEX_ACQUIRED or SYNC_MUTEX_OWNER_DIED if the mutex was locked,
+ *        SYNC_MUTEX_BUSY if a living thread owns it and
+ *        SYNC_MUTEX_NOT_RECOVERABLE if it can no longer be locked.
+ ********************************************************************************/
+enum sync_mutex_result sync_shared_mutex_try_lock(struct sync_shared_mutex* self);
+
+/********************************************************************************
+ * @brief Marks referenced shared mutex as consistent after it was recovered
+ *        from a dead owner via SYNC_MUTEX_OWNER_DIED.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        True if the mutex was marked consistent, false if the calling thread
+ *        didn't recover the mutex or marked it consistent already.
+ ********************************************************************************/
+bool sync_shared_mutex_consistent(struct sync_shared_mutex* self);
+
+/********************************************************************************
+ * @brief Unlocks referenced shared mutex. If threads are parked on the mutex,
+ *        one of them is woken. If the mutex was recovered from a dead owner
+ *        and not marked consistent, it becomes unrecoverable and all parked
+ *        threads return SYNC_MUTEX_NOT_RECOVERABLE shortly after.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        True if the mutex was unlocked, false if the calling thread doesn't
+ *        own the mutex.
+ ********************************************************************************/
+bool sync_shared_mutex_unlock(struct sync_shared_mutex* self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+ /********************************************************************************
+ * @note The following code is only available in C.
+ ********************************************************************************/
+#ifndef __cplusplus
+
+#include <stdlib.h>
+
+/********************************************************************************
+ * @brief Predeclaration of mutex. This structure is hidden in the
+ *        corresponding source file to make the futex word and the owner private.
+ ********************************************************************************/
+struct sync_mutex;
+
+/********************************************************************************
+ * @brief Creates a new dynamically allocated mutex, initially unlocked.
+ *
+ * @param name
+ *        The name of the mutex in the statistics, nullptr selects "sync_mutex".
+ * @return
+ *        A reference to the mutex, nullptr if the memory allocation failed.
+ ********************************************************************************/
+struct sync_mutex* sync_mutex_new(const char* name);
+
+/********************************************************************************
+ * @brief Creates a new dynamically allocated priority-inheritance mutex,
+ *        initially unlocked. The mutex is used like any other mutex.
+ *
+ * @param name
+ *        The name of the mutex in the statistics, nullptr selects "sync_mutex".
+ * @return
+ *        A reference to the mutex, nullptr if the memory allocation failed.
+ ********************************************************************************/
+struct sync_mutex* sync_mutex_new_pi(const char* name);
+
+/********************************************************************************
+ * @brief Deletes mutex by freeing allocated memory. The mutex pointer is set
+ *        to null after deallocation.
+ *
+ * @param self
+ *        Double pointer to the mutex.
+ ********************************************************************************/
+void sync_mutex_delete(struct sync_mutex** self);
+
+/********************************************************************************
+ * @brief Locks referenced mutex. The calling thread will be temporarily
+ *        blocked until the mutex is unlocked. Locking a mutex already owned by
+ *        the calling thread leads to a deadlock.
+ *
+ * @param self
+ *        Reference to the mutex.
+ ********************************************************************************/
+void sync_mutex_lock(struct sync_mutex* self);
+
+/********************************************************************************
+ * @brief Locks referenced mutex if it is unlocked, without blocking.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        True if the mutex was locked, false if it was already locked.
+ ********************************************************************************/
+bool sync_mutex_try_lock(struct sync_mutex* self);
+
+/********************************************************************************
+ * @brief Unlocks referenced mutex. If threads are parked on the mutex, one of
+ *        them is woken.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        True if the mutex was unlocked, false if the calling thread doesn't
+ *        own the mutex.
+ ********************************************************************************/
+bool sync_mutex_unlock(struct sync_mutex* self);
+
+/********************************************************************************
+ * @brief Indicates if the calling thread owns referenced mutex. Within an
+ *        elided critical section, the calling thread owns every mutex that
+ *        appears unlocked.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        True if the calling thread owns the mutex, else false.
+ ********************************************************************************/
+bool sync_mutex_is_owner(const struct sync_mutex* self);
+
+/********************************************************************************
+ * @brief Provides a snapshot of the statistics of referenced mutex.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @param snapshot
+ *        Reference to the snapshot to fill.
+ * @return
+ *        True if the snapshot was filled, false if the instrumentation is
+ *        disabled.
+ ********************************************************************************/
+bool sync_mutex_stats(const struct sync_mutex* self, struct sync_stats_snapshot* snapshot);
+
+/********************************************************************************
+ * @note The following code is only available in C++.
+ ********************************************************************************/
+#else
+
+#include <atomic>
+#include <thread>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/********************************************************************************
+ * @brief Class for implementing owner-tracking mutexes in C++. The class meets
+ *        the Lockable requirements, so it can be used with std::lock_guard,
+ *        std::unique_lock and std::scoped_lock.
+ ********************************************************************************/
+class sync_mutex {
+  public:
+
+    /********************************************************************************
+     * @brief Creates new mutex, initially unlocked.
+     *
+     * @param name
+     *        The name of the mutex in the statistics.
+     ********************************************************************************/
+    explicit sync_mutex(const char* name = "sync_mutex")
+        : stats_{sync_stats_new(name)} { sync_lockdep_register(this, name); }
+
+    /********************************************************************************
+     * @brief Deletes the mutex and its statistics.
+     ********************************************************************************/
+    ~sync_mutex(void) {
+        sync_lockdep_forget(this);
+        sync_stats_delete(stats_);
+    }
+
+    sync_mutex(const sync_mutex&) = delete;
+    sync_mutex& operator=(const sync_mutex&) = delete;
+
+    /********************************************************************************
+     * @brief Locks the mutex. The calling thread will be temporarily blocked
+     *        until the mutex is unlocked. Locking a mutex already owned by the
+     *        calling thread leads to a deadlock.
+     *
+     * @note  If lock elision is available, the critical section is first run
+     *        transactionally without locking the mutex. The fast path is a 
+     *        single compare-and-swap from unlocked to locked. Else the calling 
+     *        thread spins with exponential backoff as long as nobody is parked,
+     *        then marks the mutex as contended and is parked until the futex 
+     *        word changes. A thread that acquires the mutex after being parked
+     *        leaves it marked as contended, since other threads might still be
+     *        parked.
+     ********************************************************************************/
+    void lock(void) {
+        sync_lockdep_acquire(this, true);
+        if (sync_elision_supported() && lock_elided()) return;
+        auto state{SYNC_MUTEX_UNLOCKED};
+        if (state_.compare_exchange_strong(state, SYNC_MUTEX_LOCKED, std::memory_order_acquire,
+                                           std::memory_order_relaxed)) {
+            sync_stats_acquired(stats_, 0, 0);
+        } else {
+            lock_contended(state);
+        }
+        owner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    }
+
+    /********************************************************************************
+     * @brief Locks the mutex if it is unlocked, without blocking.
+     *
+     * @return
+     *        True if the mutex was locked, false if it was already locked.
+     ********************************************************************************/
+    bool try_lock(void) {
+        auto state{SYNC_MUTEX_UNLOCKED};
+        if (!state_.compare_exchange_strong(state, SYNC_MUTEX_LOCKED, std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+            return false;
+        }
+        owner_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        sync_stats_acquired(stats_, 0, 0);
+        sync_lockdep_acquire(this, false);
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Unlocks the mutex. If threads are parked on the mutex, one of them
+     *        is woken.
+     *
+     * @return
+     *        True if the mutex was unlocked, false if the calling thread doesn't
+     *        own the mutex.
+     ********************************************************************************/
+    bool unlock(void) {
+        if (elided()) {
+            sync_elision_end();
+            sync_stats_elided(stats_);
+            sync_lockdep_release(this);
+            return true;
+        }
+        if (!is_owner()) return false;
+        owner_.store(std::thread::id{}, std::memory_order_relaxed);
+        sync_stats_released(stats_);
+        sync_lockdep_release(this);
+        if (state_.exchange(SYNC_MUTEX_UNLOCKED, std::memory_order_release) == SYNC_MUTEX_CONTENDED) {
+            state_.notify_one();
+        }
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Indicates if the calling thread owns the mutex. Within an elided
+     *        critical section, the calling thread owns the mutex if it appears
+     *        unlocked.
+     *
+     * @return
+     *        True if the calling thread owns the mutex, else false.
+     ********************************************************************************/
+    bool is_owner(void) const {
+        return elided() || owner_.load(std::memory_order_relaxed) == std::this_thread::get_id();
+    }
+
+    /********************************************************************************
+     * @brief Provides a snapshot of the statistics of the mutex.
+     *
+     * @param snapshot
+     *        Reference to the snapshot to fill.
+     * @return
+     *        True if the snapshot was filled, false if no statistics are available.
+     ********************************************************************************/
+    bool stats(sync_stats_snapshot& snapshot) const { return sync_stats_read(stats_, &snapshot); }
+
+  private:
+
+    /********************************************************************************
+     * @brief Tries to elide the lock via a hardware transaction, which reads
+     *        the futex word, so that a thread locking the mutex for real 
+     *        aborts it. Aborted transactions are retried after backing off 
+     *        until SYNC_ELISION_MAX_ABORTS aborts, unless a retry is futile.
+     *
+     * @return
+     *        True if the calling thread runs the critical section 
+     *        transactionally, false if it must lock the mutex normally.
+     ********************************************************************************/
+    bool lock_elided(void) {
+        for (uint16_t num_aborts{}; num_aborts < SYNC_ELISION_MAX_ABORTS; ) {
+            const auto status{sync_elision_begin()};
+            if (status == SYNC_ELISION_STARTED) {
+                if (state_.load(std::memory_order_relaxed) == SYNC_MUTEX_UNLOCKED) return true;
+                sync_elision_abort_busy();
+            }
+            sync_stats_elision_aborted(stats_);
+            if (!sync_elision_retry(status)) return false;
+            backoff_pause(num_aborts++);
+        }
+        return false;
+    }
+
+    /********************************************************************************
+     * @brief Indicates if the calling thread runs an elided critical section
+     *        of the mutex, i.e. runs transactionally while it appears unlocked.
+     *
+     * @return
+     *        True if the critical section is elided, else false.
+     ********************************************************************************/
+    bool elided(void) const {
+        return sync_elision_active() && state_.load(std::memory_order_relaxed) == SYNC_MUTEX_UNLOCKED;
+    }
+
+    /********************************************************************************
+     * @brief Waits for the mutex after the fast path failed.
+     *
+     * @param state
+     *        The state of the futex word observed by the fast path.
+     ********************************************************************************/
+    void lock_contended(uint32_t state) {
+        const auto wait_start{sync_stats_now()};
+        sync_stats_wait_begin(stats_);
+        uint16_t spins{};
+        while (state != SYNC_MUTEX_CONTENDED && spins < SYNC_MUTEX_SPIN_LIMIT) {
+            backoff_pause(spins++);
+            state = SYNC_MUTEX_UNLOCKED;
+            if (state_.compare_exchange_weak(state, SYNC_MUTEX_LOCKED, std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                sync_stats_wait_end(stats_);
+                sync_stats_acquired(stats_, wait_start, spins);
+                return;
+            }
+        }
+        while (state_.exchange(SYNC_MUTEX_CONTENDED, std::memory_order_acquire) != SYNC_MUTEX_UNLOCKED) {
+            state_.wait(SYNC_MUTEX_CONTENDED, std::memory_order_relaxed);
+        }
+        sync_stats_wait_end(stats_);
+        sync_stats_acquired(stats_, wait_start, spins);
+    }
+
+    std::atomic<uint32_t> state_{SYNC_MUTEX_UNLOCKED}; /* The futex word. */
+    std::atomic<std::thread::id> owner_{};              /* The owner, empty if unlocked. */
+    sync_stats* stats_;                                 /* Statistics, nullptr if disabled. */
+};
+
+/********************************************************************************
+ * @brief Class for implementing priority-inheritance mutexes in C++. The class
+ *        meets the Lockable requirements, like sync_mutex.
+ *
+ * @note  The futex word holds the kernel thread ID of the owner, so the owner
+ *        is tracked by the word itself. An uncontended lock and unlock is a
+ *        single compare-and-swap each. Else the kernel queues the waiting
+ *        threads by priority and boosts the owner (FUTEX_LOCK_PI), and hands
+ *        the mutex to the waiter of the highest priority (FUTEX_UNLOCK_PI).
+ ********************************************************************************/
+class sync_pi_mutex {
+  public:
+
+    /********************************************************************************
+     * @brief Creates new priority-inheritance mutex, initially unlocked.
+     *
+     * @param name
+     *        The name of the mutex in the statistics.
+     ********************************************************************************/
+    explicit sync_pi_mutex(const char* name = "sync_mutex")
+        : stats_{sync_stats_new(name)} { sync_lockdep_register(this, name); }
+
+    /********************************************************************************
+     * @brief Deletes the mutex and its statistics.
+     ********************************************************************************/
+    ~sync_pi_mutex(void) {
+        sync_lockdep_forget(this);
+        sync_stats_delete(stats_);
+    }
+
+    sync_pi_mutex(const sync_pi_mutex&) = delete;
+    sync_pi_mutex& operator=(const sync_pi_mutex&) = delete;
+
+    /********************************************************************************
+     * @brief Locks the mutex. The calling thread will be blocked until the
+     *        mutex is handed to it, while the owner inherits its priority.
+     *        Locking a mutex already owned by the calling thread leads to a
+     *        deadlock.
+     ********************************************************************************/
+    void lock(void) {
+        sync_lockdep_acquire(this, true);
+        uint32_t state{SYNC_MUTEX_UNLOCKED};
+        if (state_.compare_exchange_strong(state, thread_id(), std::memory_order_acquire,
+                                           std::memory_order_relaxed)) {
+            sync_stats_acquired(stats_, 0, 0);
+            return;
+        }
+        const auto wait_start{sync_stats_now()};
+        sync_stats_wait_begin(stats_);
+        sync_pi_futex_lock(&state_);
+        sync_stats_wait_end(stats_);
+        sync_stats_acquired(stats_, wait_start, 0);
+    }
+
+    /********************************************************************************
+     * @brief Locks the mutex if it is unlocked, without blocking.
+     *
+     * @return
+     *        True if the mutex was locked, false if it was already locked.
+     ********************************************************************************/
+    bool try_lock(void) {
+        uint32_t state{SYNC_MUTEX_UNLOCKED};
+        if (!state_.compare_exchange_strong(state, thread_id(), std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+            return false;
+        }
+        sync_stats_acquired(stats_, 0, 0);
+        sync_lockdep_acquire(this, false);
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Unlocks the mutex. If threads wait for the mutex, it is handed to
+     *        the one of highest priority.
+     *
+     * @return
+     *        True if the mutex was unlocked, false if the calling thread doesn't
+     *        own the mutex.
+     ********************************************************************************/
+    bool unlock(void) {
+        if (!is_owner()) return false;
+        sync_stats_released(stats_);
+        sync_lockdep_release(this);
+        auto state{thread_id()};
+        if (!state_.compare_exchange_strong(state, SYNC_MUTEX_UNLOCKED, std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+            sync_pi_futex_unlock(&state_);
+        }
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Indicates if the calling thread owns the mutex.
+     *
+     * @return
+     *        True if the calling thread owns the mutex, else false.
+     ********************************************************************************/
+    bool is_owner(void) const {
+        return (state_.load(std::memory_order_relaxed) & FUTEX_TID_MASK) == thread_id();
+    }
+
+    /********************************************************************************
+     * @brief Provides a snapshot of the statistics of the mutex.
+     *
+     * @param snapshot
+     *        Reference to the snapshot to fill.
+     * @return
+     *        True if the snapshot was filled, false if no statistics are available.
+     ********************************************************************************/
+    bool stats(sync_stats_snapshot& snapshot) const { return sync_stats_read(stats_, &snapshot); }
+
+  private:
+
+    /********************************************************************************
+     * @brief Provides the kernel thread ID of the calling thread, cached per
+     *        thread. The cache is cleared in the child after fork, since the
+     *        child thread has another ID.
+     *
+     * @return
+     *        The thread ID of the calling thread (never 0).
+     ********************************************************************************/
+    static uint32_t thread_id(void) {
+        static const int fork_handler{pthread_atfork(nullptr, nullptr, []() { cached_thread_id_ = 0; })};
+        (void)fork_handler;
+        if (!cached_thread_id_) cached_thread_id_ = static_cast<uint32_t>(syscall(SYS_gettid));
+        return cached_thread_id_;
+    }
+
+    static inline thread_local uint32_t cached_thread_id_{}; /* Thread ID of the calling thread. */
+    std::atomic<uint32_t> state_{SYNC_MUTEX_UNLOCKED};        /* The futex word, holding the owner. */
+    sync_stats* stats_;                                       /* Statistics, nullptr if disabled. */
+};
+
+#endif /* ifndef __cplusplus */
@@ -0,0 +1,57 @@
+/********************************************************************************
+ * @brief Contains runtime detection of the NUMA topology, shared by the
+ *        NUMA-aware synchronization primitives in C and C++. The interface is
+ *        shared between C and C++.
+ *
+ * @note  The number of nodes is read from sysfs once, and the node of each
+ *        thread is cached per thread and refreshed periodically, so that a
+ *        query usually costs a thread-local load. A thread migrated to
+ *        another node is therefore detected with some delay, which only
+ *        affects performance, never the correctness of the primitives.
+ ********************************************************************************/
+#pragma once
+
+/********************************************************************************
+ * @brief The code within the extern "C" directive is compiled as C code if
+ *        if a C++ compiler is used. This code is compatible with C and C++.
+ ********************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+
+/********************************************************************************
+ * @brief Parameters for the NUMA topology detection.
+ *
+ * @param SYNC_NUMA_MAX_NODES
+ *        The highest number of nodes the primitives distinguish (16). Threads
+ *        of nodes beyond the limit are mapped onto the supported nodes.
+ * @param SYNC_NUMA_REFRESH_PERIOD
+ *        The number of queries after which the node of a thread is read
+ *        again (256).
+ ********************************************************************************/
+#define SYNC_NUMA_MAX_NODES      (uint16_t)(16)
+#define SYNC_NUMA_REFRESH_PERIOD (uint16_t)(256)
+
+/********************************************************************************
+ * @brief Provides the number of NUMA nodes of the system, read from
+ *        /sys/devices/system/node/online on the first call.
+ *
+ * @return
+ *        The number of nodes, between 1 and SYNC_NUMA_MAX_NODES. Systems
+ *        without NUMA support are reported as a single node.
+ ********************************************************************************/
+uint16_t sync_numa_num_nodes(void);
+
+/********************************************************************************
+ * @brief Provides the NUMA node the calling thread runs on.
+ *
+ * @return
+ *        The node of the calling thread, lower than sync_numa_num_nodes().
+ ********************************************************************************/
+uint16_t sync_numa_current_node(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -0,0 +1,270 @@
+/********************************************************************************
+ * @brief Contains a bounded lock-free multi-producer multi-consumer (MPMC)
+ *        queue for usage in C and C++. Separate interfaces are implemented:
+ *        in C the element size is given at creation, while in C++ the queue
+ *        is a class template over the element type and capacity.
+ *
+ * @note  The queue is a ring buffer of slots, where each slot holds a sequence
+ *        number next to its element (Dmitry Vyukov's bounded MPMC queue).
+ *        Producers and consumers claim a position via compare-and-swap on the
+ *        enqueue and dequeue counters respectively, and the sequence number of
+ *        the slot tells whether it is ready to be written or read. An enqueue
+ *        or dequeue therefore costs one compare-and-swap and two accesses of
+ *        the slot, without locks or system calls.
+ *
+ *        The capacity must be a power of two, so that positions map to slots
+ *        via a mask. Each slot is placed on cache lines of its own, so that
+ *        producers and consumers of neighbouring slots don't share a cache
+ *        line. The queue never blocks: a full queue makes push fail and an
+ *        empty queue makes pop fail, and the caller decides how to wait.
+ ********************************************************************************/
+#pragma once
+
+#include <sync/cache_line.h>
+
+/********************************************************************************
+ * @note The following code is only available in C.
+ ********************************************************************************/
+#ifndef __cplusplus
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+/********************************************************************************
+ * @brief Predeclaration of MPMC queue. This structure is hidden in the
+ *        corresponding source file to make the counters and slots private.
+ ********************************************************************************/
+struct mpmc_queue;
+
+/********************************************************************************
+ * @brief Creates a new dynamically allocated MPMC queue.
+ *
+ * @param capacity
+ *        The maximum number of elements in the queue, must be a power of two
+ *        and at least 2.
+ * @param element_size
+ *        The size of each element in bytes, must be greater than 0.
+ * @return
+ *        A reference to the queue, nullptr if the memory allocation failed or
+ *        if an invalid capacity or element size was specified.
+ ********************************************************************************/
+struct mpmc_queue* mpmc_queue_new(const uint32_t capacity, const size_t element_size);
+
+/********************************************************************************
+ * @brief Deletes MPMC queue by freeing allocated memory. Elements still in
+ *        the queue are discarded. The queue pointer is set to null after
+ *        deallocation.
+ *
+ * @param self
+ *        Double pointer to the queue.
+ ********************************************************************************/
+void mpmc_queue_delete(struct mpmc_queue** self);
+
+/********************************************************************************
+ * @brief Copies specified element to the back of referenced queue.
+ *
+ * @param self
+ *        Reference to the queue.
+ * @param element
+ *        Reference to the element, element_size bytes are copied.
+ * @return
+ *        True if the element was enqueued, false if the queue is full.
+ ********************************************************************************/
+bool mpmc_queue_try_push(struct mpmc_queue* self, const void* element);
+
+/********************************************************************************
+ * @brief Moves the element at the front of referenced queue to specified
+ *        destination.
+ *
+ * @param self
+ *        Reference to the queue.
+ * @param element
+ *        Reference to the destination, element_size bytes are copied.
+ * @return
+ *        True if an element was dequeued, false if the queue is empty.
+ ********************************************************************************/
+bool mpmc_queue_try_pop(struct mpmc_queue* self, void* element);
+
+/********************************************************************************
+ * @brief Provides the number of elements in referenced queue. The number is
+ *        only a snapshot, since other threads may push or pop meanwhile.
+ *
+ * @param self
+ *        Reference to the queue.
+ * @return
+ *        The number of elements in the queue.
+ ********************************************************************************/
+uint32_t mpmc_queue_size(const struct mpmc_queue* self);
+
+/********************************************************************************
+ * @brief Provides the capacity of referenced queue.
+ *
+ * @param self
+ *        Reference to the queue.
+ * @return
+ *        The maximum number of elements in the queue.
+ ********************************************************************************/
+uint32_t mpmc_queue_capacity(const struct mpmc_queue* self);
+
+/********************************************************************************
+ * @note The following code is only available in C++.
+ ********************************************************************************/
+#else
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+/********************************************************************************
+ * @brief Class for implementing bounded MPMC queues in C++.
+ *
+ * @tparam T
+ *         The type of the elements.
+ * @tparam capacity
+ *         The maximum number of elements in the queue, must be a power of two
+ *         and at least 2.
+ ********************************************************************************/
+template <typename T, uint32_t capacity>
+class mpmc_queue {
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0,
+                  "The capacity of an MPMC queue must be a power of two and at least 2!");
+  public:
+
+    /********************************************************************************
+     * @brief Creates new empty queue.
+     ********************************************************************************/
+    mpmc_queue(void) : slots_{new slot[capacity]} {
+        for (uint32_t i{}; i < capacity; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /********************************************************************************
+     * @brief Deletes the queue and destroys the elements still in it.
+     ********************************************************************************/
+    ~mpmc_queue(void) {
+        const auto end{enqueue_pos_.load(std::memory_order_relaxed)};
+        for (auto pos{dequeue_pos_.load(std::memory_order_relaxed)}; pos != end; ++pos) {
+            std::launder(reinterpret_cast<T*>(slots_[pos & mask_].storage))->~T();
+        }
+    }
+
+    mpmc_queue(const mpmc_queue&) = delete;
+    mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+    /********************************************************************************
+     * @brief Constructs an element at the back of the queue.
+     *
+     * @param args
+     *        The arguments passed to the constructor of the element.
+     * @return
+     *        True if the element was enqueued, false if the queue is full.
+     ********************************************************************************/
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        auto pos{enqueue_pos_.load(std::memory_order_relaxed)};
+        while (1) {
+            auto& slot{slots_[pos & mask_]};
+            const auto seq{slot.seq.load(std::memory_order_acquire)};
+            const auto diff{static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos)};
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    new (slot.storage) T(std::forward<Args>(args)...);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /********************************************************************************
+     * @brief Copies or moves specified element to the back of the queue.
+     *
+     * @param element
+     *        The element to enqueue.
+     * @return
+     *        True if the element was enqueued, false if the queue is full.
+     ********************************************************************************/
+    bool try_push(const T& element) { return try_emplace(element); }
+    bool try_push(T&& element) { return try_emplace(std::move(element)); }
+
+    /********************************************************************************
+     * @brief Moves the element at the front of the queue to specified
+     *        destination.
+     *
+     * @param element
+     *        Reference to the destination.
+     * @return
+     *        True if an element was dequeued, false if the queue is empty.
+     ********************************************************************************/
+    bool try_pop(T& element) {
+        auto pos{dequeue_pos_.load(std::memory_order_relaxed)};
+        while (1) {
+            auto& slot{slots_[pos & mask_]};
+            const auto seq{slot.seq.load(std::memory_order_acquire)};
+            const auto diff{static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1)};
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    auto* stored{std::launder(reinterpret_cast<T*>(slot.storage))};
+                    element = std::move(*stored);
+                    stored->~T();
+                    slot.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /********************************************************************************
+     * @brief Provides the number of elements in the queue. The number is only a
+     *        snapshot, since other threads may push or pop meanwhile.
+     *
+     * @return
+     *        The number of elements in the queue.
+     ********************************************************************************/
+    uint32_t size(void) const {
+        const auto dequeued{dequeue_pos_.load(std::memory_order_relaxed)};
+        const auto enqueued{enqueue_pos_.load(std::memory_order_relaxed)};
+        return enqueued > dequeued ? static_cast<uint32_t>(enqueued - dequeued) : 0;
+    }
+
+    /********************************************************************************
+     * @brief Provides the capacity of the queue.
+     *
+     * @return
+     *        The maximum number of elements in the queue.
+     ********************************************************************************/
+    static constexpr uint32_t max_size(void) { return capacity; }
+
+  private:
+
+    /********************************************************************************
+     * @brief Slot of the ring buffer, placed on cache lines of its own. The
+     *        sequence number equals the position of the next push to the slot
+     *        while the slot is empty, and that position + 1 while it is full.
+     ********************************************************************************/
+    struct SYNC_CACHE_ALIGNED slot {
+        std::atomic<std::size_t> seq{};              /* Sequence number of the slot. */
+        alignas(T) unsigned char storage[sizeof(T)]; /* Storage of the element. */
+    };
+
+    static constexpr std::size_t mask_{capacity - 1};           /* Maps positions to slots. */
+    SYNC_CACHE_ALIGNED std::atomic<std::size_t> enqueue_pos_{}; /* Position of the next push. */
+    SYNC_CACHE_ALIGNED std::atomic<std::size_t> dequeue_pos_{}; /* Position of the next pop. */
+    std::unique_ptr<slot[]> slots_;                             /* The ring buffer. */
+};
+
+#endif /* ifndef __cplusplus */
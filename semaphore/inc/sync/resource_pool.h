@@ -0,0 +1,302 @@
+/********************************************************************************
+ * @brief Contains a pool of reusable objects for usage in C and C++. Separate
+ *        interfaces are implemented for C and C++.
+ *
+ * @note  A resource pool pairs a counting semaphore with a preallocated set of
+ *        objects, such as buffers. The objects are allocated once when the
+ *        pool is created and are then handed out and returned without any
+ *        heap traffic. The semaphore counts the free objects, so acquiring
+ *        an object blocks according to its wait policy while all objects are
+ *        in use. Once a resource is reserved, a free object is guaranteed to
+ *        be available and is popped from a lock-free free-list. Each object
+ *        carries a flag which is set while it is acquired, so that releasing
+ *        an object twice is rejected instead of corrupting the free-list.
+ *
+ *        The free-list is a Treiber stack of object indices. The head holds
+ *        the index of the top object in its lowest 16 bits and a tag, which
+ *        is incremented on every change, in the upper 48 bits, so that a
+ *        stale compare-and-swap cannot succeed after the same index was
+ *        popped and pushed again (ABA problem). Each object is placed on
+ *        cache lines of its own, so that threads using neighboring objects
+ *        don't share cache lines.
+ ********************************************************************************/
+#pragma once
+
+#include <sync/cache_line.h>
+#include <sync/semaphore.h>
+
+/********************************************************************************
+ * @brief Marks the end of the free-list of a resource pool.
+ ********************************************************************************/
+#define RESOURCE_POOL_NIL (uint16_t)(UINT16_MAX)
+
+/********************************************************************************
+ * @note The following code is only available in C.
+ ********************************************************************************/
+#ifndef __cplusplus
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/********************************************************************************
+ * @brief Predeclaration of resource pool. This structure is hidden in the
+ *        corresponding source file to make the free-list private.
+ ********************************************************************************/
+struct resource_pool;
+
+/********************************************************************************
+ * @brief Creates a new resource pool holding specified number of objects. The
+ *        objects are zero-initialized.
+ *
+ * @param num_objects
+ *        The number of objects, between 1 and 65 534.
+ * @param object_size
+ *        The size of each object in bytes.
+ * @param options
+ *        Reference to creation-time options of the underlying counting
+ *        semaphore, nullptr selects the defaults.
+ * @return
+ *        A reference to the resource pool, nullptr if the memory allocation
+ *        failed or if an invalid number of objects or object size was
+ *        specified.
+ ********************************************************************************/
+struct resource_pool* resource_pool_new(const uint16_t num_objects, const size_t object_size,
+                                        const struct counting_semaphore_options* options);
+
+/********************************************************************************
+ * @brief Deletes resource pool and its objects by freeing allocated memory.
+ *        The pool pointer is set to null after deallocation.
+ *
+ * @param self
+ *        Double pointer to the resource pool.
+ ********************************************************************************/
+void resource_pool_delete(struct resource_pool** self);
+
+/********************************************************************************
+ * @brief Acquires an object of referenced resource pool. The calling thread
+ *        will be temporarily blocked while all objects are in use, according
+ *        to the wait policy of the pool.
+ *
+ * @param self
+ *        Reference to the resource pool.
+ * @return
+ *        A reference to the object.
+ ********************************************************************************/
+void* resource_pool_acquire(struct resource_pool* self);
+
+/********************************************************************************
+ * @brief Acquires an object of referenced resource pool if any is free. The
+ *        calling thread is never blocked.
+ *
+ * @param self
+ *        Reference to the resource pool.
+ * @return
+ *        A reference to the object, nullptr if all objects are in use.
+ ********************************************************************************/
+void* resource_pool_try_acquire(struct resource_pool* self);
+
+/********************************************************************************
+ * @brief Returns an object to referenced resource pool. The object keeps its
+ *        contents until it is acquired again.
+ *
+ * @param self
+ *        Reference to the resource pool.
+ * @param object
+ *        Reference to the object, which must have been acquired from the pool.
+ * @return
+ *        True if the object was returned, false if it doesn't belong to the
+ *        pool or isn't acquired, e.g. because it was already returned.
+ ********************************************************************************/
+bool resource_pool_release(struct resource_pool* self, void* object);
+
+/********************************************************************************
+ * @brief Provides the number of free objects of referenced resource pool.
+ *
+ * @param self
+ *        Reference to the resource pool.
+ * @return
+ *        The number of free objects.
+ ********************************************************************************/
+uint16_t resource_pool_num_available(const struct resource_pool* self);
+
+/********************************************************************************
+ * @note The following code is only available in C++.
+ ********************************************************************************/
+#else
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+/********************************************************************************
+ * @brief Class for implementing pools of reusable objects in C++. The objects
+ *        are default-constructed when the pool is created and destroyed when
+ *        the pool is deleted.
+ *
+ * @tparam T
+ *         The type of the objects.
+ * @tparam num_objects
+ *         The number of objects, between 1 and 65 534.
+ * @tparam wait_policy
+ *         The strategy used while all objects are in use, see
+ *         semaphore_wait_policy.
+ ********************************************************************************/
+template <typename T, uint16_t num_objects, typename wait_policy = semaphore_wait_adaptive<>>
+class resource_pool {
+    static_assert(num_objects > 0 && num_objects < RESOURCE_POOL_NIL,
+                  "The number of objects of a resource pool must be between 1 and 65 534!");
+  public:
+
+    /********************************************************************************
+     * @brief Creates new resource pool, where all objects are free.
+     *
+     * @param name
+     *        The name of the pool in the statistics.
+     ********************************************************************************/
+    explicit resource_pool(const char* name = "resource_pool")
+        : slots_{new slot[num_objects]}, sem_{name} {
+        for (uint16_t i{}; i < num_objects; ++i) {
+            slots_[i].next.store(i + 1U < num_objects ? i + 1U : RESOURCE_POOL_NIL, std::memory_order_relaxed);
+        }
+    }
+
+    resource_pool(const resource_pool&) = delete;
+    resource_pool& operator=(const resource_pool&) = delete;
+
+    /********************************************************************************
+     * @brief Acquires an object. The calling thread will be temporarily blocked
+     *        while all objects are in use, according to the wait policy.
+     *
+     * @return
+     *        A reference to the object.
+     ********************************************************************************/
+    T* acquire(void) {
+        sem_.take();
+        return pop_object();
+    }
+
+    /********************************************************************************
+     * @brief Acquires an object if any is free. The calling thread is never
+     *        blocked.
+     *
+     * @return
+     *        A reference to the object, nullptr if all objects are in use.
+     ********************************************************************************/
+    T* try_acquire(void) { return sem_.try_take() ? pop_object() : nullptr; }
+
+    /********************************************************************************
+     * @brief Acquires an object. The calling thread will be blocked at most
+     *        for specified duration while all objects are in use.
+     *
+     * @param timeout
+     *        The maximum time to wait for an object.
+     * @return
+     *        A reference to the object, nullptr if the timeout expired.
+     ********************************************************************************/
+    template <typename Rep, typename Period>
+    T* try_acquire_for(const std::chrono::duration<Rep, Period>& timeout) {
+        return sem_.take_for(timeout) ? pop_object() : nullptr;
+    }
+
+    /********************************************************************************
+     * @brief Returns an object to the pool. The object keeps its state until it
+     *        is acquired again.
+     *
+     * @param object
+     *        Reference to the object, which must have been acquired from the
+     *        pool.
+     * @return
+     *        True if the object was returned, false if it doesn't belong to
+     *        the pool or isn't acquired, e.g. because it was already returned.
+     ********************************************************************************/
+    bool release(T* object) {
+        const auto offset{reinterpret_cast<uintptr_t>(object) - reinterpret_cast<uintptr_t>(&slots_[0].object)};
+        const auto index{offset / sizeof(slot)};
+        if (index >= num_objects || &slots_[index].object != object) return false;
+        if (!slots_[index].in_use.exchange(false, std::memory_order_relaxed)) return false;
+        push(static_cast<uint16_t>(index));
+        return sem_.release();
+    }
+
+    /********************************************************************************
+     * @brief Provides the number of free objects.
+     *
+     * @return
+     *        The number of free objects.
+     ********************************************************************************/
+    uint16_t num_available(void) const { return sem_.num_available_resources(); }
+
+  private:
+
+    /********************************************************************************
+     * @brief Object of the pool, placed on cache lines of its own, the index of
+     *        the next free object while it is free and a flag set while it is
+     *        acquired.
+     ********************************************************************************/
+    struct SYNC_CACHE_ALIGNED slot {
+        T object{};                    /* The object handed out. */
+        std::atomic<uint16_t> next{};  /* Index of the next free object. */
+        std::atomic<bool> in_use{};    /* Set while the object is acquired. */
+    };
+
+    /********************************************************************************
+     * @brief Pops a free object and marks it in use.
+     *
+     * @return
+     *        A reference to the object.
+     ********************************************************************************/
+    T* pop_object(void) {
+        auto& entry{slots_[pop()]};
+        entry.in_use.store(true, std::memory_order_relaxed);
+        return &entry.object;
+    }
+
+    /********************************************************************************
+     * @brief Pops the index of a free object. Only called after a resource of
+     *        the semaphore was reserved, so the free-list holds an object for
+     *        the calling thread; if it appears empty, the object is about to be
+     *        pushed and we retry.
+     *
+     * @return
+     *        The index of the object.
+     ********************************************************************************/
+    uint16_t pop(void) {
+        auto head{head_.load(std::memory_order_acquire)};
+        uint16_t spins{};
+        while (1) {
+            const auto index{static_cast<uint16_t>(head & RESOURCE_POOL_NIL)};
+            if (index == RESOURCE_POOL_NIL) {
+                backoff_pause(spins++);
+                head = head_.load(std::memory_order_acquire);
+                continue;
+            }
+            const uint64_t next{slots_[index].next.load(std::memory_order_relaxed)};
+            if (head_.compare_exchange_weak(head, ((head >> 16) + 1) << 16 | next, std::memory_order_acquire,
+                                            std::memory_order_acquire)) {
+                return index;
+            }
+        }
+    }
+
+    /********************************************************************************
+     * @brief Pushes the index of a free object onto the free-list.
+     *
+     * @param index
+     *        The index of the object.
+     ********************************************************************************/
+    void push(const uint16_t index) {
+        auto head{head_.load(std::memory_order_relaxed)};
+        do {
+            slots_[index].next.store(static_cast<uint16_t>(head & RESOURCE_POOL_NIL), std::memory_order_relaxed);
+        } while (!head_.compare_exchange_weak(head, ((head >> 16) + 1) << 16 | index, std::memory_order_release,
+                                              std::memory_order_relaxed));
+    }
+
+    std::unique_ptr<slot[]> slots_;                        /* The objects. */
+    counting_semaphore<num_objects, wait_policy> sem_;     /* Counts the free objects. */
+    SYNC_CACHE_ALIGNED std::atomic<uint64_t> head_{};     /* Tag and index of the top free object. */
+};
+
+#endif /* ifndef __cplusplus */
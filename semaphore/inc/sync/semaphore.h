@@ -0,0 +1,2111 @@
+/********************************************************************************
+ * @brief Contains binary and counting semaphores for usage in C and C++, 
+ *        together with reader-writer semaphores, barriers and latches. The 
+ *        binary semaphore interface is shared between C and C++, while 
+ *        separate interfaces are implemented for the other primitives.
+ ********************************************************************************/
+#pragma once
+
+#include <sync/elision.h>
+#include <sync/lockdep.h>
+#include <sync/stats.h>
+
+/********************************************************************************
+ * @brief The code within the extern "C" directive is compiled as C code if
+ *        if a C++ compiler is used. This code is compatible with C and C++.
+ ********************************************************************************/
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sync/backoff.h>
+
+/********************************************************************************
+ * @brief Parameters for binary semaphores. The limit and the number of hot 
+ *        IDs can be overridden at compile time, for instance via the CMake
+ *        cache variables of the same names.
+ * 
+ * @param BINARY_SEMAPHORE_LIMIT
+ *        The number of available binary semaphores (1024 by default, at most
+ *        65 535).
+ * @param BINARY_SEMAPHORE_NUM_HOT_IDS
+ *        The number of semaphores, starting from ID 0, that are placed on a
+ *        cache line of their own (0 by default). The remaining semaphores 
+ *        are packed 32 per cache line. Use this for the most contended IDs,
+ *        so that they don't bounce cache lines with each other.
+ * @param BINARY_SEMAPHORE_IDS_PER_SHARD
+ *        The number of packed semaphores sharing a cache line (32).
+ * @param BINARY_SEMAPHORE_ID_MIN
+ *        The lowest permitted semaphore ID (0).
+ * @param BINARY_SEMAPHORE_ID_MAX
+ *        The highest permitted semaphore ID (BINARY_SEMAPHORE_LIMIT - 1).
+ ********************************************************************************/
+#ifndef BINARY_SEMAPHORE_LIMIT
+#define BINARY_SEMAPHORE_LIMIT         (uint16_t)(1024)
+#endif /* BINARY_SEMAPHORE_LIMIT */
+
+#ifndef BINARY_SEMAPHORE_NUM_HOT_IDS
+#define BINARY_SEMAPHORE_NUM_HOT_IDS   (uint16_t)(0)
+#endif /* BINARY_SEMAPHORE_NUM_HOT_IDS */
+
+#define BINARY_SEMAPHORE_IDS_PER_SHARD (uint16_t)(32)
+#define BINARY_SEMAPHORE_ID_MIN        (uint16_t)(0)
+#define BINARY_SEMAPHORE_ID_MAX        (uint16_t)(BINARY_SEMAPHORE_LIMIT - 1)
+
+/********************************************************************************
+ * @brief Reseves semaphore with specified ID. If the semaphore is reserved,
+ *        the calling thread is blocked until the semaphore is available.
+ * 
+ * @note  If lock elision is compiled in (see sync/elision.h) and supported by
+ *        the processor, the reservation is first elided, i.e. the critical 
+ *        section runs as a hardware transaction until the calling thread
+ *        releases the semaphore. If the semaphore is released by another
+ *        thread instead, the transaction aborts and the reservation falls back
+ *        to the normal path, so semaphores used for signaling between threads
+ *        are better reserved via binary_semaphore_take_mask, which is never
+ *        elided.
+ * 
+ * @param sem_id
+ *        Identifier of the semaphore to reserve (0 - BINARY_SEMAPHORE_ID_MAX).
+ * @return 
+ *        True upon successful reservation, false if an invalid semaphore
+ *        identifier was specified (sem_id >= BINARY_SEMAPHORE_LIMIT).
+ ********************************************************************************/
+bool binary_semaphore_take(const uint16_t sem_id);
+
+/********************************************************************************
+ * @brief Releases semaphore with specified ID. 
+ * 
+ * @param sem_id
+ *        Identifier of the semaphore to release (0 - BINARY_SEMAPHORE_ID_MAX).
+ * @return 
+ *        True upon successful release, false if an invalid semaphore
+ *        identifier was specified (sem_id >= BINARY_SEMAPHORE_LIMIT).
+ ********************************************************************************/
+bool binary_semaphore_release(const uint16_t sem_id);
+
+/********************************************************************************
+ * @brief Reserves all semaphores whose IDs are set in specified mask at once.
+ *        If any of the semaphores is reserved, the calling thread is blocked 
+ *        until all of them are available. Since no semaphore is held while
+ *        waiting, several semaphores can be reserved together without the 
+ *        risk of lock-ordering deadlocks.
+ * 
+ * @note  The semaphores sharing a cache line are reserved with a single 
+ *        compare-and-swap, which is the case for all packed semaphores if
+ *        first_id is a multiple of 32 counted from the first packed ID. If the 
+ *        mask spans several cache lines, for instance hot IDs, the cache lines
+ *        are reserved one by one in ascending order without waiting. If the
+ *        semaphores of a cache line are unavailable, the cache lines reserved
+ *        so far are released again and the calling thread waits for that 
+ *        cache line before it starts over, so it holds no semaphore while
+ *        waiting in this case either.
+ * 
+ * @param first_id
+ *        Identifier of the semaphore corresponding to bit 0 of the mask.
+ * @param mask
+ *        Mask of the semaphores to reserve, where bit n corresponds to ID
+ *        first_id + n, for instance (1UL << BINARY_SEM_ID_A) | (1UL << BINARY_SEM_ID_B)
+ *        with first_id = 0.
+ * @return 
+ *        True upon successful reservation, false if an empty mask was
+ *        specified or if the mask contains an invalid semaphore identifier.
+ ********************************************************************************/
+bool binary_semaphore_take_mask(const uint16_t first_id, const uint32_t mask);
+
+/********************************************************************************
+ * @brief Releases all semaphores whose IDs are set in specified mask at once.
+ * 
+ * @param first_id
+ *        Identifier of the semaphore corresponding to bit 0 of the mask.
+ * @param mask
+ *        Mask of the semaphores to release, where bit n corresponds to ID
+ *        first_id + n.
+ * @return 
+ *        True upon successful release, false if an empty mask was specified
+ *        or if the mask contains an invalid semaphore identifier.
+ ********************************************************************************/
+bool binary_semaphore_release_mask(const uint16_t first_id, const uint32_t mask);
+
+/********************************************************************************
+ * @brief Provides a snapshot of the statistics of semaphore with specified ID.
+ * 
+ * @param sem_id
+ *        Identifier of the semaphore (0 - BINARY_SEMAPHORE_ID_MAX).
+ * @param snapshot
+ *        Reference to the snapshot to fill.
+ * @return 
+ *        True if the snapshot was filled, false if an invalid semaphore
+ *        identifier was specified or if no statistics are available 
+ *        (instrumentation disabled or semaphore never used).
+ ********************************************************************************/
+bool binary_semaphore_stats(const uint16_t sem_id, struct sync_stats_snapshot* snapshot);
+
+/********************************************************************************
+ * @brief Predeclaration of binary semaphore bank. A bank holds binary 
+ *        semaphores in caller-provided memory, such as a region mapped via
+ *        shm_open and mmap, so that several processes can share them. The
+ *        semaphores are packed 32 per cache line like the semaphores above and
+ *        are parked on via shared futexes. Binary semaphores have no owner, so
+ *        a semaphore reserved by a process that dies stays reserved; use
+ *        sync_shared_mutex if owner recovery is needed.
+ ********************************************************************************/
+struct binary_semaphore_bank;
+
+/********************************************************************************
+ * @brief Provides the size of a binary semaphore bank.
+ * 
+ * @param num_semaphores
+ *        The number of semaphores of the bank.
+ * @return
+ *        The number of bytes to provide to binary_semaphore_bank_init.
+ ********************************************************************************/
+size_t binary_semaphore_bank_size(const uint16_t num_semaphores);
+
+/********************************************************************************
+ * @brief Initializes a binary semaphore bank in specified memory, where all
+ *        semaphores are available. Only one process initializes the bank,
+ *        before any process uses it.
+ * 
+ * @param memory
+ *        Reference to the memory, at least binary_semaphore_bank_size bytes
+ *        large and aligned to a cache line (SYNC_CACHE_LINE_SIZE), which holds
+ *        for memory mapped via mmap.
+ * @param num_semaphores
+ *        The number of semaphores of the bank.
+ * @return
+ *        A reference to the bank, nullptr if the memory is misaligned or if an
+ *        invalid number of semaphores was specified (num_semaphores = 0).
+ ********************************************************************************/
+struct binary_semaphore_bank* binary_semaphore_bank_init(void* memory, const uint16_t num_semaphores);
+
+/********************************************************************************
+ * @brief Provides the binary semaphore bank held by specified memory, which
+ *        was initialized via binary_semaphore_bank_init, possibly by another
+ *        process and at another address.
+ * 
+ * @param memory
+ *        Reference to the initialized memory.
+ * @return
+ *        A reference to the bank.
+ ********************************************************************************/
+static inline struct binary_semaphore_bank* binary_semaphore_bank_from_memory(void* memory) {
+    return (struct binary_semaphore_bank*)memory;
+}
+
+/********************************************************************************
+ * @brief Reserves semaphore with specified ID of referenced bank. If the 
+ *        semaphore is reserved, the calling thread is blocked until the 
+ *        semaphore is available.
+ * 
+ * @param self
+ *        Reference to the bank.
+ * @param sem_id
+ *        Identifier of the semaphore to reserve.
+ * @return 
+ *        True upon successful reservation, false if an invalid semaphore
+ *        identifier was specified.
+ ********************************************************************************/
+bool binary_semaphore_bank_take(struct binary_semaphore_bank* self, const uint16_t sem_id);
+
+/********************************************************************************
+ * @brief Releases semaphore with specified ID of referenced bank.
+ * 
+ * @param self
+ *        Reference to the bank.
+ * @param sem_id
+ *        Identifier of the semaphore to release.
+ * @return 
+ *        True upon successful release, false if an invalid semaphore
+ *        identifier was specified.
+ ********************************************************************************/
+bool binary_semaphore_bank_release(struct binary_semaphore_bank* self, const uint16_t sem_id);
+
+/********************************************************************************
+ * @brief Reserves all semaphores of referenced bank whose IDs are set in 
+ *        specified mask at once, see binary_semaphore_take_mask.
+ * 
+ * @param self
+ *        Reference to the bank.
+ * @param first_id
+ *        Identifier of the semaphore corresponding to bit 0 of the mask.
+ * @param mask
+ *        Mask of the semaphores to reserve, where bit n corresponds to ID
+ *        first_id + n.
+ * @return 
+ *        True upon successful reservation, false if an empty mask was
+ *        specified or if the mask contains an invalid semaphore identifier.
+ ********************************************************************************/
+bool binary_semaphore_bank_take_mask(struct binary_semaphore_bank* self, const uint16_t first_id,
+                                     const uint32_t mask);
+
+/********************************************************************************
+ * @brief Releases all semaphores of referenced bank whose IDs are set in 
+ *        specified mask at once.
+ * 
+ * @param self
+ *        Reference to the bank.
+ * @param first_id
+ *        Identifier of the semaphore corresponding to bit 0 of the mask.
+ * @param mask
+ *        Mask of the semaphores to release, where bit n corresponds to ID
+ *        first_id + n.
+ * @return 
+ *        True upon successful release, false if an empty mask was specified
+ *        or if the mask contains an invalid semaphore identifier.
+ ********************************************************************************/
+bool binary_semaphore_bank_release_mask(struct binary_semaphore_bank* self, const uint16_t first_id,
+                                        const uint32_t mask);
+
+/********************************************************************************
+ * @brief Parameters for reader-writer semaphores.
+ * 
+ * @param RW_SEMAPHORE_NUM_SLOTS
+ *        The number of reader slots per reader-writer semaphore (16 by default).
+ *        Each slot counts the readers of the threads assigned to it and is 
+ *        placed on a cache line of its own. Threads are assigned to slots round
+ *        robin, so up to this number of reading threads never write to the
+ *        same cache line.
+ ********************************************************************************/
+#ifndef RW_SEMAPHORE_NUM_SLOTS
+#define RW_SEMAPHORE_NUM_SLOTS (uint16_t)(16)
+#endif /* RW_SEMAPHORE_NUM_SLOTS */
+
+/********************************************************************************
+ * @brief Parameters for fair counting semaphores.
+ * 
+ * @param SEMAPHORE_FAIR_QUEUE_NUM_SLOTS
+ *        The number of turn slots of a counting semaphore using the queue
+ *        fairness mode (32 by default). Each slot is placed on a cache line of
+ *        its own, so up to this number of queued threads wait on separate 
+ *        cache lines. Further waiters share slots, which is still correct.
+ ********************************************************************************/
+#ifndef SEMAPHORE_FAIR_QUEUE_NUM_SLOTS
+#define SEMAPHORE_FAIR_QUEUE_NUM_SLOTS (uint16_t)(32)
+#endif /* SEMAPHORE_FAIR_QUEUE_NUM_SLOTS */
+
+/********************************************************************************
+ * @brief Parameters for counting semaphores caching resources per thread.
+ * 
+ * @param SEMAPHORE_CACHE_NUM_SLOTS
+ *        The number of cache slots of a counting semaphore using the caching 
+ *        mode (16 by default). Each slot holds the resources cached by the
+ *        threads assigned to it and is placed on a cache line of its own. 
+ *        Threads are assigned to slots round robin, so up to this number of 
+ *        threads take and release resources without sharing a cache line.
+ ********************************************************************************/
+#ifndef SEMAPHORE_CACHE_NUM_SLOTS
+#define SEMAPHORE_CACHE_NUM_SLOTS (uint16_t)(16)
+#endif /* SEMAPHORE_CACHE_NUM_SLOTS */
+
+/********************************************************************************
+ * @brief Parameters for barriers.
+ * 
+ * @param BARRIER_FAN_IN
+ *        The number of arrivals combined per node of the combining tree of a
+ *        barrier (4 by default). Each node is placed on a cache line of its 
+ *        own, so at most this number of threads update the same cache line
+ *        when they arrive. A barrier for at most this number of threads 
+ *        consists of a single node, i.e. a centralized counter.
+ ********************************************************************************/
+#ifndef BARRIER_FAN_IN
+#define BARRIER_FAN_IN (uint16_t)(4)
+#endif /* BARRIER_FAN_IN */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+ /********************************************************************************
+ * @note The following code is only available in C.
+ ********************************************************************************/
+#ifndef __cplusplus 
+
+#include <stdlib.h>
+
+/********************************************************************************
+ * @brief Strategies for waiting on a counting semaphore whose resources are
+ *        all reserved.
+ * 
+ * @param SEMAPHORE_WAIT_ADAPTIVE
+ *        Spin with exponential backoff for a bounded number of iterations,
+ *        then park the thread in the kernel until a resource is released.
+ * @param SEMAPHORE_WAIT_SPIN
+ *        Spin with exponential backoff until a resource is available.
+ * @param SEMAPHORE_WAIT_PARK
+ *        Park the thread in the kernel immediately.
+ ********************************************************************************/
+enum semaphore_wait_policy {
+    SEMAPHORE_WAIT_ADAPTIVE,
+    SEMAPHORE_WAIT_SPIN,
+    SEMAPHORE_WAIT_PARK,
+};
+
+/********************************************************************************
+ * @brief Orders in which waiting threads reserve the resources of a counting
+ *        semaphore.
+ * 
+ * @param SEMAPHORE_FAIR_NONE
+ *        Whichever thread observes a released resource first reserves it. 
+ *        Gives the highest throughput, but waiting threads may be starved.
+ * @param SEMAPHORE_FAIR_TICKET
+ *        Threads reserve resources in FIFO order. Queued threads wait on a 
+ *        shared counter (ticket lock), which suits low core counts.
+ * @param SEMAPHORE_FAIR_QUEUE
+ *        Threads reserve resources in FIFO order. Each queued thread waits on
+ *        a turn slot of its own cache line (array-based queue lock), so a 
+ *        handover only disturbs the next thread in line.
+ * @param SEMAPHORE_FAIR_PRIORITY
+ *        Threads reserve resources in order of their real-time priority 
+ *        (SCHED_FIFO or SCHED_RR, other threads count as priority 0), and in
+ *        FIFO order among equal priorities. Waiting threads are parked at once
+ *        instead of spinning, and released resources are handed directly to
+ *        the first waiter, so a real-time thread never spins against a 
+ *        preempted holder of lower priority and cannot be overtaken by one. 
+ *        The wait queue is protected by a priority-inheriting lock.
+ ********************************************************************************/
+enum semaphore_fairness {
+    SEMAPHORE_FAIR_NONE,
+    SEMAPHORE_FAIR_TICKET,
+    SEMAPHORE_FAIR_QUEUE,
+    SEMAPHORE_FAIR_PRIORITY,
+};
+
+/********************************************************************************
+ * @brief Creation-time options for counting semaphores. A zero-initialized
+ *        structure selects the default options.
+ * 
+ * @param wait_policy
+ *        The strategy used when all resources are reserved.
+ * @param spin_limit
+ *        The number of spin iterations before an adaptive waiter is parked,
+ *        0 selects the default limit (BACKOFF_SPIN_LIMIT_DEFAULT).
+ * @param name
+ *        The name of the semaphore in the statistics, nullptr selects
+ *        "counting_semaphore".
+ * @param fairness
+ *        The order in which waiting threads reserve resources.
+ * @param pollable
+ *        True to expose the available resources via a file descriptor, see
+ *        counting_semaphore_fd (Linux only).
+ * @param process_shared
+ *        True to share the semaphore between processes, in which case it must
+ *        be initialized via counting_semaphore_init in memory shared between
+ *        them. A process-shared semaphore records no statistics and cannot be
+ *        combined with the queue or priority fairness modes or the pollable
+ *        mode.
+ * @param cache_batch
+ *        The number of resources a thread fetches from the shared counter at
+ *        once in the caching mode, 0 disables the caching. The calling thread
+ *        keeps the resources it doesn't need yet in its cache slot, see
+ *        SEMAPHORE_CACHE_NUM_SLOTS, and releases resources into the slot as 
+ *        well, up to the resources the threads of the slots have taken. Only when its slot is empty, or holds more than twice the batch,
+ *        the shared counter is accessed. The total number of resources is 
+ *        still respected: a thread that would have to wait first returns the 
+ *        resources of all slots to the shared counter, and while it waits, 
+ *        released resources bypass the slots. The caching suits semaphores
+ *        with many resources, such as rate limiters and pools, and cannot be 
+ *        combined with a fairness mode, the pollable mode or the 
+ *        process-shared mode.
+ ********************************************************************************/
+struct counting_semaphore_options {
+    enum semaphore_wait_policy wait_policy;
+    uint16_t spin_limit;
+    const char* name;
+    enum semaphore_fairness fairness;
+    bool pollable;
+    bool process_shared;
+    uint16_t cache_batch;
+};
+
+/********************************************************************************
+ * @brief Predeclaration of counting semaphore. This structure is hidden in
+ *        the corresponding source file to make the semaphore counter private.
+ ********************************************************************************/
+struct counting_semaphore;
+
+/********************************************************************************
+ * @brief The number of 64-bit words of the private part of the storage of a
+ *        counting semaphore.
+ ********************************************************************************/
+#define COUNTING_SEMAPHORE_STORAGE_WORDS (size_t)(6)
+
+/********************************************************************************
+ * @brief Storage for a counting semaphore that isn't allocated on the heap,
+ *        so that it can be embedded in other structures, arrays or static
+ *        memory, next to the data it protects, or in memory shared between
+ *        processes. The storage is 64 bytes large, i.e. a single cache line
+ *        if aligned.
+ *
+ * @note  The storage is either initialized via counting_semaphore_init or
+ *        statically via COUNTING_SEMAPHORE_INITIALIZER. The members must not
+ *        be altered afterwards; the semaphore is accessed through the pointer
+ *        provided by counting_semaphore_from_storage. Other processes sharing
+ *        the storage of a process-shared semaphore only call the latter.
+ *
+ * @param num_resources
+ *        The number of resources available for the counting semaphore.
+ * @param spin_limit
+ *        The number of spin iterations before an adaptive waiter is parked.
+ * @param wait_policy
+ *        The strategy used when all resources are reserved.
+ * @param fairness
+ *        The order in which waiting threads reserve resources.
+ * @param event_fd
+ *        The file descriptor of the pollable mode, -1 if not selected.
+ * @param private_words
+ *        The private state of the semaphore, zero-initialized.
+ ********************************************************************************/
+struct counting_semaphore_storage {
+    uint16_t num_resources;
+    uint16_t spin_limit;
+    enum semaphore_wait_policy wait_policy;
+    enum semaphore_fairness fairness;
+    int event_fd;
+    uint64_t private_words[COUNTING_SEMAPHORE_STORAGE_WORDS];
+};
+
+/********************************************************************************
+ * @brief Static initializer for the storage of a counting semaphore with
+ *        specified number of resources and the default wait policy. A
+ *        statically initialized semaphore is ready to use without any call,
+ *        but it records no statistics and cannot use the queue fairness mode,
+ *        the pollable mode or the caching mode. It doesn't need to be 
+ *        destroyed.
+ *
+ * @param num_resources
+ *        The number of resources available for the counting semaphore, must
+ *        be at least 1.
+ ********************************************************************************/
+#define COUNTING_SEMAPHORE_INITIALIZER(num_resources) \
+    {(num_resources), BACKOFF_SPIN_LIMIT_DEFAULT, SEMAPHORE_WAIT_ADAPTIVE, SEMAPHORE_FAIR_NONE, -1, {0}}
+
+/********************************************************************************
+ * @brief Provides the counting semaphore held by specified storage.
+ *
+ * @param storage
+ *        Reference to the initialized storage.
+ * @return
+ *        A reference to the counting semaphore.
+ ********************************************************************************/
+static inline struct counting_semaphore* counting_semaphore_from_storage(struct counting_semaphore_storage* storage) {
+    return (struct counting_semaphore*)storage;
+}
+
+/********************************************************************************
+ * @brief Initializes a counting semaphore in specified storage without
+ *        allocating the semaphore on the heap. Only the turn slots of the
+ *        queue fairness mode, the cache slots of the caching mode, the file 
+ *        descriptor of the pollable mode and the statistics are allocated, if
+ *        selected.
+ *
+ * @param storage
+ *        Reference to the storage to initialize.
+ * @param num_resources
+ *        The number of resources available for the counting semaphore.
+ * @param options
+ *        Reference to creation-time options, nullptr selects the defaults.
+ * @return
+ *        A reference to the counting semaphore, nullptr if a memory allocation
+ *        or the creation of the file descriptor failed, if an invalid number
+ *        of resources was specified (num_resources = 0) or if the options
+ *        combine modes that cannot be combined.
+ ********************************************************************************/
+struct counting_semaphore* counting_semaphore_init(struct counting_semaphore_storage* storage,
+                                                   const uint16_t num_resources,
+                                                   const struct counting_semaphore_options* options);
+
+/********************************************************************************
+ * @brief Destroys a counting semaphore initialized via counting_semaphore_init
+ *        by freeing its turn slots, cache slots and statistics and closing its
+ *        file descriptor. The storage itself is left
+ *        to the caller, no thread may use the semaphore afterwards.
+ *
+ * @param self
+ *        Reference to the counting semaphore.
+ ********************************************************************************/
+void counting_semaphore_destroy(struct counting_semaphore* self);
+
+/********************************************************************************
+ * @brief Creates a new dynamically allocated counting semaphore.
+ * 
+ * @param num_resources
+ *        The number of resources available for the counting semaphore.
+ * @param options
+ *        Reference to creation-time options, nullptr selects the defaults.
+ * @return 
+ *        A reference to the counting semaphore, nullptr if the memory allocation
+ *        failed or if an invalid number of resources was specified 
+ *        (num_resources = 0).
+ ********************************************************************************/
+struct counting_semaphore* counting_semaphore_new(const uint16_t num_resources,
+                                                  const struct counting_semaphore_options* options);
+
+/********************************************************************************
+ * @brief Deletes dynamically allocated counting semaphore and sets the
+ *        corresponding pointer to null.
+ * 
+ * @param self
+ *        The address of the counting semaphore pointer.
+ ********************************************************************************/
+void counting_semaphore_delete(struct counting_semaphore** self);
+
+/********************************************************************************
+ * @brief Provides the number of reserved resources of counting semaphore. In
+ *        the caching mode, resources cached in the slots count as available,
+ *        and the number is a snapshot that may be off while threads take or
+ *        release resources.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @return
+ *        The number of reserved resources.
+ ********************************************************************************/
+uint16_t counting_semaphore_num_reserved(const struct counting_semaphore* self);
+
+/********************************************************************************
+ * @brief Provides the number of available resources of counting semaphore.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @return
+ *        The number of available resources.
+ ********************************************************************************/
+uint16_t counting_semaphore_num_available(const struct counting_semaphore* self);
+
+/********************************************************************************
+ * @brief Reserves a resource of referenced counting semaphore. The calling 
+ *        thread will be temporarily blocked if all resources are reserved,
+ *        according to the wait policy selected at creation.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ ********************************************************************************/
+void counting_semaphore_take(struct counting_semaphore* self);
+
+/********************************************************************************
+ * @brief Releases a resource of referenced counting semaphore.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ ********************************************************************************/
+void counting_semaphore_release(struct counting_semaphore* self);
+
+/********************************************************************************
+ * @brief Reserves specified number of resources of referenced counting 
+ *        semaphore. The resources are reserved all at once, the calling thread
+ *        will be temporarily blocked until enough resources are available.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param num
+ *        The number of resources to reserve.
+ * @return
+ *        True upon successful reservation, false if an invalid number of
+ *        resources was specified (num = 0 or num > total resources).
+ ********************************************************************************/
+bool counting_semaphore_take_n(struct counting_semaphore* self, const uint16_t num);
+
+/********************************************************************************
+ * @brief Reserves specified number of resources of referenced counting 
+ *        semaphore if enough resources are available. The calling thread is
+ *        never blocked. If a fairness mode is selected, the reservation fails
+ *        while other threads are queued, so that they are not overtaken.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param num
+ *        The number of resources to reserve.
+ * @return
+ *        True if the resources were reserved, false if too few resources are
+ *        available or if an invalid number of resources was specified.
+ ********************************************************************************/
+bool counting_semaphore_try_take_n(struct counting_semaphore* self, const uint16_t num);
+
+/********************************************************************************
+ * @brief Releases specified number of resources of referenced counting
+ *        semaphore all at once.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param num
+ *        The number of resources to release.
+ * @return
+ *        True upon successful release, false if an invalid number of
+ *        resources was specified (num = 0 or num > reserved resources). In the
+ *        caching mode, the cache slots track the resources taken by their
+ *        threads, so releasing more resources than taken is rejected before
+ *        the released resources become available as well. In the pollable mode,
+ *        false is also returned if the resources were released but couldn't
+ *        be added to the eventfd.
+ ********************************************************************************/
+bool counting_semaphore_release_n(struct counting_semaphore* self, const uint16_t num);
+
+/********************************************************************************
+ * @brief Provides a snapshot of the statistics of referenced counting semaphore.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param snapshot
+ *        Reference to the snapshot to fill.
+ * @return
+ *        True if the snapshot was filled, false if the instrumentation is
+ *        disabled.
+ ********************************************************************************/
+bool counting_semaphore_stats(const struct counting_semaphore* self, struct sync_stats_snapshot* snapshot);
+
+/********************************************************************************
+ * @brief Provides the file descriptor of referenced counting semaphore, which
+ *        is readable while resources are available. It lets an event loop
+ *        wait for a resource together with sockets and timers in one call to
+ *        poll, epoll_wait or io_uring (IORING_OP_POLL_ADD), without a helper
+ *        thread per semaphore.
+ *
+ * @note  The descriptor is an eventfd in semaphore mode (EFD_SEMAPHORE), whose
+ *        counter tracks the available resources. Readiness only signals that
+ *        a resource may be available: once woken, the event loop reserves it
+ *        via counting_semaphore_try_take_n, which can still fail if another
+ *        thread was faster, in which case it keeps waiting. The descriptor
+ *        must be polled level-triggered and never read or written directly.
+ *
+ * @param self
+ *        Reference to the counting semaphore.
+ * @return
+ *        The file descriptor, -1 if the semaphore isn't pollable.
+ ********************************************************************************/
+int counting_semaphore_fd(const struct counting_semaphore* self);
+
+/********************************************************************************
+ * @brief Predeclaration of reader-writer semaphore. This structure is hidden 
+ *        in the corresponding source file to make the counters private.
+ ********************************************************************************/
+struct rw_semaphore;
+
+/********************************************************************************
+ * @brief Creates a new dynamically allocated reader-writer semaphore. Any
+ *        number of readers can hold the semaphore at the same time, while a 
+ *        writer holds it exclusively.
+ * 
+ * @note  Readers only write to the reader slot of the calling thread, so the
+ *        read paths scale across cores as long as no writer is active. Writers
+ *        are preferred: once a writer is waiting, new readers wait until the
+ *        writer has released the semaphore, so writers cannot be starved.
+ * 
+ * @param name
+ *        The name of the semaphore in the statistics, nullptr selects 
+ *        "rw_semaphore".
+ * @return 
+ *        A reference to the reader-writer semaphore, nullptr if the memory 
+ *        allocation failed.
+ ********************************************************************************/
+struct rw_semaphore* rw_semaphore_new(const char* name);
+
+/********************************************************************************
+ * @brief Deletes reader-writer semaphore by freeing allocated memory. The 
+ *        semaphore pointer is set to null after deallocation.
+ * 
+ * @param self
+ *        Double pointer to the reader-writer semaphore.
+ ********************************************************************************/
+void rw_semaphore_delete(struct rw_semaphore** self);
+
+/********************************************************************************
+ * @brief Reserves referenced reader-writer semaphore for reading. The calling
+ *        thread will be temporarily blocked while a writer holds or waits for
+ *        the semaphore.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ ********************************************************************************/
+void rw_semaphore_take_read(struct rw_semaphore* self);
+
+/********************************************************************************
+ * @brief Reserves referenced reader-writer semaphore for reading if no writer
+ *        holds or waits for it, without blocking.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ * @return
+ *        True if the semaphore was reserved for reading, else false.
+ ********************************************************************************/
+bool rw_semaphore_try_take_read(struct rw_semaphore* self);
+
+/********************************************************************************
+ * @brief Releases a read reservation of referenced reader-writer semaphore. 
+ *        Must be called by the thread that made the reservation.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ ********************************************************************************/
+void rw_semaphore_release_read(struct rw_semaphore* self);
+
+/********************************************************************************
+ * @brief Reserves referenced reader-writer semaphore for writing. The calling
+ *        thread will be temporarily blocked until all readers and any other
+ *        writer have released the semaphore.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ ********************************************************************************/
+void rw_semaphore_take_write(struct rw_semaphore* self);
+
+/********************************************************************************
+ * @brief Reserves referenced reader-writer semaphore for writing if it is
+ *        not held by any reader or writer, without blocking.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ * @return
+ *        True if the semaphore was reserved for writing, else false.
+ ********************************************************************************/
+bool rw_semaphore_try_take_write(struct rw_semaphore* self);
+
+/********************************************************************************
+ * @brief Releases the write reservation of referenced reader-writer semaphore.
+ *        All threads waiting for the semaphore are woken.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ ********************************************************************************/
+void rw_semaphore_release_write(struct rw_semaphore* self);
+
+/********************************************************************************
+ * @brief Provides a snapshot of the statistics of referenced reader-writer
+ *        semaphore, covering both read and write reservations.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ * @param snapshot
+ *        Reference to the snapshot to fill.
+ * @return
+ *        True if the snapshot was filled, false if the instrumentation is
+ *        disabled.
+ ********************************************************************************/
+bool rw_semaphore_stats(const struct rw_semaphore* self, struct sync_stats_snapshot* snapshot);
+
+/********************************************************************************
+ * @brief Predeclaration of barrier. This structure is hidden in the 
+ *        corresponding source file to make the combining tree private.
+ ********************************************************************************/
+struct barrier;
+
+/********************************************************************************
+ * @brief Creates a new dynamically allocated barrier for a fixed number of 
+ *        threads. The barrier is reusable: each time all threads have arrived,
+ *        a new phase starts.
+ * 
+ * @note  Arriving threads are combined in a tree of counters, see 
+ *        BARRIER_FAN_IN, so that arrivals update different cache lines. The
+ *        last thread to arrive at a node continues to its parent, the others
+ *        wait. The thread completing the root runs the completion function 
+ *        and starts the next phase by advancing the phase word, which all 
+ *        waiting threads spin or park on, so a phase transition costs a single
+ *        broadcast wake-up instead of one wake-up per thread.
+ * 
+ * @param num_threads
+ *        The number of threads that must arrive to complete a phase.
+ * @param completion
+ *        Function run by the last arriving thread before the waiting threads
+ *        are released, nullptr for none.
+ * @param context
+ *        Argument passed to the completion function.
+ * @return 
+ *        A reference to the barrier, nullptr if the memory allocation failed
+ *        or if an invalid number of threads was specified (num_threads = 0).
+ ********************************************************************************/
+struct barrier* barrier_new(const uint32_t num_threads, void (*completion)(void* context), void* context);
+
+/********************************************************************************
+ * @brief Deletes barrier by freeing allocated memory. The barrier pointer is 
+ *        set to null after deallocation. No thread may wait on the barrier.
+ * 
+ * @param self
+ *        Double pointer to the barrier.
+ ********************************************************************************/
+void barrier_delete(struct barrier** self);
+
+/********************************************************************************
+ * @brief Arrives at the barrier and waits until all threads have arrived in 
+ *        the current phase. The calling thread spins with exponential backoff
+ *        for a bounded number of iterations before it is parked.
+ * 
+ * @param self
+ *        Reference to the barrier.
+ * @return
+ *        True for the thread that completed the phase and ran the completion
+ *        function, false for all other threads.
+ ********************************************************************************/
+bool barrier_arrive_and_wait(struct barrier* self);
+
+/********************************************************************************
+ * @brief Provides the number of phases completed by referenced barrier.
+ * 
+ * @param self
+ *        Reference to the barrier.
+ * @return
+ *        The number of completed phases, wrapping around at UINT32_MAX.
+ ********************************************************************************/
+uint32_t barrier_phase(const struct barrier* self);
+
+/********************************************************************************
+ * @brief Predeclaration of latch. This structure is hidden in the 
+ *        corresponding source file to make the counter private.
+ ********************************************************************************/
+struct latch;
+
+/********************************************************************************
+ * @brief Creates a new dynamically allocated latch, i.e. a single-use 
+ *        countdown. Threads waiting on the latch are released once the counter
+ *        reaches zero, with a single broadcast wake-up.
+ * 
+ * @param count
+ *        The initial value of the counter.
+ * @return 
+ *        A reference to the latch, nullptr if the memory allocation failed.
+ ********************************************************************************/
+struct latch* latch_new(const uint32_t count);
+
+/********************************************************************************
+ * @brief Deletes latch by freeing allocated memory. The latch pointer is set 
+ *        to null after deallocation. No thread may wait on the latch.
+ * 
+ * @param self
+ *        Double pointer to the latch.
+ ********************************************************************************/
+void latch_delete(struct latch** self);
+
+/********************************************************************************
+ * @brief Decrements the counter of referenced latch without waiting. If the 
+ *        counter reaches zero, all waiting threads are released.
+ * 
+ * @param self
+ *        Reference to the latch.
+ * @param num
+ *        The value to subtract from the counter.
+ * @return
+ *        True upon success, false if num exceeds the counter, in which case
+ *        the counter is left unchanged.
+ ********************************************************************************/
+bool latch_count_down(struct latch* self, const uint32_t num);
+
+/********************************************************************************
+ * @brief Indicates if the counter of referenced latch has reached zero, 
+ *        without waiting.
+ * 
+ * @param self
+ *        Reference to the latch.
+ * @return
+ *        True if the counter is zero, else false.
+ ********************************************************************************/
+bool latch_try_wait(const struct latch* self);
+
+/********************************************************************************
+ * @brief Waits until the counter of referenced latch reaches zero. The calling
+ *        thread spins with exponential backoff for a bounded number of 
+ *        iterations before it is parked.
+ * 
+ * @param self
+ *        Reference to the latch.
+ ********************************************************************************/
+void latch_wait(struct latch* self);
+
+/********************************************************************************
+ * @brief Decrements the counter of referenced latch and waits until it 
+ *        reaches zero.
+ * 
+ * @param self
+ *        Reference to the latch.
+ * @param num
+ *        The value to subtract from the counter.
+ * @return
+ *        True upon success, false if num exceeds the counter, in which case
+ *        the counter is left unchanged and the calling thread doesn't wait.
+ ********************************************************************************/
+bool latch_arrive_and_wait(struct latch* self, const uint32_t num);
+
+/********************************************************************************
+ * @note The following code is only available in C++.
+ ********************************************************************************/
+#else 
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <sync/cache_line.h>
+
+/********************************************************************************
+ * @brief Orders in which waiting threads reserve the resources of a counting
+ *        semaphore in C++.
+ * 
+ * @param none
+ *        Whichever thread observes a released resource first reserves it.
+ * @param ticket
+ *        FIFO order, queued threads wait on a shared counter (ticket lock).
+ * @param queue
+ *        FIFO order, each queued thread waits on a turn slot of its own cache
+ *        line (array-based queue lock).
+ ********************************************************************************/
+enum class semaphore_fairness { none, ticket, queue };
+
+/********************************************************************************
+ * @brief Wait policy for counting semaphores in C++, selected via template
+ *        parameter.
+ * 
+ * @tparam max_spins
+ *        The number of spin iterations (with exponential backoff) performed
+ *        before the waiting thread is parked.
+ * @tparam park_when_exhausted
+ *        Indicates if the thread is parked in the kernel when the spin limit
+ *        is reached (true) or if it keeps spinning (false).
+ * @tparam order
+ *        The order in which waiting threads reserve resources (default = none).
+ ********************************************************************************/
+template <uint16_t max_spins, bool park_when_exhausted, semaphore_fairness order = semaphore_fairness::none>
+struct semaphore_wait_policy {
+    static constexpr uint16_t spin_limit{max_spins};
+    static constexpr bool park{park_when_exhausted};
+    static constexpr semaphore_fairness fairness{order};
+};
+
+/********************************************************************************
+ * @brief Spins for a bounded number of iterations, then parks (default).
+ ********************************************************************************/
+template <uint16_t max_spins = BACKOFF_SPIN_LIMIT_DEFAULT>
+using semaphore_wait_adaptive = semaphore_wait_policy<max_spins, true>;
+
+/********************************************************************************
+ * @brief Spins with exponential backoff until a resource is available.
+ ********************************************************************************/
+using semaphore_wait_spin = semaphore_wait_policy<0, false>;
+
+/********************************************************************************
+ * @brief Parks the waiting thread immediately.
+ ********************************************************************************/
+using semaphore_wait_park = semaphore_wait_policy<0, true>;
+
+/********************************************************************************
+ * @brief Adaptive waiting in FIFO order, queued threads wait on a shared
+ *        counter (ticket lock). Suits low core counts.
+ ********************************************************************************/
+template <uint16_t max_spins = BACKOFF_SPIN_LIMIT_DEFAULT>
+using semaphore_fair_ticket = semaphore_wait_policy<max_spins, true, semaphore_fairness::ticket>;
+
+/********************************************************************************
+ * @brief Adaptive waiting in FIFO order, each queued thread waits on a cache
+ *        line of its own (array-based queue lock). Suits high core counts.
+ ********************************************************************************/
+template <uint16_t max_spins = BACKOFF_SPIN_LIMIT_DEFAULT>
+using semaphore_fair_queue = semaphore_wait_policy<max_spins, true, semaphore_fairness::queue>;
+
+/********************************************************************************
+ * @brief Turn state of fair counting semaphores. Each blocking reservation 
+ *        draws a ticket and waits for its turn, so that only the thread 
+ *        whose turn it is competes for the resources. Once it has reserved
+ *        them, it passes the turn to the next ticket. Unfair semaphores hold
+ *        no turn state.
+ * 
+ * @tparam fairness
+ *         The order in which waiting threads reserve resources.
+ ********************************************************************************/
+template <semaphore_fairness fairness>
+struct semaphore_turns {};
+
+/********************************************************************************
+ * @brief Turn state of the ticket fairness mode, where all queued threads
+ *        wait on the counter of the ticket being served.
+ ********************************************************************************/
+template <>
+struct semaphore_turns<semaphore_fairness::ticket> {
+    std::atomic<uint32_t>& word_of(const uint32_t) { return serving; }
+
+    void pass(const uint32_t ticket) {
+        serving.store(ticket + 1, std::memory_order_release);
+        serving.notify_all();
+    }
+
+    bool empty(void) const {
+        return next.load(std::memory_order_relaxed) == serving.load(std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> next{};    /* The next ticket to draw. */
+    std::atomic<uint32_t> serving{}; /* The ticket whose turn it is. */
+};
+
+/********************************************************************************
+ * @brief Turn state of the queue fairness mode, where each queued thread waits
+ *        on the turn slot of its ticket. The slot of ticket t holds t once it
+ *        is the turn of t, so a handover only writes the cache line of the 
+ *        next thread in line.
+ ********************************************************************************/
+template <>
+struct semaphore_turns<semaphore_fairness::queue> {
+    semaphore_turns(void) {
+        for (uint16_t i{1}; i < SEMAPHORE_FAIR_QUEUE_NUM_SLOTS; ++i) {
+            slots[i].ticket.store(UINT32_MAX, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint32_t>& word_of(const uint32_t ticket) {
+        return slots[ticket % SEMAPHORE_FAIR_QUEUE_NUM_SLOTS].ticket;
+    }
+
+    void pass(const uint32_t ticket) {
+        serving.store(ticket + 1, std::memory_order_relaxed);
+        auto& word{word_of(ticket + 1)};
+        word.store(ticket + 1, std::memory_order_release);
+        word.notify_all();
+    }
+
+    bool empty(void) const {
+        return next.load(std::memory_order_relaxed) == serving.load(std::memory_order_relaxed);
+    }
+
+    struct SYNC_CACHE_ALIGNED slot {
+        std::atomic<uint32_t> ticket{}; /* The ticket whose turn it is, if mapped to this slot. */
+    };
+
+    std::atomic<uint32_t> next{};                /* The next ticket to draw. */
+    std::atomic<uint32_t> serving{};             /* The ticket whose turn it is. */
+    slot slots[SEMAPHORE_FAIR_QUEUE_NUM_SLOTS]{}; /* The turn slots. */
+};
+
+/********************************************************************************
+ * @brief Counter of counting semaphores in C++, selected at compile time by the
+ *        number of resources. A semaphore with a single resource only holds a
+ *        flag, which is reserved via exchange like a spinlock. Otherwise the
+ *        counter is the narrowest type holding all resources, i.e. a single
+ *        byte for up to 255 resources. Larger semaphores count in 32 bits,
+ *        which is the width std::atomic::wait parks on natively (futex).
+ *
+ * @tparam num_resources
+ *         The number of resources of the semaphore.
+ ********************************************************************************/
+template <uint16_t num_resources>
+struct semaphore_counter_traits {
+    static constexpr bool binary{num_resources == 1};
+    using type = std::conditional_t<binary, bool, std::conditional_t<num_resources <= UINT8_MAX, uint8_t, uint32_t>>;
+};
+
+/********************************************************************************
+ * @brief Class for implementing counting semaphores in C++.
+ * 
+ * @tparam num_resources
+ *         The number of resources available for the counting semaphore.
+ * @tparam wait_policy
+ *         The strategy used when all resources are reserved, see
+ *         semaphore_wait_policy. The fair policies semaphore_fair_ticket and
+ *         semaphore_fair_queue make threads reserve resources in FIFO order.
+ *
+ * @note  The counter is selected via semaphore_counter_traits. A binary
+ *        semaphore (num_resources = 1) is taken by a single exchange of its
+ *        flag and released by another, so uncontended it costs as much as a
+ *        raw spinlock. If lock elision is compiled in (see sync/elision.h) and
+ *        supported by the processor, take first tries to run the critical 
+ *        section of an unfair binary semaphore as a hardware transaction, 
+ *        which is committed by release.
+ ********************************************************************************/
+template <uint16_t num_resources, typename wait_policy = semaphore_wait_adaptive<>>
+class counting_semaphore {
+    static_assert(num_resources > 0, "The number of resources for a counting semaphore cannot be 0!");
+  public:
+
+    /********************************************************************************
+     * @brief Creates new counting semaphore.
+     * 
+     * @param name
+     *        The name of the semaphore in the statistics.
+     ********************************************************************************/
+    explicit counting_semaphore(const char* name = "counting_semaphore")
+        : stats_{sync_stats_new(name)} { sync_lockdep_register(this, name); }
+
+    /********************************************************************************
+     * @brief Deletes the counting semaphore and its statistics.
+     ********************************************************************************/
+    ~counting_semaphore(void) {
+        sync_lockdep_forget(this);
+        sync_stats_delete(stats_);
+    }
+
+    counting_semaphore(const counting_semaphore&) = delete;
+    counting_semaphore& operator=(const counting_semaphore&) = delete;
+
+    /********************************************************************************
+     * @brief Provides the number of reserved resources of counting semaphore.
+     * 
+     * @return
+     *        The number of reserved resources.
+     ********************************************************************************/
+    uint16_t num_reserved_resources(void) const { 
+        return static_cast<uint16_t>(num_reserved_resources_.load(std::memory_order_relaxed)); 
+    }
+
+    /********************************************************************************
+     * @brief Provides the number of available resources of counting semaphore.
+     * 
+     * @return
+     *        The number of available resources.
+     ********************************************************************************/
+    uint16_t num_available_resources(void) const { return num_resources - num_reserved_resources(); }
+
+    /********************************************************************************
+     * @brief Reserves specified number of resources of referenced counting 
+     *        semaphore. The resources are reserved all at once, the calling 
+     *        thread will be temporarily blocked until enough resources are 
+     *        available, according to the wait policy.
+     * 
+     * @note  While too few resources are available, the calling thread spins 
+     *        with exponential backoff. When the spin limit of the wait policy is
+     *        reached, the thread is parked until the counter changes. If the
+     *        wait policy is fair, the calling thread first waits for its turn
+     *        in the same way, so that resources are reserved in FIFO order.
+     * 
+     * @param num
+     *        The number of resources to reserve (default = 1).
+     * @return
+     *        True upon successful reservation, false if an invalid number of
+     *        resources was specified (num = 0 or num > num_resources).
+     ********************************************************************************/
+    bool take(const uint16_t num = 1) {
+        if (num == 0 || num > num_resources) return false;
+        sync_lockdep_acquire(this, true);
+        if constexpr (elidable_) {
+            if (sync_elision_supported() && take_elided()) return true;
+        }
+        uint16_t spins{};
+        uint64_t wait_start{};
+        if constexpr (wait_policy::fairness == semaphore_fairness::none) {
+            reserve(num, spins, wait_start);
+        } else {
+            const auto ticket{turns_.next.fetch_add(1, std::memory_order_relaxed)};
+            wait_for_turn(ticket, spins, wait_start);
+            reserve(num, spins, wait_start);
+            turns_.pass(ticket);
+        }
+        if (wait_start) sync_stats_wait_end(stats_);
+        sync_stats_acquired(stats_, wait_start, spins);
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Reserves specified number of resources of referenced counting 
+     *        semaphore if enough resources are available. The calling thread is
+     *        never blocked. If the wait policy is fair, the reservation fails
+     *        while other threads are queued, so that they are not overtaken.
+     * 
+     * @param num
+     *        The number of resources to reserve (default = 1).
+     * @return
+     *        True if the resources were reserved, false if too few resources are
+     *        available or if an invalid number of resources was specified.
+     ********************************************************************************/
+    bool try_take(const uint16_t num = 1) {
+        if (!try_reserve(num)) return false;
+        sync_stats_acquired(stats_, 0, 0);
+        sync_lockdep_acquire(this, false);
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Reserves specified number of resources of referenced counting 
+     *        semaphore. The calling thread will be blocked at most for specified 
+     *        duration if too few resources are available.
+     * 
+     * @param timeout
+     *        The maximum time to wait for the resources.
+     * @param num
+     *        The number of resources to reserve (default = 1).
+     * @return
+     *        True if the resources were reserved, false if the timeout expired
+     *        or if an invalid number of resources was specified.
+     ********************************************************************************/
+    template <typename Rep, typename Period>
+    bool take_for(const std::chrono::duration<Rep, Period>& timeout, const uint16_t num = 1) {
+        return take_until(std::chrono::steady_clock::now() + timeout, num);
+    }
+
+    /********************************************************************************
+     * @brief Reserves specified number of resources of referenced counting 
+     *        semaphore. The calling thread will be blocked at most until 
+     *        specified point in time if too few resources are available.
+     * 
+     * @note  std::atomic::wait has no timed overload, so when the spin limit of
+     *        the wait policy is reached, a timed waiter sleeps in steps that 
+     *        double from 50 us up to 1 ms (and never beyond the deadline)
+     *        instead of being parked on the counter. A timed waiter cannot
+     *        leave the queue of a fair semaphore once queued, so it never 
+     *        draws a ticket. Instead it only reserves resources while no other
+     *        thread is queued, which keeps the FIFO order of queued threads.
+     *        A timed wait cannot deadlock, so it adds no edges to the 
+     *        lock-order graph.
+     * 
+     * @param deadline
+     *        The point in time when to stop waiting for the resources.
+     * @param num
+     *        The number of resources to reserve (default = 1).
+     * @return
+     *        True if the resources were reserved, false if the deadline was 
+     *        reached or if an invalid number of resources was specified.
+     ********************************************************************************/
+    template <typename Clock, typename Duration>
+    bool take_until(const std::chrono::time_point<Clock, Duration>& deadline, const uint16_t num = 1) {
+        if (num == 0 || num > num_resources) return false;
+        if (try_take(num)) return true;
+        const auto wait_start{sync_stats_now()};
+        uint16_t spins{};
+        std::chrono::microseconds sleep_time{min_sleep_time_};
+        sync_stats_wait_begin(stats_);
+        while (!try_reserve(num)) {
+            const auto now{Clock::now()};
+            if (now >= deadline) {
+                sync_stats_wait_end(stats_);
+                return false;
+            }
+            if (!wait_policy::park || spins < wait_policy::spin_limit) {
+                backoff_pause(spins);
+                if (spins < UINT16_MAX) spins++;
+            } else {
+                const auto remaining{std::chrono::ceil<std::chrono::microseconds>(deadline - now)};
+                std::this_thread::sleep_for(remaining < sleep_time ? remaining : sleep_time);
+                if (sleep_time < max_sleep_time_) sleep_time *= 2;
+            }
+        }
+        sync_stats_wait_end(stats_);
+        sync_stats_acquired(stats_, wait_start, spins);
+        sync_lockdep_acquire(this, false);
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Provides a snapshot of the statistics of the counting semaphore.
+     * 
+     * @param snapshot
+     *        Reference to the snapshot to fill.
+     * @return
+     *        True if the snapshot was filled, false if the instrumentation is
+     *        disabled.
+     ********************************************************************************/
+    bool stats(sync_stats_snapshot& snapshot) const { return sync_stats_read(stats_, &snapshot); }
+
+    /********************************************************************************
+     * @brief Releases specified number of resources of referenced counting 
+     *        semaphore. 
+     * 
+     * @note  The counter is decremented in a compare-and-swap loop, which fails
+     *        without modifying the counter if fewer resources than specified 
+     *        are reserved. Otherwise parked threads are notified one at a 
+     *        time, unless several resources were released or a thread waits
+     *        for several resources. The flag of a
+     *        binary semaphore is cleared by a single exchange instead, unless
+     *        its critical section was elided, in which case the transaction is
+     *        committed.
+     * 
+     * @param num
+     *        The number of resources to release (default = 1).
+     * @return
+     *        True upon successful release, false if an invalid number of
+     *        resources was specified (num = 0 or num > reserved resources).
+     ********************************************************************************/
+    bool release(const uint16_t num = 1) {
+        if (num == 0 || num > num_resources) return false;
+        if constexpr (elidable_) {
+            if (sync_elision_active() && !num_reserved_resources_.load(std::memory_order_relaxed)) {
+                sync_elision_end();
+                sync_stats_elided(stats_);
+                sync_lockdep_release(this);
+                return true;
+            }
+        }
+        if constexpr (counter_traits::binary) {
+            if (!num_reserved_resources_.exchange(false, std::memory_order_release)) return false;
+            if constexpr (wait_policy::park) num_reserved_resources_.notify_one();
+        } else {
+            const auto count{static_cast<counter_type>(num)};
+            auto reserved{num_reserved_resources_.load(std::memory_order_relaxed)};
+            do {
+                if (reserved < count) return false;
+            } while (!num_reserved_resources_.compare_exchange_weak(reserved, static_cast<counter_type>(reserved - count),
+                                                                    std::memory_order_seq_cst, std::memory_order_relaxed));
+            if constexpr (wait_policy::park) {
+                if (num == 1 && num_bulk_waiters_.load(std::memory_order_seq_cst) == 0) {
+                    num_reserved_resources_.notify_one();
+                } else {
+                    num_reserved_resources_.notify_all();
+                }
+            }
+        }
+        sync_stats_released(stats_);
+        sync_lockdep_release(this);
+        return true;
+    }
+
+  private:
+    using counter_traits = semaphore_counter_traits<num_resources>;
+    using counter_type = typename counter_traits::type;
+    static constexpr bool elidable_{counter_traits::binary && wait_policy::fairness == semaphore_fairness::none};
+
+    /********************************************************************************
+     * @brief Reserves specified number of resources if enough resources are 
+     *        available and no thread is queued, without recording the 
+     *        acquisition in the statistics.
+     * 
+     * @param num
+     *        The number of resources to reserve.
+     * @return
+     *        True if the resources were reserved, else false.
+     ********************************************************************************/
+    bool try_reserve(const uint16_t num) {
+        if (num == 0 || num > num_resources) return false;
+        if constexpr (wait_policy::fairness != semaphore_fairness::none) {
+            if (!turns_.empty()) return false;
+        }
+        if constexpr (counter_traits::binary) {
+            return !num_reserved_resources_.load(std::memory_order_relaxed) &&
+                   !num_reserved_resources_.exchange(true, std::memory_order_acquire);
+        }
+        auto reserved{num_reserved_resources_.load(std::memory_order_relaxed)};
+        while (reserved + num <= num_resources) {
+            if (num_reserved_resources_.compare_exchange_weak(reserved, static_cast<counter_type>(reserved + num),
+                                                              std::memory_order_acquire,
+                                                              std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /********************************************************************************
+     * @brief Reserves specified number of resources, spinning and parking 
+     *        according to the wait policy while too few resources are available.
+     *        The flag of a binary semaphore is only exchanged once it was seen
+     *        cleared, so that waiters spin on a shared cache line.
+     * 
+     * @param num
+     *        The number of resources to reserve.
+     * @param spins
+     *        Reference to the number of spin iterations performed so far.
+     * @param wait_start
+     *        Reference to the start time of the wait, 0 until the thread waits.
+     ********************************************************************************/
+    void reserve(const uint16_t num, uint16_t& spins, uint64_t& wait_start) {
+        if constexpr (counter_traits::binary) {
+            while (num_reserved_resources_.exchange(true, std::memory_order_acquire)) {
+                do {
+                    begin_wait(wait_start);
+                    if (!wait_policy::park || spins < wait_policy::spin_limit) {
+                        backoff_pause(spins);
+                        if (spins < UINT16_MAX) spins++;
+                    } else {
+                        num_reserved_resources_.wait(true, std::memory_order_relaxed);
+                    }
+                } while (num_reserved_resources_.load(std::memory_order_relaxed));
+            }
+            return;
+        }
+        auto reserved{num_reserved_resources_.load(std::memory_order_relaxed)};
+        while (1) {
+            if (reserved + num <= num_resources) {
+                if (num_reserved_resources_.compare_exchange_weak(reserved, static_cast<counter_type>(reserved + num), 
+                                                                  std::memory_order_acquire,
+                                                                  std::memory_order_relaxed)) {
+                    return;
+                }
+                continue;
+            }
+            begin_wait(wait_start);
+            if (!wait_policy::park || spins < wait_policy::spin_limit) {
+                backoff_pause(spins);
+                if (spins < UINT16_MAX) spins++;
+            } else {
+                wait(reserved, num);
+            }
+            reserved = num_reserved_resources_.load(std::memory_order_relaxed);
+        }
+    }
+
+    /********************************************************************************
+     * @brief Waits until it is the turn of specified ticket, spinning and 
+     *        parking on the turn word according to the wait policy.
+     * 
+     * @param ticket
+     *        The ticket of the calling thread.
+     * @param spins
+     *        Reference to the number of spin iterations performed so far.
+     * @param wait_start
+     *        Reference to the start time of the wait, 0 until the thread waits.
+     ********************************************************************************/
+    void wait_for_turn(const uint32_t ticket, uint16_t& spins, uint64_t& wait_start) {
+        auto& word{turns_.word_of(ticket)};
+        auto current{word.load(std::memory_order_acquire)};
+        while (current != ticket) {
+            begin_wait(wait_start);
+            if (!wait_policy::park || spins < wait_policy::spin_limit) {
+                backoff_pause(spins);
+                if (spins < UINT16_MAX) spins++;
+            } else {
+                word.wait(current, std::memory_order_acquire);
+            }
+            current = word.load(std::memory_order_acquire);
+        }
+    }
+
+    /********************************************************************************
+     * @brief Tries to elide the reservation of a binary semaphore via a 
+     *        hardware transaction, which reads the flag, so that a thread 
+     *        taking the semaphore for real aborts it. Aborted transactions are
+     *        retried after backing off until SYNC_ELISION_MAX_ABORTS aborts,
+     *        unless a retry is futile.
+     * 
+     * @return
+     *        True if the calling thread runs the critical section 
+     *        transactionally, false if it must take the semaphore normally.
+     ********************************************************************************/
+    bool take_elided(void) {
+        for (uint16_t num_aborts{}; num_aborts < SYNC_ELISION_MAX_ABORTS; ) {
+            const auto status{sync_elision_begin()};
+            if (status == SYNC_ELISION_STARTED) {
+                if (!num_reserved_resources_.load(std::memory_order_relaxed)) return true;
+                sync_elision_abort_busy();
+            }
+            sync_stats_elision_aborted(stats_);
+            if (!sync_elision_retry(status)) return false;
+            backoff_pause(num_aborts++);
+        }
+        return false;
+    }
+
+    /********************************************************************************
+     * @brief Records the start of a wait in the statistics, unless already done.
+     * 
+     * @param wait_start
+     *        Reference to the start time of the wait, 0 until the thread waits.
+     ********************************************************************************/
+    void begin_wait(uint64_t& wait_start) {
+        if (!wait_start) {
+            wait_start = sync_stats_now();
+            sync_stats_wait_begin(stats_);
+        }
+    }
+
+    /********************************************************************************
+     * @brief Parks the calling thread as long as the counter holds specified
+     *        value. Threads waiting for several resources are registered, since
+     *        a single release might not be sufficient for them, which would make 
+     *        a notification of only one thread lose the wake-up of another.
+     * 
+     * @param reserved
+     *        The last observed number of reserved resources.
+     * @param num
+     *        The number of resources the calling thread waits for.
+     ********************************************************************************/
+    void wait(const counter_type reserved, const uint16_t num) {
+        if (num == 1) {
+            num_reserved_resources_.wait(reserved, std::memory_order_relaxed);
+        } else {
+            num_bulk_waiters_.fetch_add(1, std::memory_order_seq_cst);
+            num_reserved_resources_.wait(reserved, std::memory_order_seq_cst);
+            num_bulk_waiters_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    static constexpr std::chrono::microseconds min_sleep_time_{50};   /* First sleep of a timed waiter. */
+    static constexpr std::chrono::microseconds max_sleep_time_{1000}; /* Longest sleep of a timed waiter. */
+    std::atomic<counter_type> num_reserved_resources_{}; /* Counts the number of reserved resources. */
+    std::atomic<uint16_t> num_bulk_waiters_{};           /* Counts threads parked for several resources. */
+    sync_stats* stats_;                                  /* Statistics, nullptr if disabled. */
+    [[no_unique_address]] semaphore_turns<wait_policy::fairness> turns_{}; /* Turn state if fair. */
+};
+
+/********************************************************************************
+ * @brief Class for implementing reader-writer semaphores in C++. Any number of
+ *        readers can hold the semaphore at the same time, while a writer holds
+ *        it exclusively. The class meets the Lockable and SharedLockable 
+ *        requirements, so it can be used with std::lock_guard, std::unique_lock
+ *        and std::shared_lock.
+ * 
+ * @note  Each reader only writes to the reader slot of the calling thread, so 
+ *        the read paths scale across cores as long as no writer is active. 
+ *        Writers are preferred: once a writer is waiting, new readers wait 
+ *        until the writer has released the semaphore, so writers cannot be 
+ *        starved. Readers and writers waiting for a writer spin with 
+ *        exponential backoff for a bounded number of iterations before they 
+ *        are parked.
+ ********************************************************************************/
+class rw_semaphore {
+  public:
+
+    /********************************************************************************
+     * @brief Creates new reader-writer semaphore.
+     * 
+     * @param name
+     *        The name of the semaphore in the statistics.
+     ********************************************************************************/
+    explicit rw_semaphore(const char* name = "rw_semaphore")
+        : stats_{sync_stats_new(name)} { sync_lockdep_register(this, name); }
+
+    /********************************************************************************
+     * @brief Deletes the reader-writer semaphore and its statistics.
+     ********************************************************************************/
+    ~rw_semaphore(void) {
+        sync_lockdep_forget(this);
+        sync_stats_delete(stats_);
+    }
+
+    rw_semaphore(const rw_semaphore&) = delete;
+    rw_semaphore& operator=(const rw_semaphore&) = delete;
+
+    /********************************************************************************
+     * @brief Reserves the semaphore for reading. The calling thread will be 
+     *        temporarily blocked while a writer holds or waits for the semaphore.
+     ********************************************************************************/
+    void take_read(void) {
+        sync_lockdep_acquire(this, true);
+        auto& slot{slot_of_thread()};
+        if (enter(slot)) {
+            sync_stats_acquired(stats_, 0, 0);
+            return;
+        }
+        const auto wait_start{sync_stats_now()};
+        sync_stats_wait_begin(stats_);
+        uint16_t spins{};
+        do {
+            wait_for_writer(spins);
+        } while (!enter(slot));
+        sync_stats_wait_end(stats_);
+        sync_stats_acquired(stats_, wait_start, spins);
+    }
+
+    /********************************************************************************
+     * @brief Reserves the semaphore for reading if no writer holds or waits for
+     *        it, without blocking.
+     * 
+     * @return
+     *        True if the semaphore was reserved for reading, else false.
+     ********************************************************************************/
+    bool try_take_read(void) {
+        if (!enter(slot_of_thread())) return false;
+        sync_stats_acquired(stats_, 0, 0);
+        sync_lockdep_acquire(this, false);
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Releases a read reservation. Must be called by the thread that made
+     *        the reservation.
+     ********************************************************************************/
+    void release_read(void) {
+        sync_stats_released(stats_);
+        sync_lockdep_release(this);
+        leave(slot_of_thread());
+    }
+
+    /********************************************************************************
+     * @brief Reserves the semaphore for writing. The calling thread will be 
+     *        temporarily blocked until all readers and any other writer have 
+     *        released the semaphore.
+     * 
+     * @note  The writer word is claimed first, so new readers wait for us. Then
+     *        we wait for the readers to leave, slot by slot, spinning before we
+     *        park on the drain sequence. The sequence is read before the slot, 
+     *        so a reader leaving in between makes the wait return immediately.
+     ********************************************************************************/
+    void take_write(void) {
+        sync_lockdep_acquire(this, true);
+        auto state{no_writer_};
+        uint16_t spins{};
+        uint64_t wait_start{};
+        if (!writer_.compare_exchange_strong(state, writer_active_, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+            wait_start = sync_stats_now();
+            sync_stats_wait_begin(stats_);
+            claim_writer(state, spins);
+        }
+        for (auto& slot : slots_) {
+            while (slot.num_readers.load(std::memory_order_seq_cst)) {
+                if (!wait_start) {
+                    wait_start = sync_stats_now();
+                    sync_stats_wait_begin(stats_);
+                }
+                if (spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+                    backoff_pause(spins++);
+                    continue;
+                }
+                const auto seq{drain_seq_.load(std::memory_order_seq_cst)};
+                if (slot.num_readers.load(std::memory_order_seq_cst)) {
+                    drain_seq_.wait(seq, std::memory_order_seq_cst);
+                }
+            }
+        }
+        if (wait_start) sync_stats_wait_end(stats_);
+        sync_stats_acquired(stats_, wait_start, spins);
+    }
+
+    /********************************************************************************
+     * @brief Reserves the semaphore for writing if it is not held by any reader
+     *        or writer, without blocking.
+     * 
+     * @return
+     *        True if the semaphore was reserved for writing, else false.
+     ********************************************************************************/
+    bool try_take_write(void) {
+        auto state{no_writer_};
+        if (!writer_.compare_exchange_strong(state, writer_active_, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+            return false;
+        }
+        for (const auto& slot : slots_) {
+            if (slot.num_readers.load(std::memory_order_seq_cst)) {
+                release_writer();
+                return false;
+            }
+        }
+        sync_stats_acquired(stats_, 0, 0);
+        sync_lockdep_acquire(this, false);
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Releases the write reservation. All threads waiting for the 
+     *        semaphore are woken.
+     ********************************************************************************/
+    void release_write(void) {
+        sync_stats_released(stats_);
+        sync_lockdep_release(this);
+        release_writer();
+    }
+
+    /********************************************************************************
+     * @brief Lockable and SharedLockable interface, forwarded to the write and
+     *        read reservations respectively.
+     ********************************************************************************/
+    void lock(void) { take_write(); }
+    bool try_lock(void) { return try_take_write(); }
+    void unlock(void) { release_write(); }
+    void lock_shared(void) { take_read(); }
+    bool try_lock_shared(void) { return try_take_read(); }
+    void unlock_shared(void) { release_read(); }
+
+    /********************************************************************************
+     * @brief Provides a snapshot of the statistics of the semaphore, covering 
+     *        both read and write reservations.
+     * 
+     * @param snapshot
+     *        Reference to the snapshot to fill.
+     * @return
+     *        True if the snapshot was filled, false if no statistics are available.
+     ********************************************************************************/
+    bool stats(sync_stats_snapshot& snapshot) const { return sync_stats_read(stats_, &snapshot); }
+
+  private:
+
+    /********************************************************************************
+     * @brief Reader slot, placed on a cache line of its own so that readers of
+     *        different slots never share a cache line.
+     ********************************************************************************/
+    struct SYNC_CACHE_ALIGNED reader_slot {
+        std::atomic<uint32_t> num_readers{}; /* Readers of the threads assigned to the slot. */
+    };
+
+    /********************************************************************************
+     * @brief Provides the reader slot of the calling thread. Threads are 
+     *        assigned to slots round robin on first use, and the assignment is
+     *        fixed so that a read reservation is released on the slot where it
+     *        was made.
+     * 
+     * @return
+     *        Reference to the reader slot of the calling thread.
+     ********************************************************************************/
+    reader_slot& slot_of_thread(void) {
+        static std::atomic<uint32_t> num_threads{};
+        static thread_local const uint32_t index{num_threads.fetch_add(1, std::memory_order_relaxed) %
+                                                 RW_SEMAPHORE_NUM_SLOTS};
+        return slots_[index];
+    }
+
+    /********************************************************************************
+     * @brief Tries to enter specified reader slot. The reader is registered 
+     *        before the writer word is checked, both with sequential consistency,
+     *        so either the reader sees the writer and leaves, or the writer sees
+     *        the reader and waits for it to leave.
+     * 
+     * @param slot
+     *        Reference to the reader slot of the calling thread.
+     * @return
+     *        True if the reader entered, false if a writer holds or waits for
+     *        the semaphore.
+     ********************************************************************************/
+    bool enter(reader_slot& slot) {
+        slot.num_readers.fetch_add(1, std::memory_order_seq_cst);
+        if (writer_.load(std::memory_order_seq_cst) == no_writer_) return true;
+        leave(slot);
+        return false;
+    }
+
+    /********************************************************************************
+     * @brief Leaves specified reader slot. If a writer is active, it is woken in
+     *        case it waits for the readers to leave.
+     * 
+     * @param slot
+     *        Reference to the reader slot of the calling thread.
+     ********************************************************************************/
+    void leave(reader_slot& slot) {
+        slot.num_readers.fetch_sub(1, std::memory_order_seq_cst);
+        if (writer_.load(std::memory_order_seq_cst) != no_writer_) {
+            drain_seq_.fetch_add(1, std::memory_order_seq_cst);
+            drain_seq_.notify_one();
+        }
+    }
+
+    /********************************************************************************
+     * @brief Waits until no writer holds or waits for the semaphore, spinning 
+     *        for a bounded number of iterations before the writer word is 
+     *        marked as contended and the thread is parked on it.
+     * 
+     * @param spins
+     *        Reference to the number of spin iterations performed so far.
+     ********************************************************************************/
+    void wait_for_writer(uint16_t& spins) {
+        auto state{writer_.load(std::memory_order_relaxed)};
+        while (state != no_writer_) {
+            if (spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+                backoff_pause(spins++);
+            } else if (state == writer_contended_ ||
+                       writer_.compare_exchange_weak(state, writer_contended_, std::memory_order_relaxed)) {
+                writer_.wait(writer_contended_, std::memory_order_relaxed);
+            } else {
+                continue;
+            }
+            state = writer_.load(std::memory_order_relaxed);
+        }
+    }
+
+    /********************************************************************************
+     * @brief Claims the writer word after the fast path failed, in the same way
+     *        as a three-state futex mutex.
+     * 
+     * @param state
+     *        The state of the writer word observed by the fast path.
+     * @param spins
+     *        Reference to the number of spin iterations performed so far.
+     ********************************************************************************/
+    void claim_writer(uint32_t state, uint16_t& spins) {
+        while (state != writer_contended_ && spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+            backoff_pause(spins++);
+            state = no_writer_;
+            if (writer_.compare_exchange_weak(state, writer_active_, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        while (writer_.exchange(writer_contended_, std::memory_order_seq_cst) != no_writer_) {
+            writer_.wait(writer_contended_, std::memory_order_relaxed);
+        }
+    }
+
+    /********************************************************************************
+     * @brief Releases the writer word and wakes all threads parked on it.
+     ********************************************************************************/
+    void release_writer(void) {
+        if (writer_.exchange(no_writer_, std::memory_order_seq_cst) == writer_contended_) {
+            writer_.notify_all();
+        }
+    }
+
+    static constexpr uint32_t no_writer_{0};        /* No writer holds or waits for the semaphore. */
+    static constexpr uint32_t writer_active_{1};    /* A writer holds or waits, nobody is parked. */
+    static constexpr uint32_t writer_contended_{2}; /* A writer holds or waits, threads might be parked. */
+    reader_slot slots_[RW_SEMAPHORE_NUM_SLOTS]{};   /* The reader slots. */
+    SYNC_CACHE_ALIGNED std::atomic<uint32_t> writer_{no_writer_}; /* The writer word. */
+    std::atomic<uint32_t> drain_seq_{};             /* Bumped by readers leaving while a writer is active. */
+    sync_stats* stats_;                             /* Statistics, nullptr if disabled. */
+};
+
+/********************************************************************************
+ * @brief Completion function of a barrier that does nothing.
+ ********************************************************************************/
+struct barrier_no_completion {
+    void operator()(void) noexcept {}
+};
+
+/********************************************************************************
+ * @brief Class for implementing reusable barriers for a fixed number of 
+ *        threads in C++. Each time all threads have arrived, the completion 
+ *        function is run and a new phase starts.
+ * 
+ * @note  Arriving threads are combined in a tree of counters, see 
+ *        BARRIER_FAN_IN, so that arrivals update different cache lines. The 
+ *        last thread to arrive at a node continues to its parent, the others
+ *        wait. The thread completing the root runs the completion function and
+ *        advances the phase word, which all waiting threads spin or park on,
+ *        so a phase transition costs a single broadcast wake-up.
+ * 
+ *        The counters are never reset: in phase p, a node with n expected 
+ *        arrivals counts from p * n to (p + 1) * n, wrapping around. A thread
+ *        arriving at a full leaf therefore sees it as full until the next 
+ *        phase and tries the next leaf instead.
+ * 
+ * @tparam completion_function
+ *         The type of the completion function, callable without arguments 
+ *         (default = barrier_no_completion).
+ ********************************************************************************/
+template <typename completion_function = barrier_no_completion>
+class barrier {
+  public:
+
+    /********************************************************************************
+     * @brief Creates new barrier.
+     * 
+     * @param num_threads
+     *        The number of threads that must arrive to complete a phase, at 
+     *        least 1.
+     * @param completion
+     *        The function run by the last arriving thread of each phase before
+     *        the waiting threads are released.
+     ********************************************************************************/
+    explicit barrier(const uint32_t num_threads, completion_function completion = completion_function{})
+        : num_leaves_{num_nodes_at(num_threads)}, nodes_{std::make_unique<node[]>(num_nodes_of(num_threads))},
+          completion_{std::move(completion)} {
+        uint32_t offset{}, num_arrivals{num_threads}, num_nodes{num_leaves_};
+        while (true) {
+            for (uint32_t i{}; i < num_nodes; ++i) {
+                auto& current{nodes_[offset + i]};
+                current.expected = num_arrivals - i * BARRIER_FAN_IN < BARRIER_FAN_IN ?
+                                   num_arrivals - i * BARRIER_FAN_IN : BARRIER_FAN_IN;
+                current.parent = num_nodes == 1 ? no_parent_ : offset + num_nodes + i / BARRIER_FAN_IN;
+            }
+            if (num_nodes == 1) break;
+            offset += num_nodes;
+            num_arrivals = num_nodes;
+            num_nodes = num_nodes_at(num_nodes);
+        }
+    }
+
+    barrier(const barrier&) = delete;
+    barrier& operator=(const barrier&) = delete;
+
+    /********************************************************************************
+     * @brief Arrives at the barrier and waits until all threads have arrived in
+     *        the current phase. The calling thread spins with exponential 
+     *        backoff for a bounded number of iterations before it is parked.
+     * 
+     * @note  The phase is read before arriving; it cannot advance until we have
+     *        arrived. All counters are updated with acquire-release ordering 
+     *        and the phase is advanced with release ordering, so the writes of
+     *        all threads before arriving are visible to the completion function
+     *        and to every thread after the wait.
+     * 
+     * @return
+     *        True for the thread that completed the phase and ran the 
+     *        completion function, false for all other threads.
+     ********************************************************************************/
+    bool arrive_and_wait(void) {
+        const auto arrival_phase{phase_.load(std::memory_order_acquire)};
+        if (!arrive(arrival_phase)) {
+            uint16_t spins{};
+            while (phase_.load(std::memory_order_acquire) == arrival_phase) {
+                if (spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+                    backoff_pause(spins++);
+                } else {
+                    phase_.wait(arrival_phase, std::memory_order_acquire);
+                }
+            }
+            return false;
+        }
+        completion_();
+        phase_.store(arrival_phase + 1, std::memory_order_release);
+        phase_.notify_all();
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Provides the number of phases completed by the barrier.
+     * 
+     * @return
+     *        The number of completed phases, wrapping around at UINT32_MAX.
+     ********************************************************************************/
+    uint32_t phase(void) const { return phase_.load(std::memory_order_acquire); }
+
+  private:
+
+    /********************************************************************************
+     * @brief Node of the combining tree, placed on a cache line of its own.
+     ********************************************************************************/
+    struct SYNC_CACHE_ALIGNED node {
+        std::atomic<uint32_t> count{}; /* The arrivals of all phases so far. */
+        uint32_t expected{};           /* The number of arrivals per phase. */
+        uint32_t parent{};             /* The index of the parent, no_parent_ for the root. */
+    };
+
+    /********************************************************************************
+     * @brief Provides the number of nodes combining specified number of 
+     *        arrivals.
+     * 
+     * @param num_arrivals
+     *        The number of arrivals.
+     * @return
+     *        The number of nodes, at least 1.
+     ********************************************************************************/
+    static uint32_t num_nodes_at(const uint32_t num_arrivals) {
+        return num_arrivals > BARRIER_FAN_IN ? (num_arrivals + BARRIER_FAN_IN - 1) / BARRIER_FAN_IN : 1;
+    }
+
+    /********************************************************************************
+     * @brief Provides the number of nodes of the tree for specified number of
+     *        threads.
+     * 
+     * @param num_threads
+     *        The number of threads.
+     * @return
+     *        The number of nodes of all levels.
+     ********************************************************************************/
+    static uint32_t num_nodes_of(const uint32_t num_threads) {
+        uint32_t num_nodes{num_nodes_at(num_threads)}, total{num_nodes};
+        while (num_nodes > 1) {
+            num_nodes = num_nodes_at(num_nodes);
+            total += num_nodes;
+        }
+        return total;
+    }
+
+    /********************************************************************************
+     * @brief Provides the leaf the calling thread tries first. Threads are 
+     *        assigned to leaves round robin on first use.
+     * 
+     * @return
+     *        The index of the first leaf to try.
+     ********************************************************************************/
+    uint32_t leaf_of_thread(void) const {
+        static std::atomic<uint32_t> num_threads{};
+        static thread_local const uint32_t index{num_threads.fetch_add(1, std::memory_order_relaxed)};
+        return index % num_leaves_;
+    }
+
+    /********************************************************************************
+     * @brief Arrives at the combining tree in specified phase. A leaf that is 
+     *        full in this phase is skipped, which terminates since the leaves
+     *        together expect exactly one arrival per thread.
+     * 
+     * @param arrival_phase
+     *        The current phase.
+     * @return
+     *        True if the calling thread completed the root, else false.
+     ********************************************************************************/
+    bool arrive(const uint32_t arrival_phase) {
+        auto index{leaf_of_thread()};
+        while (true) {
+            auto& leaf{nodes_[index]};
+            const uint32_t base{arrival_phase * leaf.expected};
+            auto count{leaf.count.load(std::memory_order_relaxed)};
+            while (count - base < leaf.expected) {
+                if (leaf.count.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel,
+                                                    std::memory_order_relaxed)) {
+                    if (count + 1 - base != leaf.expected) return false;
+                    for (auto parent{leaf.parent}; parent != no_parent_; parent = nodes_[parent].parent) {
+                        auto& current{nodes_[parent]};
+                        const auto arrived{current.count.fetch_add(1, std::memory_order_acq_rel) + 1};
+                        if (arrived - arrival_phase * current.expected != current.expected) return false;
+                    }
+                    return true;
+                }
+            }
+            index = index + 1 < num_leaves_ ? index + 1 : 0;
+        }
+    }
+
+    static constexpr uint32_t no_parent_{UINT32_MAX}; /* Parent index of the root. */
+    const uint32_t num_leaves_;                       /* The number of leaves of the tree. */
+    std::unique_ptr<node[]> nodes_;                   /* The leaves, followed by each upper level. */
+    completion_function completion_;                  /* Run once per phase. */
+    SYNC_CACHE_ALIGNED std::atomic<uint32_t> phase_{}; /* The number of completed phases. */
+};
+
+/********************************************************************************
+ * @brief Class for implementing latches, i.e. single-use countdowns, in C++.
+ *        Threads waiting on the latch are released once the counter reaches
+ *        zero, with a single broadcast wake-up.
+ ********************************************************************************/
+class latch {
+  public:
+
+    /********************************************************************************
+     * @brief Creates new latch.
+     * 
+     * @param count
+     *        The initial value of the counter.
+     ********************************************************************************/
+    explicit latch(const uint32_t count) : count_{count} {}
+
+    latch(const latch&) = delete;
+    latch& operator=(const latch&) = delete;
+
+    /********************************************************************************
+     * @brief Decrements the counter without waiting. If the counter reaches 
+     *        zero, all waiting threads are released.
+     * 
+     * @param num
+     *        The value to subtract from the counter (default = 1).
+     * @return
+     *        True upon success, false if num exceeds the counter, in which case
+     *        the counter is left unchanged.
+     ********************************************************************************/
+    bool count_down(const uint32_t num = 1) {
+        auto count{count_.load(std::memory_order_relaxed)};
+        do {
+            if (num > count) return false;
+        } while (!count_.compare_exchange_weak(count, count - num, std::memory_order_acq_rel,
+                                               std::memory_order_relaxed));
+        if (count == num) count_.notify_all();
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Indicates if the counter has reached zero, without waiting.
+     * 
+     * @return
+     *        True if the counter is zero, else false.
+     ********************************************************************************/
+    bool try_wait(void) const { return count_.load(std::memory_order_acquire) == 0; }
+
+    /********************************************************************************
+     * @brief Waits until the counter reaches zero. The calling thread spins with
+     *        exponential backoff for a bounded number of iterations before it is
+     *        parked.
+     ********************************************************************************/
+    void wait(void) const {
+        uint16_t spins{};
+        auto count{count_.load(std::memory_order_acquire)};
+        while (count != 0) {
+            if (spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+                backoff_pause(spins++);
+            } else {
+                count_.wait(count, std::memory_order_acquire);
+            }
+            count = count_.load(std::memory_order_acquire);
+        }
+    }
+
+    /********************************************************************************
+     * @brief Decrements the counter and waits until it reaches zero.
+     * 
+     * @param num
+     *        The value to subtract from the counter (default = 1).
+     * @return
+     *        True upon success, false if num exceeds the counter, in which case
+     *        the counter is left unchanged and the calling thread doesn't wait.
+     ********************************************************************************/
+    bool arrive_and_wait(const uint32_t num = 1) {
+        if (!count_down(num)) return false;
+        wait();
+        return true;
+    }
+
+  private:
+    std::atomic<uint32_t> count_; /* The remaining count. */
+};
+
+#endif /* ifndef __cplusplus */
\ No newline at end of file
@@ -0,0 +1,275 @@
+/********************************************************************************
+ * @brief Contains sequence locks (seqlocks) for publishing small, read-mostly
+ *        values in C and C++. A macro interface over a structure is
+ *        implemented for C, while a class template is implemented for C++.
+ *
+ * @note  A seqlock consists of a sequence counter and a value. A writer makes
+ *        the counter odd, updates the value and makes the counter even again.
+ *        A reader copies the value and retries if the counter was odd or
+ *        changed meanwhile. Readers therefore never write to shared memory and
+ *        never block writers, which makes snapshots of small values cost only
+ *        a few nanoseconds as long as writes are rare.
+ *
+ *        Writers are serialized via compare-and-swap on the counter, so
+ *        several writers may update the same seqlock. The value must be
+ *        trivially copyable, since it is copied while it may be written.
+ ********************************************************************************/
+#pragma once
+
+/********************************************************************************
+ * @note The following code is only available in C.
+ ********************************************************************************/
+#ifndef __cplusplus
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sync/backoff.h>
+
+/********************************************************************************
+ * @brief Declares a seqlock structure holding a value of specified type.
+ *
+ * @param type
+ *        The type of the value, for instance a structure.
+ ********************************************************************************/
+#define SEQLOCK(type) struct { _Atomic uint32_t seq; type value; }
+
+/********************************************************************************
+ * @brief Initializer of a seqlock holding specified initial value.
+ ********************************************************************************/
+#define SEQLOCK_INIT(...) { 0, __VA_ARGS__ }
+
+/********************************************************************************
+ * @brief Copies the value of referenced seqlock to specified destination. The
+ *        copy is retried until it was made without a concurrent write.
+ *
+ * @param self
+ *        Reference to the seqlock.
+ * @param out
+ *        Reference to the destination, which must have the type of the value.
+ ********************************************************************************/
+#define SEQLOCK_LOAD(self, out) do {                                                \
+    (void)sizeof(*(out) = (self)->value);                                           \
+    uint32_t seqlock_start_;                                                        \
+    do {                                                                            \
+        seqlock_read_begin(&(self)->seq, &seqlock_start_);                          \
+        memcpy((out), (const void*)&(self)->value, sizeof((self)->value));          \
+    } while (seqlock_read_retry(&(self)->seq, seqlock_start_));                     \
+} while (0)
+
+/********************************************************************************
+ * @brief Stores specified value in referenced seqlock.
+ *
+ * @param self
+ *        Reference to the seqlock.
+ * @param in
+ *        Reference to the new value, which must have the type of the value.
+ ********************************************************************************/
+#define SEQLOCK_STORE(self, in) do {                                                \
+    seqlock_write_begin(&(self)->seq);                                              \
+    (self)->value = *(in);                                                          \
+    seqlock_write_end(&(self)->seq);                                                \
+} while (0)
+
+/********************************************************************************
+ * @brief Starts and ends a write section of referenced seqlock, so that the
+ *        value can be modified in place, for instance to increment a member.
+ *
+ * @param self
+ *        Reference to the seqlock.
+ ********************************************************************************/
+#define SEQLOCK_WRITE_BEGIN(self) seqlock_write_begin(&(self)->seq)
+#define SEQLOCK_WRITE_END(self)   seqlock_write_end(&(self)->seq)
+
+/********************************************************************************
+ * @brief Waits until no write is in progress and provides the sequence number
+ *        at which the read starts.
+ *
+ * @param seq
+ *        Reference to the sequence counter.
+ * @param start
+ *        Reference to variable set to the sequence number (always even).
+ ********************************************************************************/
+static inline void seqlock_read_begin(const _Atomic uint32_t* seq, uint32_t* start) {
+    uint16_t spins = 0;
+    while ((*start = atomic_load_explicit((_Atomic uint32_t*)seq, memory_order_acquire)) & 1U) {
+        backoff_pause(spins);
+        if (spins < UINT16_MAX) spins++;
+    }
+}
+
+/********************************************************************************
+ * @brief Indicates if a read must be retried since a write started after the
+ *        read.
+ *
+ * @note  The acquire fence keeps the copy from being moved past the second
+ *        load of the counter.
+ *
+ * @param seq
+ *        Reference to the sequence counter.
+ * @param start
+ *        The sequence number at which the read started.
+ * @return
+ *        True if the read must be retried, else false.
+ ********************************************************************************/
+static inline bool seqlock_read_retry(const _Atomic uint32_t* seq, const uint32_t start) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit((_Atomic uint32_t*)seq, memory_order_relaxed) != start;
+}
+
+/********************************************************************************
+ * @brief Starts a write by making the sequence counter odd. Concurrent writers
+ *        are serialized via compare-and-swap.
+ *
+ * @note  The release fence keeps the writes of the value from being moved
+ *        before the counter becomes odd.
+ *
+ * @param seq
+ *        Reference to the sequence counter.
+ ********************************************************************************/
+static inline void seqlock_write_begin(_Atomic uint32_t* seq) {
+    uint32_t current = atomic_load_explicit(seq, memory_order_relaxed);
+    uint16_t spins = 0;
+    while ((current & 1U) || !atomic_compare_exchange_weak_explicit(seq, &current, current + 1,
+                                                                   memory_order_acquire,
+                                                                   memory_order_relaxed)) {
+        if (current & 1U) {
+            backoff_pause(spins);
+            if (spins < UINT16_MAX) spins++;
+            current = atomic_load_explicit(seq, memory_order_relaxed);
+        }
+    }
+    atomic_thread_fence(memory_order_release);
+}
+
+/********************************************************************************
+ * @brief Ends a write by making the sequence counter even again (release
+ *        ordering publishes the new value to the readers).
+ *
+ * @param seq
+ *        Reference to the sequence counter.
+ ********************************************************************************/
+static inline void seqlock_write_end(_Atomic uint32_t* seq) {
+    atomic_fetch_add_explicit(seq, 1, memory_order_release);
+}
+
+/********************************************************************************
+ * @note The following code is only available in C++.
+ ********************************************************************************/
+#else
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <sync/backoff.h>
+
+/********************************************************************************
+ * @brief Class for implementing seqlocks in C++.
+ *
+ * @tparam T
+ *         The type of the value, must be trivially copyable.
+ ********************************************************************************/
+template <typename T>
+class seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "The value of a seqlock must be trivially copyable!");
+  public:
+
+    /********************************************************************************
+     * @brief Creates new seqlock holding specified initial value.
+     *
+     * @param value
+     *        The initial value (default = value-initialized).
+     ********************************************************************************/
+    explicit seqlock(const T& value = T{}) : value_{value} {}
+
+    seqlock(const seqlock&) = delete;
+    seqlock& operator=(const seqlock&) = delete;
+
+    /********************************************************************************
+     * @brief Provides a copy of the value. The copy is retried until it was
+     *        made without a concurrent write, the seqlock is never written.
+     *
+     * @return
+     *        A copy of the value.
+     ********************************************************************************/
+    T load(void) const {
+        T copy;
+        uint32_t start;
+        do {
+            start = read_begin();
+            std::memcpy(static_cast<void*>(&copy), static_cast<const void*>(&value_), sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (seq_.load(std::memory_order_relaxed) != start);
+        return copy;
+    }
+
+    /********************************************************************************
+     * @brief Stores specified value.
+     *
+     * @param value
+     *        The new value.
+     ********************************************************************************/
+    void store(const T& value) {
+        update([&value](T& current) { current = value; });
+    }
+
+    /********************************************************************************
+     * @brief Modifies the value in place, for instance to increment a member.
+     *
+     * @tparam F
+     *         Callable taking a reference to the value.
+     * @param modify
+     *         The modification, performed while readers are held off.
+     ********************************************************************************/
+    template <typename F>
+    void update(F&& modify) {
+        write_begin();
+        modify(value_);
+        seq_.fetch_add(1, std::memory_order_release);
+    }
+
+  private:
+
+    /********************************************************************************
+     * @brief Waits until no write is in progress.
+     *
+     * @return
+     *        The sequence number at which the read starts (always even).
+     ********************************************************************************/
+    uint32_t read_begin(void) const {
+        uint16_t spins{};
+        while (1) {
+            const auto start{seq_.load(std::memory_order_acquire)};
+            if ((start & 1U) == 0) return start;
+            backoff_pause(spins);
+            if (spins < UINT16_MAX) spins++;
+        }
+    }
+
+    /********************************************************************************
+     * @brief Starts a write by making the sequence counter odd. Concurrent
+     *        writers are serialized via compare-and-swap. The release fence
+     *        keeps the writes of the value from being moved before the
+     *        counter becomes odd.
+     ********************************************************************************/
+    void write_begin(void) {
+        auto current{seq_.load(std::memory_order_relaxed)};
+        uint16_t spins{};
+        while ((current & 1U) || !seq_.compare_exchange_weak(current, current + 1, std::memory_order_acquire,
+                                                             std::memory_order_relaxed)) {
+            if (current & 1U) {
+                backoff_pause(spins);
+                if (spins < UINT16_MAX) spins++;
+                current = seq_.load(std::memory_order_relaxed);
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    std::atomic<uint32_t> seq_{}; /* The sequence counter, odd while a write is in progress. */
+    T value_;                     /* The published value. */
+};
+
+#endif /* ifndef __cplusplus */
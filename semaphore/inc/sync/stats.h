@@ -0,0 +1,324 @@
+/********************************************************************************
+ * @brief Opt-in contention and hold-time instrumentation for the
+ *        synchronization primitives, usable from C and C++.
+ *
+ * @note  The instrumentation is compiled in when SYNC_STATS is defined, for
+ *        instance via the CMake option SYNC_ENABLE_STATS. Otherwise all
+ *        recording functions are empty inline functions, which the compiler
+ *        removes entirely, and no statistics are available.
+ *
+ *        Counters are kept in per-thread shards, each on a cache line of its
+ *        own, and are only aggregated when a snapshot is read. Therefore the
+ *        instrumentation doesn't become a bottleneck of its own.
+ ********************************************************************************/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/********************************************************************************
+ * @brief Parameters for the instrumentation.
+ *
+ * @param SYNC_STATS_ENABLED
+ *        Indicates if the instrumentation is compiled in (1) or not (0).
+ * @param SYNC_STATS_NUM_SHARDS
+ *        The number of per-thread counter shards per primitive (8). Threads
+ *        are assigned to shards round robin, so up to eight threads never
+ *        share counters.
+ * @param SYNC_STATS_NUM_BUCKETS
+ *        The number of buckets of the time histograms (32). Bucket n counts
+ *        durations of [2^n, 2^(n + 1)) ns, the last bucket also counts all
+ *        longer durations.
+ * @param SYNC_STATS_NAME_SIZE
+ *        The maximum length of a primitive name, including the terminator.
+ ********************************************************************************/
+#ifdef SYNC_STATS
+#define SYNC_STATS_ENABLED     1
+#else
+#define SYNC_STATS_ENABLED     0
+#endif /* SYNC_STATS */
+
+#define SYNC_STATS_NUM_SHARDS  8
+#define SYNC_STATS_NUM_BUCKETS 32
+#define SYNC_STATS_NAME_SIZE   32
+
+/********************************************************************************
+ * @brief Snapshot of the statistics of a synchronization primitive,
+ *        aggregated over all threads.
+ *
+ * @param name
+ *        The name of the primitive.
+ * @param num_acquisitions
+ *        The total number of acquisitions.
+ * @param num_contended
+ *        The number of acquisitions where the calling thread had to wait.
+ * @param num_spins
+ *        The total number of spin iterations performed while waiting.
+ * @param max_waiters
+ *        The highest number of threads waiting at the same time.
+ * @param num_elided
+ *        The number of acquisitions elided via hardware transactions, which
+ *        are included in num_acquisitions but not in the histograms.
+ * @param num_elision_aborts
+ *        The number of aborted transactions of elided acquisitions.
+ * @param wait_time_ns
+ *        Histogram of the wait times of contended acquisitions.
+ * @param hold_time_ns
+ *        Histogram of the hold times, measured when a thread releases what it
+ *        acquired itself.
+ ********************************************************************************/
+struct sync_stats_snapshot {
+    char name[SYNC_STATS_NAME_SIZE];
+    uint64_t num_acquisitions;
+    uint64_t num_contended;
+    uint64_t num_spins;
+    uint32_t max_waiters;
+    uint64_t num_elided;
+    uint64_t num_elision_aborts;
+    uint64_t wait_time_ns[SYNC_STATS_NUM_BUCKETS];
+    uint64_t hold_time_ns[SYNC_STATS_NUM_BUCKETS];
+};
+
+/********************************************************************************
+ * @brief Predeclaration of the statistics of a synchronization primitive. The
+ *        structure is hidden in the corresponding source file.
+ ********************************************************************************/
+struct sync_stats;
+
+/********************************************************************************
+ * @brief Aggregates the statistics of specified primitive into a snapshot.
+ *
+ * @param self
+ *        Reference to the statistics, may be a nullptr.
+ * @param snapshot
+ *        Reference to the snapshot to fill.
+ * @return
+ *        True if the snapshot was filled, false if no statistics are available
+ *        (instrumentation disabled or self is a nullptr).
+ ********************************************************************************/
+bool sync_stats_read(const struct sync_stats* self, struct sync_stats_snapshot* snapshot);
+
+/********************************************************************************
+ * @brief Provides the percentile of specified histogram.
+ *
+ * @param histogram
+ *        Reference to a histogram of SYNC_STATS_NUM_BUCKETS buckets.
+ * @param percentile
+ *        The percentile to provide, for instance 99.0.
+ * @return
+ *        The upper bound of the bucket containing the percentile in ns, 0 if
+ *        the histogram is empty.
+ ********************************************************************************/
+uint64_t sync_stats_percentile(const uint64_t* histogram, const double percentile);
+
+/********************************************************************************
+ * @brief Writes the statistics of all instrumented primitives that have been
+ *        acquired at least once to specified stream, one line per primitive.
+ *
+ * @param stream
+ *        The stream to write to, for instance stdout.
+ ********************************************************************************/
+void sync_stats_dump(FILE* stream);
+
+#ifdef SYNC_STATS
+
+/********************************************************************************
+ * @brief Creates new statistics for a primitive and registers them, so that
+ *        they are included in sync_stats_dump.
+ *
+ * @param name
+ *        The name of the primitive, truncated to SYNC_STATS_NAME_SIZE - 1
+ *        characters.
+ * @return
+ *        A reference to the statistics, nullptr if the memory allocation failed.
+ ********************************************************************************/
+struct sync_stats* sync_stats_new(const char* name);
+
+/********************************************************************************
+ * @brief Unregisters and deletes statistics.
+ *
+ * @param self
+ *        Reference to the statistics, may be a nullptr.
+ ********************************************************************************/
+void sync_stats_delete(struct sync_stats* self);
+
+/********************************************************************************
+ * @brief Provides a monotonic timestamp for the instrumentation.
+ *
+ * @return
+ *        The current time in ns.
+ ********************************************************************************/
+uint64_t sync_stats_now(void);
+
+/********************************************************************************
+ * @brief Records that the calling thread starts waiting for a primitive.
+ *
+ * @param self
+ *        Reference to the statistics, may be a nullptr.
+ ********************************************************************************/
+void sync_stats_wait_begin(struct sync_stats* self);
+
+/********************************************************************************
+ * @brief Records that the calling thread stops waiting for a primitive.
+ *
+ * @param self
+ *        Reference to the statistics, may be a nullptr.
+ ********************************************************************************/
+void sync_stats_wait_end(struct sync_stats* self);
+
+/********************************************************************************
+ * @brief Records an acquisition of a primitive by the calling thread.
+ *
+ * @param self
+ *        Reference to the statistics, may be a nullptr.
+ * @param wait_start
+ *        Timestamp when the calling thread started waiting, 0 if the
+ *        acquisition was uncontended.
+ * @param num_spins
+ *        The number of spin iterations performed while waiting.
+ ********************************************************************************/
+void sync_stats_acquired(struct sync_stats* self, const uint64_t wait_start, const uint32_t num_spins);
+
+/********************************************************************************
+ * @brief Records a release of a primitive by the calling thread.
+ *
+ * @param self
+ *        Reference to the statistics, may be a nullptr.
+ ********************************************************************************/
+void sync_stats_released(struct sync_stats* self);
+
+/********************************************************************************
+ * @brief Records an elided acquisition of a primitive by the calling thread,
+ *        once its transaction has been committed.
+ *
+ * @param self
+ *        Reference to the statistics, may be a nullptr.
+ ********************************************************************************/
+void sync_stats_elided(struct sync_stats* self);
+
+/********************************************************************************
+ * @brief Records an aborted transaction of an elided acquisition by the
+ *        calling thread.
+ *
+ * @param self
+ *        Reference to the statistics, may be a nullptr.
+ ********************************************************************************/
+void sync_stats_elision_aborted(struct sync_stats* self);
+
+#else
+
+static inline struct sync_stats* sync_stats_new(const char* name) { (void)name; return 0; }
+static inline void sync_stats_delete(struct sync_stats* self) { (void)self; }
+static inline uint64_t sync_stats_now(void) { return 0; }
+static inline void sync_stats_wait_begin(struct sync_stats* self) { (void)self; }
+static inline void sync_stats_wait_end(struct sync_stats* self) { (void)self; }
+static inline void sync_stats_acquired(struct sync_stats* self, const uint64_t wait_start,
+                                       const uint32_t num_spins) {
+    (void)self; (void)wait_start; (void)num_spins;
+}
+static inline void sync_stats_released(struct sync_stats* self) { (void)self; }
+static inline void sync_stats_elided(struct sync_stats* self) { (void)self; }
+static inline void sync_stats_elision_aborted(struct sync_stats* self) { (void)self; }
+
+#endif /* SYNC_STATS */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+/********************************************************************************
+ * @note The following code is only available in C++.
+ ********************************************************************************/
+#ifdef __cplusplus
+
+/********************************************************************************
+ * @brief Wrapper adding instrumentation to any type meeting the Lockable
+ *        requirements, for instance std::mutex. The wrapper meets the Lockable
+ *        requirements itself, so it can be used with std::lock_guard. If the
+ *        instrumentation is disabled, all calls are forwarded as is.
+ *
+ * @tparam lockable
+ *         The wrapped lock type.
+ ********************************************************************************/
+template <typename lockable>
+class instrumented_lock {
+  public:
+
+    /********************************************************************************
+     * @brief Creates new instrumented lock.
+     *
+     * @param name
+     *        The name of the lock in the statistics.
+     ********************************************************************************/
+    explicit instrumented_lock(const char* name = "instrumented_lock")
+        : stats_{sync_stats_new(name)} {}
+
+    /********************************************************************************
+     * @brief Deletes the instrumented lock and its statistics.
+     ********************************************************************************/
+    ~instrumented_lock(void) { sync_stats_delete(stats_); }
+
+    instrumented_lock(const instrumented_lock&) = delete;
+    instrumented_lock& operator=(const instrumented_lock&) = delete;
+
+    /********************************************************************************
+     * @brief Locks the wrapped lock. The calling thread is blocked until the
+     *        lock is available.
+     ********************************************************************************/
+    void lock(void) {
+        if constexpr (SYNC_STATS_ENABLED) {
+            if (lock_.try_lock()) {
+                sync_stats_acquired(stats_, 0, 0);
+            } else {
+                const auto wait_start{sync_stats_now()};
+                sync_stats_wait_begin(stats_);
+                lock_.lock();
+                sync_stats_wait_end(stats_);
+                sync_stats_acquired(stats_, wait_start, 0);
+            }
+        } else {
+            lock_.lock();
+        }
+    }
+
+    /********************************************************************************
+     * @brief Locks the wrapped lock if it is available.
+     *
+     * @return
+     *        True if the lock was acquired, else false.
+     ********************************************************************************/
+    bool try_lock(void) {
+        if (!lock_.try_lock()) return false;
+        sync_stats_acquired(stats_, 0, 0);
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Unlocks the wrapped lock.
+     ********************************************************************************/
+    void unlock(void) {
+        sync_stats_released(stats_);
+        lock_.unlock();
+    }
+
+    /********************************************************************************
+     * @brief Provides a snapshot of the statistics of the lock.
+     *
+     * @param snapshot
+     *        Reference to the snapshot to fill.
+     * @return
+     *        True if the snapshot was filled, false if no statistics are available.
+     ********************************************************************************/
+    bool stats(sync_stats_snapshot& snapshot) const { return sync_stats_read(stats_, &snapshot); }
+
+  private:
+    lockable lock_{};    /* The wrapped lock. */
+    sync_stats* stats_;  /* Statistics of the lock, nullptr if disabled. */
+};
+
+#endif /* __cplusplus */
@@ -0,0 +1,518 @@
+/********************************************************************************
+ * @brief Contains a fixed-size worker thread pool for usage in C and C++.
+ *        Separate interfaces are implemented: in C a task is a function
+ *        pointer and an argument, while in C++ a task is any callable.
+ *
+ * @note  The worker threads are created once, so the cost of creating a
+ *        thread isn't paid per task. Each worker owns a fixed-size Chase-Lev
+ *        deque. Tasks submitted by a worker are pushed onto its own deque and
+ *        popped from the same end, so they stay on the worker that created
+ *        them without touching any shared cache line. Tasks submitted by
+ *        other threads are enqueued in the lock-free MPMC queue of
+ *        sync/queue.h, which also takes the tasks of a worker whose deque is
+ *        full. An idle worker first drains the shared queue, then steals the
+ *        oldest tasks from the other end of the deques of the other workers,
+ *        starting at a random victim.
+ *
+ *        When no task can be found, the worker spins with exponential backoff
+ *        for a bounded number of iterations, then it is parked on a counting
+ *        semaphore of sync/semaphore.h. Submitting a task releases the
+ *        semaphore only if a worker is parked, so no system call is made
+ *        while all workers are busy.
+ *
+ *        By default the pool creates one worker per hardware thread. The
+ *        workers can be pinned to the CPUs the process may run on, worker i
+ *        to the i-th permitted CPU (round robin). Pinning is best effort: if
+ *        the affinity cannot be set, the worker runs unpinned.
+ *
+ *        A task submitted while the shared queue is full waits for room, so a
+ *        thread that is not a worker should not submit tasks from a task.
+ ********************************************************************************/
+#pragma once
+
+#include <sync/backoff.h>
+#include <sync/cache_line.h>
+#include <sync/queue.h>
+#include <sync/semaphore.h>
+
+/********************************************************************************
+ * @brief The default number of tasks the queue of a thread pool can hold
+ *        (1024).
+ ********************************************************************************/
+#define THREAD_POOL_CAPACITY_DEFAULT (uint32_t)(1024)
+
+/********************************************************************************
+ * @brief The number of tasks the deque of each worker can hold, must be a
+ *        power of two (256).
+ ********************************************************************************/
+#ifndef THREAD_POOL_DEQUE_CAPACITY
+#define THREAD_POOL_DEQUE_CAPACITY (uint32_t)(256)
+#endif /* THREAD_POOL_DEQUE_CAPACITY */
+
+/********************************************************************************
+ * @note The following code is only available in C.
+ ********************************************************************************/
+#ifndef __cplusplus
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/********************************************************************************
+ * @brief Creation-time options for thread pools. A zero-initialized structure
+ *        selects the default options.
+ *
+ * @param num_threads
+ *        The number of worker threads, 0 selects the number of online CPUs.
+ * @param capacity
+ *        The number of tasks the shared queue can hold, rounded up to a power
+ *        of two.
+ *        0 selects THREAD_POOL_CAPACITY_DEFAULT.
+ * @param pin_threads
+ *        Indicates if each worker is pinned to a CPU of its own.
+ ********************************************************************************/
+struct thread_pool_options {
+    uint16_t num_threads;
+    uint32_t capacity;
+    bool pin_threads;
+};
+
+/********************************************************************************
+ * @brief Predeclaration of thread pool. This structure is hidden in the
+ *        corresponding source file.
+ ********************************************************************************/
+struct thread_pool;
+
+/********************************************************************************
+ * @brief Creates a new thread pool and starts its worker threads.
+ *
+ * @param options
+ *        Reference to creation-time options, nullptr selects the defaults.
+ * @return
+ *        A reference to the thread pool, nullptr if the memory allocation or
+ *        the creation of a worker thread failed.
+ ********************************************************************************/
+struct thread_pool* thread_pool_new(const struct thread_pool_options* options);
+
+/********************************************************************************
+ * @brief Runs all submitted tasks, stops the worker threads and deletes the
+ *        thread pool. The calling thread is blocked until every task has
+ *        returned. The thread pool pointer is set to null after deallocation.
+ *
+ * @param self
+ *        Double pointer to the thread pool.
+ ********************************************************************************/
+void thread_pool_delete(struct thread_pool** self);
+
+/********************************************************************************
+ * @brief Submits a task to referenced thread pool. If the calling thread is a
+ *        worker of the pool, the task is pushed onto its own deque. Else, or
+ *        if the deque is full, the task is enqueued in the shared queue; if
+ *        that is full, the calling thread waits until a worker has made room.
+ *
+ * @param self
+ *        Reference to the thread pool.
+ * @param task
+ *        The function to run on a worker thread.
+ * @param arg
+ *        The argument passed to the function.
+ * @return
+ *        True if the task was submitted, false if no function was specified.
+ ********************************************************************************/
+bool thread_pool_submit(struct thread_pool* self, void (*task)(void* arg), void* arg);
+
+/********************************************************************************
+ * @brief Blocks the calling thread until all tasks submitted so far have
+ *        returned.
+ *
+ * @param self
+ *        Reference to the thread pool.
+ ********************************************************************************/
+void thread_pool_wait_idle(struct thread_pool* self);
+
+/********************************************************************************
+ * @brief Provides the number of worker threads of referenced thread pool.
+ *
+ * @param self
+ *        Reference to the thread pool.
+ * @return
+ *        The number of worker threads.
+ ********************************************************************************/
+uint16_t thread_pool_num_threads(const struct thread_pool* self);
+
+/********************************************************************************
+ * @note The following code is only available in C++.
+ ********************************************************************************/
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+/********************************************************************************
+ * @brief Class for implementing work-stealing worker thread pools in C++.
+ *
+ * @tparam capacity
+ *         The number of tasks the shared queue can hold, must be a power of
+ *         two (default = THREAD_POOL_CAPACITY_DEFAULT).
+ ********************************************************************************/
+template <uint32_t capacity = THREAD_POOL_CAPACITY_DEFAULT>
+class thread_pool {
+    static_assert((THREAD_POOL_DEQUE_CAPACITY & (THREAD_POOL_DEQUE_CAPACITY - 1)) == 0,
+                  "The deque capacity of a thread pool must be a power of two!");
+  public:
+
+    /********************************************************************************
+     * @brief Creates new thread pool and starts its worker threads.
+     *
+     * @param num_threads
+     *        The number of worker threads, 0 selects the number of hardware
+     *        threads (default = 0).
+     * @param pin_threads
+     *        Indicates if each worker is pinned to a CPU of its own
+     *        (default = false).
+     ********************************************************************************/
+    explicit thread_pool(const uint16_t num_threads = 0, const bool pin_threads = false)
+        : num_workers_{static_cast<uint16_t>(num_threads ? num_threads :
+                       std::clamp(std::thread::hardware_concurrency(), 1U, static_cast<unsigned>(UINT16_MAX)))},
+          workers_{new worker[num_workers_]} {
+        wake_sem_.take(UINT16_MAX);
+        threads_.reserve(num_workers_);
+        for (uint16_t i{}; i < num_workers_; ++i) {
+            workers_[i].pool = this;
+            workers_[i].rng = i + 1U;
+            threads_.emplace_back([this, i, pin_threads]() {
+                if (pin_threads) pin(i);
+                run(workers_[i]);
+            });
+        }
+    }
+
+    /********************************************************************************
+     * @brief Runs all submitted tasks, stops the worker threads and deletes the
+     *        thread pool.
+     ********************************************************************************/
+    ~thread_pool(void) {
+        running_.store(false, std::memory_order_seq_cst);
+        const auto num_parked{num_sleeping_.exchange(0, std::memory_order_seq_cst)};
+        if (num_parked) wake_sem_.release(static_cast<uint16_t>(num_parked));
+        for (auto& thread : threads_) thread.join();
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    /********************************************************************************
+     * @brief Submits a task to the thread pool. If the calling thread is a
+     *        worker of the pool, the task is pushed onto its own deque. Else,
+     *        or if the deque is full, the task is enqueued in the shared queue;
+     *        if that is full, the calling thread waits until a worker has made
+     *        room.
+     *
+     * @param task
+     *        The callable to run on a worker thread.
+     ********************************************************************************/
+    template <typename F>
+    void submit(F&& task) {
+        num_pending_.fetch_add(1, std::memory_order_relaxed);
+        if (current_ && current_->pool == this) {
+            auto entry{std::make_unique<std::function<void()>>(std::forward<F>(task))};
+            if (current_->push(entry.get())) {
+                entry.release();
+            } else {
+                push_shared(std::move(*entry));
+            }
+        } else {
+            push_shared(std::function<void()>{std::forward<F>(task)});
+        }
+        wake();
+    }
+
+    /********************************************************************************
+     * @brief Blocks the calling thread until all tasks submitted so far have
+     *        returned.
+     ********************************************************************************/
+    void wait_idle(void) {
+        auto pending{num_pending_.load(std::memory_order_acquire)};
+        while (pending != 0) {
+            num_pending_.wait(pending, std::memory_order_acquire);
+            pending = num_pending_.load(std::memory_order_acquire);
+        }
+    }
+
+    /********************************************************************************
+     * @brief Provides the number of worker threads.
+     *
+     * @return
+     *        The number of worker threads.
+     ********************************************************************************/
+    uint16_t num_threads(void) const { return num_workers_; }
+
+  private:
+
+    /********************************************************************************
+     * @brief Worker of the pool, which owns a fixed-size Chase-Lev deque. The
+     *        owner pushes and pops at the bottom, other workers steal at the
+     *        top. The tasks are heap-allocated and referenced via atomic
+     *        pointers, so that a thief racing with the owner never reads a
+     *        partially written task.
+     ********************************************************************************/
+    struct SYNC_CACHE_ALIGNED worker {
+        std::atomic<int64_t> top{};                                     /* Index of the oldest task. */
+        SYNC_CACHE_ALIGNED std::atomic<int64_t> bottom{};               /* Index past the newest task. */
+        std::atomic<std::function<void()>*> slots[THREAD_POOL_DEQUE_CAPACITY]{}; /* The tasks. */
+        thread_pool* pool{};                                            /* The pool of the worker. */
+        uint32_t rng{};                                                 /* State of the victim selection. */
+
+        /********************************************************************************
+         * @brief Pushes specified task onto the bottom of the deque. Only called
+         *        by the owner.
+         *
+         * @param task
+         *        Reference to the task.
+         * @return
+         *        True if the task was pushed, false if the deque is full.
+         ********************************************************************************/
+        bool push(std::function<void()>* task) {
+            const auto b{bottom.load(std::memory_order_relaxed)};
+            const auto t{top.load(std::memory_order_acquire)};
+            if (b - t >= static_cast<int64_t>(THREAD_POOL_DEQUE_CAPACITY)) return false;
+            slots[b & (THREAD_POOL_DEQUE_CAPACITY - 1)].store(task, std::memory_order_release);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /********************************************************************************
+         * @brief Pops the newest task from the bottom of the deque. Only called
+         *        by the owner. If a single task is left, the owner races with
+         *        the thieves for it via the top index.
+         *
+         * @return
+         *        A reference to the task, nullptr if the deque is empty.
+         ********************************************************************************/
+        std::function<void()>* pop(void) {
+            const auto b{bottom.load(std::memory_order_relaxed) - 1};
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto t{top.load(std::memory_order_relaxed)};
+            std::function<void()>* task{};
+            if (t <= b) {
+                task = slots[b & (THREAD_POOL_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+                if (t == b) {
+                    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                     std::memory_order_relaxed)) {
+                        task = nullptr;
+                    }
+                    bottom.store(b + 1, std::memory_order_relaxed);
+                }
+            } else {
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return task;
+        }
+
+        /********************************************************************************
+         * @brief Steals the oldest task from the top of the deque.
+         *
+         * @return
+         *        A reference to the task, nullptr if the deque is empty or if
+         *        another thread took the task first.
+         ********************************************************************************/
+        std::function<void()>* steal(void) {
+            auto t{top.load(std::memory_order_acquire)};
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const auto b{bottom.load(std::memory_order_acquire)};
+            if (t >= b) return nullptr;
+            auto task{slots[t & (THREAD_POOL_DEQUE_CAPACITY - 1)].load(std::memory_order_acquire)};
+            return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed) ?
+                   task : nullptr;
+        }
+
+        /********************************************************************************
+         * @brief Indicates if the deque holds any tasks.
+         *
+         * @return
+         *        True if the deque is empty, else false.
+         ********************************************************************************/
+        bool empty(void) const {
+            return bottom.load(std::memory_order_seq_cst) <= top.load(std::memory_order_seq_cst);
+        }
+    };
+
+    /********************************************************************************
+     * @brief Enqueues specified task in the shared queue. While the queue is
+     *        full, a worker is woken and the calling thread spins with
+     *        exponential backoff.
+     *
+     * @param task
+     *        The task to enqueue.
+     ********************************************************************************/
+    void push_shared(std::function<void()>&& task) {
+        uint16_t spins{};
+        while (!tasks_.try_push(std::move(task))) {
+            wake();
+            backoff_pause(spins);
+            if (spins < UINT16_MAX) spins++;
+        }
+    }
+
+    /********************************************************************************
+     * @brief Runs a worker thread. Tasks are taken from the own deque, then
+     *        from the shared queue, then stolen from the other workers. If the
+     *        pool is being deleted, the worker returns once no task is left,
+     *        else it spins for a while and then parks until woken. The running
+     *        flag is read before the tasks are searched, so tasks submitted
+     *        before the deletion are never lost.
+     *
+     * @param self
+     *        Reference to the worker.
+     ********************************************************************************/
+    void run(worker& self) {
+        current_ = &self;
+        std::function<void()> task{};
+        uint16_t spins{};
+        while (1) {
+            const bool stopping{!running_.load(std::memory_order_acquire)};
+            if (find(self, task)) {
+                task();
+                task = nullptr;
+                if (num_pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) num_pending_.notify_all();
+                spins = 0;
+                continue;
+            }
+            if (stopping) break;
+            if (spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+                backoff_pause(spins++);
+                continue;
+            }
+            park();
+        }
+        current_ = nullptr;
+    }
+
+    /********************************************************************************
+     * @brief Searches a task for specified worker: its own deque first, then
+     *        the shared queue, then the deques of the other workers, starting
+     *        at a random victim.
+     *
+     * @param self
+     *        Reference to the worker.
+     * @param task
+     *        Reference to the task to fill.
+     * @return
+     *        True if a task was found, else false.
+     ********************************************************************************/
+    bool find(worker& self, std::function<void()>& task) {
+        auto entry{self.pop()};
+        if (!entry && tasks_.try_pop(task)) return true;
+        self.rng ^= self.rng << 13;
+        self.rng ^= self.rng >> 17;
+        self.rng ^= self.rng << 5;
+        for (uint16_t i{}; !entry && i < num_workers_; ++i) {
+            auto& victim{workers_[(self.rng + i) % num_workers_]};
+            if (&victim != &self) entry = victim.steal();
+        }
+        if (!entry) return false;
+        task = std::move(*entry);
+        delete entry;
+        return true;
+    }
+
+    /********************************************************************************
+     * @brief Indicates if any task is queued in the pool.
+     *
+     * @return
+     *        True if the shared queue or any deque holds a task, else false.
+     ********************************************************************************/
+    bool has_work(void) const {
+        if (tasks_.size() != 0) return true;
+        for (uint16_t i{}; i < num_workers_; ++i) {
+            if (!workers_[i].empty()) return true;
+        }
+        return false;
+    }
+
+    /********************************************************************************
+     * @brief Parks the calling worker on the wake semaphore.
+     *
+     * @note  The worker registers as sleeping before it checks for tasks for
+     *        the last time, so a submitter either sees the registration or the
+     *        worker sees the task. A submitter claims a registration before it
+     *        releases the semaphore once. If the worker cancels its wait but
+     *        all registrations are claimed, a token is on its way, which the
+     *        worker consumes to keep both counts equal.
+     ********************************************************************************/
+    void park(void) {
+        num_sleeping_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (running_.load(std::memory_order_seq_cst) && !has_work()) {
+            wake_sem_.take();
+            return;
+        }
+        auto num_parked{num_sleeping_.load(std::memory_order_relaxed)};
+        while (num_parked > 0) {
+            if (num_sleeping_.compare_exchange_weak(num_parked, num_parked - 1, std::memory_order_relaxed)) return;
+        }
+        wake_sem_.take();
+    }
+
+    /********************************************************************************
+     * @brief Wakes a parked worker, if any. The fence orders the preceding push
+     *        before the check of the sleeping workers. Together with the fence
+     *        of the worker, either we see the worker, or it sees the task.
+     ********************************************************************************/
+    void wake(void) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto num_parked{num_sleeping_.load(std::memory_order_relaxed)};
+        while (num_parked > 0) {
+            if (num_sleeping_.compare_exchange_weak(num_parked, num_parked - 1, std::memory_order_relaxed)) {
+                wake_sem_.release();
+                return;
+            }
+        }
+    }
+
+    /********************************************************************************
+     * @brief Pins the calling worker to the CPU of specified index among the
+     *        CPUs the process may run on (round robin). A std::thread cannot be
+     *        created with an affinity, so each worker pins itself before it
+     *        touches its deque. Failures are ignored.
+     *
+     * @param index
+     *        The index of the worker.
+     ********************************************************************************/
+    static void pin(const uint16_t index) {
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) return;
+        auto target{index % CPU_COUNT(&allowed)};
+        for (int cpu{}; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+                return;
+            }
+        }
+    }
+
+    static inline thread_local worker* current_{};            /* The worker of the calling thread. */
+    const uint16_t num_workers_;                                /* The number of workers. */
+    std::unique_ptr<worker[]> workers_;                         /* The workers and their deques. */
+    mpmc_queue<std::function<void()>, capacity> tasks_{};       /* Tasks submitted by other threads. */
+    std::vector<std::thread> threads_{};                        /* The worker threads. */
+    std::atomic<bool> running_{true};                           /* Cleared when the pool is deleted. */
+    counting_semaphore<UINT16_MAX, semaphore_wait_park> wake_sem_{"thread_pool"}; /* Parks idle workers. */
+    SYNC_CACHE_ALIGNED std::atomic<uint32_t> num_sleeping_{};   /* Unclaimed parking workers. */
+    SYNC_CACHE_ALIGNED std::atomic<uint32_t> num_pending_{};    /* Submitted tasks not yet returned. */
+};
+
+#endif /* ifndef __cplusplus */
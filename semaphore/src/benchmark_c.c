@@ -0,0 +1,44 @@
+/********************************************************************************
+ * @brief Implementation details for the C counting semaphore adapter used by
+ *        the benchmark.
+ ********************************************************************************/
+#include <sync/semaphore.h>
+#include "benchmark_c.h"
+
+/********************************************************************************
+ * @note 1. We create the semaphore with the default options.
+ ********************************************************************************/
+void* benchmark_counting_semaphore_new(const uint16_t num_resources) {
+    return counting_semaphore_new(num_resources, 0);
+}
+
+/********************************************************************************
+ * @note 1. We create the semaphore in the caching mode with specified batch.
+ ********************************************************************************/
+void* benchmark_counting_semaphore_new_cached(const uint16_t num_resources, const uint16_t cache_batch) {
+    struct counting_semaphore_options options = {0};
+    options.cache_batch = cache_batch;
+    return counting_semaphore_new(num_resources, &options);
+}
+
+/********************************************************************************
+ * @note 1. We delete the semaphore via a local copy of the pointer.
+ ********************************************************************************/
+void benchmark_counting_semaphore_delete(void* self) {
+    struct counting_semaphore* semaphore = (struct counting_semaphore*)self;
+    counting_semaphore_delete(&semaphore);
+}
+
+/********************************************************************************
+ * @note 1. We reserve a resource of the semaphore.
+ ********************************************************************************/
+void benchmark_counting_semaphore_take(void* self) {
+    counting_semaphore_take((struct counting_semaphore*)self);
+}
+
+/********************************************************************************
+ * @note 1. We release a resource of the semaphore.
+ ********************************************************************************/
+void benchmark_counting_semaphore_release(void* self) {
+    counting_semaphore_release((struct counting_semaphore*)self);
+}
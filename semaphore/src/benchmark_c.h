@@ -0,0 +1,62 @@
+/********************************************************************************
+ * @brief Adapter making the C counting semaphore available to the C++
+ *        benchmark. In C++ the name counting_semaphore refers to the class
+ *        template, so the C interface is wrapped behind opaque pointers.
+ ********************************************************************************/
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+
+/********************************************************************************
+ * @brief Creates a new C counting semaphore with default options.
+ *
+ * @param num_resources
+ *        The number of resources available for the counting semaphore.
+ * @return
+ *        A reference to the counting semaphore, nullptr upon failure.
+ ********************************************************************************/
+void* benchmark_counting_semaphore_new(const uint16_t num_resources);
+
+/********************************************************************************
+ * @brief Creates a new C counting semaphore caching resources per thread.
+ *
+ * @param num_resources
+ *        The number of resources available for the counting semaphore.
+ * @param cache_batch
+ *        The number of resources fetched from the shared counter at once.
+ * @return
+ *        A reference to the counting semaphore, nullptr upon failure.
+ ********************************************************************************/
+void* benchmark_counting_semaphore_new_cached(const uint16_t num_resources, const uint16_t cache_batch);
+
+/********************************************************************************
+ * @brief Deletes C counting semaphore.
+ *
+ * @param self
+ *        Reference to the counting semaphore.
+ ********************************************************************************/
+void benchmark_counting_semaphore_delete(void* self);
+
+/********************************************************************************
+ * @brief Reserves a resource of C counting semaphore.
+ *
+ * @param self
+ *        Reference to the counting semaphore.
+ ********************************************************************************/
+void benchmark_counting_semaphore_take(void* self);
+
+/********************************************************************************
+ * @brief Releases a resource of C counting semaphore.
+ *
+ * @param self
+ *        Reference to the counting semaphore.
+ ********************************************************************************/
+void benchmark_counting_semaphore_release(void* self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -0,0 +1,124 @@
+/********************************************************************************
+ * @brief Adapters giving the synchronization primitives a uniform take/release
+ *        interface, shared by the benchmark and the load harness.
+ *
+ * @note  Each adapter is constructed with the number of resources, which only
+ *        counting semaphores use, and names itself for the reported results.
+ ********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <pthread.h>
+#include <sync/backoff.h>
+#include <sync/cohort.h>
+#include <sync/mutex.h>
+#include <sync/semaphore.h>
+#include "benchmark_c.h"
+
+/********************************************************************************
+ * @brief Binary semaphore of the library, using one ID of the bank.
+ ********************************************************************************/
+struct binary_semaphore_primitive {
+    static constexpr const char* name{"binary_semaphore"};
+    explicit binary_semaphore_primitive(const uint16_t) {}
+    void take(void) { binary_semaphore_take(0); }
+    void release(void) { binary_semaphore_release(0); }
+};
+
+/********************************************************************************
+ * @brief Counting semaphore of the library in C.
+ ********************************************************************************/
+struct c_counting_semaphore_primitive {
+    static constexpr const char* name{"counting_semaphore_c"};
+    explicit c_counting_semaphore_primitive(const uint16_t capacity)
+        : semaphore_{benchmark_counting_semaphore_new(capacity)} {}
+    ~c_counting_semaphore_primitive(void) { benchmark_counting_semaphore_delete(semaphore_); }
+    void take(void) { benchmark_counting_semaphore_take(semaphore_); }
+    void release(void) { benchmark_counting_semaphore_release(semaphore_); }
+    void* semaphore_;
+};
+
+/********************************************************************************
+ * @brief Counting semaphore of the library in C, caching resources per thread.
+ *        The batch is chosen so that all cache slots together hold at most
+ *        the capacity.
+ ********************************************************************************/
+struct c_cached_counting_semaphore_primitive {
+    static constexpr const char* name{"counting_semaphore_c_cached"};
+    explicit c_cached_counting_semaphore_primitive(const uint16_t capacity)
+        : semaphore_{benchmark_counting_semaphore_new_cached(
+              capacity, static_cast<uint16_t>(std::max(1, capacity / (2 * SEMAPHORE_CACHE_NUM_SLOTS))))} {}
+    ~c_cached_counting_semaphore_primitive(void) { benchmark_counting_semaphore_delete(semaphore_); }
+    void take(void) { benchmark_counting_semaphore_take(semaphore_); }
+    void release(void) { benchmark_counting_semaphore_release(semaphore_); }
+    void* semaphore_;
+};
+
+/********************************************************************************
+ * @brief Reader-writer semaphore of the library, reserved for reading only.
+ ********************************************************************************/
+struct rw_semaphore_read_primitive {
+    static constexpr const char* name{"rw_semaphore_read"};
+    explicit rw_semaphore_read_primitive(const uint16_t) {}
+    void take(void) { semaphore_.take_read(); }
+    void release(void) { semaphore_.release_read(); }
+    rw_semaphore semaphore_{"benchmark"};
+};
+
+/********************************************************************************
+ * @brief Reader-writer semaphore of the library, reserved for writing only.
+ ********************************************************************************/
+struct rw_semaphore_write_primitive {
+    static constexpr const char* name{"rw_semaphore_write"};
+    explicit rw_semaphore_write_primitive(const uint16_t) {}
+    void take(void) { semaphore_.take_write(); }
+    void release(void) { semaphore_.release_write(); }
+    rw_semaphore semaphore_{"benchmark"};
+};
+
+/********************************************************************************
+ * @brief Futex-based mutex of the library.
+ ********************************************************************************/
+struct sync_mutex_primitive {
+    static constexpr const char* name{"sync_mutex"};
+    explicit sync_mutex_primitive(const uint16_t) {}
+    void take(void) { mutex_.lock(); }
+    void release(void) { mutex_.unlock(); }
+    sync_mutex mutex_{"benchmark"};
+};
+
+/********************************************************************************
+ * @brief NUMA-aware cohort mutex of the library.
+ ********************************************************************************/
+struct cohort_mutex_primitive {
+    static constexpr const char* name{"cohort_mutex"};
+    explicit cohort_mutex_primitive(const uint16_t) {}
+    void take(void) { mutex_.lock(); }
+    void release(void) { mutex_.unlock(); }
+    cohort_mutex mutex_{"benchmark"};
+};
+
+/********************************************************************************
+ * @brief POSIX mutex with default attributes, as a reference.
+ ********************************************************************************/
+struct pthread_mutex_primitive {
+    static constexpr const char* name{"pthread_mutex"};
+    explicit pthread_mutex_primitive(const uint16_t) { pthread_mutex_init(&mutex_, nullptr); }
+    ~pthread_mutex_primitive(void) { pthread_mutex_destroy(&mutex_); }
+    void take(void) { pthread_mutex_lock(&mutex_); }
+    void release(void) { pthread_mutex_unlock(&mutex_); }
+    pthread_mutex_t mutex_;
+};
+
+/********************************************************************************
+ * @brief Performs specified number of work units, each a pause instruction.
+ *
+ * @param num_units
+ *        The number of work units to perform.
+ ********************************************************************************/
+inline void Work(const uint32_t num_units) {
+    for (uint32_t i{}; i < num_units; ++i) {
+        backoff_cpu_relax();
+    }
+}
@@ -0,0 +1,262 @@
+/********************************************************************************
+ * @brief Implementation details for NUMA-aware cohort mutexes in C.
+ ********************************************************************************/
+#include <stdatomic.h>
+#include <sync/cohort.h>
+#include <sync/lockdep.h>
+#include "futex.h"
+
+/********************************************************************************
+ * @brief Local lock of a node, placed on a cache line of its own. Apart from
+ *        the waiter count, the members are only accessed by the thread
+ *        holding the local lock.
+ *
+ * @param state
+ *        The futex word of the local lock.
+ * @param num_waiting
+ *        The number of threads of the node waiting for the mutex.
+ * @param global_passed
+ *        Indicates if the global lock was passed on to the next local owner.
+ * @param num_handoffs
+ *        The number of local handoffs in a row.
+ ********************************************************************************/
+struct cohort_mutex_node {
+    SYNC_CACHE_ALIGNED _Atomic uint32_t state;
+    _Atomic uint32_t num_waiting;
+    bool global_passed;
+    uint16_t num_handoffs;
+};
+
+/********************************************************************************
+ * @brief Structure for implementing cohort mutexes in C. The structure is
+ *        private in this file so that the user cannot alter the lock words
+ *        manually.
+ *
+ * @param global
+ *        The futex word of the global lock, on a cache line of its own.
+ * @param num_nodes
+ *        The number of local locks.
+ * @param handoff_limit
+ *        The number of local handoffs in a row before the global lock is
+ *        unlocked.
+ * @param owner_node
+ *        The local lock of the owner.
+ * @param nodes
+ *        The local locks.
+ * @param stats
+ *        Statistics of the mutex, nullptr if the instrumentation is disabled.
+ ********************************************************************************/
+struct cohort_mutex {
+    SYNC_CACHE_ALIGNED _Atomic uint32_t global;
+    SYNC_CACHE_ALIGNED uint16_t num_nodes;
+    uint16_t handoff_limit;
+    struct cohort_mutex_node* owner_node;
+    struct cohort_mutex_node* nodes;
+    struct sync_stats* stats;
+};
+
+/********************************************************************************
+ * @brief Locks specified three-state futex word in the same way as a mutex.
+ *
+ * @note  As long as nobody is parked, we spin with exponential backoff and
+ *        try to lock the word via compare-and-swap. Else we mark the word as
+ *        contended and are parked until it changes.
+ *
+ * @param self
+ *        Reference to the cohort mutex, whose statistics record the wait.
+ * @param word
+ *        Reference to the futex word.
+ * @param wait_start
+ *        Reference to the start time of the wait, 0 until the thread waits.
+ * @param spins
+ *        Reference to the number of spin iterations performed so far.
+ ********************************************************************************/
+static void cohort_mutex_lock_word(struct cohort_mutex* self, _Atomic uint32_t* word,
+                                   uint64_t* wait_start, uint16_t* spins) {
+    uint32_t state = SYNC_MUTEX_UNLOCKED;
+    if (atomic_compare_exchange_strong_explicit(word, &state, SYNC_MUTEX_LOCKED,
+                                                memory_order_acquire, memory_order_relaxed)) {
+        return;
+    }
+    if (!*wait_start) {
+        *wait_start = sync_stats_now();
+        sync_stats_wait_begin(self->stats);
+    }
+    for (uint16_t i = 0; state != SYNC_MUTEX_CONTENDED && i < SYNC_MUTEX_SPIN_LIMIT; ++i) {
+        backoff_pause(i);
+        if (*spins < UINT16_MAX) (*spins)++;
+        state = SYNC_MUTEX_UNLOCKED;
+        if (atomic_compare_exchange_weak_explicit(word, &state, SYNC_MUTEX_LOCKED,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            return;
+        }
+    }
+    while (atomic_exchange_explicit(word, SYNC_MUTEX_CONTENDED, memory_order_acquire) != SYNC_MUTEX_UNLOCKED) {
+        futex_wait(word, SYNC_MUTEX_CONTENDED);
+    }
+}
+
+/********************************************************************************
+ * @brief Locks specified three-state futex word if it is unlocked.
+ *
+ * @param word
+ *        Reference to the futex word.
+ * @return
+ *        True if the word was locked, else false.
+ ********************************************************************************/
+static inline bool cohort_mutex_try_lock_word(_Atomic uint32_t* word) {
+    uint32_t state = SYNC_MUTEX_UNLOCKED;
+    return atomic_compare_exchange_strong_explicit(word, &state, SYNC_MUTEX_LOCKED,
+                                                   memory_order_acquire, memory_order_relaxed);
+}
+
+/********************************************************************************
+ * @brief Unlocks specified three-state futex word and wakes a parked thread if
+ *        the word was marked as contended.
+ *
+ * @param word
+ *        Reference to the futex word.
+ ********************************************************************************/
+static inline void cohort_mutex_unlock_word(_Atomic uint32_t* word) {
+    if (atomic_exchange_explicit(word, SYNC_MUTEX_UNLOCKED, memory_order_release) == SYNC_MUTEX_CONTENDED) {
+        futex_wake(word, 1);
+    }
+}
+
+/********************************************************************************
+ * @brief Provides the local lock of the calling thread.
+ *
+ * @param self
+ *        Reference to the cohort mutex.
+ * @return
+ *        A reference to the local lock of the node the calling thread runs on.
+ ********************************************************************************/
+static inline struct cohort_mutex_node* cohort_mutex_node_of(struct cohort_mutex* self) {
+    return &self->nodes[sync_numa_current_node() % self->num_nodes];
+}
+
+/********************************************************************************
+ * @note 1. We allocate the mutex and one local lock per detected node, both
+ *          aligned to a cache line. If any memory allocation fails, we return
+ *          a nullptr.
+ *       2. We initialize all locks as unlocked. If no handoff limit was
+ *          specified, the default is used. If the instrumentation is enabled,
+ *          the statistics are created, and the mutex is named in the 
+ *          lock-order graph.
+ ********************************************************************************/
+struct cohort_mutex* cohort_mutex_new(const char* name, const uint16_t handoff_limit) {
+    struct cohort_mutex* self = (struct cohort_mutex*)aligned_alloc(SYNC_CACHE_LINE_SIZE, sizeof(struct cohort_mutex));
+    if (!self) return 0;
+    self->num_nodes = sync_numa_num_nodes();
+    self->nodes = (struct cohort_mutex_node*)aligned_alloc(SYNC_CACHE_LINE_SIZE,
+                                                           self->num_nodes * sizeof(struct cohort_mutex_node));
+    if (!self->nodes) {
+        free(self);
+        return 0;
+    }
+    for (uint16_t i = 0; i < self->num_nodes; ++i) {
+        atomic_init(&self->nodes[i].state, SYNC_MUTEX_UNLOCKED);
+        atomic_init(&self->nodes[i].num_waiting, 0);
+        self->nodes[i].global_passed = false;
+        self->nodes[i].num_handoffs = 0;
+    }
+    atomic_init(&self->global, SYNC_MUTEX_UNLOCKED);
+    self->handoff_limit = handoff_limit ? handoff_limit : COHORT_MUTEX_HANDOFF_LIMIT;
+    self->owner_node = 0;
+    self->stats = sync_stats_new(name ? name : "cohort_mutex");
+    sync_lockdep_register(self, name ? name : "cohort_mutex");
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. Deallocates the local locks, the statistics and the mutex, and
+ *          removes the mutex from the lock-order graph.
+ *       2. Sets the mutex pointer to null via the double pointer.
+ ********************************************************************************/
+void cohort_mutex_delete(struct cohort_mutex** self) {
+    if (*self) {
+        sync_lockdep_forget(*self);
+        sync_stats_delete((*self)->stats);
+        free((*self)->nodes);
+    }
+    free(*self);
+    *self = 0;
+}
+
+/********************************************************************************
+ * @note 1. We register as a waiter of our node and lock the local lock, so
+ *          that the owner can tell whether to pass the global lock on.
+ *       2. If the global lock was passed on to our node, we own the mutex
+ *          without touching the global lock. Else we lock the global lock.
+ *       3. We record our node as the node of the owner, and the acquisition in
+ *          the statistics. The acquisition is recorded in the lock-order graph
+ *          before we wait.
+ ********************************************************************************/
+void cohort_mutex_lock(struct cohort_mutex* self) {
+    sync_lockdep_acquire(self, true);
+    struct cohort_mutex_node* local = cohort_mutex_node_of(self);
+    uint64_t wait_start = 0;
+    uint16_t spins = 0;
+    atomic_fetch_add_explicit(&local->num_waiting, 1, memory_order_relaxed);
+    cohort_mutex_lock_word(self, &local->state, &wait_start, &spins);
+    atomic_fetch_sub_explicit(&local->num_waiting, 1, memory_order_relaxed);
+    if (local->global_passed) {
+        local->global_passed = false;
+    } else {
+        cohort_mutex_lock_word(self, &self->global, &wait_start, &spins);
+    }
+    self->owner_node = local;
+    if (wait_start) sync_stats_wait_end(self->stats);
+    sync_stats_acquired(self->stats, wait_start, spins);
+}
+
+/********************************************************************************
+ * @note 1. We try to lock the local lock of our node, else we return false.
+ *       2. If the global lock was passed on to our node, we own the mutex.
+ *          Else we try to lock the global lock; if that fails, we unlock the
+ *          local lock again and return false.
+ ********************************************************************************/
+bool cohort_mutex_try_lock(struct cohort_mutex* self) {
+    struct cohort_mutex_node* local = cohort_mutex_node_of(self);
+    if (!cohort_mutex_try_lock_word(&local->state)) return false;
+    if (local->global_passed) {
+        local->global_passed = false;
+    } else if (!cohort_mutex_try_lock_word(&self->global)) {
+        cohort_mutex_unlock_word(&local->state);
+        return false;
+    }
+    self->owner_node = local;
+    sync_stats_acquired(self->stats, 0, 0);
+    sync_lockdep_acquire(self, false);
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. If another thread of our node waits and the handoff limit isn't
+ *          reached, we pass the global lock on to it by only unlocking the
+ *          local lock. The flag is published by the release ordering of the
+ *          unlock.
+ *       2. Else we unlock the global lock, so that threads of other nodes get
+ *          their turn, and then the local lock.
+ ********************************************************************************/
+void cohort_mutex_unlock(struct cohort_mutex* self) {
+    struct cohort_mutex_node* local = self->owner_node;
+    sync_stats_released(self->stats);
+    sync_lockdep_release(self);
+    if (atomic_load_explicit(&local->num_waiting, memory_order_relaxed) > 0 &&
+        local->num_handoffs < self->handoff_limit) {
+        local->num_handoffs++;
+        local->global_passed = true;
+    } else {
+        local->num_handoffs = 0;
+        cohort_mutex_unlock_word(&self->global);
+    }
+    cohort_mutex_unlock_word(&local->state);
+}
+
+/********************************************************************************
+ * @note 1. We read the statistics of the mutex, if any.
+ ********************************************************************************/
+bool cohort_mutex_stats(const struct cohort_mutex* self, struct sync_stats_snapshot* snapshot) {
+    return sync_stats_read(self->stats, snapshot);
+}
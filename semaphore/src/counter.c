@@ -0,0 +1,123 @@
+/********************************************************************************
+ * @brief Implementation details for sharded counters in C.
+ ********************************************************************************/
+#include <stdatomic.h>
+#include <sync/counter.h>
+
+/********************************************************************************
+ * @brief Slot of a sharded counter, placed on a cache line of its own so that
+ *        threads of different slots never share a cache line.
+ *
+ * @param value
+ *        The increments of the threads assigned to the slot.
+ ********************************************************************************/
+struct sharded_counter_slot {
+    SYNC_CACHE_ALIGNED _Atomic uint64_t value;
+};
+
+/********************************************************************************
+ * @brief Structure for implementing sharded counters in C. The structure is
+ *        private in this file so that the user cannot alter the slots
+ *        manually.
+ *
+ * @param num_slots
+ *        The number of slots.
+ * @param slots
+ *        The slots of the counter.
+ ********************************************************************************/
+struct sharded_counter {
+    uint16_t num_slots;
+    struct sharded_counter_slot* slots;
+};
+
+/********************************************************************************
+ * @brief The number of threads assigned to slots so far, and the index of the
+ *        calling thread (UINT32_MAX until the thread increments a counter for
+ *        the first time). The index is shared by all counters.
+ ********************************************************************************/
+static _Atomic uint32_t sharded_counter_num_threads = 0;
+static _Thread_local uint32_t sharded_counter_thread_index = UINT32_MAX;
+
+/********************************************************************************
+ * @brief Provides the slot of the calling thread.
+ *
+ * @note  Threads are assigned to indexes round robin on first use.
+ *
+ * @param self
+ *        Reference to the counter.
+ * @return
+ *        A reference to the slot of the calling thread.
+ ********************************************************************************/
+static inline struct sharded_counter_slot* sharded_counter_slot_of(struct sharded_counter* self) {
+    if (sharded_counter_thread_index == UINT32_MAX) {
+        sharded_counter_thread_index = atomic_fetch_add_explicit(&sharded_counter_num_threads, 1,
+                                                                 memory_order_relaxed);
+    }
+    return &self->slots[sharded_counter_thread_index % self->num_slots];
+}
+
+/********************************************************************************
+ * @note 1. We allocate the counter and its slots, the slots aligned to a cache
+ *          line. If any memory allocation fails, we return a nullptr.
+ *       2. We initialize all slots to zero.
+ ********************************************************************************/
+struct sharded_counter* sharded_counter_new(const uint16_t num_slots) {
+    struct sharded_counter* self = (struct sharded_counter*)malloc(sizeof(struct sharded_counter));
+    if (!self) return 0;
+    self->num_slots = num_slots ? num_slots : SHARDED_COUNTER_NUM_SLOTS;
+    self->slots = (struct sharded_counter_slot*)aligned_alloc(SYNC_CACHE_LINE_SIZE,
+                                                              self->num_slots * sizeof(struct sharded_counter_slot));
+    if (!self->slots) {
+        free(self);
+        return 0;
+    }
+    for (uint16_t i = 0; i < self->num_slots; ++i) {
+        atomic_init(&self->slots[i].value, 0);
+    }
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. Deallocates the slots and the counter.
+ *       2. Sets the counter pointer to null via the double pointer.
+ ********************************************************************************/
+void sharded_counter_delete(struct sharded_counter** self) {
+    if (*self) free((*self)->slots);
+    free(*self);
+    *self = 0;
+}
+
+/********************************************************************************
+ * @note 1. We add the value to the slot of the calling thread. Relaxed
+ *          ordering suffices, since the counter doesn't publish other data.
+ ********************************************************************************/
+void sharded_counter_add(struct sharded_counter* self, const uint64_t value) {
+    atomic_fetch_add_explicit(&sharded_counter_slot_of(self)->value, value, memory_order_relaxed);
+}
+
+/********************************************************************************
+ * @note 1. We add one to the slot of the calling thread.
+ ********************************************************************************/
+void sharded_counter_increment(struct sharded_counter* self) {
+    sharded_counter_add(self, 1);
+}
+
+/********************************************************************************
+ * @note 1. We return the sum of all slots.
+ ********************************************************************************/
+uint64_t sharded_counter_read(const struct sharded_counter* self) {
+    uint64_t sum = 0;
+    for (uint16_t i = 0; i < self->num_slots; ++i) {
+        sum += atomic_load_explicit(&self->slots[i].value, memory_order_relaxed);
+    }
+    return sum;
+}
+
+/********************************************************************************
+ * @note 1. We set all slots to zero.
+ ********************************************************************************/
+void sharded_counter_reset(struct sharded_counter* self) {
+    for (uint16_t i = 0; i < self->num_slots; ++i) {
+        atomic_store_explicit(&self->slots[i].value, 0, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,219 @@
+/********************************************************************************
+ * @brief Thin wrappers around the futex system call, shared by the
+ *        implementation files of the synchronization primitives.
+ ********************************************************************************/
+#pragma once
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/********************************************************************************
+ * @brief Provides the futex operation to perform on a futex word.
+ * 
+ * @note  Private operations are faster, since the kernel identifies the futex
+ *        word by its address in the calling process alone. A futex word in
+ *        memory shared between processes, for instance via shm_open and mmap,
+ *        must be accessed with shared operations instead.
+ * 
+ * @param op
+ *        The futex operation, for instance FUTEX_WAIT.
+ * @param process_shared
+ *        True if the futex word is shared between processes.
+ * @return
+ *        The operation, with the private flag set unless shared.
+ ********************************************************************************/
+static inline int futex_op(const int op, const bool process_shared) {
+    return process_shared ? op : op | FUTEX_PRIVATE_FLAG;
+}
+
+/********************************************************************************
+ * @brief Parks the calling thread on specified futex word as long as it holds
+ *        the expected value. Only wake-ups whose bitset overlaps the specified
+ *        bitset will wake the thread.
+ * 
+ * @param address
+ *        Reference to the futex word.
+ * @param expected
+ *        The value the futex word is expected to hold.
+ * @param bitset
+ *        Bitset selecting which wake-ups the thread is interested in.
+ * @param process_shared
+ *        True if the futex word is shared between processes.
+ ********************************************************************************/
+static inline void futex_wait_bitset_scoped(_Atomic uint32_t* address, const uint32_t expected, 
+                                            const uint32_t bitset, const bool process_shared) {
+    syscall(SYS_futex, address, futex_op(FUTEX_WAIT_BITSET, process_shared), expected, 0, 0, bitset);
+}
+
+/********************************************************************************
+ * @brief Wakes all threads parked on specified futex word whose bitset
+ *        overlaps the specified bitset.
+ * 
+ * @param address
+ *        Reference to the futex word.
+ * @param bitset
+ *        Bitset selecting which waiters to wake.
+ * @param process_shared
+ *        True if the futex word is shared between processes.
+ ********************************************************************************/
+static inline void futex_wake_bitset_scoped(_Atomic uint32_t* address, const uint32_t bitset,
+                                            const bool process_shared) {
+    syscall(SYS_futex, address, futex_op(FUTEX_WAKE_BITSET, process_shared), INT_MAX, 0, 0, bitset);
+}
+
+/********************************************************************************
+ * @brief Parks the calling thread on specified futex word as long as it holds
+ *        the expected value.
+ * 
+ * @param address
+ *        Reference to the futex word.
+ * @param expected
+ *        The value the futex word is expected to hold.
+ * @param process_shared
+ *        True if the futex word is shared between processes.
+ ********************************************************************************/
+static inline void futex_wait_scoped(_Atomic uint32_t* address, const uint32_t expected,
+                                     const bool process_shared) {
+    syscall(SYS_futex, address, futex_op(FUTEX_WAIT, process_shared), expected, 0, 0, 0);
+}
+
+/********************************************************************************
+ * @brief Parks the calling thread on specified private futex word as long as
+ *        it holds the expected value.
+ * 
+ * @param address
+ *        Reference to the futex word.
+ * @param expected
+ *        The value the futex word is expected to hold.
+ ********************************************************************************/
+static inline void futex_wait(_Atomic uint32_t* address, const uint32_t expected) {
+    futex_wait_scoped(address, expected, false);
+}
+
+/********************************************************************************
+ * @brief Parks the calling thread on specified futex word as long as it holds
+ *        the expected value, for at most specified timeout.
+ * 
+ * @param address
+ *        Reference to the futex word.
+ * @param expected
+ *        The value the futex word is expected to hold.
+ * @param timeout_ms
+ *        The longest time to park the thread, measured in milliseconds.
+ * @param process_shared
+ *        True if the futex word is shared between processes.
+ ********************************************************************************/
+static inline void futex_wait_for_scoped(_Atomic uint32_t* address, const uint32_t expected, 
+                                         const uint32_t timeout_ms, const bool process_shared) {
+    const struct timespec timeout = {(time_t)(timeout_ms / 1000), (long)(timeout_ms % 1000) * 1000000L};
+    syscall(SYS_futex, address, futex_op(FUTEX_WAIT, process_shared), expected, &timeout, 0, 0);
+}
+
+/********************************************************************************
+ * @brief Parks the calling thread on specified private futex word as long as
+ *        it holds the expected value, for at most specified timeout.
+ * 
+ * @param address
+ *        Reference to the futex word.
+ * @param expected
+ *        The value the futex word is expected to hold.
+ * @param timeout_ms
+ *        The longest time to park the thread, measured in milliseconds.
+ ********************************************************************************/
+static inline void futex_wait_for(_Atomic uint32_t* address, const uint32_t expected, 
+                                  const uint32_t timeout_ms) {
+    futex_wait_for_scoped(address, expected, timeout_ms, false);
+}
+
+/********************************************************************************
+ * @brief Wakes up to specified number of threads parked on a futex word.
+ * 
+ * @param address
+ *        Reference to the futex word.
+ * @param num_threads
+ *        The maximum number of threads to wake.
+ * @param process_shared
+ *        True if the futex word is shared between processes.
+ ********************************************************************************/
+static inline void futex_wake_scoped(_Atomic uint32_t* address, const int num_threads,
+                                     const bool process_shared) {
+    syscall(SYS_futex, address, futex_op(FUTEX_WAKE, process_shared), num_threads, 0, 0, 0);
+}
+
+/********************************************************************************
+ * @brief Wakes up to specified number of threads parked on a private futex
+ *        word.
+ * 
+ * @param address
+ *        Reference to the futex word.
+ * @param num_threads
+ *        The maximum number of threads to wake.
+ ********************************************************************************/
+static inline void futex_wake(_Atomic uint32_t* address, const int num_threads) {
+    futex_wake_scoped(address, num_threads, false);
+}
+
+/********************************************************************************
+ * @brief Reports a failed priority-inheritance futex operation and aborts.
+ * 
+ * @note  A failed lock or unlock leaves the caller without (or still with) 
+ *        the mutex, for instance upon deadlock (EDEADLK), a corrupted futex 
+ *        word (EINVAL) or a caller that doesn't own the word (EPERM). Since
+ *        mutual exclusion can no longer be guaranteed, the process is ended
+ *        rather than letting the caller continue.
+ * 
+ * @param operation
+ *        The name of the failed operation.
+ * @param error
+ *        The error number of the failure.
+ ********************************************************************************/
+static inline void futex_pi_failed(const char* operation, const int error) {
+    fprintf(stderr, "%s failed: %s\n", operation, strerror(error));
+    abort();
+}
+
+/********************************************************************************
+ * @brief Locks specified priority-inheritance futex word after the fast path,
+ *        a compare-and-swap from 0 to the thread ID of the caller, failed.
+ * 
+ * @note  The kernel queues the calling thread by priority and boosts the 
+ *        owner to the priority of the highest waiter until it unlocks the
+ *        word. When the call returns, the word holds the thread ID of the
+ *        caller, possibly with FUTEX_WAITERS set. The call is retried while
+ *        the owner is exiting (EAGAIN) or if it was interrupted (EINTR); any
+ *        other failure aborts, see futex_pi_failed.
+ * 
+ * @param address
+ *        Reference to the futex word, holding the thread ID of the owner.
+ ********************************************************************************/
+static inline void futex_lock_pi(_Atomic uint32_t* address) {
+    while (syscall(SYS_futex, address, FUTEX_LOCK_PI_PRIVATE, 0, 0, 0, 0) != 0) {
+        if (errno != EAGAIN && errno != EINTR) futex_pi_failed("FUTEX_LOCK_PI", errno);
+    }
+}
+
+/********************************************************************************
+ * @brief Unlocks specified priority-inheritance futex word after the fast
+ *        path, a compare-and-swap from the thread ID of the caller to 0, 
+ *        failed since threads are waiting. The kernel hands the word to the
+ *        waiter of the highest priority. A failure aborts, see 
+ *        futex_pi_failed.
+ * 
+ * @param address
+ *        Reference to the futex word, holding the thread ID of the caller.
+ ********************************************************************************/
+static inline void futex_unlock_pi(_Atomic uint32_t* address) {
+    while (syscall(SYS_futex, address, FUTEX_UNLOCK_PI_PRIVATE, 0, 0, 0, 0) != 0) {
+        if (errno != EINTR) futex_pi_failed("FUTEX_UNLOCK_PI", errno);
+    }
+}
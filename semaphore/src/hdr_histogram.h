@@ -0,0 +1,130 @@
+/********************************************************************************
+ * @brief High dynamic range (HDR) histogram of latencies, used by the load
+ *        harness to report percentiles.
+ *
+ * @note  Values are recorded into log-linear buckets: values below twice the
+ *        number of sub-buckets are counted exactly, and every power of two
+ *        above is split into the same number of sub-buckets. The relative
+ *        error of a reported value is therefore bounded by 1 / sub-buckets
+ *        (below 1 %) over the whole 64-bit range, while the histogram has a
+ *        fixed size and recording costs a few instructions and no allocation.
+ *        Each thread records into a histogram of its own, and the histograms
+ *        are merged once the threads have been joined.
+ ********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+/********************************************************************************
+ * @brief Class for implementing HDR histograms of 64-bit values.
+ ********************************************************************************/
+class hdr_histogram {
+  public:
+
+    /********************************************************************************
+     * @brief Records specified value.
+     *
+     * @param value
+     *        The value to record, for instance a latency in ns.
+     ********************************************************************************/
+    void record(const uint64_t value) {
+        counts_[index_of(value)]++;
+        num_values_++;
+        max_ = std::max(max_, value);
+    }
+
+    /********************************************************************************
+     * @brief Adds the values recorded by another histogram.
+     *
+     * @param other
+     *        Reference to the histogram to add.
+     ********************************************************************************/
+    void add(const hdr_histogram& other) {
+        for (uint32_t i{}; i < num_buckets_; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        num_values_ += other.num_values_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    /********************************************************************************
+     * @brief Provides the number of recorded values.
+     *
+     * @return
+     *        The number of recorded values.
+     ********************************************************************************/
+    uint64_t count(void) const { return num_values_; }
+
+    /********************************************************************************
+     * @brief Provides the highest recorded value, which is tracked exactly.
+     *
+     * @return
+     *        The highest recorded value, 0 if no value was recorded.
+     ********************************************************************************/
+    uint64_t max(void) const { return max_; }
+
+    /********************************************************************************
+     * @brief Provides the value below or at which specified percentage of the
+     *        recorded values lie.
+     *
+     * @param percentile
+     *        The percentile, for instance 99.9.
+     * @return
+     *        The highest value of the bucket holding the percentile, limited
+     *        to the highest recorded value, 0 if no value was recorded.
+     ********************************************************************************/
+    uint64_t value_at_percentile(const double percentile) const {
+        if (!num_values_) return 0;
+        const auto target{std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * num_values_)))};
+        uint64_t num_below{};
+        for (uint32_t i{}; i < num_buckets_; ++i) {
+            num_below += counts_[i];
+            if (num_below >= target) return std::min(highest_value_of(i), max_);
+        }
+        return max_;
+    }
+
+  private:
+
+    /********************************************************************************
+     * @brief Provides the bucket index of specified value. A value of the power
+     *        of two [2^m, 2^(m + 1)) is shifted right by m - sub_bucket_bits_,
+     *        which leaves a sub-bucket in [num_sub_buckets_, 2 * num_sub_buckets_).
+     *
+     * @param value
+     *        The value.
+     * @return
+     *        The index of the bucket counting the value.
+     ********************************************************************************/
+    static uint32_t index_of(const uint64_t value) {
+        if (value < 2 * num_sub_buckets_) return static_cast<uint32_t>(value);
+        const auto shift{static_cast<uint32_t>(std::bit_width(value)) - 1 - sub_bucket_bits_};
+        return shift * num_sub_buckets_ + static_cast<uint32_t>(value >> shift);
+    }
+
+    /********************************************************************************
+     * @brief Provides the highest value counted by specified bucket.
+     *
+     * @param index
+     *        The index of the bucket.
+     * @return
+     *        The highest value of the bucket.
+     ********************************************************************************/
+    static uint64_t highest_value_of(const uint32_t index) {
+        if (index < 2 * num_sub_buckets_) return index;
+        const auto shift{index / num_sub_buckets_ - 1};
+        const uint64_t sub_bucket{index - shift * num_sub_buckets_};
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+    static constexpr uint32_t sub_bucket_bits_{7};                         /* Precision, log2 of the sub-buckets. */
+    static constexpr uint32_t num_sub_buckets_{1U << sub_bucket_bits_};    /* Sub-buckets per power of two. */
+    static constexpr uint32_t num_buckets_{(64 - sub_bucket_bits_ + 1) * num_sub_buckets_}; /* All buckets. */
+    std::array<uint64_t, num_buckets_> counts_{}; /* The number of values per bucket. */
+    uint64_t num_values_{};                       /* The number of recorded values. */
+    uint64_t max_{};                              /* The highest recorded value. */
+};
@@ -0,0 +1,405 @@
+/********************************************************************************
+ * @brief Implementation details for the lock-order checker of the
+ *        synchronization primitives.
+ ********************************************************************************/
+#include <sync/lockdep.h>
+
+#ifdef SYNC_LOCKDEP
+
+#include <execinfo.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+/********************************************************************************
+ * @brief The number of buckets of the table of primitives of the lock-order
+ *        graph.
+ ********************************************************************************/
+#define SYNC_LOCKDEP_NUM_BUCKETS 256
+
+/********************************************************************************
+ * @brief Edge of the lock-order graph, recording that a thread has blocked on
+ *        a primitive while holding another one.
+ *
+ * @param from
+ *        The held primitive.
+ * @param to
+ *        The primitive acquired while holding the other one.
+ * @param stack
+ *        The stack trace of the first acquisition in this order.
+ * @param depth
+ *        The number of frames of the stack trace.
+ * @param next
+ *        The next edge from the same primitive.
+ ********************************************************************************/
+struct sync_lockdep_edge {
+    struct sync_lockdep_node* from;
+    struct sync_lockdep_node* to;
+    void* stack[SYNC_LOCKDEP_STACK_DEPTH];
+    int depth;
+    struct sync_lockdep_edge* next;
+};
+
+/********************************************************************************
+ * @brief Primitive of the lock-order graph.
+ *
+ * @param lock
+ *        Reference identifying the primitive.
+ * @param name
+ *        The name of the primitive, empty if it wasn't named.
+ * @param edges
+ *        The edges to the primitives acquired while holding this one.
+ * @param visit
+ *        The last search that visited the primitive.
+ * @param via
+ *        The edge the last search reached the primitive by.
+ * @param next
+ *        The next primitive of the same bucket.
+ ********************************************************************************/
+struct sync_lockdep_node {
+    const void* lock;
+    char name[SYNC_LOCKDEP_NAME_SIZE];
+    struct sync_lockdep_edge* edges;
+    uint32_t visit;
+    struct sync_lockdep_edge* via;
+    struct sync_lockdep_node* next;
+};
+
+/********************************************************************************
+ * @brief A primitive held by the calling thread.
+ *
+ * @param lock
+ *        Reference identifying the primitive.
+ * @param count
+ *        The number of times the primitive is held, for instance resources of
+ *        a counting semaphore.
+ ********************************************************************************/
+struct sync_lockdep_held {
+    const void* lock;
+    uint32_t count;
+};
+
+/********************************************************************************
+ * @brief The lock-order graph, protected by a mutex. The graph is only
+ *        accessed by blocking acquisitions of threads holding primitives and
+ *        when primitives are named or forgotten.
+ ********************************************************************************/
+static pthread_mutex_t sync_lockdep_graph_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct sync_lockdep_node* sync_lockdep_nodes[SYNC_LOCKDEP_NUM_BUCKETS];
+static uint32_t sync_lockdep_num_nodes = 0;
+static uint32_t sync_lockdep_num_visits = 0;
+
+/********************************************************************************
+ * @brief The number of lock-order inversions reported so far.
+ ********************************************************************************/
+static _Atomic uint32_t sync_lockdep_inversions = 0;
+
+/********************************************************************************
+ * @brief The primitives held by the calling thread, oldest first.
+ ********************************************************************************/
+static _Thread_local struct sync_lockdep_held sync_lockdep_held[SYNC_LOCKDEP_MAX_HELD];
+static _Thread_local uint16_t sync_lockdep_num_held = 0;
+
+/********************************************************************************
+ * @brief Provides the bucket of the table holding specified primitive.
+ *
+ * @param lock
+ *        Reference identifying the primitive.
+ * @return
+ *        A reference to the head of the bucket.
+ ********************************************************************************/
+static inline struct sync_lockdep_node** sync_lockdep_bucket(const void* lock) {
+    const uintptr_t key = (uintptr_t)lock;
+    return &sync_lockdep_nodes[(key >> 4 ^ key >> 12) % SYNC_LOCKDEP_NUM_BUCKETS];
+}
+
+/********************************************************************************
+ * @brief Provides the node of specified primitive, which is added to the graph
+ *        if needed. The graph lock must be held.
+ *
+ * @param lock
+ *        Reference identifying the primitive.
+ * @return
+ *        A reference to the node, nullptr if the memory allocation failed.
+ ********************************************************************************/
+static struct sync_lockdep_node* sync_lockdep_node_of(const void* lock) {
+    struct sync_lockdep_node** bucket = sync_lockdep_bucket(lock);
+    for (struct sync_lockdep_node* node = *bucket; node; node = node->next) {
+        if (node->lock == lock) return node;
+    }
+    struct sync_lockdep_node* node = (struct sync_lockdep_node*)calloc(1, sizeof(struct sync_lockdep_node));
+    if (!node) return 0;
+    node->lock = lock;
+    node->next = *bucket;
+    *bucket = node;
+    sync_lockdep_num_nodes++;
+    return node;
+}
+
+/********************************************************************************
+ * @brief Searches the graph for a path between specified primitives, via
+ *        depth-first search. The graph lock must be held.
+ *
+ * @note  Each visited node records the edge it was reached by, so that the
+ *        path can be traced back from the target.
+ *
+ * @param source
+ *        The node to start from.
+ * @param target
+ *        The node to search for.
+ * @return
+ *        True if the target is reachable from the source, else false.
+ ********************************************************************************/
+static bool sync_lockdep_find_path(struct sync_lockdep_node* source, const struct sync_lockdep_node* target) {
+    struct sync_lockdep_node** pending =
+        (struct sync_lockdep_node**)malloc(sync_lockdep_num_nodes * sizeof(struct sync_lockdep_node*));
+    if (!pending) return false;
+    const uint32_t visit = ++sync_lockdep_num_visits;
+    uint32_t num_pending = 0;
+    source->visit = visit;
+    source->via = 0;
+    pending[num_pending++] = source;
+    while (num_pending > 0) {
+        struct sync_lockdep_node* node = pending[--num_pending];
+        for (struct sync_lockdep_edge* edge = node->edges; edge; edge = edge->next) {
+            if (edge->to->visit == visit) continue;
+            edge->to->visit = visit;
+            edge->to->via = edge;
+            if (edge->to == target) {
+                free(pending);
+                return true;
+            }
+            pending[num_pending++] = edge->to;
+        }
+    }
+    free(pending);
+    return false;
+}
+
+/********************************************************************************
+ * @brief Writes the name of specified primitive to stderr, or its address if
+ *        it wasn't named.
+ *
+ * @param node
+ *        Reference to the node of the primitive.
+ ********************************************************************************/
+static void sync_lockdep_print_name(const struct sync_lockdep_node* node) {
+    if (node->name[0]) fputs(node->name, stderr);
+    else fprintf(stderr, "%p", node->lock);
+}
+
+/********************************************************************************
+ * @brief Writes an edge and its stack trace to stderr.
+ *
+ * @param from
+ *        The held primitive.
+ * @param to
+ *        The primitive acquired while holding the other one.
+ * @param stack
+ *        The stack trace of the acquisition.
+ * @param depth
+ *        The number of frames of the stack trace.
+ ********************************************************************************/
+static void sync_lockdep_print_edge(const struct sync_lockdep_node* from, const struct sync_lockdep_node* to,
+                                    void* const* stack, const int depth) {
+    fputs("sync_lockdep:   ", stderr);
+    sync_lockdep_print_name(to);
+    fputs(" acquired while holding ", stderr);
+    sync_lockdep_print_name(from);
+    fputs(" at:\n", stderr);
+    fflush(stderr);
+    backtrace_symbols_fd(stack, depth, fileno(stderr));
+}
+
+/********************************************************************************
+ * @brief Reports the cycle closed by a new edge to stderr. The graph lock must
+ *        be held, so that reports of different threads don't interleave.
+ *
+ * @note 1. We print the new edge with the stack trace of the calling thread.
+ *       2. We trace the path from the acquired primitive back to the held one
+ *          and print its edges in order, each with the stack trace of its
+ *          first acquisition.
+ *
+ * @param from
+ *        The held primitive.
+ * @param to
+ *        The primitive acquired while holding the other one.
+ * @param stack
+ *        The stack trace of the calling thread.
+ * @param depth
+ *        The number of frames of the stack trace.
+ ********************************************************************************/
+static void sync_lockdep_report(const struct sync_lockdep_node* from, const struct sync_lockdep_node* to,
+                                void* const* stack, const int depth) {
+    atomic_fetch_add_explicit(&sync_lockdep_inversions, 1, memory_order_relaxed);
+    fputs("sync_lockdep: lock-order inversion, acquiring ", stderr);
+    sync_lockdep_print_name(to);
+    fputs(" while holding ", stderr);
+    sync_lockdep_print_name(from);
+    fputs(", which has been acquired the other way around:\n", stderr);
+    sync_lockdep_print_edge(from, to, stack, depth);
+    uint32_t length = 0;
+    for (const struct sync_lockdep_edge* edge = from->via; edge; edge = edge->from->via) length++;
+    for (uint32_t i = length; i > 0; --i) {
+        const struct sync_lockdep_edge* edge = from->via;
+        for (uint32_t j = 1; j < i; ++j) edge = edge->from->via;
+        sync_lockdep_print_edge(edge->from, edge->to, edge->stack, edge->depth);
+    }
+}
+
+/********************************************************************************
+ * @brief Adds the edges from all primitives held by the calling thread to
+ *        specified primitive, unless they exist already. The graph lock must
+ *        be held.
+ *
+ * @note 1. If an edge from a held primitive exists, the order is known and we
+ *          continue with the next held primitive.
+ *       2. Else we capture the stack trace of the calling thread, once per
+ *          acquisition. If the held primitive is reachable from the acquired
+ *          one, the new edge closes a cycle, which we report.
+ *       3. We add the edge, even if it closes a cycle, so that the inversion
+ *          is only reported once.
+ *
+ * @param lock
+ *        Reference identifying the acquired primitive.
+ ********************************************************************************/
+static void sync_lockdep_add_edges(const void* lock) {
+    struct sync_lockdep_node* to = sync_lockdep_node_of(lock);
+    if (!to) return;
+    void* stack[SYNC_LOCKDEP_STACK_DEPTH];
+    int depth = -1;
+    for (uint16_t i = 0; i < sync_lockdep_num_held; ++i) {
+        if (sync_lockdep_held[i].lock == lock) continue;
+        struct sync_lockdep_node* from = sync_lockdep_node_of(sync_lockdep_held[i].lock);
+        if (!from) continue;
+        const struct sync_lockdep_edge* existing = from->edges;
+        while (existing && existing->to != to) existing = existing->next;
+        if (existing) continue;
+        if (depth < 0) depth = backtrace(stack, SYNC_LOCKDEP_STACK_DEPTH);
+        if (sync_lockdep_find_path(to, from)) sync_lockdep_report(from, to, stack, depth);
+        struct sync_lockdep_edge* edge = (struct sync_lockdep_edge*)malloc(sizeof(struct sync_lockdep_edge));
+        if (!edge) continue;
+        edge->from = from;
+        edge->to = to;
+        memcpy(edge->stack, stack, (size_t)depth * sizeof(void*));
+        edge->depth = depth;
+        edge->next = from->edges;
+        from->edges = edge;
+    }
+}
+
+/********************************************************************************
+ * @note 1. We name the node of the primitive, which is added if needed.
+ ********************************************************************************/
+void sync_lockdep_register(const void* lock, const char* name) {
+    pthread_mutex_lock(&sync_lockdep_graph_lock);
+    struct sync_lockdep_node* node = sync_lockdep_node_of(lock);
+    if (node) strncpy(node->name, name, SYNC_LOCKDEP_NAME_SIZE - 1);
+    pthread_mutex_unlock(&sync_lockdep_graph_lock);
+}
+
+/********************************************************************************
+ * @note 1. We remove the node of the primitive from its bucket. If the
+ *          primitive isn't part of the graph, we are done.
+ *       2. We remove all edges to the primitive from the other nodes.
+ *       3. We delete the edges of the primitive and its node.
+ ********************************************************************************/
+void sync_lockdep_forget(const void* lock) {
+    pthread_mutex_lock(&sync_lockdep_graph_lock);
+    struct sync_lockdep_node** link = sync_lockdep_bucket(lock);
+    while (*link && (*link)->lock != lock) link = &(*link)->next;
+    struct sync_lockdep_node* node = *link;
+    if (node) {
+        *link = node->next;
+        sync_lockdep_num_nodes--;
+        for (uint16_t i = 0; i < SYNC_LOCKDEP_NUM_BUCKETS; ++i) {
+            for (struct sync_lockdep_node* other = sync_lockdep_nodes[i]; other; other = other->next) {
+                struct sync_lockdep_edge** edge = &other->edges;
+                while (*edge) {
+                    if ((*edge)->to == node) {
+                        struct sync_lockdep_edge* removed = *edge;
+                        *edge = removed->next;
+                        free(removed);
+                    } else {
+                        edge = &(*edge)->next;
+                    }
+                }
+            }
+        }
+        while (node->edges) {
+            struct sync_lockdep_edge* removed = node->edges;
+            node->edges = removed->next;
+            free(removed);
+        }
+        free(node);
+    }
+    pthread_mutex_unlock(&sync_lockdep_graph_lock);
+}
+
+/********************************************************************************
+ * @note 1. If the acquisition might block while we hold other primitives, we
+ *          add the edges from them to the acquired primitive.
+ *       2. If we hold the primitive already, we count the acquisition.
+ *       3. Else we add the primitive to the held ones. If we already hold the
+ *          maximum number of primitives, we stop tracking the oldest one.
+ ********************************************************************************/
+void sync_lockdep_acquire(const void* lock, const bool blocking) {
+    if (blocking && sync_lockdep_num_held > 0) {
+        pthread_mutex_lock(&sync_lockdep_graph_lock);
+        sync_lockdep_add_edges(lock);
+        pthread_mutex_unlock(&sync_lockdep_graph_lock);
+    }
+    for (uint16_t i = 0; i < sync_lockdep_num_held; ++i) {
+        if (sync_lockdep_held[i].lock == lock) {
+            sync_lockdep_held[i].count++;
+            return;
+        }
+    }
+    if (sync_lockdep_num_held == SYNC_LOCKDEP_MAX_HELD) {
+        memmove(&sync_lockdep_held[0], &sync_lockdep_held[1],
+                sizeof(struct sync_lockdep_held) * (SYNC_LOCKDEP_MAX_HELD - 1));
+        sync_lockdep_num_held--;
+    }
+    sync_lockdep_held[sync_lockdep_num_held].lock = lock;
+    sync_lockdep_held[sync_lockdep_num_held].count = 1;
+    sync_lockdep_num_held++;
+}
+
+/********************************************************************************
+ * @note 1. We search for the primitive among the held ones. If we don't hold
+ *          it, we are done.
+ *       2. Else we count the release, and once the primitive is released as
+ *          often as it was acquired, we stop tracking it.
+ ********************************************************************************/
+void sync_lockdep_release(const void* lock) {
+    for (uint16_t i = sync_lockdep_num_held; i > 0; --i) {
+        if (sync_lockdep_held[i - 1].lock == lock) {
+            if (--sync_lockdep_held[i - 1].count == 0) {
+                memmove(&sync_lockdep_held[i - 1], &sync_lockdep_held[i],
+                        sizeof(struct sync_lockdep_held) * (sync_lockdep_num_held - i));
+                sync_lockdep_num_held--;
+            }
+            return;
+        }
+    }
+}
+
+/********************************************************************************
+ * @note 1. We return the number of reported inversions.
+ ********************************************************************************/
+uint32_t sync_lockdep_num_inversions(void) {
+    return atomic_load_explicit(&sync_lockdep_inversions, memory_order_relaxed);
+}
+
+#else
+
+/********************************************************************************
+ * @note 1. The checker is disabled, no inversions are reported.
+ ********************************************************************************/
+uint32_t sync_lockdep_num_inversions(void) {
+    return 0;
+}
+
+#endif /* SYNC_LOCKDEP */
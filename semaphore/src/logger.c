@@ -0,0 +1,465 @@
+/********************************************************************************
+ * @brief Implementation details for the asynchronous batched logger.
+ ********************************************************************************/
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <sync/backoff.h>
+#include <sync/logger.h>
+#include <sync/queue.h>
+#include "futex.h"
+
+/********************************************************************************
+ * @brief Length of a record that marks a flush request instead of holding
+ *        text. The text of the marker holds a reference to the futex word
+ *        of the flushing thread.
+ ********************************************************************************/
+#define ASYNC_LOGGER_FLUSH_MARKER UINT16_MAX
+
+/********************************************************************************
+ * @brief Record of the logger, copied into the queue as is.
+ *
+ * @param length
+ *        The length of the text in bytes, or ASYNC_LOGGER_FLUSH_MARKER.
+ * @param text
+ *        The text of the record, not null-terminated.
+ ********************************************************************************/
+struct async_logger_record {
+    uint16_t length;
+    char text[ASYNC_LOGGER_RECORD_SIZE - sizeof(uint16_t)];
+};
+
+/********************************************************************************
+ * @brief Structure for implementing the asynchronous logger. The structure is
+ *        private in this file.
+ *
+ * @param queue
+ *        The queue of records logged but not yet written.
+ * @param fd
+ *        The file descriptor the records are written to.
+ * @param flush_interval_ms
+ *        The longest time between two batches, 0 makes every record wake the
+ *        background thread.
+ * @param overflow_policy
+ *        The policy for records logged while the queue is full.
+ * @param wake_threshold
+ *        The number of queued records at which producers wake the background
+ *        thread before the flush interval has elapsed.
+ * @param thread
+ *        The background thread.
+ * @param running
+ *        Cleared when the logger is deleted.
+ * @param wake_seq
+ *        Futex word the background thread is parked on, incremented to wake it.
+ * @param sleeping
+ *        Set while the background thread is parked or about to be parked.
+ * @param space_seq
+ *        Futex word blocked producers are parked on, incremented by the
+ *        background thread to wake them after it dequeued records.
+ * @param num_blocked
+ *        The number of producers parked or about to be parked on a full queue.
+ * @param num_dropped
+ *        The number of records dropped due to a full queue.
+ * @param num_reported
+ *        The number of dropped records written to the output so far, only
+ *        accessed by the background thread.
+ * @param batch
+ *        The records of the batch being written.
+ * @param iov
+ *        The vector of the batch being written.
+ ********************************************************************************/
+struct async_logger {
+    struct mpmc_queue* queue;
+    int fd;
+    uint16_t flush_interval_ms;
+    enum async_logger_overflow_policy overflow_policy;
+    uint32_t wake_threshold;
+    pthread_t thread;
+    _Atomic bool running;
+    SYNC_CACHE_ALIGNED _Atomic uint32_t wake_seq;
+    _Atomic uint32_t sleeping;
+    SYNC_CACHE_ALIGNED _Atomic uint32_t space_seq;
+    _Atomic uint32_t num_blocked;
+    SYNC_CACHE_ALIGNED _Atomic uint64_t num_dropped;
+    SYNC_CACHE_ALIGNED uint64_t num_reported;
+    struct async_logger_record batch[ASYNC_LOGGER_BATCH_SIZE];
+    struct iovec iov[ASYNC_LOGGER_BATCH_SIZE];
+};
+
+/********************************************************************************
+ * @brief Buffer the calling thread formats its records into.
+ ********************************************************************************/
+static _Thread_local struct async_logger_record async_logger_buffer;
+
+/********************************************************************************
+ * @brief Writes specified vector completely, resuming after partial writes.
+ *
+ * @param fd
+ *        The file descriptor to write to.
+ * @param iov
+ *        Reference to the vector, modified by partial writes.
+ * @param count
+ *        The number of entries of the vector.
+ ********************************************************************************/
+static void async_logger_write_all(const int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        }
+    }
+}
+
+/********************************************************************************
+ * @brief Wakes the background thread if it is parked.
+ *
+ * @note  The fence orders the preceding push before the check of the sleeping
+ *        flag. Together with the fence of the background thread, either we see
+ *        the flag, or the background thread sees the pushed record.
+ *
+ * @param self
+ *        Reference to the logger.
+ ********************************************************************************/
+static inline void async_logger_wake(struct async_logger* self) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&self->sleeping, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&self->wake_seq, 1, memory_order_seq_cst);
+        futex_wake(&self->wake_seq, 1);
+    }
+}
+
+/********************************************************************************
+ * @brief Waits for room in the queue and enqueues specified record.
+ *
+ * @note 1. We wake the background thread and spin with exponential backoff
+ *          for a bounded number of iterations, retrying the push.
+ *       2. Then we register as a blocked producer and park until the 
+ *          background thread has dequeued records. The wake sequence is read
+ *          before we register and retry the push, and the fence orders the 
+ *          registration before the retry. Together with the fence of the 
+ *          background thread, either we see the room it made, or it sees us
+ *          and increments the sequence, which makes our wait return.
+ *
+ * @param self
+ *        Reference to the logger.
+ * @param record
+ *        Reference to the record.
+ ********************************************************************************/
+static void async_logger_push_blocking(struct async_logger* self, const struct async_logger_record* record) {
+    for (uint16_t spins = 0; spins < BACKOFF_SPIN_LIMIT_DEFAULT; ) {
+        async_logger_wake(self);
+        backoff_pause(spins++);
+        if (mpmc_queue_try_push(self->queue, record)) return;
+    }
+    while (1) {
+        const uint32_t seq = atomic_load_explicit(&self->space_seq, memory_order_seq_cst);
+        atomic_fetch_add_explicit(&self->num_blocked, 1, memory_order_seq_cst);
+        atomic_thread_fence(memory_order_seq_cst);
+        const bool pushed = mpmc_queue_try_push(self->queue, record);
+        if (!pushed) {
+            async_logger_wake(self);
+            futex_wait(&self->space_seq, seq);
+        }
+        atomic_fetch_sub_explicit(&self->num_blocked, 1, memory_order_relaxed);
+        if (pushed) return;
+    }
+}
+
+/********************************************************************************
+ * @brief Wakes the producers blocked on a full queue, if any, after records 
+ *        were dequeued. See async_logger_push_blocking.
+ *
+ * @param self
+ *        Reference to the logger.
+ ********************************************************************************/
+static inline void async_logger_wake_blocked(struct async_logger* self) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&self->num_blocked, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&self->space_seq, 1, memory_order_seq_cst);
+        futex_wake(&self->space_seq, INT_MAX);
+    }
+}
+
+/********************************************************************************
+ * @brief Enqueues specified record.
+ *
+ * @note 1. If the record fits in the queue, we wake the background thread: 
+ *          without a flush interval for every record, else only if it sleeps
+ *          and the queue has reached the wake threshold. The sleeping flag is
+ *          read first, so the counters of the queue aren't read while the 
+ *          background thread is busy. A wake-up missed since the flag is read
+ *          without a fence only delays the batch until the flush interval has
+ *          elapsed.
+ *       2. Else, if blocking is permitted, we park until the record fits, see
+ *          async_logger_push_blocking.
+ *       3. Else we count the record as dropped.
+ *
+ * @param self
+ *        Reference to the logger.
+ * @param record
+ *        Reference to the record.
+ * @param block
+ *        Indicates if the calling thread may wait for room in the queue.
+ * @return
+ *        True if the record was enqueued, false if it was dropped.
+ ********************************************************************************/
+static bool async_logger_push(struct async_logger* self, const struct async_logger_record* record,
+                              const bool block) {
+    if (mpmc_queue_try_push(self->queue, record)) {
+        if (!self->flush_interval_ms) {
+            async_logger_wake(self);
+        } else if (atomic_load_explicit(&self->sleeping, memory_order_relaxed) &&
+                   mpmc_queue_size(self->queue) >= self->wake_threshold) {
+            async_logger_wake(self);
+        }
+        return true;
+    }
+    if (!block) {
+        atomic_fetch_add_explicit(&self->num_dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    async_logger_push_blocking(self, record);
+    return true;
+}
+
+/********************************************************************************
+ * @brief Writes a line with the number of records dropped since the last
+ *        report, if any, when drops are to be reported.
+ *
+ * @param self
+ *        Reference to the logger.
+ ********************************************************************************/
+static void async_logger_report_drops(struct async_logger* self) {
+    if (self->overflow_policy != ASYNC_LOGGER_OVERFLOW_COUNT) return;
+    const uint64_t num_dropped = atomic_load_explicit(&self->num_dropped, memory_order_relaxed);
+    if (num_dropped == self->num_reported) return;
+    char line[64];
+    const int length = snprintf(line, sizeof(line), "async_logger: %llu records dropped\n",
+                                (unsigned long long)(num_dropped - self->num_reported));
+    struct iovec iov = {line, (size_t)length};
+    async_logger_write_all(self->fd, &iov, 1);
+    self->num_reported = num_dropped;
+}
+
+/********************************************************************************
+ * @brief Dequeues and writes a batch of records.
+ *
+ * @note 1. We dequeue up to ASYNC_LOGGER_BATCH_SIZE records and collect their
+ *          texts in the vector.
+ *       2. When we meet a flush marker, we first write the records before it,
+ *          then signal the flushing thread via its futex word.
+ *       3. If we dequeued any records, we wake the producers blocked on the
+ *          full queue.
+ *       4. We write the remaining records with a single writev call.
+ *
+ * @param self
+ *        Reference to the logger.
+ * @return
+ *        The number of dequeued records, including flush markers.
+ ********************************************************************************/
+static uint16_t async_logger_write_batch(struct async_logger* self) {
+    uint16_t num_records = 0;
+    int num_iov = 0;
+    while (num_records < ASYNC_LOGGER_BATCH_SIZE &&
+           mpmc_queue_try_pop(self->queue, &self->batch[num_records])) {
+        struct async_logger_record* record = &self->batch[num_records++];
+        if (record->length == ASYNC_LOGGER_FLUSH_MARKER) {
+            _Atomic uint32_t* done;
+            memcpy(&done, record->text, sizeof(done));
+            async_logger_write_all(self->fd, self->iov, num_iov);
+            num_iov = 0;
+            atomic_store_explicit(done, 1, memory_order_release);
+            futex_wake(done, 1);
+        } else {
+            self->iov[num_iov].iov_base = record->text;
+            self->iov[num_iov++].iov_len = record->length;
+        }
+    }
+    if (num_records) async_logger_wake_blocked(self);
+    async_logger_write_all(self->fd, self->iov, num_iov);
+    if (num_records) async_logger_report_drops(self);
+    return num_records;
+}
+
+/********************************************************************************
+ * @brief Runs the background thread of the logger.
+ *
+ * @note 1. We write batches as long as full batches are available.
+ *       2. If the logger is being deleted, we keep going until the queue is
+ *          empty, then we return. The running flag is read before the queue,
+ *          so records logged before the deletion are never lost.
+ *       3. Else we park for the flush interval, or until a producer wakes us.
+ *          The wake sequence is read before the sleeping flag is set, so a
+ *          wake-up in between makes the wait return immediately. Without a
+ *          flush interval, we only park if the queue is empty.
+ *
+ * @param arg
+ *        Reference to the logger.
+ * @return
+ *        A nullptr.
+ ********************************************************************************/
+static void* async_logger_run(void* arg) {
+    struct async_logger* self = (struct async_logger*)arg;
+    while (1) {
+        const bool stopping = !atomic_load_explicit(&self->running, memory_order_acquire);
+        const uint16_t num_records = async_logger_write_batch(self);
+        if (num_records == ASYNC_LOGGER_BATCH_SIZE) continue;
+        if (stopping) {
+            if (num_records == 0) break;
+            continue;
+        }
+        const uint32_t seq = atomic_load_explicit(&self->wake_seq, memory_order_seq_cst);
+        atomic_store_explicit(&self->sleeping, 1, memory_order_seq_cst);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&self->running, memory_order_seq_cst)) {
+            if (self->flush_interval_ms) {
+                futex_wait_for(&self->wake_seq, seq, self->flush_interval_ms);
+            } else if (mpmc_queue_size(self->queue) == 0) {
+                futex_wait(&self->wake_seq, seq);
+            }
+        }
+        atomic_store_explicit(&self->sleeping, 0, memory_order_relaxed);
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Provides the lowest power of two not less than specified number.
+ *
+ * @param num
+ *        The number.
+ * @return
+ *        The power of two, at least 2.
+ ********************************************************************************/
+static inline uint32_t async_logger_round_up(const uint32_t num) {
+    uint32_t power = 2;
+    while (power < num && power < (UINT32_C(1) << 31)) power <<= 1;
+    return power;
+}
+
+/********************************************************************************
+ * @note 1. We allocate the logger, aligned to a cache line, and its queue.
+ *       2. We apply the options, where zero-initialized fields select the
+ *          defaults. Producers wake the background thread when the queue is
+ *          half full, or on every record without a flush interval.
+ *       3. We start the background thread. If anything fails, we release the
+ *          allocated memory and return a nullptr.
+ ********************************************************************************/
+struct async_logger* async_logger_new(const struct async_logger_options* options) {
+    struct async_logger* self = (struct async_logger*)aligned_alloc(SYNC_CACHE_LINE_SIZE,
+                                                                    sizeof(struct async_logger));
+    if (!self) return 0;
+    const uint32_t capacity = async_logger_round_up(options && options->capacity ?
+                                                    options->capacity : ASYNC_LOGGER_CAPACITY_DEFAULT);
+    self->queue = mpmc_queue_new(capacity, sizeof(struct async_logger_record));
+    if (!self->queue) {
+        free(self);
+        return 0;
+    }
+    self->fd = options && options->fd ? options->fd : STDOUT_FILENO;
+    self->flush_interval_ms = options ? options->flush_interval_ms : ASYNC_LOGGER_FLUSH_INTERVAL_DEFAULT;
+    self->overflow_policy = options ? options->overflow_policy : ASYNC_LOGGER_OVERFLOW_BLOCK;
+    self->wake_threshold = capacity / 2;
+    self->num_reported = 0;
+    atomic_init(&self->running, true);
+    atomic_init(&self->wake_seq, 0);
+    atomic_init(&self->sleeping, 0);
+    atomic_init(&self->space_seq, 0);
+    atomic_init(&self->num_blocked, 0);
+    atomic_init(&self->num_dropped, 0);
+    if (pthread_create(&self->thread, 0, async_logger_run, self) != 0) {
+        mpmc_queue_delete(&self->queue);
+        free(self);
+        return 0;
+    }
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. We clear the running flag and wake the background thread, which
+ *          writes all remaining records before it returns.
+ *       2. We join the background thread and deallocate the logger.
+ *       3. Sets the logger pointer to null via the double pointer.
+ ********************************************************************************/
+void async_logger_delete(struct async_logger** self) {
+    if (*self) {
+        atomic_store_explicit(&(*self)->running, false, memory_order_seq_cst);
+        atomic_fetch_add_explicit(&(*self)->wake_seq, 1, memory_order_seq_cst);
+        futex_wake(&(*self)->wake_seq, 1);
+        pthread_join((*self)->thread, 0);
+        mpmc_queue_delete(&(*self)->queue);
+    }
+    free(*self);
+    *self = 0;
+}
+
+/********************************************************************************
+ * @note 1. We format the record into the buffer of the calling thread. Texts
+ *          longer than the record are truncated.
+ *       2. We enqueue the record according to the overflow policy.
+ ********************************************************************************/
+bool async_logger_printf(struct async_logger* self, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(async_logger_buffer.text, sizeof(async_logger_buffer.text), format, args);
+    va_end(args);
+    if (length < 0) return false;
+    async_logger_buffer.length = (size_t)length < sizeof(async_logger_buffer.text) ?
+                                 (uint16_t)length : (uint16_t)(sizeof(async_logger_buffer.text) - 1);
+    return async_logger_push(self, &async_logger_buffer,
+                             self->overflow_policy == ASYNC_LOGGER_OVERFLOW_BLOCK);
+}
+
+/********************************************************************************
+ * @note 1. We copy the text into the buffer of the calling thread. Texts longer
+ *          than the record are truncated.
+ *       2. We enqueue the record according to the overflow policy.
+ ********************************************************************************/
+bool async_logger_write(struct async_logger* self, const char* text, const size_t length) {
+    const size_t copied = length < sizeof(async_logger_buffer.text) ? length : sizeof(async_logger_buffer.text);
+    memcpy(async_logger_buffer.text, text, copied);
+    async_logger_buffer.length = (uint16_t)copied;
+    return async_logger_push(self, &async_logger_buffer,
+                             self->overflow_policy == ASYNC_LOGGER_OVERFLOW_BLOCK);
+}
+
+/********************************************************************************
+ * @note 1. We enqueue a flush marker holding a reference to a futex word of
+ *          our own. The marker always waits for room, since there is no point
+ *          in dropping it. The queue is FIFO, so the marker is dequeued after
+ *          all records we have logged before.
+ *       2. We wake the background thread and park until it has written the
+ *          records before the marker and set our futex word.
+ ********************************************************************************/
+void async_logger_flush(struct async_logger* self) {
+    _Atomic uint32_t done;
+    atomic_init(&done, 0);
+    struct async_logger_record marker = {.length = ASYNC_LOGGER_FLUSH_MARKER};
+    _Atomic uint32_t* reference = &done;
+    memcpy(marker.text, &reference, sizeof(reference));
+    async_logger_push(self, &marker, true);
+    async_logger_wake(self);
+    while (!atomic_load_explicit(&done, memory_order_acquire)) {
+        futex_wait(&done, 0);
+    }
+}
+
+/********************************************************************************
+ * @note 1. We return the drop counter.
+ ********************************************************************************/
+uint64_t async_logger_num_dropped(const struct async_logger* self) {
+    return atomic_load_explicit(&self->num_dropped, memory_order_relaxed);
+}
@@ -0,0 +1,452 @@
+/********************************************************************************
+ * @brief Microbenchmark comparing the synchronization primitives under load.
+ *
+ * @note  Three benchmarks are run for every primitive:
+ *            - uncontended: latency of a take/release pair in a single thread.
+ *            - contended: throughput of take/work/release loops run by an
+ *              increasing number of threads, swept over critical-section
+ *              lengths and, for counting semaphores, over capacities.
+ *            - fairness: for each contended run, Jain's fairness index of the
+ *              number of operations performed by each thread (1.0 = fair).
+ *        The results are written to stdout as CSV (default) or JSON, so that
+ *        they can be tracked for regressions.
+ *
+ *        Usage: run_benchmark [--duration-ms=N] [--max-threads=N] [--format=csv|json]
+ ********************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <semaphore>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sync/cache_line.h>
+#include <sync/counter.h>
+#include <sync/semaphore.h>
+#include "benchmark_primitives.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief Benchmark options given on the command line.
+ *
+ * @param duration_ms
+ *        The duration of each run, measured in milliseconds.
+ * @param max_threads
+ *        The highest number of threads used in the contended runs.
+ * @param json
+ *        Indicates if the results are written as JSON (true) or CSV (false).
+ ********************************************************************************/
+struct options {
+    uint32_t duration_ms{200};
+    uint16_t max_threads{static_cast<uint16_t>(std::max(1U, std::thread::hardware_concurrency()))};
+    bool json{false};
+};
+
+/********************************************************************************
+ * @brief Result of a benchmark run.
+ ********************************************************************************/
+struct result {
+    const char* benchmark;   /* The name of the benchmark. */
+    const char* primitive;   /* The name of the primitive. */
+    uint16_t capacity;       /* The number of resources of the primitive. */
+    uint16_t num_threads;    /* The number of threads competing for the primitive. */
+    uint32_t cs_length;      /* The number of work units in the critical section. */
+    uint64_t num_ops;        /* The total number of take/release pairs. */
+    double ns_per_op;        /* Wall-clock time per operation, measured in ns. */
+    double ops_per_sec;      /* Total throughput in operations per second. */
+    double fairness;         /* Jain's fairness index of the per-thread operations. */
+    uint64_t min_thread_ops; /* The lowest number of operations of a thread. */
+    uint64_t max_thread_ops; /* The highest number of operations of a thread. */
+};
+
+/********************************************************************************
+ * @brief Critical-section lengths swept in the contended runs.
+ ********************************************************************************/
+constexpr uint32_t cs_lengths[]{0, 50, 500};
+
+/********************************************************************************
+ * @brief Counting semaphore of the library in C++.
+ ********************************************************************************/
+template <uint16_t capacity>
+struct cpp_counting_semaphore_primitive {
+    static constexpr const char* name{"counting_semaphore_cpp"};
+    explicit cpp_counting_semaphore_primitive(const uint16_t) {}
+    void take(void) { semaphore_.take(); }
+    void release(void) { semaphore_.release(); }
+    counting_semaphore<capacity> semaphore_{"benchmark"};
+};
+
+/********************************************************************************
+ * @brief Counting semaphore of the library in C++, reserved in FIFO order via
+ *        a ticket lock.
+ ********************************************************************************/
+template <uint16_t capacity>
+struct cpp_fair_ticket_semaphore_primitive {
+    static constexpr const char* name{"counting_semaphore_fair_ticket"};
+    explicit cpp_fair_ticket_semaphore_primitive(const uint16_t) {}
+    void take(void) { semaphore_.take(); }
+    void release(void) { semaphore_.release(); }
+    counting_semaphore<capacity, semaphore_fair_ticket<>> semaphore_{"benchmark"};
+};
+
+/********************************************************************************
+ * @brief Counting semaphore of the library in C++, reserved in FIFO order via
+ *        an array-based queue lock.
+ ********************************************************************************/
+template <uint16_t capacity>
+struct cpp_fair_queue_semaphore_primitive {
+    static constexpr const char* name{"counting_semaphore_fair_queue"};
+    explicit cpp_fair_queue_semaphore_primitive(const uint16_t) {}
+    void take(void) { semaphore_.take(); }
+    void release(void) { semaphore_.release(); }
+    counting_semaphore<capacity, semaphore_fair_queue<>> semaphore_{"benchmark"};
+};
+
+/********************************************************************************
+ * @brief Mutex of the C++ standard library.
+ ********************************************************************************/
+struct std_mutex_primitive {
+    static constexpr const char* name{"std_mutex"};
+    explicit std_mutex_primitive(const uint16_t) {}
+    void take(void) { mutex_.lock(); }
+    void release(void) { mutex_.unlock(); }
+    std::mutex mutex_{};
+};
+
+/********************************************************************************
+ * @brief Counting semaphore of the C++20 standard library.
+ ********************************************************************************/
+template <uint16_t capacity>
+struct std_counting_semaphore_primitive {
+    static constexpr const char* name{"std_counting_semaphore"};
+    explicit std_counting_semaphore_primitive(const uint16_t) {}
+    void take(void) { semaphore_.acquire(); }
+    void release(void) { semaphore_.release(); }
+    std::counting_semaphore<capacity> semaphore_{capacity};
+};
+
+/********************************************************************************
+ * @brief Sharded counter of the library, where take increments the counter and
+ *        release does nothing. Compared to a single atomic counter below.
+ ********************************************************************************/
+struct sharded_counter_primitive {
+    static constexpr const char* name{"sharded_counter"};
+    explicit sharded_counter_primitive(const uint16_t) {}
+    void take(void) { ++counter_; }
+    void release(void) {}
+    sharded_counter<> counter_{};
+};
+
+/********************************************************************************
+ * @brief Single atomic counter shared by all threads, where take increments
+ *        the counter and release does nothing.
+ ********************************************************************************/
+struct atomic_counter_primitive {
+    static constexpr const char* name{"atomic_counter"};
+    explicit atomic_counter_primitive(const uint16_t) {}
+    void take(void) { counter_.fetch_add(1, std::memory_order_relaxed); }
+    void release(void) {}
+    std::atomic<uint64_t> counter_{};
+};
+
+/********************************************************************************
+ * @brief Per-thread operation counter, placed on a cache line of its own so
+ *        that the counters don't disturb the measurement.
+ ********************************************************************************/
+struct alignas(SYNC_CACHE_LINE_SIZE) thread_counter {
+    uint64_t num_ops{};
+};
+
+/********************************************************************************
+ * @brief Provides the elapsed time since specified point in time in ns.
+ *
+ * @param start
+ *        The point in time to measure from.
+ * @return
+ *        The elapsed time in ns.
+ ********************************************************************************/
+inline double ElapsedNs(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+/********************************************************************************
+ * @brief Measures the latency of uncontended take/release pairs.
+ *
+ * @tparam primitive
+ *         The primitive to benchmark.
+ * @param capacity
+ *        The number of resources of the primitive.
+ * @param opts
+ *        The benchmark options.
+ * @return
+ *        The result of the run.
+ ********************************************************************************/
+template <typename primitive>
+result RunUncontended(const uint16_t capacity, const options& opts) {
+    primitive p{capacity};
+    constexpr uint32_t batch_size{1000};
+    const auto duration_ns{static_cast<double>(opts.duration_ms) * 1e6};
+    uint64_t num_ops{};
+    const auto start{std::chrono::steady_clock::now()};
+    double elapsed_ns{};
+    do {
+        for (uint32_t i{}; i < batch_size; ++i) {
+            p.take();
+            p.release();
+        }
+        num_ops += batch_size;
+        elapsed_ns = ElapsedNs(start);
+    } while (elapsed_ns < duration_ns);
+    return result{"uncontended", primitive::name, capacity, 1, 0, num_ops, elapsed_ns / num_ops,
+                  num_ops * 1e9 / elapsed_ns, 1.0, num_ops, num_ops};
+}
+
+/********************************************************************************
+ * @brief Measures the throughput and fairness of threads competing for the
+ *        primitive in take/work/release loops.
+ *
+ * @tparam primitive
+ *         The primitive to benchmark.
+ * @param capacity
+ *        The number of resources of the primitive.
+ * @param num_threads
+ *        The number of competing threads.
+ * @param cs_length
+ *        The number of work units in the critical section.
+ * @param opts
+ *        The benchmark options.
+ * @return
+ *        The result of the run.
+ ********************************************************************************/
+template <typename primitive>
+result RunContended(const uint16_t capacity, const uint16_t num_threads, const uint32_t cs_length,
+                    const options& opts) {
+    primitive p{capacity};
+    std::vector<thread_counter> counters(num_threads);
+    std::atomic<uint16_t> num_ready{};
+    std::atomic<bool> start{false}, stop{false};
+    std::vector<std::thread> threads{};
+
+    for (uint16_t i{}; i < num_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            num_ready.fetch_add(1, std::memory_order_relaxed);
+            while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+            uint64_t num_ops{};
+            while (!stop.load(std::memory_order_relaxed)) {
+                p.take();
+                Work(cs_length);
+                p.release();
+                num_ops++;
+            }
+            counters[i].num_ops = num_ops;
+        });
+    }
+    while (num_ready.load(std::memory_order_relaxed) < num_threads) std::this_thread::yield();
+    const auto start_time{std::chrono::steady_clock::now()};
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(opts.duration_ms));
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& thread : threads) thread.join();
+    const auto elapsed_ns{ElapsedNs(start_time)};
+
+    uint64_t num_ops{}, min_ops{UINT64_MAX}, max_ops{};
+    double sum_of_squares{};
+    for (const auto& counter : counters) {
+        num_ops += counter.num_ops;
+        min_ops = std::min(min_ops, counter.num_ops);
+        max_ops = std::max(max_ops, counter.num_ops);
+        sum_of_squares += static_cast<double>(counter.num_ops) * counter.num_ops;
+    }
+    const auto fairness{sum_of_squares > 0 ? static_cast<double>(num_ops) * num_ops /
+                                             (num_threads * sum_of_squares) : 0.0};
+    return result{"contended", primitive::name, capacity, num_threads, cs_length, num_ops,
+                  num_ops ? elapsed_ns / num_ops : 0.0, num_ops * 1e9 / elapsed_ns, fairness, min_ops, max_ops};
+}
+
+/********************************************************************************
+ * @brief Provides the thread counts of the sweep: powers of two up to the
+ *        maximum, plus the maximum itself.
+ *
+ * @param max_threads
+ *        The highest number of threads.
+ * @return
+ *        The thread counts in ascending order.
+ ********************************************************************************/
+std::vector<uint16_t> ThreadCounts(const uint16_t max_threads) {
+    std::vector<uint16_t> counts{};
+    for (uint32_t n{1}; n < max_threads; n *= 2) counts.push_back(static_cast<uint16_t>(n));
+    counts.push_back(max_threads);
+    return counts;
+}
+
+/********************************************************************************
+ * @brief Runs all benchmarks for specified primitive and capacity.
+ *
+ * @tparam primitive
+ *         The primitive to benchmark, see benchmark_primitives.h.
+ * @param capacity
+ *        The number of resources of the primitive.
+ * @param opts
+ *        The benchmark options.
+ * @param results
+ *        Reference to vector the results are appended to.
+ ********************************************************************************/
+template <typename primitive>
+void RunPrimitive(const uint16_t capacity, const options& opts, std::vector<result>& results) {
+    results.push_back(RunUncontended<primitive>(capacity, opts));
+    for (const auto num_threads : ThreadCounts(opts.max_threads)) {
+        for (const auto cs_length : cs_lengths) {
+            results.push_back(RunContended<primitive>(capacity, num_threads, cs_length, opts));
+        }
+    }
+}
+
+/********************************************************************************
+ * @brief Runs all benchmarks for specified primitive with the capacities of
+ *        the sweep (1, 4 and 16 resources).
+ *
+ * @tparam primitive
+ *         The primitive to benchmark, constructed with the capacity.
+ * @param opts
+ *        The benchmark options.
+ * @param results
+ *        Reference to vector the results are appended to.
+ ********************************************************************************/
+template <typename primitive>
+void RunCountingPrimitive(const options& opts, std::vector<result>& results) {
+    RunPrimitive<primitive>(1, opts, results);
+    RunPrimitive<primitive>(4, opts, results);
+    RunPrimitive<primitive>(16, opts, results);
+}
+
+/********************************************************************************
+ * @brief Runs all benchmarks for specified primitive with the capacities of
+ *        the sweep (1, 4 and 16 resources).
+ *
+ * @tparam primitive
+ *         The primitive to benchmark, instantiated with the capacity.
+ * @param opts
+ *        The benchmark options.
+ * @param results
+ *        Reference to vector the results are appended to.
+ ********************************************************************************/
+template <template <uint16_t> class primitive>
+void RunCountingPrimitive(const options& opts, std::vector<result>& results) {
+    RunPrimitive<primitive<1>>(1, opts, results);
+    RunPrimitive<primitive<4>>(4, opts, results);
+    RunPrimitive<primitive<16>>(16, opts, results);
+}
+
+/********************************************************************************
+ * @brief Writes specified results to stdout as CSV.
+ *
+ * @param results
+ *        The results to write.
+ ********************************************************************************/
+void PrintCsv(const std::vector<result>& results) {
+    std::printf("benchmark,primitive,capacity,threads,cs_length,ops,ns_per_op,ops_per_sec,"
+                "fairness,min_thread_ops,max_thread_ops\n");
+    for (const auto& r : results) {
+        std::printf("%s,%s,%u,%u,%u,%llu,%.2f,%.0f,%.4f,%llu,%llu\n", r.benchmark, r.primitive, r.capacity,
+                    r.num_threads, r.cs_length, static_cast<unsigned long long>(r.num_ops), r.ns_per_op,
+                    r.ops_per_sec, r.fairness, static_cast<unsigned long long>(r.min_thread_ops),
+                    static_cast<unsigned long long>(r.max_thread_ops));
+    }
+}
+
+/********************************************************************************
+ * @brief Writes specified results to stdout as a JSON array.
+ *
+ * @param results
+ *        The results to write.
+ ********************************************************************************/
+void PrintJson(const std::vector<result>& results) {
+    std::printf("[\n");
+    for (std::size_t i{}; i < results.size(); ++i) {
+        const auto& r{results[i]};
+        std::printf("  {\"benchmark\": \"%s\", \"primitive\": \"%s\", \"capacity\": %u, \"threads\": %u, "
+                    "\"cs_length\": %u, \"ops\": %llu, \"ns_per_op\": %.2f, \"ops_per_sec\": %.0f, "
+                    "\"fairness\": %.4f, \"min_thread_ops\": %llu, \"max_thread_ops\": %llu}%s\n",
+                    r.benchmark, r.primitive, r.capacity, r.num_threads, r.cs_length,
+                    static_cast<unsigned long long>(r.num_ops), r.ns_per_op, r.ops_per_sec, r.fairness,
+                    static_cast<unsigned long long>(r.min_thread_ops),
+                    static_cast<unsigned long long>(r.max_thread_ops), i + 1 < results.size() ? "," : "");
+    }
+    std::printf("]\n");
+}
+
+/********************************************************************************
+ * @brief Parses the command line options.
+ *
+ * @param argc
+ *        The number of command line arguments.
+ * @param argv
+ *        The command line arguments.
+ * @param opts
+ *        Reference to the options to fill.
+ * @return
+ *        True if the options were parsed, false upon invalid options, such
+ *        as thread counts above 65535.
+ ********************************************************************************/
+bool ParseOptions(const int argc, char** argv, options& opts) {
+    for (int i{1}; i < argc; ++i) {
+        const char* arg{argv[i]};
+        if (std::strncmp(arg, "--duration-ms=", 14) == 0) {
+            opts.duration_ms = static_cast<uint32_t>(std::strtoul(arg + 14, nullptr, 10));
+        } else if (std::strncmp(arg, "--max-threads=", 14) == 0) {
+            const auto max_threads{std::strtoul(arg + 14, nullptr, 10)};
+            if (max_threads > UINT16_MAX) return false;
+            opts.max_threads = static_cast<uint16_t>(max_threads);
+        } else if (std::strcmp(arg, "--format=json") == 0) {
+            opts.json = true;
+        } else if (std::strcmp(arg, "--format=csv") == 0) {
+            opts.json = false;
+        } else {
+            return false;
+        }
+    }
+    return opts.duration_ms > 0 && opts.max_threads > 0;
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the benchmarks for all primitives and writes the results.
+ ********************************************************************************/
+int main(int argc, char** argv) {
+    options opts{};
+    if (!ParseOptions(argc, argv, opts)) {
+        std::fprintf(stderr, "Usage: %s [--duration-ms=N] [--max-threads=N] [--format=csv|json]\n", argv[0]);
+        return 1;
+    }
+    std::vector<result> results{};
+    RunPrimitive<binary_semaphore_primitive>(1, opts, results);
+    RunPrimitive<sync_mutex_primitive>(1, opts, results);
+    RunPrimitive<cohort_mutex_primitive>(1, opts, results);
+    RunPrimitive<rw_semaphore_read_primitive>(1, opts, results);
+    RunPrimitive<rw_semaphore_write_primitive>(1, opts, results);
+    RunPrimitive<pthread_mutex_primitive>(1, opts, results);
+    RunPrimitive<std_mutex_primitive>(1, opts, results);
+    RunPrimitive<sharded_counter_primitive>(1, opts, results);
+    RunPrimitive<atomic_counter_primitive>(1, opts, results);
+    RunCountingPrimitive<c_counting_semaphore_primitive>(opts, results);
+    RunCountingPrimitive<c_cached_counting_semaphore_primitive>(opts, results);
+    RunPrimitive<c_counting_semaphore_primitive>(1024, opts, results);
+    RunPrimitive<c_cached_counting_semaphore_primitive>(1024, opts, results);
+    RunCountingPrimitive<cpp_counting_semaphore_primitive>(opts, results);
+    RunCountingPrimitive<cpp_fair_ticket_semaphore_primitive>(opts, results);
+    RunCountingPrimitive<cpp_fair_queue_semaphore_primitive>(opts, results);
+    RunCountingPrimitive<std_counting_semaphore_primitive>(opts, results);
+
+    if (opts.json) {
+        PrintJson(results);
+    } else {
+        PrintCsv(results);
+    }
+    return 0;
+}
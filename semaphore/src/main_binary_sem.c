@@ -1,24 +1,24 @@
 /********************************************************************************
  * @brief Demonstration of binary semaphores in C.
  ********************************************************************************/
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <unistd.h>
-#include <pthread.h>
-#include <semaphore.h>
+#include <sync/counter.h>
+#include <sync/logger.h>
+#include <sync/semaphore.h>
+#include <sync/thread_pool.h>
 
 /********************************************************************************
  * @brief Identifiers for binary semaphores used in the program. These
  *        semaphores are used to make sure that only one thread has access to
  *        any given shared resource at a given time.
  * 
- * @param BINARY_SEM_ID_CONSOLE
- *        Semaphore for reserving the terminal (ID = 0).
  * @param BINARY_SEM_ID_SHARED_MEM
  *        Semaphore for reserving shared variables (ID = 1)
  ********************************************************************************/
-#define BINARY_SEM_ID_CONSOLE    (uint8_t)(0)
-#define BINARY_SEM_ID_SHARED_MEM (uint8_t)(1)
+#define BINARY_SEM_ID_SHARED_MEM (uint16_t)(1)
 
 /********************************************************************************
  * @brief Structure containing thread arguments.
@@ -34,9 +34,16 @@ struct thread_args {
 };
 
 /********************************************************************************
- * @brief Stores the number of performed prints.
+ * @brief Logger writing the prints of all threads to the terminal. The threads
+ *        only enqueue their prints, so they never wait for the terminal.
  ********************************************************************************/
-static uint16_t num_prints = 0;
+static struct async_logger* logger = 0;
+
+/********************************************************************************
+ * @brief Stores the number of performed prints. The counter is sharded, so the
+ *        threads increment it without synchronization.
+ ********************************************************************************/
+static struct sharded_counter* num_prints = 0;
 
 /********************************************************************************
  * @brief Blocks the calling thread for specified delay time in milliseconds.
@@ -56,43 +63,43 @@ static inline void delay_ms(const uint16_t delay_time_ms) {
  * @param args
  *        Thread-specific arguments passed as a reference to a thread_args
  *        structure. 
- * @return 
- *        A nullptr, since thread functions in C need to return some kind of
- *        pointer.
  ********************************************************************************/
-static void* run_thread(void* args) {
+static void run_thread(void* args) {
     struct thread_args* self = (struct thread_args*)(args);
-    const uint16_t adjusted_print_interval_ms = self->print_interval_ms > 10 ? self->print_interval_ms - 10 : 10;
     while (1) {
+        sharded_counter_increment(num_prints);
         binary_semaphore_take(BINARY_SEM_ID_SHARED_MEM);
-        const uint16_t num_prints_copy = ++num_prints;
+        async_logger_printf(logger,
+                            "--------------------------------------------------------------------------------\n"
+                            "Running thread with ID %hu!\n"
+                            "Number of performed prints: %" PRIu64 "\n"
+                            "--------------------------------------------------------------------------------\n\n",
+                            self->id, sharded_counter_read(num_prints));
         binary_semaphore_release(BINARY_SEM_ID_SHARED_MEM);
-
-        binary_semaphore_take(BINARY_SEM_ID_CONSOLE);
-        printf("--------------------------------------------------------------------------------\n");
-        printf("Running thread with ID %hu!\n", self->id);
-        printf("Number of performed prints: %hu\n", num_prints_copy);
-        printf("--------------------------------------------------------------------------------\n\n");
-        delay_ms(10);
-        binary_semaphore_release(BINARY_SEM_ID_CONSOLE);
-        delay_ms(adjusted_print_interval_ms);
+        delay_ms(self->print_interval_ms);
     }
-    return 0;
 }
 
 /********************************************************************************
  * @brief Creates and runs two threads with different parameters.
  * 
- * @note
- *        When creating threads, specify the starting routine and it's input
- *        arguments. Synchronize the threads by calling the join function.
+ * @note  The threads are workers of a thread pool, which runs each submitted
+ *        task with its input arguments. The pool gets one worker per task,
+ *        since the tasks never return. Deleting the pool waits for the tasks,
+ *        just like joining the threads.
  ********************************************************************************/
 int main(void) {
     struct thread_args args1 = {1, 1000}, args2 = {2, 1000};
-    pthread_t t1, t2;
-    pthread_create(&t1, 0, run_thread, &args1);
-    pthread_create(&t2, 0, run_thread, &args2);
-    pthread_join(t1, 0);
-    pthread_join(t2, 0);
+    const struct thread_pool_options options = {2, 0, false};
+    struct thread_pool* pool = thread_pool_new(&options);
+    logger = async_logger_new(0);
+    num_prints = sharded_counter_new(0);
+    if (!pool || !logger || !num_prints) return 1;
+
+    thread_pool_submit(pool, run_thread, &args1);
+    thread_pool_submit(pool, run_thread, &args2);
+    thread_pool_delete(&pool);
+    async_logger_delete(&logger);
+    sharded_counter_delete(&num_prints);
     return 0;
 }
\ No newline at end of file
@@ -1,11 +1,14 @@
 /********************************************************************************
  * @brief Demonstration of counting semaphores in C. 
  ********************************************************************************/
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <unistd.h>
-#include <pthread.h>
-#include <semaphore.h>
+#include <sync/counter.h>
+#include <sync/logger.h>
+#include <sync/semaphore.h>
+#include <sync/thread_pool.h>
 
 /********************************************************************************
  * @brief Structure containing thread arguments.
@@ -21,17 +24,24 @@ struct thread_args {
 };
 
 /********************************************************************************
- * @brief Counting semaphores for synchronized usage of the terminal and
- *        shared memory. The max count of the semaphores are set to 1, which
- *        makes them function as binary semaphores in this case, but we can
- *        set the max count to everyting between [1, 65 535].
+ * @brief Counting semaphore for synchronized usage of shared memory. The max 
+ *        count of the semaphore is set to 1, which makes it function as a 
+ *        binary semaphore in this case, but we can set the max count to 
+ *        everyting between [1, 65 535].
  ********************************************************************************/
-static struct counting_semaphore *sem_console, *sem_shared_mem;
+static struct counting_semaphore* sem_shared_mem = 0;
 
 /********************************************************************************
- * @brief Stores the number of performed prints.
+ * @brief Logger writing the prints of all threads to the terminal. The threads
+ *        only enqueue their prints, so they never wait for the terminal.
  ********************************************************************************/
-static uint16_t num_prints = 0;
+static struct async_logger* logger = 0;
+
+/********************************************************************************
+ * @brief Stores the number of performed prints. The counter is sharded, so the
+ *        threads increment it without synchronization.
+ ********************************************************************************/
+static struct sharded_counter* num_prints = 0;
 
 /********************************************************************************
  * @brief Blocks the calling thread for specified delay time in milliseconds.
@@ -51,48 +61,45 @@ static inline void delay_ms(const uint16_t delay_time_ms) {
  * @param args
  *        Thread-specific arguments passed as a reference to a thread_args
  *        structure. 
- * @return 
- *        A nullptr, since thread functions in C need to return some kind of
- *        pointer.
  ********************************************************************************/
-static void* run_thread(void* args) {
+static void run_thread(void* args) {
     struct thread_args* self = (struct thread_args*)(args);
-    const uint16_t adjusted_print_interval_ms = self->print_interval_ms > 10 ? self->print_interval_ms - 10 : 10;
     while (1) {
+        sharded_counter_increment(num_prints);
         counting_semaphore_take(sem_shared_mem);
-        const uint16_t num_prints_copy = ++num_prints;
+        async_logger_printf(logger,
+                            "--------------------------------------------------------------------------------\n"
+                            "Running thread with ID %hu!\n"
+                            "Number of performed prints: %" PRIu64 "\n"
+                            "--------------------------------------------------------------------------------\n\n",
+                            self->id, sharded_counter_read(num_prints));
         counting_semaphore_release(sem_shared_mem);
-
-        counting_semaphore_take(sem_console);
-        printf("--------------------------------------------------------------------------------\n");
-        printf("Running thread with ID %hu!\n", self->id);
-        printf("Number of performed prints: %hu\n", num_prints_copy);
-        printf("--------------------------------------------------------------------------------\n\n");
-        delay_ms(10);
-        counting_semaphore_release(sem_console);
-        delay_ms(adjusted_print_interval_ms);
+        delay_ms(self->print_interval_ms);
     }
-    return 0;
 }
 
 /********************************************************************************
  * @brief Creates and runs two threads with different parameters.
  * 
- * @note
- *        When creating threads, specify the starting routine and it's input
- *        arguments. Synchronize the threads by calling the join function.
+ * @note  The threads are workers of a thread pool, which runs each submitted
+ *        task with its input arguments. The pool gets one worker per task,
+ *        since the tasks never return. Deleting the pool waits for the tasks,
+ *        just like joining the threads.
  ********************************************************************************/
 int main(void) {
     struct thread_args args1 = {1, 1000}, args2 = {2, 1000};
-    pthread_t t1, t2;
-    sem_console = counting_semaphore_new(1);
-    sem_shared_mem = counting_semaphore_new(1);
+    const struct thread_pool_options options = {2, 0, false};
+    struct thread_pool* pool = thread_pool_new(&options);
+    sem_shared_mem = counting_semaphore_new(1, 0);
+    logger = async_logger_new(0);
+    num_prints = sharded_counter_new(0);
+    if (!pool || !sem_shared_mem || !logger || !num_prints) return 1;
 
-    pthread_create(&t1, 0, run_thread, &args1);
-    pthread_create(&t2, 0, run_thread, &args2);
-    pthread_join(t1, 0);
-    pthread_join(t2, 0);
-    counting_semaphore_delete(&sem_console);
+    thread_pool_submit(pool, run_thread, &args1);
+    thread_pool_submit(pool, run_thread, &args2);
+    thread_pool_delete(&pool);
     counting_semaphore_delete(&sem_shared_mem);
+    async_logger_delete(&logger);
+    sharded_counter_delete(&num_prints);
     return 0;
 }
\ No newline at end of file
@@ -1,27 +1,36 @@
 /********************************************************************************
  * @brief Demonstration of counting semaphores in C++.
  ********************************************************************************/
-#include <iostream>
 #include <thread>
 #include <chrono>
+#include <cinttypes>
 #include <cstdint>
-#include <semaphore.h>
+#include <sync/counter.h>
+#include <sync/logger.h>
+#include <sync/semaphore.h>
+#include <sync/thread_pool.h>
 
 namespace {
 
 /********************************************************************************
- * @brief Counting semaphores for synchronized usage of the terminal and
- *        shared memory. The max count of the semaphores are set to 1, which
- *        makes them function as binary semaphores in this case, but we can
- *        set the max count to everyting between [1, 65 535].
+ * @brief Counting semaphore for synchronized usage of shared memory. The max
+ *        count of the semaphore is set to 1, which makes it function as a
+ *        binary semaphore in this case, but we can set the max count to
+ *        everyting between [1, 65 535].
  ********************************************************************************/
-counting_semaphore<1> sem_console{};
 counting_semaphore<1> sem_shared_mem{};
 
 /********************************************************************************
- * @brief Stores the number of performed prints.
+ * @brief Logger writing the prints of all threads to the terminal. The threads
+ *        only enqueue their prints, so they never wait for the terminal.
  ********************************************************************************/
-uint16_t num_prints{};
+async_logger* logger{};
+
+/********************************************************************************
+ * @brief Stores the number of performed prints. The counter is sharded, so the
+ *        threads increment it without synchronization.
+ ********************************************************************************/
+sharded_counter<> num_prints{};
 
 /********************************************************************************
  * @brief Blocks the calling thread for specified delay time in milliseconds.
@@ -44,20 +53,17 @@ inline void Delay_ms(const uint16_t delay_time_ms) {
  *        The time interval between each print, measured in milliseconds.
  ********************************************************************************/
 void RunThread(const uint16_t thread_id, const uint16_t print_interval_ms) {
-    const auto adjusted_print_interval_ms{static_cast<uint16_t>(print_interval_ms > 10 ? print_interval_ms - 10 : 10)};
     while (1) {
+        ++num_prints;
         sem_shared_mem.take();
-        const auto num_prints_copy{++num_prints};
+        async_logger_printf(logger,
+                            "--------------------------------------------------------------------------------\n"
+                            "Running thread with ID %hu!\n"
+                            "Number of performed prints: %" PRIu64 "\n"
+                            "--------------------------------------------------------------------------------\n\n",
+                            thread_id, num_prints.read());
         sem_shared_mem.release();
-
-        sem_console.take();
-        std::cout << "--------------------------------------------------------------------------------\n";
-        std::cout << "Running thread with ID " << thread_id << "!\n";
-        std::cout << "Number of performed prints: " << num_prints_copy << "\n";
-        std::cout << "--------------------------------------------------------------------------------\n\n";
-        Delay_ms(10);
-        sem_console.release();
-        Delay_ms(adjusted_print_interval_ms);
+        Delay_ms(print_interval_ms);
     }
 }
 } /* namespace */
@@ -65,14 +71,18 @@ void RunThread(const uint16_t thread_id, const uint16_t print_interval_ms) {
 /********************************************************************************
  * @brief Creates and runs two threads with different parameters.
  * 
- * @note
- *        When creating threads, specify the starting routine and it's input
- *        arguments. Synchronize the threads by calling the join function.
+ * @note  The threads are workers of a thread pool, which runs each submitted
+ *        task on a worker of its own. The pool gets one worker per task,
+ *        since the tasks never return. Waiting for the pool to become idle
+ *        corresponds to joining the threads.
  ********************************************************************************/
 int main(void) {
-    std::thread t1{RunThread, 1, 1000};
-    std::thread t2{RunThread, 2, 1000};
-    t1.join();
-    t2.join();
+    logger = async_logger_new(nullptr);
+    if (!logger) return 1;
+    thread_pool<> pool{2};
+    pool.submit([]() { RunThread(1, 1000); });
+    pool.submit([]() { RunThread(2, 1000); });
+    pool.wait_idle();
+    async_logger_delete(&logger);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,307 @@
+/********************************************************************************
+ * @brief Load harness running a configurable number of threads against one of
+ *        the synchronization primitives and reporting acquisition latency
+ *        percentiles.
+ *
+ * @note  Each thread repeatedly takes the primitive, performs the critical
+ *        section work and releases it, until the duration has passed or the
+ *        harness is interrupted (SIGINT, SIGTERM), after which all threads
+ *        are stopped and joined. Two arrival models are supported:
+ *            - closed loop (rate 0): each thread takes the primitive again as
+ *              soon as it released it, and the latency of an acquisition is
+ *              measured from the call to take.
+ *            - open loop (rate > 0): acquisitions are scheduled at a fixed
+ *              total rate, spread evenly over the threads, and the latency is
+ *              measured from the scheduled time. If a thread falls behind, the
+ *              time it was late counts as latency, so that a stalled primitive
+ *              isn't hidden by fewer measurements (coordinated omission).
+ *        The latencies are recorded in an HDR histogram per thread, which are
+ *        merged once the threads have been joined. The result is written to
+ *        stdout as CSV (default) or JSON.
+ *
+ *        Usage: run_load [--primitive=NAME] [--threads=N] [--duration-ms=N]
+ *                        [--cs-work=N] [--rate=N] [--capacity=N]
+ *                        [--format=csv|json]
+ *
+ *        A duration of 0 runs until the harness is interrupted. The rate is
+ *        the total number of acquisitions per second, at most 10^9 per thread
+ *        as each thread schedules its acquisitions with ns resolution.
+ ********************************************************************************/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <sync/backoff.h>
+#include <sync/semaphore.h>
+#include "benchmark_primitives.h"
+#include "hdr_histogram.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief Harness options given on the command line.
+ *
+ * @param primitive
+ *        The name of the primitive to load.
+ * @param num_threads
+ *        The number of threads competing for the primitive.
+ * @param duration_ms
+ *        The duration of the run in milliseconds, 0 to run until interrupted.
+ * @param cs_work
+ *        The number of work units in the critical section.
+ * @param rate
+ *        The total number of acquisitions per second, 0 for a closed loop, at
+ *        most 10^9 per thread.
+ * @param capacity
+ *        The number of resources of counting semaphores.
+ * @param json
+ *        Indicates if the result is written as JSON (true) or CSV (false).
+ ********************************************************************************/
+struct options {
+    const char* primitive{"sync_mutex"};
+    uint16_t num_threads{2};
+    uint32_t duration_ms{1000};
+    uint32_t cs_work{50};
+    uint64_t rate{};
+    uint16_t capacity{1};
+    bool json{false};
+};
+
+/********************************************************************************
+ * @brief Set by the signal handler when the harness is interrupted.
+ ********************************************************************************/
+std::atomic<bool> interrupted{false};
+
+/********************************************************************************
+ * @brief Requests a clean shutdown when SIGINT or SIGTERM is received.
+ *
+ * @param signal
+ *        The received signal.
+ ********************************************************************************/
+extern "C" void OnSignal(int) { interrupted.store(true, std::memory_order_relaxed); }
+
+/********************************************************************************
+ * @brief Waits until specified point in time. Long waits sleep, the last
+ *        stretch is spun so that the wake-up latency of the scheduler doesn't
+ *        delay the arrival.
+ *
+ * @param deadline
+ *        The point in time to wait for.
+ ********************************************************************************/
+void WaitUntil(const std::chrono::steady_clock::time_point deadline) {
+    constexpr std::chrono::microseconds spin_time{100};
+    auto now{std::chrono::steady_clock::now()};
+    if (deadline - now > spin_time) std::this_thread::sleep_until(deadline - spin_time);
+    while (std::chrono::steady_clock::now() < deadline) backoff_cpu_relax();
+}
+
+/********************************************************************************
+ * @brief Result of a load run.
+ ********************************************************************************/
+struct result {
+    uint64_t num_ops;     /* The total number of take/release pairs. */
+    double elapsed_ns;    /* Wall-clock duration of the run in ns. */
+    hdr_histogram latency; /* Acquisition latencies of all threads in ns. */
+};
+
+/********************************************************************************
+ * @brief Runs the load against specified primitive.
+ *
+ * @note  The threads wait on a latch, so that they all start at the same time
+ *        as the measurement. The main thread sleeps in short slices, so that
+ *        an interruption stops the run promptly. Once stopped, every thread
+ *        finishes its current acquisition, which releases the primitive for
+ *        the others, so all threads can be joined.
+ *
+ * @tparam primitive
+ *         The primitive to load.
+ * @param opts
+ *        The harness options.
+ * @return
+ *        The result of the run.
+ ********************************************************************************/
+template <typename primitive>
+std::unique_ptr<result> RunLoad(const options& opts) {
+    primitive p{opts.capacity};
+    std::vector<hdr_histogram> histograms(opts.num_threads);
+    std::vector<uint64_t> num_ops(opts.num_threads);
+    std::atomic<bool> stop{false};
+    latch ready{static_cast<uint32_t>(opts.num_threads) + 1};
+    std::vector<std::thread> threads{};
+    std::chrono::steady_clock::time_point start_time{};
+    const std::chrono::nanoseconds interval{opts.rate ? static_cast<int64_t>(1'000'000'000ULL * opts.num_threads / opts.rate) : 0};
+
+    for (uint16_t i{}; i < opts.num_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            auto& histogram{histograms[i]};
+            uint64_t count{};
+            ready.arrive_and_wait();
+            auto next{start_time + interval * i / opts.num_threads};
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (opts.rate) {
+                    WaitUntil(next);
+                } else {
+                    next = std::chrono::steady_clock::now();
+                }
+                p.take();
+                const auto acquired{std::chrono::steady_clock::now()};
+                histogram.record(static_cast<uint64_t>(std::max<int64_t>(0, (acquired - next).count())));
+                Work(opts.cs_work);
+                p.release();
+                next += interval;
+                count++;
+            }
+            num_ops[i] = count;
+        });
+    }
+    start_time = std::chrono::steady_clock::now();
+    ready.arrive_and_wait();
+    const auto end_time{start_time + std::chrono::milliseconds(opts.duration_ms)};
+    while (!interrupted.load(std::memory_order_relaxed) &&
+           (!opts.duration_ms || std::chrono::steady_clock::now() < end_time)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stop.store(true, std::memory_order_relaxed);
+    for (auto& thread : threads) thread.join();
+
+    auto r{std::make_unique<result>()};
+    r->elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_time).count();
+    for (uint16_t i{}; i < opts.num_threads; ++i) {
+        r->num_ops += num_ops[i];
+        r->latency.add(histograms[i]);
+    }
+    return r;
+}
+
+/********************************************************************************
+ * @brief Runs the load against the primitive of specified name.
+ *
+ * @param opts
+ *        The harness options.
+ * @return
+ *        The result of the run, nullptr if the primitive is unknown.
+ ********************************************************************************/
+std::unique_ptr<result> RunNamedLoad(const options& opts) {
+    const auto is{[&](const char* name) { return std::strcmp(opts.primitive, name) == 0; }};
+    if (is("binary_semaphore")) return RunLoad<binary_semaphore_primitive>(opts);
+    if (is("counting_semaphore_c")) return RunLoad<c_counting_semaphore_primitive>(opts);
+    if (is("counting_semaphore_c_cached")) return RunLoad<c_cached_counting_semaphore_primitive>(opts);
+    if (is("rw_semaphore_read")) return RunLoad<rw_semaphore_read_primitive>(opts);
+    if (is("rw_semaphore_write")) return RunLoad<rw_semaphore_write_primitive>(opts);
+    if (is("sync_mutex")) return RunLoad<sync_mutex_primitive>(opts);
+    if (is("cohort_mutex")) return RunLoad<cohort_mutex_primitive>(opts);
+    if (is("pthread_mutex")) return RunLoad<pthread_mutex_primitive>(opts);
+    return nullptr;
+}
+
+/********************************************************************************
+ * @brief Writes specified result to stdout as CSV or JSON.
+ *
+ * @param opts
+ *        The harness options.
+ * @param r
+ *        The result to write.
+ ********************************************************************************/
+void PrintResult(const options& opts, const result& r) {
+    const auto ops_per_sec{r.elapsed_ns > 0 ? r.num_ops * 1e9 / r.elapsed_ns : 0.0};
+    const auto p50{static_cast<unsigned long long>(r.latency.value_at_percentile(50.0))};
+    const auto p99{static_cast<unsigned long long>(r.latency.value_at_percentile(99.0))};
+    const auto p999{static_cast<unsigned long long>(r.latency.value_at_percentile(99.9))};
+    const auto max{static_cast<unsigned long long>(r.latency.max())};
+    if (opts.json) {
+        std::printf("{\"primitive\": \"%s\", \"capacity\": %u, \"threads\": %u, \"cs_work\": %u, \"rate\": %llu, "
+                    "\"ops\": %llu, \"ops_per_sec\": %.0f, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+                    "\"p999_ns\": %llu, \"max_ns\": %llu}\n",
+                    opts.primitive, opts.capacity, opts.num_threads, opts.cs_work,
+                    static_cast<unsigned long long>(opts.rate), static_cast<unsigned long long>(r.num_ops),
+                    ops_per_sec, p50, p99, p999, max);
+    } else {
+        std::printf("primitive,capacity,threads,cs_work,rate,ops,ops_per_sec,p50_ns,p99_ns,p999_ns,max_ns\n");
+        std::printf("%s,%u,%u,%u,%llu,%llu,%.0f,%llu,%llu,%llu,%llu\n", opts.primitive, opts.capacity,
+                    opts.num_threads, opts.cs_work, static_cast<unsigned long long>(opts.rate),
+                    static_cast<unsigned long long>(r.num_ops), ops_per_sec, p50, p99, p999, max);
+    }
+}
+
+/********************************************************************************
+ * @brief Parses the command line options.
+ *
+ * @param argc
+ *        The number of command line arguments.
+ * @param argv
+ *        The command line arguments.
+ * @param opts
+ *        Reference to the options to fill.
+ * @return
+ *        True if the options were parsed, false upon invalid options. A rate
+ *        above 10^9 acquisitions per second and thread is invalid, as the
+ *        interval between the acquisitions of a thread would truncate to 0 ns
+ *        and the harness would silently run a closed loop. Thread counts and
+ *        capacities above 65535 are invalid as well, instead of being 
+ *        truncated to a different value.
+ ********************************************************************************/
+bool ParseOptions(const int argc, char** argv, options& opts) {
+    const auto parse_uint16{[](const char* text, uint16_t& value) {
+        const auto parsed{std::strtoul(text, nullptr, 10)};
+        value = static_cast<uint16_t>(parsed);
+        return parsed <= UINT16_MAX;
+    }};
+    for (int i{1}; i < argc; ++i) {
+        const char* arg{argv[i]};
+        if (std::strncmp(arg, "--primitive=", 12) == 0) {
+            opts.primitive = arg + 12;
+        } else if (std::strncmp(arg, "--threads=", 10) == 0) {
+            if (!parse_uint16(arg + 10, opts.num_threads)) return false;
+        } else if (std::strncmp(arg, "--duration-ms=", 14) == 0) {
+            opts.duration_ms = static_cast<uint32_t>(std::strtoul(arg + 14, nullptr, 10));
+        } else if (std::strncmp(arg, "--cs-work=", 10) == 0) {
+            opts.cs_work = static_cast<uint32_t>(std::strtoul(arg + 10, nullptr, 10));
+        } else if (std::strncmp(arg, "--rate=", 7) == 0) {
+            opts.rate = std::strtoull(arg + 7, nullptr, 10);
+        } else if (std::strncmp(arg, "--capacity=", 11) == 0) {
+            if (!parse_uint16(arg + 11, opts.capacity)) return false;
+        } else if (std::strcmp(arg, "--format=json") == 0) {
+            opts.json = true;
+        } else if (std::strcmp(arg, "--format=csv") == 0) {
+            opts.json = false;
+        } else {
+            return false;
+        }
+    }
+    return opts.num_threads > 0 && opts.capacity > 0 && opts.rate <= 1'000'000'000ULL * opts.num_threads;
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the load harness and writes the result.
+ ********************************************************************************/
+int main(int argc, char** argv) {
+    options opts{};
+    if (!ParseOptions(argc, argv, opts)) {
+        std::fprintf(stderr,
+                     "Usage: %s [--primitive=NAME] [--threads=N] [--duration-ms=N] [--cs-work=N] [--rate=N]\n"
+                     "       [--capacity=N] [--format=csv|json]\n"
+                     "Threads and capacity: 1 to 65535\n"
+                     "Rate: acquisitions per second, 0 for a closed loop, at most 10^9 per thread\n"
+                     "Primitives: binary_semaphore, counting_semaphore_c, counting_semaphore_c_cached,\n"
+                     "            rw_semaphore_read, rw_semaphore_write, sync_mutex, cohort_mutex, pthread_mutex\n",
+                     argv[0]);
+        return 1;
+    }
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+    const auto r{RunNamedLoad(opts)};
+    if (!r) {
+        std::fprintf(stderr, "Unknown primitive: %s\n", opts.primitive);
+        return 1;
+    }
+    PrintResult(opts, *r);
+    return 0;
+}
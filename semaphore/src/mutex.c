@@ -0,0 +1,547 @@
+/********************************************************************************
+ * @brief Implementation details for owner-tracking mutexes in C.
+ ********************************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sync/elision.h>
+#include <sync/lockdep.h>
+#include <sync/mutex.h>
+#include "futex.h"
+
+/********************************************************************************
+ * @brief The maximum time in milliseconds a thread is parked on a shared mutex
+ *        before it checks whether the mutex became unrecoverable meanwhile.
+ ********************************************************************************/
+#define SYNC_SHARED_MUTEX_PARK_INTERVAL_MS 10
+
+/********************************************************************************
+ * @brief Structure for implementing mutexes in C. The structure is private in
+ *        this file so that the user cannot alter the futex word or the owner
+ *        manually.
+ *
+ * @param state
+ *        The futex word, holding SYNC_MUTEX_UNLOCKED, SYNC_MUTEX_LOCKED or
+ *        SYNC_MUTEX_CONTENDED.
+ * @param owner
+ *        The kernel thread ID of the owner, 0 if the mutex is unlocked.
+ * @param stats
+ *        Statistics of the mutex, nullptr if the instrumentation is disabled.
+ * @param priority_inheritance
+ *        True if the futex word is a priority-inheritance futex, holding the
+ *        thread ID of the owner instead of the states above.
+ ********************************************************************************/
+struct sync_mutex {
+    _Atomic uint32_t state;
+    _Atomic uint32_t owner;
+    struct sync_stats* stats;
+    bool priority_inheritance;
+};
+
+/********************************************************************************
+ * @brief Structure for implementing shared mutexes in C. The structure is
+ *        private in this file so that the user cannot alter the mutex
+ *        manually. The POSIX mutex is process-shared, so that it is valid at
+ *        any address it is mapped to.
+ *
+ * @param mutex
+ *        The robust, process-shared POSIX mutex. The kernel walks the robust
+ *        list of an exiting thread and marks the mutexes it still owns, so a
+ *        dead owner is detected at once, independent of thread ID reuse and 
+ *        PID namespaces.
+ * @param recovered_by
+ *        The thread ID of the thread that recovered the mutex from a dead
+ *        owner, until it marks the mutex consistent, else 0.
+ * @param not_recoverable
+ *        Set once the mutex became unrecoverable. glibc reports this state
+ *        only to a single locking thread; later calls to trylock report the
+ *        mutex as busy and parked threads are never woken, so the state is
+ *        recorded here.
+ ********************************************************************************/
+struct sync_shared_mutex {
+    pthread_mutex_t mutex;
+    _Atomic uint32_t recovered_by;
+    _Atomic bool not_recoverable;
+};
+
+/********************************************************************************
+ * @brief The kernel thread ID of the calling thread, 0 until first used.
+ ********************************************************************************/
+static _Thread_local uint32_t sync_mutex_cached_thread_id = 0;
+
+/********************************************************************************
+ * @brief Ensures that the fork handler is only registered once.
+ ********************************************************************************/
+static pthread_once_t sync_mutex_fork_once = PTHREAD_ONCE_INIT;
+
+/********************************************************************************
+ * @brief Clears the cached thread ID in the child after fork, since the child
+ *        thread has another ID than the forking thread.
+ ********************************************************************************/
+static void sync_mutex_reset_thread_id(void) {
+    sync_mutex_cached_thread_id = 0;
+}
+
+/********************************************************************************
+ * @brief Registers the fork handler clearing the cached thread ID.
+ ********************************************************************************/
+static void sync_mutex_register_fork_handler(void) {
+    pthread_atfork(0, 0, sync_mutex_reset_thread_id);
+}
+
+/********************************************************************************
+ * @brief Provides the kernel thread ID of the calling thread.
+ *
+ * @note  The ID is cached per thread, so the system call is only made once
+ *        per thread and after each fork.
+ *
+ * @return
+ *        The thread ID of the calling thread (never 0).
+ ********************************************************************************/
+static inline uint32_t sync_mutex_thread_id(void) {
+    if (!sync_mutex_cached_thread_id) {
+        pthread_once(&sync_mutex_fork_once, sync_mutex_register_fork_handler);
+        sync_mutex_cached_thread_id = (uint32_t)syscall(SYS_gettid);
+    }
+    return sync_mutex_cached_thread_id;
+}
+
+/********************************************************************************
+ * @brief Waits for referenced mutex after the fast path failed.
+ *
+ * @note 1. As long as nobody is parked on the mutex, we spin with exponential
+ *          backoff and try to lock it via compare-and-swap.
+ *       2. Else we mark the mutex as contended via exchange. If the mutex was
+ *          unlocked, we have locked it, else we are parked until the futex word
+ *          changes and then retry. A thread that acquires the mutex this way
+ *          leaves it marked as contended, since other threads might still be
+ *          parked; the cost is at most one unnecessary wake-up call.
+ *       3. We record the acquisition in the statistics.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @param state
+ *        The state of the futex word observed by the fast path.
+ ********************************************************************************/
+static void sync_mutex_lock_contended(struct sync_mutex* self, uint32_t state) {
+    const uint64_t wait_start = sync_stats_now();
+    sync_stats_wait_begin(self->stats);
+    uint16_t spins = 0;
+    while (state != SYNC_MUTEX_CONTENDED && spins < SYNC_MUTEX_SPIN_LIMIT) {
+        backoff_pause(spins++);
+        state = SYNC_MUTEX_UNLOCKED;
+        if (atomic_compare_exchange_weak_explicit(&self->state, &state, SYNC_MUTEX_LOCKED,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            sync_stats_wait_end(self->stats);
+            sync_stats_acquired(self->stats, wait_start, spins);
+            return;
+        }
+    }
+    while (atomic_exchange_explicit(&self->state, SYNC_MUTEX_CONTENDED, memory_order_acquire)
+           != SYNC_MUTEX_UNLOCKED) {
+        futex_wait(&self->state, SYNC_MUTEX_CONTENDED);
+    }
+    sync_stats_wait_end(self->stats);
+    sync_stats_acquired(self->stats, wait_start, spins);
+}
+
+/********************************************************************************
+ * @brief Waits for referenced priority-inheritance mutex after the fast path
+ *        failed. The kernel queues us by priority and boosts the owner until
+ *        the mutex is handed to us.
+ *
+ * @param self
+ *        Reference to the mutex.
+ ********************************************************************************/
+static void sync_mutex_lock_pi(struct sync_mutex* self) {
+    const uint64_t wait_start = sync_stats_now();
+    sync_stats_wait_begin(self->stats);
+    futex_lock_pi(&self->state);
+    sync_stats_wait_end(self->stats);
+    sync_stats_acquired(self->stats, wait_start, 0);
+}
+
+/********************************************************************************
+ * @note  See futex_lock_pi.
+ ********************************************************************************/
+void sync_pi_futex_lock(void* futex_word) {
+    futex_lock_pi((_Atomic uint32_t*)futex_word);
+}
+
+/********************************************************************************
+ * @note  See futex_unlock_pi.
+ ********************************************************************************/
+void sync_pi_futex_unlock(void* futex_word) {
+    futex_unlock_pi((_Atomic uint32_t*)futex_word);
+}
+
+/********************************************************************************
+ * @brief Tries to elide the lock of referenced mutex via a hardware
+ *        transaction.
+ *
+ * @note 1. We start a transaction and read the futex word, which adds it to
+ *          the read set of the transaction. If the mutex is unlocked, we return
+ *          within the transaction. A thread locking the mutex for real then 
+ *          writes the futex word, which aborts us.
+ *       2. If the transaction is aborted, we record the abort. If it may 
+ *          succeed when retried, we back off and retry until 
+ *          SYNC_ELISION_MAX_ABORTS aborts, else we give up at once.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        True if the calling thread runs the critical section transactionally,
+ *        false if it must lock the mutex normally.
+ ********************************************************************************/
+static bool sync_mutex_lock_elided(struct sync_mutex* self) {
+    for (uint16_t num_aborts = 0; num_aborts < SYNC_ELISION_MAX_ABORTS; ) {
+        const unsigned status = sync_elision_begin();
+        if (status == SYNC_ELISION_STARTED) {
+            if (atomic_load_explicit(&self->state, memory_order_relaxed) == SYNC_MUTEX_UNLOCKED) return true;
+            sync_elision_abort_busy();
+        }
+        sync_stats_elision_aborted(self->stats);
+        if (!sync_elision_retry(status)) return false;
+        backoff_pause(num_aborts++);
+    }
+    return false;
+}
+
+/********************************************************************************
+ * @brief Indicates if the calling thread runs an elided critical section of
+ *        referenced mutex, i.e. runs transactionally while the mutex appears
+ *        unlocked.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        True if the critical section is elided, else false.
+ ********************************************************************************/
+static inline bool sync_mutex_elided(const struct sync_mutex* self) {
+    return !self->priority_inheritance && sync_elision_active() &&
+           atomic_load_explicit(&self->state, memory_order_relaxed) == SYNC_MUTEX_UNLOCKED;
+}
+
+/********************************************************************************
+ * @brief Provides the value of the futex word of referenced mutex when it is
+ *        locked by the calling thread without waiters.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        Our thread ID in the priority-inheritance mode, else SYNC_MUTEX_LOCKED.
+ ********************************************************************************/
+static inline uint32_t sync_mutex_locked_state(const struct sync_mutex* self) {
+    return self->priority_inheritance ? sync_mutex_thread_id() : SYNC_MUTEX_LOCKED;
+}
+
+/********************************************************************************
+ * @brief Creates a new mutex.
+ *
+ * @note 1. We allocate memory for a new mutex. If the memory allocation fails,
+ *          we return a nullptr.
+ *       2. We initialize the mutex as unlocked without owner. If the
+ *          instrumentation is enabled, the statistics are created. The mutex
+ *          is named in the lock-order graph.
+ *       3. We return a reference to the mutex.
+ *
+ * @param name
+ *        The name of the mutex in the statistics, nullptr selects "sync_mutex".
+ * @param priority_inheritance
+ *        True to create a priority-inheritance mutex.
+ * @return
+ *        A reference to the mutex, nullptr if the memory allocation failed.
+ ********************************************************************************/
+static struct sync_mutex* sync_mutex_create(const char* name, const bool priority_inheritance) {
+    struct sync_mutex* self = (struct sync_mutex*)malloc(sizeof(struct sync_mutex));
+    if (!self) return 0;
+    atomic_init(&self->state, SYNC_MUTEX_UNLOCKED);
+    atomic_init(&self->owner, 0);
+    self->priority_inheritance = priority_inheritance;
+    self->stats = sync_stats_new(name ? name : "sync_mutex");
+    sync_lockdep_register(self, name ? name : "sync_mutex");
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. We create a mutex using the three-state futex word.
+ ********************************************************************************/
+struct sync_mutex* sync_mutex_new(const char* name) {
+    return sync_mutex_create(name, false);
+}
+
+/********************************************************************************
+ * @note 1. We create a mutex using a priority-inheritance futex word.
+ ********************************************************************************/
+struct sync_mutex* sync_mutex_new_pi(const char* name) {
+    return sync_mutex_create(name, true);
+}
+
+/********************************************************************************
+ * @note 1. Removes the mutex from the lock-order graph and deallocates the heap
+ *          allocated memory, including the statistics.
+ *       2. Sets the mutex pointer to null via the double pointer.
+ ********************************************************************************/
+void sync_mutex_delete(struct sync_mutex** self) {
+    if (*self) {
+        sync_lockdep_forget(*self);
+        sync_stats_delete((*self)->stats);
+    }
+    free(*self);
+    *self = 0;
+}
+
+/********************************************************************************
+ * @note 1. We record the acquisition in the lock-order graph before we might
+ *          block. If lock elision is available, we try to run the critical 
+ *          section transactionally without locking the mutex. 
+ *          Priority-inheritance mutexes are never elided.
+ *       2. Else we try to lock the mutex with a single compare-and-swap from
+ *          unlocked to locked (acquire ordering makes the previous owner's
+ *          writes visible to us).
+ *       3. If the mutex was locked, we wait for it, via the kernel in the
+ *          priority-inheritance mode.
+ *       4. We record ourselves as the owner.
+ ********************************************************************************/
+void sync_mutex_lock(struct sync_mutex* self) {
+    sync_lockdep_acquire(self, true);
+    if (!self->priority_inheritance && sync_elision_supported() && sync_mutex_lock_elided(self)) return;
+    uint32_t state = SYNC_MUTEX_UNLOCKED;
+    if (atomic_compare_exchange_strong_explicit(&self->state, &state, sync_mutex_locked_state(self),
+                                                memory_order_acquire, memory_order_relaxed)) {
+        sync_stats_acquired(self->stats, 0, 0);
+    } else if (self->priority_inheritance) {
+        sync_mutex_lock_pi(self);
+    } else {
+        sync_mutex_lock_contended(self, state);
+    }
+    atomic_store_explicit(&self->owner, sync_mutex_thread_id(), memory_order_relaxed);
+}
+
+/********************************************************************************
+ * @note 1. We try to lock the mutex with a single compare-and-swap, else we
+ *          return false immediately.
+ *       2. We record ourselves as the owner and the acquisition in the 
+ *          statistics and the lock-order graph, and return true.
+ ********************************************************************************/
+bool sync_mutex_try_lock(struct sync_mutex* self) {
+    uint32_t state = SYNC_MUTEX_UNLOCKED;
+    if (!atomic_compare_exchange_strong_explicit(&self->state, &state, sync_mutex_locked_state(self),
+                                                 memory_order_acquire, memory_order_relaxed)) {
+        return false;
+    }
+    atomic_store_explicit(&self->owner, sync_mutex_thread_id(), memory_order_relaxed);
+    sync_stats_acquired(self->stats, 0, 0);
+    sync_lockdep_acquire(self, false);
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. If the critical section was elided, we commit its transaction and
+ *          record the elided acquisition.
+ *       2. If we don't own the mutex, we return false.
+ *       3. We clear the owner and unlock the mutex via exchange (release
+ *          ordering makes our writes visible to the next owner). In either
+ *          case, the release is recorded in the lock-order graph.
+ *       4. If the mutex was marked as contended, we wake one parked thread.
+ *          In the priority-inheritance mode, we unlock the mutex via 
+ *          compare-and-swap instead, which fails if threads are waiting, in
+ *          which case the kernel hands the mutex to the waiter of highest
+ *          priority.
+ ********************************************************************************/
+bool sync_mutex_unlock(struct sync_mutex* self) {
+    if (sync_mutex_elided(self)) {
+        sync_elision_end();
+        sync_stats_elided(self->stats);
+        sync_lockdep_release(self);
+        return true;
+    }
+    if (!sync_mutex_is_owner(self)) return false;
+    atomic_store_explicit(&self->owner, 0, memory_order_relaxed);
+    sync_stats_released(self->stats);
+    sync_lockdep_release(self);
+    if (self->priority_inheritance) {
+        uint32_t state = sync_mutex_thread_id();
+        if (!atomic_compare_exchange_strong_explicit(&self->state, &state, SYNC_MUTEX_UNLOCKED,
+                                                     memory_order_release, memory_order_relaxed)) {
+            futex_unlock_pi(&self->state);
+        }
+    } else if (atomic_exchange_explicit(&self->state, SYNC_MUTEX_UNLOCKED, memory_order_release)
+        == SYNC_MUTEX_CONTENDED) {
+        futex_wake(&self->state, 1);
+    }
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. Within an elided critical section, no owner is recorded, so we
+ *          count as the owner if the mutex appears unlocked.
+ *       2. Else we compare the recorded owner with our own thread ID. Only the
+ *          owner itself writes its ID, so relaxed ordering suffices.
+ ********************************************************************************/
+bool sync_mutex_is_owner(const struct sync_mutex* self) {
+    if (sync_mutex_elided(self)) return true;
+    return atomic_load_explicit(&self->owner, memory_order_relaxed) == sync_mutex_thread_id();
+}
+
+/********************************************************************************
+ * @note 1. We aggregate the statistics of the mutex into the snapshot.
+ ********************************************************************************/
+bool sync_mutex_stats(const struct sync_mutex* self, struct sync_stats_snapshot* snapshot) {
+    return sync_stats_read(self->stats, snapshot);
+}
+
+/********************************************************************************
+ * @note 1. We return the size of the mutex structure.
+ ********************************************************************************/
+size_t sync_shared_mutex_size(void) {
+    return sizeof(struct sync_shared_mutex);
+}
+
+/********************************************************************************
+ * @note 1. We initialize the POSIX mutex as robust and process-shared. If the
+ *          initialization fails, we return a nullptr.
+ *       2. We return a reference to the mutex.
+ ********************************************************************************/
+struct sync_shared_mutex* sync_shared_mutex_init(void* memory) {
+    struct sync_shared_mutex* self = sync_shared_mutex_from_memory(memory);
+    pthread_mutexattr_t attributes;
+    if (pthread_mutexattr_init(&attributes)) return 0;
+    const bool initialized = !pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED) &&
+                             !pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST) &&
+                             !pthread_mutex_init(&self->mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    if (!initialized) return 0;
+    atomic_init(&self->recovered_by, 0);
+    atomic_init(&self->not_recoverable, false);
+    return self;
+}
+
+/********************************************************************************
+ * @brief Maps the result of locking the POSIX mutex of referenced shared mutex
+ *        to the result of the shared mutex.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @param error
+ *        The result of pthread_mutex_lock or pthread_mutex_trylock.
+ * @return
+ *        The result of the shared mutex. If the owner died, we record 
+ *        ourselves as the thread that recovered the mutex, and if the mutex
+ *        is unrecoverable, we record that. Errors other than a busy mutex, 
+ *        such as a deadlock, are reported as unrecoverable.
+ ********************************************************************************/
+static enum sync_mutex_result sync_shared_mutex_result_of(struct sync_shared_mutex* self, const int error) {
+    switch (error) {
+        case 0:
+            return SYNC_MUTEX_ACQUIRED;
+        case EBUSY:
+            return SYNC_MUTEX_BUSY;
+        case EOWNERDEAD:
+            atomic_store_explicit(&self->recovered_by, sync_mutex_thread_id(), memory_order_relaxed);
+            return SYNC_MUTEX_OWNER_DIED;
+        case ENOTRECOVERABLE:
+            atomic_store_explicit(&self->not_recoverable, true, memory_order_relaxed);
+            return SYNC_MUTEX_NOT_RECOVERABLE;
+        default:
+            return SYNC_MUTEX_NOT_RECOVERABLE;
+    }
+}
+
+/********************************************************************************
+ * @brief Locks the POSIX mutex of referenced shared mutex, parking the calling
+ *        thread at most for SYNC_SHARED_MUTEX_PARK_INTERVAL_MS.
+ *
+ * @param self
+ *        Reference to the mutex.
+ * @return
+ *        The result of the shared mutex, SYNC_MUTEX_BUSY if the interval
+ *        expired.
+ ********************************************************************************/
+static enum sync_mutex_result sync_shared_mutex_park(struct sync_shared_mutex* self) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_nsec += SYNC_SHARED_MUTEX_PARK_INTERVAL_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    const int error = pthread_mutex_clocklock(&self->mutex, CLOCK_MONOTONIC, &deadline);
+    return error == ETIMEDOUT ? SYNC_MUTEX_BUSY : sync_shared_mutex_result_of(self, error);
+}
+
+/********************************************************************************
+ * @note 1. If the mutex became unrecoverable, we return right away.
+ *       2. We try to lock the mutex without blocking and, while it is busy, 
+ *          spin with exponential backoff and retry.
+ *       3. Then we lock the mutex via the POSIX mutex, which parks us via 
+ *          shared futex. If the owner dies, the kernel marks the mutex via 
+ *          the robust list of the owner, and we are woken right away. We park
+ *          for limited intervals only, since a thread parked on a mutex that
+ *          becomes unrecoverable may never be woken, and check in between.
+ *       4. The acquisition is recorded in the lock-order graph before we wait,
+ *          and withdrawn if the mutex wasn't locked.
+ ********************************************************************************/
+enum sync_mutex_result sync_shared_mutex_lock(struct sync_shared_mutex* self) {
+    if (atomic_load_explicit(&self->not_recoverable, memory_order_relaxed)) return SYNC_MUTEX_NOT_RECOVERABLE;
+    sync_lockdep_acquire(self, true);
+    enum sync_mutex_result result = sync_shared_mutex_result_of(self, pthread_mutex_trylock(&self->mutex));
+    for (uint16_t spins = 0; result == SYNC_MUTEX_BUSY && spins < SYNC_MUTEX_SPIN_LIMIT; ) {
+        backoff_pause(spins++);
+        result = sync_shared_mutex_result_of(self, pthread_mutex_trylock(&self->mutex));
+    }
+    while (result == SYNC_MUTEX_BUSY) {
+        if (atomic_load_explicit(&self->not_recoverable, memory_order_relaxed)) {
+            result = SYNC_MUTEX_NOT_RECOVERABLE;
+        } else {
+            result = sync_shared_mutex_park(self);
+        }
+    }
+    if (result == SYNC_MUTEX_NOT_RECOVERABLE) sync_lockdep_release(self);
+    return result;
+}
+
+/********************************************************************************
+ * @note 1. If the mutex became unrecoverable, we return right away.
+ *       2. We try to lock the POSIX mutex once, which also recovers the mutex
+ *          of a dead owner.
+ *       3. If we locked the mutex, we record the acquisition in the lock-order
+ *          graph.
+ ********************************************************************************/
+enum sync_mutex_result sync_shared_mutex_try_lock(struct sync_shared_mutex* self) {
+    if (atomic_load_explicit(&self->not_recoverable, memory_order_relaxed)) return SYNC_MUTEX_NOT_RECOVERABLE;
+    const enum sync_mutex_result result = sync_shared_mutex_result_of(self, pthread_mutex_trylock(&self->mutex));
+    if (result == SYNC_MUTEX_ACQUIRED || result == SYNC_MUTEX_OWNER_DIED) sync_lockdep_acquire(self, false);
+    return result;
+}
+
+/********************************************************************************
+ * @note 1. If we didn't recover the mutex, we return false.
+ *       2. Else we mark the POSIX mutex consistent, which fails if it isn't in
+ *          the recovered state, i.e. it was marked consistent already.
+ ********************************************************************************/
+bool sync_shared_mutex_consistent(struct sync_shared_mutex* self) {
+    if (atomic_load_explicit(&self->recovered_by, memory_order_relaxed) != sync_mutex_thread_id()) return false;
+    if (pthread_mutex_consistent(&self->mutex)) return false;
+    atomic_store_explicit(&self->recovered_by, 0, memory_order_relaxed);
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. If we recovered the mutex and didn't mark it consistent, we own it
+ *          and it becomes unrecoverable, so we record that before unlocking.
+ *          Parked threads then find the flag within their park interval.
+ *       2. We unlock the POSIX mutex, which fails if we don't own it, in which
+ *          case we return false.
+ *       3. The release is recorded in the lock-order graph.
+ ********************************************************************************/
+bool sync_shared_mutex_unlock(struct sync_shared_mutex* self) {
+    if (atomic_load_explicit(&self->recovered_by, memory_order_relaxed) == sync_mutex_thread_id()) {
+        atomic_store_explicit(&self->recovered_by, 0, memory_order_relaxed);
+        atomic_store_explicit(&self->not_recoverable, true, memory_order_relaxed);
+    }
+    if (pthread_mutex_unlock(&self->mutex)) return false;
+    sync_lockdep_release(self);
+    return true;
+}
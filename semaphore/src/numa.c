@@ -0,0 +1,74 @@
+/********************************************************************************
+ * @brief Implementation details for the NUMA topology detection.
+ ********************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sync/numa.h>
+
+/********************************************************************************
+ * @brief The detected number of nodes, 0 until the first query.
+ ********************************************************************************/
+static _Atomic uint16_t sync_numa_detected_nodes = 0;
+
+/********************************************************************************
+ * @brief The cached node of the calling thread, and the number of queries
+ *        left until it is read again.
+ ********************************************************************************/
+static _Thread_local uint16_t sync_numa_thread_node = 0;
+static _Thread_local uint16_t sync_numa_thread_queries_left = 0;
+
+/********************************************************************************
+ * @brief Reads the number of nodes from sysfs.
+ *
+ * @note 1. The file holds the online nodes as a list of ranges, for instance
+ *          "0-1" or "0,2-3". We take the highest listed node + 1, so that
+ *          every node ID is lower than the number of nodes.
+ *       2. If the file cannot be read, we report a single node.
+ *
+ * @return
+ *        The number of nodes, between 1 and SYNC_NUMA_MAX_NODES.
+ ********************************************************************************/
+static uint16_t sync_numa_read_nodes(void) {
+    FILE* file = fopen("/sys/devices/system/node/online", "r");
+    if (!file) return 1;
+    unsigned int highest = 0, node = 0;
+    char separator = 0;
+    while (fscanf(file, "%u%c", &node, &separator) >= 1) {
+        if (node > highest) highest = node;
+        if (separator != ',' && separator != '-') break;
+        separator = 0;
+    }
+    fclose(file);
+    return highest + 1 < SYNC_NUMA_MAX_NODES ? (uint16_t)(highest + 1) : SYNC_NUMA_MAX_NODES;
+}
+
+/********************************************************************************
+ * @note 1. We read the number of nodes on the first call. Concurrent first
+ *          calls may read it several times, but all store the same value.
+ ********************************************************************************/
+uint16_t sync_numa_num_nodes(void) {
+    uint16_t num_nodes = atomic_load_explicit(&sync_numa_detected_nodes, memory_order_relaxed);
+    if (!num_nodes) {
+        num_nodes = sync_numa_read_nodes();
+        atomic_store_explicit(&sync_numa_detected_nodes, num_nodes, memory_order_relaxed);
+    }
+    return num_nodes;
+}
+
+/********************************************************************************
+ * @note 1. We return the cached node of the calling thread, unless it is time
+ *          to read it again.
+ *       2. Else we read the node via getcpu, which is served by the vDSO
+ *          without a system call on most platforms. If it fails, we report
+ *          node 0. Nodes beyond the supported number are folded onto it.
+ ********************************************************************************/
+uint16_t sync_numa_current_node(void) {
+    if (sync_numa_thread_queries_left--) return sync_numa_thread_node;
+    unsigned int cpu = 0, node = 0;
+    if (getcpu(&cpu, &node) != 0) node = 0;
+    sync_numa_thread_node = (uint16_t)(node % sync_numa_num_nodes());
+    sync_numa_thread_queries_left = SYNC_NUMA_REFRESH_PERIOD - 1;
+    return sync_numa_thread_node;
+}
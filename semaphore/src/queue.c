@@ -0,0 +1,202 @@
+/********************************************************************************
+ * @brief Implementation details for bounded MPMC queues in C.
+ ********************************************************************************/
+#include <string.h>
+#include <stdatomic.h>
+#include <sync/queue.h>
+
+/********************************************************************************
+ * @brief Header of a slot of the ring buffer. The element is stored directly
+ *        after the header, at an offset suitably aligned for any type.
+ *
+ * @param seq
+ *        The sequence number of the slot. While the slot is empty it equals
+ *        the position of the next push to the slot, while it is full it equals
+ *        that position + 1.
+ ********************************************************************************/
+struct mpmc_queue_slot {
+    _Atomic size_t seq;
+};
+
+/********************************************************************************
+ * @brief Structure for implementing MPMC queues in C. The structure is private
+ *        in this file so that the user cannot alter the counters or slots
+ *        manually.
+ *
+ * @param enqueue_pos
+ *        The position of the next push, on a cache line of its own.
+ * @param dequeue_pos
+ *        The position of the next pop, on a cache line of its own.
+ * @param mask
+ *        Maps positions to slots (capacity - 1).
+ * @param element_size
+ *        The size of each element in bytes.
+ * @param slot_size
+ *        The size of each slot in bytes, a multiple of the cache line size.
+ * @param slots
+ *        The ring buffer.
+ ********************************************************************************/
+struct mpmc_queue {
+    SYNC_CACHE_ALIGNED _Atomic size_t enqueue_pos;
+    SYNC_CACHE_ALIGNED _Atomic size_t dequeue_pos;
+    SYNC_CACHE_ALIGNED size_t mask;
+    size_t element_size;
+    size_t slot_size;
+    unsigned char* slots;
+};
+
+/********************************************************************************
+ * @brief The offset of the element within a slot.
+ ********************************************************************************/
+#define MPMC_QUEUE_ELEMENT_OFFSET _Alignof(max_align_t)
+
+_Static_assert(sizeof(struct mpmc_queue_slot) <= MPMC_QUEUE_ELEMENT_OFFSET,
+               "The slot header must fit before the element!");
+
+/********************************************************************************
+ * @brief Provides the slot of specified position.
+ *
+ * @param self
+ *        Reference to the queue.
+ * @param pos
+ *        The position.
+ * @return
+ *        A reference to the slot holding the position.
+ ********************************************************************************/
+static inline struct mpmc_queue_slot* mpmc_queue_slot(const struct mpmc_queue* self, const size_t pos) {
+    return (struct mpmc_queue_slot*)(self->slots + (pos & self->mask) * self->slot_size);
+}
+
+/********************************************************************************
+ * @brief Provides the element storage of specified slot.
+ *
+ * @param slot
+ *        Reference to the slot.
+ * @return
+ *        A reference to the element storage.
+ ********************************************************************************/
+static inline unsigned char* mpmc_queue_element(struct mpmc_queue_slot* slot) {
+    return (unsigned char*)slot + MPMC_QUEUE_ELEMENT_OFFSET;
+}
+
+/********************************************************************************
+ * @note 1. If an invalid capacity or element size was specified, we return a
+ *          nullptr.
+ *       2. We allocate the queue and the ring buffer, both aligned to a cache
+ *          line. Each slot is rounded up to whole cache lines. If any memory
+ *          allocation fails, we return a nullptr.
+ *       3. We initialize the sequence number of each slot to its index, which
+ *          marks all slots as empty and ready for the first round of pushes.
+ ********************************************************************************/
+struct mpmc_queue* mpmc_queue_new(const uint32_t capacity, const size_t element_size) {
+    if (capacity < 2 || (capacity & (capacity - 1)) || element_size == 0) return 0;
+    struct mpmc_queue* self = (struct mpmc_queue*)aligned_alloc(SYNC_CACHE_LINE_SIZE, sizeof(struct mpmc_queue));
+    if (!self) return 0;
+    self->element_size = element_size;
+    self->slot_size = (MPMC_QUEUE_ELEMENT_OFFSET + element_size + SYNC_CACHE_LINE_SIZE - 1) /
+                      SYNC_CACHE_LINE_SIZE * SYNC_CACHE_LINE_SIZE;
+    self->slots = (unsigned char*)aligned_alloc(SYNC_CACHE_LINE_SIZE, capacity * self->slot_size);
+    if (!self->slots) {
+        free(self);
+        return 0;
+    }
+    self->mask = capacity - 1;
+    atomic_init(&self->enqueue_pos, 0);
+    atomic_init(&self->dequeue_pos, 0);
+    for (uint32_t i = 0; i < capacity; ++i) {
+        atomic_init(&mpmc_queue_slot(self, i)->seq, i);
+    }
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. Deallocates the ring buffer and the queue.
+ *       2. Sets the queue pointer to null via the double pointer.
+ ********************************************************************************/
+void mpmc_queue_delete(struct mpmc_queue** self) {
+    if (*self) free((*self)->slots);
+    free(*self);
+    *self = 0;
+}
+
+/********************************************************************************
+ * @note 1. We read the sequence number of the slot at the enqueue position.
+ *       2. If it equals the position, the slot is empty and we try to claim
+ *          the position via compare-and-swap. If we succeed, we copy the
+ *          element and publish it by setting the sequence number to the
+ *          position + 1 (release ordering makes the element visible to the
+ *          consumer).
+ *       3. If it is lower, the slot still holds an element from the previous
+ *          round, so the queue is full and we return false.
+ *       4. If it is higher, another producer claimed the position, so we
+ *          reload the enqueue position and retry.
+ ********************************************************************************/
+bool mpmc_queue_try_push(struct mpmc_queue* self, const void* element) {
+    size_t pos = atomic_load_explicit(&self->enqueue_pos, memory_order_relaxed);
+    while (1) {
+        struct mpmc_queue_slot* slot = mpmc_queue_slot(self, pos);
+        const size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&self->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                memcpy(mpmc_queue_element(slot), element, self->element_size);
+                atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&self->enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+/********************************************************************************
+ * @note 1. We read the sequence number of the slot at the dequeue position.
+ *       2. If it equals the position + 1, the slot is full and we try to claim
+ *          the position via compare-and-swap. If we succeed, we copy the
+ *          element and release the slot for the next round by setting the
+ *          sequence number to the position + capacity.
+ *       3. If it is lower, the slot has not been filled yet, so the queue is
+ *          empty and we return false.
+ *       4. If it is higher, another consumer claimed the position, so we
+ *          reload the dequeue position and retry.
+ ********************************************************************************/
+bool mpmc_queue_try_pop(struct mpmc_queue* self, void* element) {
+    size_t pos = atomic_load_explicit(&self->dequeue_pos, memory_order_relaxed);
+    while (1) {
+        struct mpmc_queue_slot* slot = mpmc_queue_slot(self, pos);
+        const size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        const intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&self->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                memcpy(element, mpmc_queue_element(slot), self->element_size);
+                atomic_store_explicit(&slot->seq, pos + self->mask + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&self->dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+/********************************************************************************
+ * @note 1. We return the difference between the enqueue and dequeue positions,
+ *          which may be transiently negative while both change.
+ ********************************************************************************/
+uint32_t mpmc_queue_size(const struct mpmc_queue* self) {
+    const size_t dequeued = atomic_load_explicit(&self->dequeue_pos, memory_order_relaxed);
+    const size_t enqueued = atomic_load_explicit(&self->enqueue_pos, memory_order_relaxed);
+    return enqueued > dequeued ? (uint32_t)(enqueued - dequeued) : 0;
+}
+
+/********************************************************************************
+ * @note 1. We return the number of slots.
+ ********************************************************************************/
+uint32_t mpmc_queue_capacity(const struct mpmc_queue* self) {
+    return (uint32_t)(self->mask + 1);
+}
@@ -0,0 +1,213 @@
+/********************************************************************************
+ * @brief Implementation details for resource pools in C.
+ ********************************************************************************/
+#include <string.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <sync/resource_pool.h>
+
+/********************************************************************************
+ * @brief Structure for implementing resource pools in C. The structure is
+ *        private in this file so that the user cannot alter the free-list
+ *        manually.
+ *
+ * @param head
+ *        Tag and index of the top free object, on a cache line of its own.
+ * @param sem
+ *        Counting semaphore counting the free objects, held by sem_storage.
+ * @param sem_storage
+ *        Inline storage of the semaphore, so that it isn't allocated apart.
+ * @param objects
+ *        The objects, each placed on cache lines of its own.
+ * @param next
+ *        The index of the next free object of each free object.
+ * @param in_use
+ *        Flag of each object, set while the object is acquired.
+ * @param stride
+ *        The distance between two objects in bytes.
+ * @param num_objects
+ *        The number of objects.
+ ********************************************************************************/
+struct resource_pool {
+    SYNC_CACHE_ALIGNED _Atomic uint64_t head;
+    SYNC_CACHE_ALIGNED struct counting_semaphore* sem;
+    struct counting_semaphore_storage sem_storage;
+    unsigned char* objects;
+    _Atomic uint16_t* next;
+    _Atomic bool* in_use;
+    size_t stride;
+    uint16_t num_objects;
+};
+
+/********************************************************************************
+ * @brief Provides the head of the free-list following specified head, with
+ *        specified index on top.
+ *
+ * @param head
+ *        The current head.
+ * @param index
+ *        The index of the new top object.
+ * @return
+ *        The new head, with the tag incremented.
+ ********************************************************************************/
+static inline uint64_t resource_pool_next_head(const uint64_t head, const uint16_t index) {
+    return ((head >> 16) + 1) << 16 | index;
+}
+
+/********************************************************************************
+ * @brief Pops the index of a free object of referenced resource pool.
+ *
+ * @note  Only called after a resource of the semaphore was reserved, so the
+ *        free-list holds an object for the calling thread. If it appears
+ *        empty, the object is about to be pushed and we retry.
+ *
+ * @param self
+ *        Reference to the resource pool.
+ * @return
+ *        The index of the object.
+ ********************************************************************************/
+static uint16_t resource_pool_pop(struct resource_pool* self) {
+    uint64_t head = atomic_load_explicit(&self->head, memory_order_acquire);
+    uint16_t spins = 0;
+    while (1) {
+        const uint16_t index = (uint16_t)(head & RESOURCE_POOL_NIL);
+        if (index == RESOURCE_POOL_NIL) {
+            backoff_pause(spins++);
+            head = atomic_load_explicit(&self->head, memory_order_acquire);
+            continue;
+        }
+        const uint16_t next = atomic_load_explicit(&self->next[index], memory_order_relaxed);
+        if (atomic_compare_exchange_weak_explicit(&self->head, &head, resource_pool_next_head(head, next),
+                                                  memory_order_acquire, memory_order_acquire)) {
+            return index;
+        }
+    }
+}
+
+/********************************************************************************
+ * @brief Pushes the index of a free object onto the free-list of referenced
+ *        resource pool.
+ *
+ * @param self
+ *        Reference to the resource pool.
+ * @param index
+ *        The index of the object.
+ ********************************************************************************/
+static void resource_pool_push(struct resource_pool* self, const uint16_t index) {
+    uint64_t head = atomic_load_explicit(&self->head, memory_order_relaxed);
+    do {
+        atomic_store_explicit(&self->next[index], (uint16_t)(head & RESOURCE_POOL_NIL), memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&self->head, &head, resource_pool_next_head(head, index),
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+/********************************************************************************
+ * @brief Pops a free object of referenced resource pool and marks it in use.
+ *
+ * @param self
+ *        Reference to the resource pool.
+ * @return
+ *        A reference to the object.
+ ********************************************************************************/
+static void* resource_pool_pop_object(struct resource_pool* self) {
+    const uint16_t index = resource_pool_pop(self);
+    atomic_store_explicit(&self->in_use[index], true, memory_order_relaxed);
+    return self->objects + index * self->stride;
+}
+
+/********************************************************************************
+ * @note 1. If an invalid number of objects or object size was specified, we
+ *          return a nullptr.
+ *       2. We allocate the pool, the objects, rounded up to whole cache lines,
+ *          the free-list and the in-use flags, and we initialize the semaphore
+ *          inline. If any allocation fails, we return a nullptr.
+ *       3. We zero the objects, mark them free and link all of them into the
+ *          free-list.
+ ********************************************************************************/
+struct resource_pool* resource_pool_new(const uint16_t num_objects, const size_t object_size,
+                                        const struct counting_semaphore_options* options) {
+    if (num_objects == 0 || num_objects == RESOURCE_POOL_NIL || object_size == 0) return 0;
+    struct resource_pool* self = (struct resource_pool*)aligned_alloc(SYNC_CACHE_LINE_SIZE,
+                                                                      sizeof(struct resource_pool));
+    if (!self) return 0;
+    self->stride = (object_size + SYNC_CACHE_LINE_SIZE - 1) / SYNC_CACHE_LINE_SIZE * SYNC_CACHE_LINE_SIZE;
+    self->num_objects = num_objects;
+    self->objects = (unsigned char*)aligned_alloc(SYNC_CACHE_LINE_SIZE, num_objects * self->stride);
+    self->next = (_Atomic uint16_t*)malloc(num_objects * sizeof(_Atomic uint16_t));
+    self->in_use = (_Atomic bool*)malloc(num_objects * sizeof(_Atomic bool));
+    self->sem = counting_semaphore_init(&self->sem_storage, num_objects, options);
+    if (!self->objects || !self->next || !self->in_use || !self->sem) {
+        resource_pool_delete(&self);
+        return 0;
+    }
+    memset(self->objects, 0, num_objects * self->stride);
+    for (uint16_t i = 0; i < num_objects; ++i) {
+        atomic_init(&self->next[i], i + 1U < num_objects ? (uint16_t)(i + 1U) : RESOURCE_POOL_NIL);
+        atomic_init(&self->in_use[i], false);
+    }
+    atomic_init(&self->head, 0);
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. Destroys the semaphore and deallocates the in-use flags, the
+ *          free-list, the objects and the pool.
+ *       2. Sets the pool pointer to null via the double pointer.
+ ********************************************************************************/
+void resource_pool_delete(struct resource_pool** self) {
+    if (*self) {
+        if ((*self)->sem) counting_semaphore_destroy((*self)->sem);
+        free((*self)->in_use);
+        free((*self)->next);
+        free((*self)->objects);
+    }
+    free(*self);
+    *self = 0;
+}
+
+/********************************************************************************
+ * @note 1. We reserve a resource of the semaphore, which blocks while all
+ *          objects are in use.
+ *       2. We pop a free object, mark it in use and return it.
+ ********************************************************************************/
+void* resource_pool_acquire(struct resource_pool* self) {
+    counting_semaphore_take(self->sem);
+    return resource_pool_pop_object(self);
+}
+
+/********************************************************************************
+ * @note 1. We try to reserve a resource of the semaphore, else we return a
+ *          nullptr.
+ *       2. We pop a free object, mark it in use and return it.
+ ********************************************************************************/
+void* resource_pool_try_acquire(struct resource_pool* self) {
+    if (!counting_semaphore_try_take_n(self->sem, 1)) return 0;
+    return resource_pool_pop_object(self);
+}
+
+/********************************************************************************
+ * @note 1. If the object doesn't start at an object of the pool, we return
+ *          false.
+ *       2. We clear the in-use flag of the object by an exchange, so that of
+ *          several releases of the same object only the first one succeeds.
+ *          Else the object would be pushed twice, which links the free-list
+ *          into a cycle.
+ *       3. We push the object onto the free-list before we release the
+ *          semaphore, so that a thread reserving the resource finds it, and
+ *          we return the result of the release.
+ ********************************************************************************/
+bool resource_pool_release(struct resource_pool* self, void* object) {
+    const uintptr_t offset = (uintptr_t)object - (uintptr_t)self->objects;
+    if (offset % self->stride != 0 || offset / self->stride >= self->num_objects) return false;
+    const uint16_t index = (uint16_t)(offset / self->stride);
+    if (!atomic_exchange_explicit(&self->in_use[index], false, memory_order_relaxed)) return false;
+    resource_pool_push(self, index);
+    return counting_semaphore_release_n(self->sem, 1);
+}
+
+/********************************************************************************
+ * @note 1. We return the number of available resources of the semaphore.
+ ********************************************************************************/
+uint16_t resource_pool_num_available(const struct resource_pool* self) {
+    return counting_semaphore_num_available(self->sem);
+}
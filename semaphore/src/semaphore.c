@@ -1,90 +1,1059 @@
 /********************************************************************************
- * @brief Implementation details for binary and counting semaphores in C.
+ * @brief Implementation details for binary, counting and reader-writer 
+ *        semaphores in C.
  ********************************************************************************/
-#include <semaphore.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sync/cache_line.h>
+#include <sync/elision.h>
+#include <sync/lockdep.h>
+#include <sync/semaphore.h>
+#include "futex.h"
+
+/********************************************************************************
+ * @brief Turn of a fair counting semaphore.
+ * 
+ * @param ticket
+ *        The ticket whose turn it is. Queued threads wait until it holds their
+ *        ticket, parked threads are parked on it via futex.
+ * @param num_parked
+ *        The number of threads parked on the turn.
+ ********************************************************************************/
+struct counting_semaphore_turn {
+    _Atomic uint32_t ticket;
+    _Atomic uint32_t num_parked;
+};
+
+/********************************************************************************
+ * @brief Turn slot of a counting semaphore using the queue fairness mode,
+ *        placed on a cache line of its own. Ticket t waits on slot 
+ *        t % SEMAPHORE_FAIR_QUEUE_NUM_SLOTS.
+ * 
+ * @param turn
+ *        The turn of the tickets mapped to the slot.
+ ********************************************************************************/
+struct counting_semaphore_turn_slot {
+    SYNC_CACHE_ALIGNED struct counting_semaphore_turn turn;
+};
+
+/********************************************************************************
+ * @brief Waiter of a counting semaphore using the priority fairness mode,
+ *        living on the stack of the waiting thread while it is queued.
+ * 
+ * @param next
+ *        The next waiter of the queue, of the same or lower priority.
+ * @param granted
+ *        Set to 1 once the resources are reserved for the waiter, which is
+ *        parked on it via futex.
+ * @param priority
+ *        The real-time priority of the waiting thread, 0 if not real-time.
+ * @param num
+ *        The number of resources the waiter waits for.
+ ********************************************************************************/
+struct counting_semaphore_waiter {
+    struct counting_semaphore_waiter* next;
+    _Atomic uint32_t granted;
+    int priority;
+    uint16_t num;
+};
+
+/********************************************************************************
+ * @brief Cache slot of a counting semaphore using the caching mode, placed on
+ *        a cache line of its own.
+ * 
+ * @param num_cached
+ *        The number of resources reserved from the shared counter but not 
+ *        taken yet, available to the threads assigned to the slot.
+ * @param num_borrowed
+ *        The number of resources taken by the threads assigned to the slot
+ *        and not released yet. A release must first claim its resources from
+ *        the borrowed resources of the slots, which bounds the resources that
+ *        can be released into the caches by the resources actually taken.
+ ********************************************************************************/
+struct counting_semaphore_cache_slot {
+    SYNC_CACHE_ALIGNED _Atomic uint32_t num_cached;
+    _Atomic uint32_t num_borrowed;
+};
+
+/********************************************************************************
+ * @brief Cache of a counting semaphore using the caching mode.
+ * 
+ * @param num_waiters
+ *        The number of threads waiting on the shared counter. While any thread
+ *        waits, released resources bypass the slots. Only written when a 
+ *        thread starts or stops waiting, so it is mostly read-shared.
+ * @param batch
+ *        The number of resources fetched from the shared counter at once.
+ * @param slots
+ *        The cache slots.
+ ********************************************************************************/
+struct counting_semaphore_cache {
+    SYNC_CACHE_ALIGNED _Atomic uint32_t num_waiters;
+    uint16_t batch;
+    struct counting_semaphore_cache_slot slots[SEMAPHORE_CACHE_NUM_SLOTS];
+};
 
 /********************************************************************************
  * @brief Structure for implementing counting semaphores in C. The structure
  *        is private in this file so that the used cannot alter the reserved
- *        resource count manually.
+ *        resource count manually. The leading members match the public members
+ *        of struct counting_semaphore_storage, so that a static initializer
+ *        can set them.
  * 
- * @param num_reserved_resources
- *        The number of reserved resources.
  * @param num_total_resources
  *        The total number of resources of the counting semaphore.
+ * @param spin_limit
+ *        The number of spin iterations before an adaptive waiter is parked.
+ * @param wait_policy
+ *        The strategy used when all resources are reserved.
+ * @param fairness
+ *        The order in which waiting threads reserve resources.
+ * @param event_fd
+ *        The eventfd counting the available resources in the pollable mode,
+ *        else -1.
+ * @param stats
+ *        Statistics of the semaphore, nullptr if the instrumentation is disabled
+ *        or if the semaphore was initialized statically.
+ * @param num_reserved_resources
+ *        The number of reserved resources. Stored as a 32-bit word so that
+ *        waiting threads can be parked on it via futex.
+ * @param num_waiters
+ *        The number of threads currently parked on the semaphore.
+ * @param num_bulk_waiters
+ *        The number of parked threads waiting for several resources at once.
+ * @param next_ticket
+ *        The next ticket to draw, only used if the ticket or queue fairness
+ *        mode is selected.
+ * @param queue_lock
+ *        Priority-inheritance futex word protecting the wait queue of the 
+ *        priority fairness mode, holding the thread ID of the owner.
+ * @param serving
+ *        The turn of the ticket being served. Queued threads of the ticket
+ *        fairness mode wait on it.
+ * @param turn_slots
+ *        The turn slots of the queue fairness mode, else nullptr.
+ * @param cache
+ *        The cache of the caching mode, else nullptr. Only used if no fairness
+ *        mode is selected.
+ * @param priority_waiters
+ *        The wait queue of the priority fairness mode, ordered by priority.
+ * @param process_shared
+ *        True if the semaphore is shared between processes, in which case it
+ *        is parked on via shared futexes.
  ********************************************************************************/
 struct counting_semaphore {
-    uint16_t num_reserved_resources;
     uint16_t num_total_resources;
+    uint16_t spin_limit;
+    enum semaphore_wait_policy wait_policy;
+    enum semaphore_fairness fairness;
+    int event_fd;
+    struct sync_stats* stats;
+    _Atomic uint32_t num_reserved_resources;
+    _Atomic uint32_t num_waiters;
+    _Atomic uint32_t num_bulk_waiters;
+    union {
+        _Atomic uint32_t next_ticket;
+        _Atomic uint32_t queue_lock;
+    };
+    struct counting_semaphore_turn serving;
+    union {
+        struct counting_semaphore_turn_slot* turn_slots;
+        struct counting_semaphore_waiter* _Atomic priority_waiters;
+        struct counting_semaphore_cache* cache;
+    };
+    bool process_shared;
+};
+
+_Static_assert(sizeof(struct counting_semaphore) <= sizeof(struct counting_semaphore_storage) &&
+               _Alignof(struct counting_semaphore) <= _Alignof(struct counting_semaphore_storage),
+               "The storage of counting semaphores is too small!");
+_Static_assert(offsetof(struct counting_semaphore, num_total_resources) ==
+               offsetof(struct counting_semaphore_storage, num_resources) &&
+               offsetof(struct counting_semaphore, spin_limit) == offsetof(struct counting_semaphore_storage, spin_limit) &&
+               offsetof(struct counting_semaphore, wait_policy) == offsetof(struct counting_semaphore_storage, wait_policy) &&
+               offsetof(struct counting_semaphore, fairness) == offsetof(struct counting_semaphore_storage, fairness) &&
+               offsetof(struct counting_semaphore, event_fd) == offsetof(struct counting_semaphore_storage, event_fd),
+               "The public members of the counting semaphore storage don't match the semaphore!");
+
+/********************************************************************************
+ * @brief States of the writer word of reader-writer semaphores.
+ * 
+ * @param RW_SEMAPHORE_NO_WRITER
+ *        No writer holds or waits for the semaphore.
+ * @param RW_SEMAPHORE_WRITER
+ *        A writer holds the semaphore or waits for the readers to leave, and
+ *        no thread is parked on the writer word.
+ * @param RW_SEMAPHORE_WRITER_CONTENDED
+ *        As RW_SEMAPHORE_WRITER, but threads might be parked on the writer word,
+ *        so the writer must wake them when releasing the semaphore.
+ ********************************************************************************/
+#define RW_SEMAPHORE_NO_WRITER        (uint32_t)(0)
+#define RW_SEMAPHORE_WRITER           (uint32_t)(1)
+#define RW_SEMAPHORE_WRITER_CONTENDED (uint32_t)(2)
+
+/********************************************************************************
+ * @brief Reader slot of a reader-writer semaphore, placed on a cache line of
+ *        its own so that readers of different slots never share a cache line.
+ * 
+ * @param num_readers
+ *        The number of readers of the threads assigned to the slot.
+ ********************************************************************************/
+struct rw_semaphore_slot {
+    SYNC_CACHE_ALIGNED _Atomic uint32_t num_readers;
+};
+
+/********************************************************************************
+ * @brief Structure for implementing reader-writer semaphores in C. The 
+ *        structure is private in this file so that the user cannot alter the
+ *        counters manually.
+ * 
+ * @param slots
+ *        The reader slots.
+ * @param writer
+ *        The writer word (see RW_SEMAPHORE_NO_WRITER), readers and writers 
+ *        waiting for a writer are parked on it.
+ * @param drain_seq
+ *        Incremented by readers leaving while a writer is active. The writer
+ *        waiting for the readers to leave is parked on it.
+ * @param stats
+ *        Statistics of the semaphore, nullptr if the instrumentation is disabled.
+ ********************************************************************************/
+struct rw_semaphore {
+    struct rw_semaphore_slot slots[RW_SEMAPHORE_NUM_SLOTS];
+    SYNC_CACHE_ALIGNED _Atomic uint32_t writer;
+    _Atomic uint32_t drain_seq;
+    struct sync_stats* stats;
+};
+
+/********************************************************************************
+ * @brief The number of threads assigned to reader slots so far, and the slot
+ *        of the calling thread (UINT32_MAX until assigned).
+ ********************************************************************************/
+static _Atomic uint32_t rw_semaphore_num_threads;
+static _Thread_local uint32_t rw_semaphore_thread_slot = UINT32_MAX;
+
+/********************************************************************************
+ * @brief The number of threads assigned to cache slots of counting semaphores
+ *        so far, and the cache slot index of the calling thread (UINT32_MAX 
+ *        until the thread uses a caching semaphore for the first time).
+ ********************************************************************************/
+static _Atomic uint32_t counting_semaphore_num_threads;
+static _Thread_local uint32_t counting_semaphore_thread_slot = UINT32_MAX;
+
+/********************************************************************************
+ * @brief Parent index of the root node of the combining tree of a barrier.
+ ********************************************************************************/
+#define BARRIER_NO_PARENT UINT32_MAX
+
+/********************************************************************************
+ * @brief Node of the combining tree of a barrier, placed on a cache line of
+ *        its own.
+ * 
+ * @note  The counter is never reset: in phase p, a node with n expected 
+ *        arrivals counts from p * n to (p + 1) * n, wrapping around. A thread
+ *        arriving at a full leaf therefore sees it as full until the next 
+ *        phase and tries the next leaf instead.
+ * 
+ * @param count
+ *        The arrivals of all phases so far.
+ * @param expected
+ *        The number of arrivals per phase, i.e. threads for a leaf and child 
+ *        nodes for an upper node.
+ * @param parent
+ *        The index of the parent node, BARRIER_NO_PARENT for the root.
+ ********************************************************************************/
+struct barrier_node {
+    SYNC_CACHE_ALIGNED _Atomic uint32_t count;
+    uint32_t expected;
+    uint32_t parent;
+};
+
+/********************************************************************************
+ * @brief Structure for implementing barriers in C. The structure is private 
+ *        in this file so that the user cannot alter the tree manually.
+ * 
+ * @param phase
+ *        The number of completed phases. Waiting threads are parked on it via
+ *        futex.
+ * @param num_parked
+ *        The number of threads parked on the phase.
+ * @param num_leaves
+ *        The number of leaves of the combining tree.
+ * @param completion
+ *        Function run by the thread completing a phase, nullptr for none.
+ * @param context
+ *        Argument passed to the completion function.
+ * @param nodes
+ *        The nodes of the combining tree: the leaves, followed by each upper
+ *        level up to the root.
+ ********************************************************************************/
+struct barrier {
+    SYNC_CACHE_ALIGNED _Atomic uint32_t phase;
+    _Atomic uint32_t num_parked;
+    uint32_t num_leaves;
+    void (*completion)(void* context);
+    void* context;
+    struct barrier_node* nodes;
+};
+
+/********************************************************************************
+ * @brief The number of threads assigned to leaves of barriers so far, and the
+ *        index of the calling thread (UINT32_MAX until the thread arrives at a
+ *        barrier for the first time). The index is shared by all barriers.
+ ********************************************************************************/
+static _Atomic uint32_t barrier_num_threads;
+static _Thread_local uint32_t barrier_thread_index = UINT32_MAX;
+
+/********************************************************************************
+ * @brief Structure for implementing latches in C. The structure is private in
+ *        this file so that the user cannot alter the counter manually.
+ * 
+ * @param count
+ *        The remaining count. Waiting threads are parked on it via futex.
+ * @param num_parked
+ *        The number of threads parked on the counter.
+ ********************************************************************************/
+struct latch {
+    _Atomic uint32_t count;
+    _Atomic uint32_t num_parked;
+};
+
+/********************************************************************************
+ * @brief The number of shards of the binary semaphore bank. Each hot semaphore
+ *        has a shard of its own, while the remaining packed semaphores share
+ *        a shard per 32 IDs.
+ ********************************************************************************/
+#define BINARY_SEMAPHORE_NUM_PACKED_IDS (BINARY_SEMAPHORE_LIMIT - BINARY_SEMAPHORE_NUM_HOT_IDS)
+#define BINARY_SEMAPHORE_NUM_SHARDS     (BINARY_SEMAPHORE_NUM_HOT_IDS + \
+    (BINARY_SEMAPHORE_NUM_PACKED_IDS + BINARY_SEMAPHORE_IDS_PER_SHARD - 1) / BINARY_SEMAPHORE_IDS_PER_SHARD)
+
+_Static_assert(BINARY_SEMAPHORE_LIMIT > 0 && BINARY_SEMAPHORE_LIMIT <= UINT16_MAX,
+               "The number of binary semaphores must be within [1, 65 535]!");
+_Static_assert(BINARY_SEMAPHORE_NUM_HOT_IDS <= BINARY_SEMAPHORE_LIMIT,
+               "The number of hot binary semaphores cannot exceed the number of binary semaphores!");
+
+/********************************************************************************
+ * @brief Shard of the binary semaphore bank, placed on a cache line of its own
+ *        so that semaphores of different shards never contend for the same
+ *        cache line.
+ * 
+ * @param bits
+ *        Each bit is set while the corresponding semaphore is reserved.
+ * @param num_waiters
+ *        The number of threads currently parked on the shard. Used to skip the
+ *        wake-up system call when nobody is waiting.
+ ********************************************************************************/
+struct binary_semaphore_shard {
+    SYNC_CACHE_ALIGNED _Atomic uint32_t bits;
+    _Atomic uint32_t num_waiters;
 };
 
 /********************************************************************************
- * @brief 32 binary semaphores, ID = [0, 31].
+ * @brief The binary semaphore bank, ID = [0, BINARY_SEMAPHORE_ID_MAX].
+ ********************************************************************************/
+static struct binary_semaphore_shard binary_semaphores[BINARY_SEMAPHORE_NUM_SHARDS];
+
+/********************************************************************************
+ * @brief Structure for implementing binary semaphore banks, placed in memory
+ *        provided by the user. The structure is private in this file so that
+ *        the user cannot alter the shards manually. It holds no pointers, so
+ *        that it is valid at any address it is mapped to.
+ * 
+ * @param num_semaphores
+ *        The number of semaphores of the bank.
+ * @param shards
+ *        The shards, each holding 32 semaphores on a cache line of its own.
+ ********************************************************************************/
+struct binary_semaphore_bank {
+    uint16_t num_semaphores;
+    struct binary_semaphore_shard shards[];
+};
+
+#ifdef SYNC_STATS
+
+/********************************************************************************
+ * @brief Statistics of the binary semaphores, created on first use of each ID.
+ ********************************************************************************/
+static struct sync_stats* _Atomic binary_semaphore_statistics[BINARY_SEMAPHORE_LIMIT];
+
+/********************************************************************************
+ * @brief Provides the statistics of the binary semaphore with specified ID.
+ * 
+ * @note  The statistics are created on first use. If two threads create them
+ *        at the same time, the loser deletes its copy and uses the winner's.
+ * 
+ * @param sem_id
+ *        Identifier of the semaphore (must be valid).
+ * @return
+ *        A reference to the statistics, nullptr if the allocation failed.
+ ********************************************************************************/
+static struct sync_stats* binary_semaphore_stats_of(const uint16_t sem_id) {
+    struct sync_stats* stats = atomic_load_explicit(&binary_semaphore_statistics[sem_id], memory_order_acquire);
+    if (stats) return stats;
+    char name[SYNC_STATS_NAME_SIZE];
+    snprintf(name, sizeof(name), "binary_semaphore[%u]", (unsigned)sem_id);
+    struct sync_stats* created = sync_stats_new(name);
+    if (atomic_compare_exchange_strong_explicit(&binary_semaphore_statistics[sem_id], &stats, created,
+                                                memory_order_acq_rel, memory_order_acquire)) {
+        return created;
+    }
+    sync_stats_delete(created);
+    return stats;
+}
+
+#else
+
+static inline struct sync_stats* binary_semaphore_stats_of(const uint16_t sem_id) {
+    (void)sem_id;
+    return 0;
+}
+
+#endif /* SYNC_STATS */
+
+#ifdef SYNC_LOCKDEP
+
+/********************************************************************************
+ * @brief Addresses identifying the binary semaphores in the lock-order graph,
+ *        and whether each of them has been named yet.
+ ********************************************************************************/
+static const char binary_semaphore_locks[BINARY_SEMAPHORE_LIMIT];
+static _Atomic bool binary_semaphore_lock_named[BINARY_SEMAPHORE_LIMIT];
+
+/********************************************************************************
+ * @brief Provides the address identifying the binary semaphore with specified
+ *        ID in the lock-order graph, which is named on first use.
+ * 
+ * @param sem_id
+ *        Identifier of the semaphore (must be valid).
+ * @return
+ *        The address identifying the semaphore.
+ ********************************************************************************/
+static const void* binary_semaphore_lock_of(const uint16_t sem_id) {
+    if (!atomic_exchange_explicit(&binary_semaphore_lock_named[sem_id], true, memory_order_relaxed)) {
+        char name[SYNC_LOCKDEP_NAME_SIZE];
+        snprintf(name, sizeof(name), "binary_semaphore[%u]", (unsigned)sem_id);
+        sync_lockdep_register(&binary_semaphore_locks[sem_id], name);
+    }
+    return &binary_semaphore_locks[sem_id];
+}
+
+#else
+
+static inline const void* binary_semaphore_lock_of(const uint16_t sem_id) {
+    (void)sem_id;
+    return 0;
+}
+
+#endif /* SYNC_LOCKDEP */
+
+/********************************************************************************
+ * @brief Provides the shard holding the binary semaphore with specified ID.
+ * 
+ * @param sem_id
+ *        Identifier of the semaphore (must be valid).
+ * @param bit
+ *        Reference to variable set to the bit of the semaphore in the shard.
+ * @return
+ *        A reference to the shard holding the semaphore.
+ ********************************************************************************/
+static inline struct binary_semaphore_shard* binary_semaphore_shard(const uint16_t sem_id, uint32_t* bit) {
+    if (sem_id < BINARY_SEMAPHORE_NUM_HOT_IDS) {
+        *bit = 1;
+        return &binary_semaphores[sem_id];
+    }
+    const uint16_t index = sem_id - BINARY_SEMAPHORE_NUM_HOT_IDS;
+    *bit = (uint32_t)(1UL << (index % BINARY_SEMAPHORE_IDS_PER_SHARD));
+    return &binary_semaphores[BINARY_SEMAPHORE_NUM_HOT_IDS + index / BINARY_SEMAPHORE_IDS_PER_SHARD];
+}
+
+/********************************************************************************
+ * @brief Provides the shard holding the binary semaphore with specified ID of
+ *        referenced bank.
+ * 
+ * @param bank
+ *        Reference to the bank, nullptr for the binary semaphores of the 
+ *        process.
+ * @param sem_id
+ *        Identifier of the semaphore (must be valid).
+ * @param bit
+ *        Reference to variable set to the bit of the semaphore in the shard.
+ * @return
+ *        A reference to the shard holding the semaphore.
+ ********************************************************************************/
+static inline struct binary_semaphore_shard* binary_semaphore_bank_shard(struct binary_semaphore_bank* bank,
+                                                                         const uint16_t sem_id, uint32_t* bit) {
+    if (!bank) return binary_semaphore_shard(sem_id, bit);
+    *bit = (uint32_t)(1UL << (sem_id % BINARY_SEMAPHORE_IDS_PER_SHARD));
+    return &bank->shards[sem_id / BINARY_SEMAPHORE_IDS_PER_SHARD];
+}
+
+/********************************************************************************
+ * @brief Reserves all semaphores of specified shard selected by the mask if
+ *        none of them is reserved, without waiting.
+ * 
+ * @note  The semaphores are reserved with a single compare-and-swap (acquire
+ *        ordering makes the previous holders' writes visible to us). If 
+ *        another thread changed the shard in between, we retry.
+ * 
+ * @param self
+ *        Reference to the shard.
+ * @param mask
+ *        Mask of the semaphores to reserve.
+ * @return
+ *        True if the semaphores were reserved, false if any of them is.
+ ********************************************************************************/
+static bool binary_semaphore_shard_try_take(struct binary_semaphore_shard* self, const uint32_t mask) {
+    uint32_t state = atomic_load_explicit(&self->bits, memory_order_relaxed);
+    while ((state & mask) == 0) {
+        if (atomic_compare_exchange_weak_explicit(&self->bits, &state, state | mask,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/********************************************************************************
+ * @brief Parks the calling thread on specified shard while any of the 
+ *        semaphores selected by the mask appears reserved.
+ * 
+ * @note  We register as a waiter and park on the shard until it changes. Only
+ *        the release of a semaphore in our mask wakes us up. The waiter 
+ *        counter and the shard are accessed with sequential consistency, so 
+ *        either we observe the release, or the releasing thread observes us
+ *        and wakes us up. The semaphores may be reserved again by the time we
+ *        return, so the caller retries.
+ * 
+ * @param self
+ *        Reference to the shard.
+ * @param mask
+ *        Mask of the semaphores to wait for.
+ * @param process_shared
+ *        True if the shard is shared between processes.
+ ********************************************************************************/
+static void binary_semaphore_shard_wait(struct binary_semaphore_shard* self, const uint32_t mask,
+                                        const bool process_shared) {
+    atomic_fetch_add_explicit(&self->num_waiters, 1, memory_order_seq_cst);
+    const uint32_t state = atomic_load_explicit(&self->bits, memory_order_seq_cst);
+    if (state & mask) futex_wait_bitset_scoped(&self->bits, state, mask, process_shared);
+    atomic_fetch_sub_explicit(&self->num_waiters, 1, memory_order_relaxed);
+}
+
+/********************************************************************************
+ * @brief Reserves all semaphores of specified shard selected by the mask.
+ * 
+ * @note  We try to reserve the semaphores and, while any of them is reserved,
+ *        park on the shard and retry.
+ * 
+ * @param self
+ *        Reference to the shard.
+ * @param mask
+ *        Mask of the semaphores to reserve.
+ * @param process_shared
+ *        True if the shard is shared between processes.
+ * @return
+ *        True if the calling thread had to wait, else false.
+ ********************************************************************************/
+static bool binary_semaphore_shard_take(struct binary_semaphore_shard* self, const uint32_t mask,
+                                        const bool process_shared) {
+    bool contended = false;
+    while (!binary_semaphore_shard_try_take(self, mask)) {
+        contended = true;
+        binary_semaphore_shard_wait(self, mask, process_shared);
+    }
+    return contended;
+}
+
+/********************************************************************************
+ * @brief Releases all semaphores of specified shard selected by the mask.
+ * 
+ * @note 1. We release the semaphores by atomically clearing the corresponding 
+ *          bits (release ordering publishes our writes to the next holders).
+ *       2. If any thread is parked on the shard, we wake the threads waiting
+ *          for any of the released semaphores. 
+ * 
+ * @param self
+ *        Reference to the shard.
+ * @param mask
+ *        Mask of the semaphores to release.
+ * @param process_shared
+ *        True if the shard is shared between processes.
+ ********************************************************************************/
+static void binary_semaphore_shard_release(struct binary_semaphore_shard* self, const uint32_t mask,
+                                           const bool process_shared) {
+    atomic_fetch_and_explicit(&self->bits, ~mask, memory_order_seq_cst);
+    if (atomic_load_explicit(&self->num_waiters, memory_order_seq_cst) > 0) {
+        futex_wake_bitset_scoped(&self->bits, mask, process_shared);
+    }
+}
+
+/********************************************************************************
+ * @brief Splits a mask of semaphores into the shards holding them, in 
+ *        ascending order and with all semaphores of the same shard together.
+ * 
+ * @param bank
+ *        Reference to the bank, nullptr for the binary semaphores of the 
+ *        process.
+ * @param first_id
+ *        Identifier of the semaphore corresponding to bit 0 of the mask.
+ * @param mask
+ *        Mask of the semaphores.
+ * @param shards
+ *        Array of at least 32 elements, filled with the shards.
+ * @param shard_masks
+ *        Array of at least 32 elements, filled with the part of the mask held
+ *        by each shard.
+ * @return
+ *        The number of shards, 0 if an empty mask was specified or if the mask
+ *        contains an invalid semaphore identifier.
+ ********************************************************************************/
+static uint32_t binary_semaphore_split_mask(struct binary_semaphore_bank* bank, const uint16_t first_id,
+                                            const uint32_t mask, struct binary_semaphore_shard** shards,
+                                            uint32_t* shard_masks) {
+    if (mask == 0) return 0;
+    const uint32_t last_id = (uint32_t)first_id + 31 - (uint32_t)__builtin_clz(mask);
+    if (last_id > (bank ? bank->num_semaphores - 1U : BINARY_SEMAPHORE_ID_MAX)) return 0;
+    uint32_t num_shards = 0;
+    for (uint32_t remaining = mask; remaining; remaining &= remaining - 1) {
+        uint32_t bit;
+        struct binary_semaphore_shard* shard = 
+            binary_semaphore_bank_shard(bank, (uint16_t)(first_id + __builtin_ctz(remaining)), &bit);
+        if (!num_shards || shards[num_shards - 1] != shard) {
+            shards[num_shards] = shard;
+            shard_masks[num_shards++] = 0;
+        }
+        shard_masks[num_shards - 1] |= bit;
+    }
+    return num_shards;
+}
+
+/********************************************************************************
+ * @brief Reserves all semaphores of a mask at once, without holding any of 
+ *        them while waiting.
+ * 
+ * @note 1. We reserve the semaphores shard by shard in ascending order, each
+ *          shard with a single compare-and-swap and without waiting.
+ *       2. If the semaphores of a shard are not available, we release the 
+ *          shards reserved so far, park on the unavailable shard until its
+ *          semaphores are released and start over. Since no semaphore is held
+ *          while waiting, a mask reservation cannot deadlock with other mask
+ *          or single reservations.
+ * 
+ * @param bank
+ *        Reference to the bank, nullptr for the binary semaphores of the 
+ *        process.
+ * @param first_id
+ *        Identifier of the semaphore corresponding to bit 0 of the mask.
+ * @param mask
+ *        Mask of the semaphores to reserve.
+ * @param contended
+ *        Reference to variable set to true if the calling thread had to wait.
+ * @return
+ *        True if the semaphores were reserved, false if an empty mask was
+ *        specified or if the mask contains an invalid semaphore identifier.
+ ********************************************************************************/
+static bool binary_semaphore_take_shards(struct binary_semaphore_bank* bank, const uint16_t first_id,
+                                         const uint32_t mask, bool* contended) {
+    struct binary_semaphore_shard* shards[32];
+    uint32_t shard_masks[32];
+    const uint32_t num_shards = binary_semaphore_split_mask(bank, first_id, mask, shards, shard_masks);
+    if (!num_shards) return false;
+    const bool process_shared = bank != 0;
+    for (uint32_t i = 0; i < num_shards; ) {
+        if (binary_semaphore_shard_try_take(shards[i], shard_masks[i])) {
+            i++;
+            continue;
+        }
+        for (uint32_t j = 0; j < i; ++j) binary_semaphore_shard_release(shards[j], shard_masks[j], process_shared);
+        *contended = true;
+        binary_semaphore_shard_wait(shards[i], shard_masks[i], process_shared);
+        i = 0;
+    }
+    return true;
+}
+
+/********************************************************************************
+ * @brief Releases all semaphores of a mask, shard by shard.
+ * 
+ * @param bank
+ *        Reference to the bank, nullptr for the binary semaphores of the 
+ *        process.
+ * @param first_id
+ *        Identifier of the semaphore corresponding to bit 0 of the mask.
+ * @param mask
+ *        Mask of the semaphores to release.
+ * @return
+ *        True if the semaphores were released, false if an empty mask was
+ *        specified or if the mask contains an invalid semaphore identifier.
+ ********************************************************************************/
+static bool binary_semaphore_release_shards(struct binary_semaphore_bank* bank, const uint16_t first_id,
+                                            const uint32_t mask) {
+    struct binary_semaphore_shard* shards[32];
+    uint32_t shard_masks[32];
+    const uint32_t num_shards = binary_semaphore_split_mask(bank, first_id, mask, shards, shard_masks);
+    for (uint32_t i = 0; i < num_shards; ++i) binary_semaphore_shard_release(shards[i], shard_masks[i], bank != 0);
+    return num_shards > 0;
+}
+
+/********************************************************************************
+ * @brief Tries to elide the reservation of a binary semaphore via a hardware
+ *        transaction.
+ * 
+ * @note 1. We start a transaction and read the shard, which adds it to the 
+ *          read set of the transaction. If the semaphore is released, we 
+ *          return within the transaction. A thread reserving any semaphore of
+ *          the shard for real then writes the shard, which aborts us.
+ *       2. If the transaction is aborted, we record the abort. If it may 
+ *          succeed when retried, we back off and retry until 
+ *          SYNC_ELISION_MAX_ABORTS aborts, else we give up at once.
+ * 
+ * @param shard
+ *        Reference to the shard holding the semaphore.
+ * @param bit
+ *        The bit of the semaphore in the shard.
+ * @param stats
+ *        Statistics of the semaphore, nullptr if disabled.
+ * @return
+ *        True if the calling thread runs the critical section transactionally,
+ *        false if it must reserve the semaphore normally.
  ********************************************************************************/
-static uint32_t binary_semaphores = 0; 
+static bool binary_semaphore_take_elided(const struct binary_semaphore_shard* shard, const uint32_t bit,
+                                         struct sync_stats* stats) {
+    for (uint16_t num_aborts = 0; num_aborts < SYNC_ELISION_MAX_ABORTS; ) {
+        const unsigned status = sync_elision_begin();
+        if (status == SYNC_ELISION_STARTED) {
+            if (!(atomic_load_explicit(&shard->bits, memory_order_relaxed) & bit)) return true;
+            sync_elision_abort_busy();
+        }
+        sync_stats_elision_aborted(stats);
+        if (!sync_elision_retry(status)) return false;
+        backoff_pause(num_aborts++);
+    }
+    return false;
+}
 
 /********************************************************************************
- * @note 1. If an invalid ID is specified (sem_id > 31), we return false.
- *       2. We block the calling thread until the semaphore is available, i.e. 
- *          the corresponding bit is cleared.
- *       3. When the semaphore is available, the calling thread reserves it
- *          by setting the corresponding bit.
- *       4. We return true to indicate that the reservation succeeded.
+ * @note 1. If an invalid ID is specified, we return false.
+ *       2. We record the acquisition in the lock-order graph before we might
+ *          block.
+ *       3. If lock elision is available, we try to run the critical section
+ *          transactionally without reserving the semaphore.
+ *       4. Else we try to reserve the semaphore by atomically setting the
+ *          corresponding bit of its shard. If the bit was cleared before, 
+ *          the semaphore is ours.
+ *       5. Else we wait for the semaphore like for any other mask.
+ *       6. We record the acquisition in the statistics of the semaphore.
+ *       7. We return true to indicate that the reservation succeeded.
  ********************************************************************************/
-bool binary_semaphore_take(const uint8_t sem_id) {
+bool binary_semaphore_take(const uint16_t sem_id) {
     if (sem_id > BINARY_SEMAPHORE_ID_MAX) return false; 
-    while (binary_semaphores & (1ULL << sem_id));       
-    binary_semaphores |= (1ULL << sem_id);              
+    sync_lockdep_acquire(binary_semaphore_lock_of(sem_id), true);
+    uint32_t bit;
+    struct binary_semaphore_shard* shard = binary_semaphore_shard(sem_id, &bit);
+    struct sync_stats* stats = binary_semaphore_stats_of(sem_id);
+    if (sync_elision_supported() && binary_semaphore_take_elided(shard, bit, stats)) return true;
+    if (atomic_fetch_or_explicit(&shard->bits, bit, memory_order_acquire) & bit) {
+        const uint64_t wait_start = sync_stats_now();
+        sync_stats_wait_begin(stats);
+        binary_semaphore_shard_take(shard, bit, false);
+        sync_stats_wait_end(stats);
+        sync_stats_acquired(stats, wait_start, 0);
+    } else {
+        sync_stats_acquired(stats, 0, 0);
+    }
     return true;
 }
 
 /********************************************************************************
- * @note 1. If an invalid ID is specified (sem_id > 31), we return false.
- *       2. The calling thread releases the semaphorer by clearing the 
- *          corresponding bit.
- *       3. We return true to indicate that the release succeeded.
+ * @note 1. If an invalid ID is specified, we return false.
+ *       2. We record the release in the lock-order graph.
+ *       3. If we run transactionally while the semaphore appears released, its
+ *          reservation was elided, so we commit the transaction and record 
+ *          the elided acquisition.
+ *       4. Else we record the release in the statistics of the semaphore.
+ *       5. We release the semaphore by clearing its bit of its shard.
+ *       6. We return true to indicate that the release succeeded.
  ********************************************************************************/
-bool binary_semaphore_release(const uint8_t sem_id) {
+bool binary_semaphore_release(const uint16_t sem_id) {
     if (sem_id > BINARY_SEMAPHORE_ID_MAX) return false;
-    binary_semaphores &= ~(1ULL << sem_id);
+    sync_lockdep_release(binary_semaphore_lock_of(sem_id));
+    uint32_t bit;
+    struct binary_semaphore_shard* shard = binary_semaphore_shard(sem_id, &bit);
+    if (sync_elision_active() && !(atomic_load_explicit(&shard->bits, memory_order_relaxed) & bit)) {
+        sync_elision_end();
+        sync_stats_elided(binary_semaphore_stats_of(sem_id));
+        return true;
+    }
+    sync_stats_released(binary_semaphore_stats_of(sem_id));
+    binary_semaphore_shard_release(shard, bit, false);
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. If the mask is empty or contains an invalid ID, we return false.
+ *       2. We record the acquisition of each semaphore in the lock-order graph
+ *          before we might block, in ascending order.
+ *       3. We reserve the semaphores all at once, see 
+ *          binary_semaphore_take_shards, which is a single compare-and-swap if
+ *          all of them share a shard.
+ *       4. We record the acquisition in the statistics of each semaphore.
+ ********************************************************************************/
+bool binary_semaphore_take_mask(const uint16_t first_id, const uint32_t mask) {
+    if (mask == 0 || (uint32_t)first_id + 31 - (uint32_t)__builtin_clz(mask) > BINARY_SEMAPHORE_ID_MAX) {
+        return false;
+    }
+    for (uint32_t remaining = mask; remaining; remaining &= remaining - 1) {
+        sync_lockdep_acquire(binary_semaphore_lock_of((uint16_t)(first_id + __builtin_ctz(remaining))), true);
+    }
+    const uint64_t wait_start = sync_stats_now();
+    bool contended = false;
+    if (!binary_semaphore_take_shards(0, first_id, mask, &contended)) return false;
+    for (uint32_t remaining = mask; remaining; remaining &= remaining - 1) {
+        sync_stats_acquired(binary_semaphore_stats_of((uint16_t)(first_id + __builtin_ctz(remaining))),
+                            contended ? wait_start : 0, 0);
+    }
     return true;
 }
 
+/********************************************************************************
+ * @note 1. We record the release in the lock-order graph and in the 
+ *          statistics of each semaphore.
+ *       2. We release the semaphores shard by shard.
+ ********************************************************************************/
+bool binary_semaphore_release_mask(const uint16_t first_id, const uint32_t mask) {
+    if (mask == 0 || (uint32_t)first_id + 31 - (uint32_t)__builtin_clz(mask) > BINARY_SEMAPHORE_ID_MAX) {
+        return false;
+    }
+    for (uint32_t remaining = mask; remaining; remaining &= remaining - 1) {
+        const uint16_t sem_id = (uint16_t)(first_id + __builtin_ctz(remaining));
+        sync_lockdep_release(binary_semaphore_lock_of(sem_id));
+        sync_stats_released(binary_semaphore_stats_of(sem_id));
+    }
+    return binary_semaphore_release_shards(0, first_id, mask);
+}
+
+/********************************************************************************
+ * @note 1. If an invalid ID is specified, we return false.
+ *       2. We read the statistics of the semaphore, if any.
+ ********************************************************************************/
+bool binary_semaphore_stats(const uint16_t sem_id, struct sync_stats_snapshot* snapshot) {
+    if (sem_id > BINARY_SEMAPHORE_ID_MAX) return false;
+    return sync_stats_read(binary_semaphore_stats_of(sem_id), snapshot);
+}
+
+/********************************************************************************
+ * @note 1. We return the size of the bank with enough shards for the 
+ *          semaphores, 32 per shard.
+ ********************************************************************************/
+size_t binary_semaphore_bank_size(const uint16_t num_semaphores) {
+    const size_t num_shards = (num_semaphores + BINARY_SEMAPHORE_IDS_PER_SHARD - 1U) / BINARY_SEMAPHORE_IDS_PER_SHARD;
+    return offsetof(struct binary_semaphore_bank, shards) + num_shards * sizeof(struct binary_semaphore_shard);
+}
+
+/********************************************************************************
+ * @note 1. If an invalid number of semaphores was specified or the memory
+ *          isn't aligned to a cache line, we return a nullptr.
+ *       2. We initialize all shards as available without waiters and return 
+ *          a reference to the bank, which lives in the memory.
+ ********************************************************************************/
+struct binary_semaphore_bank* binary_semaphore_bank_init(void* memory, const uint16_t num_semaphores) {
+    if (num_semaphores == 0 || (uintptr_t)memory % SYNC_CACHE_LINE_SIZE != 0) return 0;
+    struct binary_semaphore_bank* self = binary_semaphore_bank_from_memory(memory);
+    const size_t num_shards = (num_semaphores + BINARY_SEMAPHORE_IDS_PER_SHARD - 1U) / BINARY_SEMAPHORE_IDS_PER_SHARD;
+    self->num_semaphores = num_semaphores;
+    for (size_t i = 0; i < num_shards; ++i) {
+        atomic_init(&self->shards[i].bits, 0);
+        atomic_init(&self->shards[i].num_waiters, 0);
+    }
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. We reserve the semaphore like a mask holding the semaphore alone,
+ *          which parks on the shard via a shared futex if needed.
+ ********************************************************************************/
+bool binary_semaphore_bank_take(struct binary_semaphore_bank* self, const uint16_t sem_id) {
+    return binary_semaphore_bank_take_mask(self, sem_id, 1);
+}
+
+/********************************************************************************
+ * @note 1. We release the semaphore like a mask holding the semaphore alone.
+ ********************************************************************************/
+bool binary_semaphore_bank_release(struct binary_semaphore_bank* self, const uint16_t sem_id) {
+    return binary_semaphore_bank_release_mask(self, sem_id, 1);
+}
+
+/********************************************************************************
+ * @note 1. We reserve the semaphores all at once, see 
+ *          binary_semaphore_take_shards, which is a single compare-and-swap if
+ *          all of them share a shard.
+ ********************************************************************************/
+bool binary_semaphore_bank_take_mask(struct binary_semaphore_bank* self, const uint16_t first_id,
+                                     const uint32_t mask) {
+    bool contended = false;
+    return binary_semaphore_take_shards(self, first_id, mask, &contended);
+}
+
+/********************************************************************************
+ * @note 1. We release the semaphores shard by shard.
+ ********************************************************************************/
+bool binary_semaphore_bank_release_mask(struct binary_semaphore_bank* self, const uint16_t first_id,
+                                        const uint32_t mask) {
+    return binary_semaphore_release_shards(self, first_id, mask);
+}
 
 /********************************************************************************
  * @note 1. If an invalid total number of semaphores was specified 
- *          (num_resources = 0), we return a nullptr.
- *       2. Allocates memory for the semaphore on the heap.
- *       3. If the memory allocation failed, we return a nullptr.
- *       4. We initialize the semaphore, i.e. we set the starting values.
- *       5. We return a reference to the counting semaphore.
+ *          (num_resources = 0), or if the process-shared mode is combined with
+ *          the queue or priority fairness modes, the pollable mode or the 
+ *          caching mode, we return a nullptr, since the turn slots, the 
+ *          waiters, the file descriptor and the cache slots are process-local.
+ *          The caching mode cannot be combined with a fairness mode or the 
+ *          pollable mode either, since cached resources bypass the queue and 
+ *          the eventfd.
+ *       2. If the pollable mode is selected, we create a non-blocking eventfd
+ *          in semaphore mode holding all resources. If this fails, we return a
+ *          nullptr.
+ *       3. Allocates memory for the turn slots if the queue fairness mode is
+ *          selected. If the memory allocation failed, we close the eventfd, if
+ *          any, and return a nullptr.
+ *       4. Allocates memory for the cache if the caching mode is selected, with
+ *          all slots empty. If the memory allocation failed, we return a 
+ *          nullptr.
+ *       5. We initialize the semaphore, i.e. we set the starting values. If no
+ *          options were specified, or the spin limit is 0, the defaults are used.
+ *          The first ticket is served first, all other turn slots hold a ticket 
+ *          that is never waited for. If the instrumentation is enabled and the
+ *          semaphore is process-local, the statistics are created.
+ *       6. We return a reference to the counting semaphore, which lives in the
+ *          storage.
  ********************************************************************************/
-struct counting_semaphore* counting_semaphore_new(const uint16_t num_resources) {
+struct counting_semaphore* counting_semaphore_init(struct counting_semaphore_storage* storage,
+                                                   const uint16_t num_resources,
+                                                   const struct counting_semaphore_options* options) {
     if (num_resources == 0) return 0;
-    struct counting_semaphore* self = (struct counting_semaphore*)malloc(sizeof(struct counting_semaphore));
-    if (!self) return 0;
-    self->num_reserved_resources = 0;
+    const bool process_shared = options && options->process_shared;
+    if (process_shared && (options->fairness == SEMAPHORE_FAIR_QUEUE || options->fairness == SEMAPHORE_FAIR_PRIORITY ||
+                           options->pollable || options->cache_batch)) {
+        return 0;
+    }
+    if (options && options->cache_batch && (options->fairness != SEMAPHORE_FAIR_NONE || options->pollable)) return 0;
+    struct counting_semaphore* self = counting_semaphore_from_storage(storage);
+    self->fairness = options ? options->fairness : SEMAPHORE_FAIR_NONE;
+    self->process_shared = process_shared;
+    self->turn_slots = 0;
+    self->event_fd = -1;
+    if (options && options->pollable) {
+        self->event_fd = eventfd(num_resources, EFD_SEMAPHORE | EFD_NONBLOCK | EFD_CLOEXEC);
+        if (self->event_fd < 0) return 0;
+    }
+    if (self->fairness == SEMAPHORE_FAIR_QUEUE) {
+        self->turn_slots = (struct counting_semaphore_turn_slot*)aligned_alloc(SYNC_CACHE_LINE_SIZE,
+            SEMAPHORE_FAIR_QUEUE_NUM_SLOTS * sizeof(struct counting_semaphore_turn_slot));
+        if (!self->turn_slots) {
+            if (self->event_fd >= 0) close(self->event_fd);
+            return 0;
+        }
+        for (uint16_t i = 0; i < SEMAPHORE_FAIR_QUEUE_NUM_SLOTS; ++i) {
+            atomic_init(&self->turn_slots[i].turn.ticket, i == 0 ? 0 : UINT32_MAX);
+            atomic_init(&self->turn_slots[i].turn.num_parked, 0);
+        }
+    }
+    if (options && options->cache_batch) {
+        self->cache = (struct counting_semaphore_cache*)aligned_alloc(SYNC_CACHE_LINE_SIZE,
+                                                                      sizeof(struct counting_semaphore_cache));
+        if (!self->cache) return 0;
+        atomic_init(&self->cache->num_waiters, 0);
+        self->cache->batch = options->cache_batch;
+        for (uint16_t i = 0; i < SEMAPHORE_CACHE_NUM_SLOTS; ++i) {
+            atomic_init(&self->cache->slots[i].num_cached, 0);
+            atomic_init(&self->cache->slots[i].num_borrowed, 0);
+        }
+    }
+    atomic_init(&self->num_reserved_resources, 0);
+    atomic_init(&self->num_waiters, 0);
+    atomic_init(&self->num_bulk_waiters, 0);
+    atomic_init(&self->next_ticket, 0);
+    if (self->fairness == SEMAPHORE_FAIR_PRIORITY) atomic_init(&self->priority_waiters, 0);
+    atomic_init(&self->serving.ticket, 0);
+    atomic_init(&self->serving.num_parked, 0);
     self->num_total_resources = num_resources;
+    self->wait_policy = options ? options->wait_policy : SEMAPHORE_WAIT_ADAPTIVE;
+    self->spin_limit = options && options->spin_limit ? options->spin_limit : BACKOFF_SPIN_LIMIT_DEFAULT;
+    self->stats = process_shared ? 0 : sync_stats_new(options && options->name ? options->name : "counting_semaphore");
+    sync_lockdep_register(self, options && options->name ? options->name : "counting_semaphore");
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. Deallocates the turn slots, the cache and the statistics and closes 
+ *          the file descriptor, if any. The storage of the semaphore is left to
+ *          the caller.
+ *       2. Removes the semaphore from the lock-order graph.
+ ********************************************************************************/
+void counting_semaphore_destroy(struct counting_semaphore* self) {
+    sync_lockdep_forget(self);
+    sync_stats_delete(self->stats);
+    if (self->fairness == SEMAPHORE_FAIR_QUEUE) free(self->turn_slots);
+    if (self->fairness == SEMAPHORE_FAIR_NONE) free(self->cache);
+    if (self->event_fd >= 0) close(self->event_fd);
+    self->stats = 0;
+    self->turn_slots = 0;
+    self->event_fd = -1;
+}
+
+/********************************************************************************
+ * @note 1. Allocates memory for the semaphore storage on the heap. If the
+ *          memory allocation failed, we return a nullptr.
+ *       2. We initialize the semaphore in the storage. If the initialization
+ *          failed, we free the storage and return a nullptr.
+ ********************************************************************************/
+struct counting_semaphore* counting_semaphore_new(const uint16_t num_resources,
+                                                  const struct counting_semaphore_options* options) {
+    if (num_resources == 0) return 0;
+    struct counting_semaphore_storage* storage =
+        (struct counting_semaphore_storage*)malloc(sizeof(struct counting_semaphore_storage));
+    if (!storage) return 0;
+    struct counting_semaphore* self = counting_semaphore_init(storage, num_resources, options);
+    if (!self) free(storage);
     return self;
 }
 
 /********************************************************************************
- * @note 1. Deallocates the heap allocated memory.
+ * @note 1. Destroys the semaphore and deallocates its heap allocated storage.
  *       2. Sets the semaphore pointer to null. The double-pointer makes it
  *          possible to set the "real" pointer to null, else a copy of the
  *          pointer would be passed and set to null and the original would still
  *          point at the adress where the semaphore was allocated previously.
  ********************************************************************************/
 void counting_semaphore_delete(struct counting_semaphore** self) {
+    if (*self) counting_semaphore_destroy(*self);
     free(*self);
     *self = 0;
 }
 
 /********************************************************************************
  * @note 1. We return the value of the reserved resources counter.
+ *       2. In the caching mode, we subtract the resources cached in the slots,
+ *          since they are reserved from the shared counter but available. The
+ *          slots are read after the counter, so a concurrent refill might be
+ *          counted in the slots only, in which case we return 0 instead of 
+ *          underflowing.
  ********************************************************************************/
 uint16_t counting_semaphore_num_reserved(const struct counting_semaphore* self) {
-    return self->num_reserved_resources;
+    const uint32_t reserved = atomic_load_explicit(&self->num_reserved_resources, memory_order_relaxed);
+    if (self->fairness != SEMAPHORE_FAIR_NONE || !self->cache) return (uint16_t)reserved;
+    uint32_t cached = 0;
+    for (uint16_t i = 0; i < SEMAPHORE_CACHE_NUM_SLOTS; ++i) {
+        cached += atomic_load_explicit(&self->cache->slots[i].num_cached, memory_order_relaxed);
+    }
+    return cached < reserved ? (uint16_t)(reserved - cached) : 0;
 }
 
 /********************************************************************************
@@ -92,26 +1061,1293 @@ uint16_t counting_semaphore_num_reserved(const struct counting_semaphore* self)
  *          number of resources with the number of reserved resources.
  ********************************************************************************/
 uint16_t counting_semaphore_num_available(const struct counting_semaphore* self) {
-    return self->num_total_resources - self->num_reserved_resources;
+    return self->num_total_resources - counting_semaphore_num_reserved(self);
 }
 
 /********************************************************************************
- * @note 1. The calling thread is blocked until at least one resource is
- *          available.
- *       2. The calling thread reserves a resource, we increment the reserved
- *          resources counter.
+ * @note 1. We reserve one resource.
  ********************************************************************************/
 void counting_semaphore_take(struct counting_semaphore* self) {
-    while (self->num_reserved_resources >= self->num_total_resources);
-    self->num_reserved_resources++;
+    counting_semaphore_take_n(self, 1);
 }
 
 /********************************************************************************
- * @note 1. If at least one resource is reserved, we decrement the reserved
- *          resources counter.
+ * @note 1. We release one resource.
  ********************************************************************************/
 void counting_semaphore_release(struct counting_semaphore* self) {
-    if (self->num_reserved_resources > 0) {
-        self->num_reserved_resources--;
+    counting_semaphore_release_n(self, 1);
+}
+
+/********************************************************************************
+ * @brief Indicates if a waiter of referenced counting semaphore shall spin
+ *        (true) or park (false) after specified number of spin iterations.
+ * 
+ * @note  Spin-only waiters never stop spinning, while adaptive waiters stop 
+ *        when the spin limit is reached.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param spins
+ *        The number of spin iterations performed so far.
+ * @return
+ *        True if the waiter shall spin, false if it shall park.
+ ********************************************************************************/
+static inline bool counting_semaphore_should_spin(const struct counting_semaphore* self, const uint16_t spins) {
+    return self->wait_policy == SEMAPHORE_WAIT_SPIN ||
+           (self->wait_policy == SEMAPHORE_WAIT_ADAPTIVE && spins < self->spin_limit);
+}
+
+/********************************************************************************
+ * @brief Records the start of a wait in the statistics, unless already done.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param wait_start
+ *        Reference to the start time of the wait, 0 until the thread waits.
+ ********************************************************************************/
+static inline void counting_semaphore_begin_wait(struct counting_semaphore* self, uint64_t* wait_start) {
+    if (!*wait_start) {
+        *wait_start = sync_stats_now();
+        sync_stats_wait_begin(self->stats);
     }
-}
\ No newline at end of file
+}
+
+/********************************************************************************
+ * @brief Provides the turn that specified ticket waits on.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param ticket
+ *        The ticket.
+ * @return
+ *        The turn slot of the ticket in the queue fairness mode, else the 
+ *        shared turn of the ticket being served.
+ ********************************************************************************/
+static inline struct counting_semaphore_turn* counting_semaphore_turn_of(struct counting_semaphore* self,
+                                                                         const uint32_t ticket) {
+    if (!self->turn_slots) return &self->serving;
+    return &self->turn_slots[ticket % SEMAPHORE_FAIR_QUEUE_NUM_SLOTS].turn;
+}
+
+/********************************************************************************
+ * @brief Waits until it is the turn of specified ticket, spinning and parking
+ *        on the turn according to the wait policy.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param ticket
+ *        The ticket of the calling thread.
+ * @param spins
+ *        Reference to the number of spin iterations performed so far.
+ * @param wait_start
+ *        Reference to the start time of the wait, 0 until the thread waits.
+ ********************************************************************************/
+static void counting_semaphore_wait_for_turn(struct counting_semaphore* self, const uint32_t ticket,
+                                             uint16_t* spins, uint64_t* wait_start) {
+    struct counting_semaphore_turn* turn = counting_semaphore_turn_of(self, ticket);
+    uint32_t current = atomic_load_explicit(&turn->ticket, memory_order_acquire);
+    while (current != ticket) {
+        counting_semaphore_begin_wait(self, wait_start);
+        if (counting_semaphore_should_spin(self, *spins)) {
+            backoff_pause(*spins);
+            if (*spins < UINT16_MAX) (*spins)++;
+        } else {
+            atomic_fetch_add_explicit(&turn->num_parked, 1, memory_order_seq_cst);
+            current = atomic_load_explicit(&turn->ticket, memory_order_seq_cst);
+            if (current != ticket) futex_wait_scoped(&turn->ticket, current, self->process_shared);
+            atomic_fetch_sub_explicit(&turn->num_parked, 1, memory_order_relaxed);
+        }
+        current = atomic_load_explicit(&turn->ticket, memory_order_acquire);
+    }
+}
+
+/********************************************************************************
+ * @brief Passes the turn from specified ticket to the next ticket.
+ * 
+ * @note  The shared turn always holds the ticket being served, so that 
+ *        try_take can tell whether threads are queued. In the queue fairness
+ *        mode, the turn slot of the next ticket is updated as well. Threads
+ *        parked on the turn are all woken, since several tickets may share it.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param ticket
+ *        The ticket of the calling thread.
+ ********************************************************************************/
+static void counting_semaphore_pass_turn(struct counting_semaphore* self, const uint32_t ticket) {
+    struct counting_semaphore_turn* turn = counting_semaphore_turn_of(self, ticket + 1);
+    atomic_store_explicit(&self->serving.ticket, ticket + 1, memory_order_seq_cst);
+    if (turn != &self->serving) atomic_store_explicit(&turn->ticket, ticket + 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&turn->num_parked, memory_order_seq_cst) > 0) {
+        futex_wake_scoped(&turn->ticket, INT_MAX, self->process_shared);
+    }
+}
+
+/********************************************************************************
+ * @brief Consumes specified number of reserved resources from the eventfd of
+ *        referenced counting semaphore, if it is pollable.
+ * 
+ * @note  Only called after the resources were reserved, so the eventfd holds
+ *        them for the calling thread. If it appears empty, a releasing thread 
+ *        is about to write them: we retry with exponential backoff up to the
+ *        spin limit, then block in poll until the eventfd becomes readable.
+ *        Interrupted calls are retried. Any other failure, for instance of a
+ *        closed eventfd, ends the consumption, since the resources are 
+ *        reserved regardless.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param num
+ *        The number of reserved resources.
+ ********************************************************************************/
+static void counting_semaphore_consume_fd(struct counting_semaphore* self, const uint16_t num) {
+    if (self->event_fd < 0) return;
+    uint16_t spins = 0;
+    for (uint16_t i = 0; i < num; ) {
+        uint64_t value;
+        if (read(self->event_fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+            i++;
+        } else if (errno == EAGAIN && spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+            backoff_pause(spins++);
+        } else if (errno == EAGAIN) {
+            struct pollfd readable = {.fd = self->event_fd, .events = POLLIN, .revents = 0};
+            poll(&readable, 1, -1);
+        } else if (errno != EINTR) {
+            return;
+        }
+    }
+}
+
+/********************************************************************************
+ * @brief Reserves specified number of resources of referenced counting 
+ *        semaphore, spinning and parking according to the wait policy while 
+ *        too few resources are available.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param num
+ *        The number of resources to reserve.
+ * @param spins
+ *        Reference to the number of spin iterations performed so far.
+ * @param wait_start
+ *        Reference to the start time of the wait, 0 until the thread waits.
+ ********************************************************************************/
+static void counting_semaphore_reserve(struct counting_semaphore* self, const uint16_t num,
+                                       uint16_t* spins, uint64_t* wait_start) {
+    uint32_t reserved = atomic_load_explicit(&self->num_reserved_resources, memory_order_relaxed);
+    while (1) {
+        if (reserved + num <= self->num_total_resources) {
+            if (atomic_compare_exchange_weak_explicit(&self->num_reserved_resources, &reserved, reserved + num,
+                                                      memory_order_acquire, memory_order_relaxed)) {
+                return;
+            }
+            continue;
+        }
+        counting_semaphore_begin_wait(self, wait_start);
+        if (counting_semaphore_should_spin(self, *spins)) {
+            backoff_pause(*spins);
+            if (*spins < UINT16_MAX) (*spins)++;
+            reserved = atomic_load_explicit(&self->num_reserved_resources, memory_order_relaxed);
+        } else {
+            atomic_fetch_add_explicit(&self->num_waiters, 1, memory_order_seq_cst);
+            if (num > 1) atomic_fetch_add_explicit(&self->num_bulk_waiters, 1, memory_order_seq_cst);
+            reserved = atomic_load_explicit(&self->num_reserved_resources, memory_order_seq_cst);
+            if (reserved + num > self->num_total_resources) {
+                futex_wait_scoped(&self->num_reserved_resources, reserved, self->process_shared);
+                reserved = atomic_load_explicit(&self->num_reserved_resources, memory_order_relaxed);
+            }
+            if (num > 1) atomic_fetch_sub_explicit(&self->num_bulk_waiters, 1, memory_order_relaxed);
+            atomic_fetch_sub_explicit(&self->num_waiters, 1, memory_order_relaxed);
+        }
+    }
+}
+
+/********************************************************************************
+ * @brief Provides the real-time priority of the calling thread.
+ * 
+ * @return
+ *        The priority of a SCHED_FIFO or SCHED_RR thread, else 0.
+ ********************************************************************************/
+static int counting_semaphore_thread_priority(void) {
+    int policy;
+    struct sched_param param;
+    if (pthread_getschedparam(pthread_self(), &policy, &param) != 0) return 0;
+    return policy == SCHED_FIFO || policy == SCHED_RR ? param.sched_priority : 0;
+}
+
+/********************************************************************************
+ * @brief Locks the wait queue of referenced counting semaphore. If the lock
+ *        is held, the calling thread is queued in the kernel by priority and
+ *        the holder inherits its priority.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param thread_id
+ *        The kernel thread ID of the calling thread.
+ ********************************************************************************/
+static inline void counting_semaphore_lock_queue(struct counting_semaphore* self, const uint32_t thread_id) {
+    uint32_t expected = 0;
+    if (!atomic_compare_exchange_strong_explicit(&self->queue_lock, &expected, thread_id,
+                                                 memory_order_acquire, memory_order_relaxed)) {
+        futex_lock_pi(&self->queue_lock);
+    }
+}
+
+/********************************************************************************
+ * @brief Unlocks the wait queue of referenced counting semaphore. If threads 
+ *        wait for the lock, the kernel hands it to the one of highest priority.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param thread_id
+ *        The kernel thread ID of the calling thread.
+ ********************************************************************************/
+static inline void counting_semaphore_unlock_queue(struct counting_semaphore* self, const uint32_t thread_id) {
+    uint32_t expected = thread_id;
+    if (!atomic_compare_exchange_strong_explicit(&self->queue_lock, &expected, 0,
+                                                 memory_order_release, memory_order_relaxed)) {
+        futex_unlock_pi(&self->queue_lock);
+    }
+}
+
+/********************************************************************************
+ * @brief Reserves specified number of resources of referenced counting 
+ *        semaphore if enough resources are available, via compare-and-swap.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param num
+ *        The number of resources to reserve.
+ * @return
+ *        True if the resources were reserved, else false.
+ ********************************************************************************/
+static inline bool counting_semaphore_try_reserve(struct counting_semaphore* self, const uint16_t num) {
+    uint32_t reserved = atomic_load_explicit(&self->num_reserved_resources, memory_order_seq_cst);
+    while (reserved + num <= self->num_total_resources) {
+        if (atomic_compare_exchange_weak_explicit(&self->num_reserved_resources, &reserved, reserved + num,
+                                                  memory_order_seq_cst, memory_order_seq_cst)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/********************************************************************************
+ * @brief Hands available resources to the waiters at the head of the wait 
+ *        queue of referenced counting semaphore, in queue order. Only called
+ *        with the wait queue locked.
+ * 
+ * @note  A waiter may return as soon as it is granted its resources, so the
+ *        next waiter is read beforehand. The head waits for its resources 
+ *        even if a later waiter needs fewer, so that it is never overtaken.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ ********************************************************************************/
+static void counting_semaphore_grant_waiters(struct counting_semaphore* self) {
+    struct counting_semaphore_waiter* waiter = atomic_load_explicit(&self->priority_waiters, memory_order_seq_cst);
+    while (waiter && counting_semaphore_try_reserve(self, waiter->num)) {
+        struct counting_semaphore_waiter* next = waiter->next;
+        atomic_store_explicit(&self->priority_waiters, next, memory_order_seq_cst);
+        atomic_store_explicit(&waiter->granted, 1, memory_order_release);
+        futex_wake(&waiter->granted, 1);
+        waiter = next;
+    }
+}
+
+/********************************************************************************
+ * @brief Reserves specified number of resources of referenced counting 
+ *        semaphore using the priority fairness mode.
+ * 
+ * @note 1. If nobody is queued and enough resources are available, we reserve
+ *          them right away.
+ *       2. Else we insert ourselves into the wait queue behind all waiters of
+ *          the same or higher priority, and hand available resources to the
+ *          head of the queue, since resources might have been released since
+ *          we checked. The queue head and the reserved resources counter are
+ *          accessed with sequential consistency, so either we observe a 
+ *          concurrent release or the releasing thread observes the queue.
+ *       3. We park until the resources are granted to us. We don't spin, so
+ *          we never compete with a preempted holder for the processor.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param num
+ *        The number of resources to reserve.
+ * @param wait_start
+ *        Reference to the start time of the wait, 0 until the thread waits.
+ ********************************************************************************/
+static void counting_semaphore_reserve_prioritized(struct counting_semaphore* self, const uint16_t num,
+                                                   uint64_t* wait_start) {
+    if (!atomic_load_explicit(&self->priority_waiters, memory_order_seq_cst) &&
+        counting_semaphore_try_reserve(self, num)) {
+        return;
+    }
+    struct counting_semaphore_waiter waiter = {0, 0, counting_semaphore_thread_priority(), num};
+    const uint32_t thread_id = (uint32_t)syscall(SYS_gettid);
+    counting_semaphore_begin_wait(self, wait_start);
+    counting_semaphore_lock_queue(self, thread_id);
+    struct counting_semaphore_waiter* head = atomic_load_explicit(&self->priority_waiters, memory_order_relaxed);
+    if (!head || head->priority < waiter.priority) {
+        waiter.next = head;
+        atomic_store_explicit(&self->priority_waiters, &waiter, memory_order_seq_cst);
+    } else {
+        while (head->next && head->next->priority >= waiter.priority) head = head->next;
+        waiter.next = head->next;
+        head->next = &waiter;
+    }
+    counting_semaphore_grant_waiters(self);
+    counting_semaphore_unlock_queue(self, thread_id);
+    while (!atomic_load_explicit(&waiter.granted, memory_order_acquire)) futex_wait(&waiter.granted, 0);
+}
+
+/********************************************************************************
+ * @brief Returns specified number of resources to the reserved resources 
+ *        counter of referenced counting semaphore and wakes parked threads, 
+ *        without recording a release.
+ * 
+ * @note  See counting_semaphore_release_n, steps 2 - 4. An interrupted write
+ *        to the eventfd is retried. If it fails otherwise, for instance since
+ *        the eventfd was closed, parked threads are still woken, since the 
+ *        resources were returned to the counter, and the failure is reported.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param num
+ *        The number of resources to return.
+ * @return
+ *        True if the resources were returned, false if fewer resources than
+ *        specified were reserved or the eventfd couldn't be written.
+ ********************************************************************************/
+static bool counting_semaphore_unreserve(struct counting_semaphore* self, const uint16_t num) {
+    uint32_t reserved = atomic_load_explicit(&self->num_reserved_resources, memory_order_relaxed);
+    do {
+        if (reserved < num) return false;
+    } while (!atomic_compare_exchange_weak_explicit(&self->num_reserved_resources, &reserved, reserved - num,
+                                                    memory_order_seq_cst, memory_order_relaxed));
+    bool written = true;
+    if (self->event_fd >= 0) {
+        const uint64_t value = num;
+        while (write(self->event_fd, &value, sizeof(value)) != (ssize_t)sizeof(value)) {
+            if (errno != EINTR) {
+                written = false;
+                break;
+            }
+        }
+    }
+    if (self->fairness == SEMAPHORE_FAIR_PRIORITY) {
+        if (atomic_load_explicit(&self->priority_waiters, memory_order_seq_cst)) {
+            const uint32_t thread_id = (uint32_t)syscall(SYS_gettid);
+            counting_semaphore_lock_queue(self, thread_id);
+            counting_semaphore_grant_waiters(self);
+            counting_semaphore_unlock_queue(self, thread_id);
+        }
+    } else if (atomic_load_explicit(&self->num_waiters, memory_order_seq_cst) > 0) {
+        const bool wake_all = atomic_load_explicit(&self->num_bulk_waiters, memory_order_seq_cst) > 0;
+        futex_wake_scoped(&self->num_reserved_resources, wake_all ? INT_MAX : num, self->process_shared);
+    }
+    return written;
+}
+
+/********************************************************************************
+ * @brief Provides the cache slot of the calling thread.
+ * 
+ * @note  Threads are assigned to slots round robin on first use. Resources
+ *        may be released on another slot than they were taken from, since 
+ *        all cached resources are alike.
+ * 
+ * @param cache
+ *        Reference to the cache of the counting semaphore.
+ * @return
+ *        A reference to the cache slot of the calling thread.
+ ********************************************************************************/
+static inline struct counting_semaphore_cache_slot* counting_semaphore_cache_slot_of(
+    struct counting_semaphore_cache* cache) {
+    if (counting_semaphore_thread_slot == UINT32_MAX) {
+        counting_semaphore_thread_slot = atomic_fetch_add_explicit(&counting_semaphore_num_threads, 1,
+                                                                   memory_order_relaxed) % SEMAPHORE_CACHE_NUM_SLOTS;
+    }
+    return &cache->slots[counting_semaphore_thread_slot];
+}
+
+/********************************************************************************
+ * @brief Takes specified number of resources from the cache slot of the 
+ *        calling thread, if it holds enough of them. If not, the resources 
+ *        are reserved from the shared counter if available, together with up
+ *        to a batch of resources more, which are added to the slot. The batch
+ *        is skipped while threads wait on the shared counter.
+ * 
+ * @note  A thread may start to wait between the check of the waiters and the
+ *        addition of the batch to the slot, and flush the slots before the
+ *        batch arrives. Like in counting_semaphore_release_cached, the slot and
+ *        the waiter count are therefore accessed with sequential consistency
+ *        and the waiters are checked again after the addition, so either the
+ *        waiter observes the batch when it flushes, or we observe the waiter
+ *        and return the slot to the shared counter ourselves.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param num
+ *        The number of resources to take.
+ * @return
+ *        True if the resources were taken, false if neither the slot nor the
+ *        shared counter holds enough resources.
+ ********************************************************************************/
+static bool counting_semaphore_take_cached(struct counting_semaphore* self, const uint16_t num) {
+    struct counting_semaphore_cache_slot* slot = counting_semaphore_cache_slot_of(self->cache);
+    uint32_t cached = atomic_load_explicit(&slot->num_cached, memory_order_relaxed);
+    while (cached >= num) {
+        if (atomic_compare_exchange_weak_explicit(&slot->num_cached, &cached, cached - num,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            atomic_fetch_add_explicit(&slot->num_borrowed, num, memory_order_relaxed);
+            return true;
+        }
+    }
+    const uint32_t batch = atomic_load_explicit(&self->cache->num_waiters, memory_order_seq_cst) ?
+                           0 : self->cache->batch;
+    uint32_t reserved = atomic_load_explicit(&self->num_reserved_resources, memory_order_relaxed);
+    while (reserved + num <= self->num_total_resources) {
+        const uint32_t available = self->num_total_resources - reserved - num;
+        const uint32_t extra = available < batch ? available : batch;
+        if (atomic_compare_exchange_weak_explicit(&self->num_reserved_resources, &reserved, reserved + num + extra,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            atomic_fetch_add_explicit(&slot->num_borrowed, num, memory_order_relaxed);
+            if (extra) {
+                atomic_fetch_add_explicit(&slot->num_cached, extra, memory_order_seq_cst);
+                if (atomic_load_explicit(&self->cache->num_waiters, memory_order_seq_cst) > 0) {
+                    const uint32_t cached = atomic_exchange_explicit(&slot->num_cached, 0, memory_order_seq_cst);
+                    if (cached) counting_semaphore_unreserve(self, (uint16_t)cached);
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/********************************************************************************
+ * @brief Returns the resources of all cache slots of referenced counting
+ *        semaphore to the shared counter, so that threads waiting on it can
+ *        reserve them.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ ********************************************************************************/
+static void counting_semaphore_flush_cache(struct counting_semaphore* self) {
+    for (uint16_t i = 0; i < SEMAPHORE_CACHE_NUM_SLOTS; ++i) {
+        const uint32_t cached = atomic_exchange_explicit(&self->cache->slots[i].num_cached, 0, memory_order_seq_cst);
+        if (cached) counting_semaphore_unreserve(self, (uint16_t)cached);
+    }
+}
+
+/********************************************************************************
+ * @brief Claims specified number of borrowed resources for a release, starting
+ *        with specified cache slot and continuing with the other slots, since
+ *        resources may be released by another thread than the one that took 
+ *        them.
+ * 
+ * @note  If the slots hold too few borrowed resources, the claimed resources
+ *        are given back to their slots. Meanwhile, a valid release of these
+ *        resources might fail as well, which only happens while an invalid
+ *        release is in progress.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param slot
+ *        Reference to the cache slot of the calling thread.
+ * @param num
+ *        The number of resources to claim.
+ * @return
+ *        True if the resources were claimed, false if fewer resources than
+ *        specified are borrowed.
+ ********************************************************************************/
+static bool counting_semaphore_claim_borrowed(struct counting_semaphore* self,
+                                              struct counting_semaphore_cache_slot* slot, const uint16_t num) {
+    uint32_t claimed[SEMAPHORE_CACHE_NUM_SLOTS] = {0};
+    const uint16_t first = (uint16_t)(slot - self->cache->slots);
+    uint32_t remaining = num;
+    for (uint16_t i = 0; i < SEMAPHORE_CACHE_NUM_SLOTS && remaining; ++i) {
+        const uint16_t index = (uint16_t)((first + i) % SEMAPHORE_CACHE_NUM_SLOTS);
+        _Atomic uint32_t* borrowed = &self->cache->slots[index].num_borrowed;
+        uint32_t current = atomic_load_explicit(borrowed, memory_order_relaxed);
+        while (current) {
+            const uint32_t part = current < remaining ? current : remaining;
+            if (atomic_compare_exchange_weak_explicit(borrowed, &current, current - part,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                claimed[index] = part;
+                remaining -= part;
+                break;
+            }
+        }
+    }
+    if (!remaining) return true;
+    for (uint16_t i = 0; i < SEMAPHORE_CACHE_NUM_SLOTS; ++i) {
+        if (claimed[i]) atomic_fetch_add_explicit(&self->cache->slots[i].num_borrowed, claimed[i], memory_order_relaxed);
+    }
+    return false;
+}
+
+/********************************************************************************
+ * @brief Releases specified number of resources into the cache slot of the 
+ *        calling thread. 
+ * 
+ * @note  The resources are first claimed from the borrowed resources of the
+ *        slots, so a release of resources that were never taken fails before
+ *        they become available. If threads wait on the shared counter, the
+ *        slot is emptied into the shared counter instead. The slot and the 
+ *        waiter count are accessed with sequential consistency, so either a
+ *        thread starting to wait observes the released resources when it 
+ *        flushes the slots, or we observe the waiter. If the slot holds more
+ *        than twice the batch, the surplus above one batch is returned to the
+ *        shared counter.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param num
+ *        The number of resources to release.
+ * @return
+ *        True upon successful release, false if fewer resources than specified
+ *        were taken and not released yet, or if the eventfd couldn't be 
+ *        written.
+ ********************************************************************************/
+static bool counting_semaphore_release_cached(struct counting_semaphore* self, const uint16_t num) {
+    struct counting_semaphore_cache_slot* slot = counting_semaphore_cache_slot_of(self->cache);
+    if (!counting_semaphore_claim_borrowed(self, slot, num)) return false;
+    uint32_t cached = atomic_fetch_add_explicit(&slot->num_cached, num, memory_order_seq_cst) + num;
+    if (atomic_load_explicit(&self->cache->num_waiters, memory_order_seq_cst) > 0) {
+        cached = atomic_exchange_explicit(&slot->num_cached, 0, memory_order_seq_cst);
+        return !cached || counting_semaphore_unreserve(self, (uint16_t)cached);
+    }
+    const uint32_t batch = self->cache->batch;
+    while (cached > 2 * batch) {
+        if (atomic_compare_exchange_weak_explicit(&slot->num_cached, &cached, batch,
+                                                  memory_order_seq_cst, memory_order_relaxed)) {
+            return counting_semaphore_unreserve(self, (uint16_t)(cached - batch));
+        }
+    }
+    return true;
+}
+
+/********************************************************************************
+ * @brief Reserves specified number of resources of referenced counting 
+ *        semaphore using the caching mode.
+ * 
+ * @note 1. We take the resources from the cache slot of the calling thread or
+ *          the shared counter, see counting_semaphore_take_cached.
+ *       2. Else we register as a waiter of the cache and return the resources
+ *          of all slots to the shared counter, where we reserve the resources,
+ *          spinning and parking according to the wait policy. While we are 
+ *          registered, released resources go to the shared counter directly.
+ *          The reserved resources count as borrowed by our slot, so that they
+ *          can be released into the caches again.
+ * 
+ * @param self
+ *        Reference to the counting semaphore.
+ * @param num
+ *        The number of resources to reserve.
+ * @param spins
+ *        Reference to the number of spin iterations performed so far.
+ * @param wait_start
+ *        Reference to the start time of the wait, 0 until the thread waits.
+ ********************************************************************************/
+static void counting_semaphore_reserve_cached(struct counting_semaphore* self, const uint16_t num,
+                                              uint16_t* spins, uint64_t* wait_start) {
+    if (counting_semaphore_take_cached(self, num)) return;
+    atomic_fetch_add_explicit(&self->cache->num_waiters, 1, memory_order_seq_cst);
+    counting_semaphore_flush_cache(self);
+    counting_semaphore_reserve(self, num, spins, wait_start);
+    atomic_fetch_add_explicit(&counting_semaphore_cache_slot_of(self->cache)->num_borrowed, num, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&self->cache->num_waiters, 1, memory_order_seq_cst);
+}
+
+/********************************************************************************
+ * @note 1. If an invalid number of resources was specified, we return false.
+ *       2. If a fairness mode is selected, we draw a ticket and wait for our
+ *          turn, so that only one queued thread at a time competes for the
+ *          resources.
+ *       3. If enough resources are available, we try to reserve them all at 
+ *          once by adding to the reserved resources counter via compare-and-swap.
+ *          If another thread changed the counter in between, we retry.
+ *       4. Else, if the wait policy permits spinning, we spin with exponential
+ *          backoff.
+ *       5. Else we register as a waiter and park on the counter as long as
+ *          too few resources are available. Like for binary semaphores, the 
+ *          waiter counters and the reserved resources counter are accessed 
+ *          with sequential consistency, so a concurrent release cannot be 
+ *          missed. Waiting for several resources is registered separately,
+ *          since such waiters might need more than one release to proceed.
+ *       6. If a fairness mode is selected, we pass the turn to the next ticket
+ *          once the resources are reserved. The priority fairness mode instead
+ *          queues the waiting threads by priority, see 
+ *          counting_semaphore_reserve_prioritized. The caching mode takes the
+ *          resources from the cache slot of the calling thread if possible, 
+ *          see counting_semaphore_reserve_cached.
+ *       7. If the semaphore is pollable, we consume the reserved resources 
+ *          from the eventfd.
+ *       8. We record the acquisition in the statistics, where the wait time 
+ *          starts when we first had to wait for our turn or for resources. The
+ *          acquisition is recorded in the lock-order graph before we might 
+ *          block.
+ ********************************************************************************/
+bool counting_semaphore_take_n(struct counting_semaphore* self, const uint16_t num) {
+    if (num == 0 || num > self->num_total_resources) return false;
+    sync_lockdep_acquire(self, true);
+    uint16_t spins = 0;
+    uint64_t wait_start = 0;
+    if (self->fairness == SEMAPHORE_FAIR_NONE && self->cache) {
+        counting_semaphore_reserve_cached(self, num, &spins, &wait_start);
+    } else if (self->fairness == SEMAPHORE_FAIR_NONE) {
+        counting_semaphore_reserve(self, num, &spins, &wait_start);
+    } else if (self->fairness == SEMAPHORE_FAIR_PRIORITY) {
+        counting_semaphore_reserve_prioritized(self, num, &wait_start);
+    } else {
+        const uint32_t ticket = atomic_fetch_add_explicit(&self->next_ticket, 1, memory_order_relaxed);
+        counting_semaphore_wait_for_turn(self, ticket, &spins, &wait_start);
+        counting_semaphore_reserve(self, num, &spins, &wait_start);
+        counting_semaphore_pass_turn(self, ticket);
+    }
+    counting_semaphore_consume_fd(self, num);
+    if (wait_start) sync_stats_wait_end(self->stats);
+    sync_stats_acquired(self->stats, wait_start, spins);
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. If an invalid number of resources was specified, we return false.
+ *       2. If a fairness mode is selected and any thread is queued, i.e. a 
+ *          ticket has been drawn that has not passed its turn yet or the wait
+ *          queue of the priority fairness mode isn't empty, we return false so
+ *          that the queued threads are not overtaken.
+ *       3. As long as enough resources are available, we try to reserve them
+ *          via compare-and-swap, else we return false immediately. In the 
+ *          caching mode, we first try the cache slot of the calling thread and
+ *          the shared counter. If both hold too few resources, we return the 
+ *          resources of all slots to the shared counter before the last
+ *          attempt, so that we don't fail while resources are cached. The 
+ *          reserved resources count as borrowed by the slot of the calling
+ *          thread.
+ *       4. If the semaphore is pollable, we consume the reserved resources 
+ *          from the eventfd.
+ *       5. We record the acquisition in the statistics and in the lock-order
+ *          graph, where it adds no edges, since we never blocked.
+ ********************************************************************************/
+bool counting_semaphore_try_take_n(struct counting_semaphore* self, const uint16_t num) {
+    if (num == 0 || num > self->num_total_resources) return false;
+    if (self->fairness == SEMAPHORE_FAIR_PRIORITY) {
+        if (atomic_load_explicit(&self->priority_waiters, memory_order_relaxed)) return false;
+    } else if (self->fairness != SEMAPHORE_FAIR_NONE &&
+               atomic_load_explicit(&self->next_ticket, memory_order_relaxed) !=
+               atomic_load_explicit(&self->serving.ticket, memory_order_relaxed)) {
+        return false;
+    }
+    if (self->fairness == SEMAPHORE_FAIR_NONE && self->cache) {
+        if (counting_semaphore_take_cached(self, num)) {
+            sync_stats_acquired(self->stats, 0, 0);
+            sync_lockdep_acquire(self, false);
+            return true;
+        }
+        counting_semaphore_flush_cache(self);
+    }
+    uint32_t reserved = atomic_load_explicit(&self->num_reserved_resources, memory_order_relaxed);
+    while (reserved + num <= self->num_total_resources) {
+        if (atomic_compare_exchange_weak_explicit(&self->num_reserved_resources, &reserved, reserved + num,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            if (self->fairness == SEMAPHORE_FAIR_NONE && self->cache) {
+                atomic_fetch_add_explicit(&counting_semaphore_cache_slot_of(self->cache)->num_borrowed, num,
+                                          memory_order_relaxed);
+            }
+            counting_semaphore_consume_fd(self, num);
+            sync_stats_acquired(self->stats, 0, 0);
+            sync_lockdep_acquire(self, false);
+            return true;
+        }
+    }
+    return false;
+}
+
+/********************************************************************************
+ * @note 1. If an invalid number of resources was specified, we return false.
+ *       2. We subtract the released resources from the reserved resources 
+ *          counter in a compare-and-swap loop. If fewer resources than 
+ *          specified are reserved, we return false without modifying the
+ *          counter, so a concurrent invalid release never makes resources 
+ *          appear available.
+ *       3. If the semaphore is pollable, we add the released resources to the
+ *          eventfd, which makes it readable for polling threads.
+ *       4. If any thread is parked on the semaphore, we wake as many threads
+ *          as resources were released. If any parked thread waits for several 
+ *          resources, all threads are woken, since waking a thread that still 
+ *          cannot proceed would otherwise consume the wake-up of one that can.
+ *          In the priority fairness mode, the released resources are instead
+ *          handed to the head of the wait queue, if any.
+ *       5. In the caching mode, the resources are instead released into the
+ *          cache slot of the calling thread once they are claimed from the 
+ *          resources borrowed by the slots, see 
+ *          counting_semaphore_release_cached.
+ *       6. We record the release in the statistics and in the lock-order graph.
+ ********************************************************************************/
+bool counting_semaphore_release_n(struct counting_semaphore* self, const uint16_t num) {
+    if (num == 0) return false;
+    if (self->fairness == SEMAPHORE_FAIR_NONE && self->cache) {
+        if (num > self->num_total_resources || !counting_semaphore_release_cached(self, num)) return false;
+    } else if (!counting_semaphore_unreserve(self, num)) {
+        return false;
+    }
+    sync_stats_released(self->stats);
+    sync_lockdep_release(self);
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. We read the statistics of the semaphore, if any.
+ ********************************************************************************/
+bool counting_semaphore_stats(const struct counting_semaphore* self, struct sync_stats_snapshot* snapshot) {
+    return sync_stats_read(self->stats, snapshot);
+}
+
+/********************************************************************************
+ * @note 1. We return the eventfd of the semaphore, -1 if it isn't pollable.
+ ********************************************************************************/
+int counting_semaphore_fd(const struct counting_semaphore* self) {
+    return self->event_fd;
+}
+
+/********************************************************************************
+ * @brief Provides the reader slot of the calling thread.
+ * 
+ * @note  Threads are assigned to slots round robin on first use. The 
+ *        assignment is fixed, so a read reservation is always released on the
+ *        slot where it was made.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ * @return
+ *        A reference to the reader slot of the calling thread.
+ ********************************************************************************/
+static inline struct rw_semaphore_slot* rw_semaphore_slot_of(struct rw_semaphore* self) {
+    if (rw_semaphore_thread_slot == UINT32_MAX) {
+        rw_semaphore_thread_slot = atomic_fetch_add_explicit(&rw_semaphore_num_threads, 1, memory_order_relaxed)
+                                   % RW_SEMAPHORE_NUM_SLOTS;
+    }
+    return &self->slots[rw_semaphore_thread_slot];
+}
+
+/********************************************************************************
+ * @brief Leaves specified reader slot. If a writer is active, it is woken in
+ *        case it waits for the readers to leave.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ * @param slot
+ *        Reference to the reader slot of the calling thread.
+ ********************************************************************************/
+static inline void rw_semaphore_leave(struct rw_semaphore* self, struct rw_semaphore_slot* slot) {
+    atomic_fetch_sub_explicit(&slot->num_readers, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&self->writer, memory_order_seq_cst) != RW_SEMAPHORE_NO_WRITER) {
+        atomic_fetch_add_explicit(&self->drain_seq, 1, memory_order_seq_cst);
+        futex_wake(&self->drain_seq, 1);
+    }
+}
+
+/********************************************************************************
+ * @brief Tries to enter specified reader slot.
+ * 
+ * @note  The reader is registered in its slot before the writer word is 
+ *        checked, both with sequential consistency. Therefore either the reader
+ *        sees the writer and leaves, or the writer sees the reader and waits 
+ *        for it to leave.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ * @param slot
+ *        Reference to the reader slot of the calling thread.
+ * @return
+ *        True if the reader entered, false if a writer holds or waits for
+ *        the semaphore.
+ ********************************************************************************/
+static inline bool rw_semaphore_enter(struct rw_semaphore* self, struct rw_semaphore_slot* slot) {
+    atomic_fetch_add_explicit(&slot->num_readers, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&self->writer, memory_order_seq_cst) == RW_SEMAPHORE_NO_WRITER) return true;
+    rw_semaphore_leave(self, slot);
+    return false;
+}
+
+/********************************************************************************
+ * @brief Waits until no writer holds or waits for the semaphore.
+ * 
+ * @note  We spin with exponential backoff for a bounded number of iterations,
+ *        then mark the writer word as contended and park on it.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ * @param spins
+ *        Reference to the number of spin iterations performed so far.
+ ********************************************************************************/
+static void rw_semaphore_wait_for_writer(struct rw_semaphore* self, uint16_t* spins) {
+    uint32_t state = atomic_load_explicit(&self->writer, memory_order_relaxed);
+    while (state != RW_SEMAPHORE_NO_WRITER) {
+        if (*spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+            backoff_pause((*spins)++);
+        } else if (state == RW_SEMAPHORE_WRITER_CONTENDED ||
+                   atomic_compare_exchange_weak_explicit(&self->writer, &state, RW_SEMAPHORE_WRITER_CONTENDED,
+                                                         memory_order_relaxed, memory_order_relaxed)) {
+            futex_wait(&self->writer, RW_SEMAPHORE_WRITER_CONTENDED);
+        } else {
+            continue;
+        }
+        state = atomic_load_explicit(&self->writer, memory_order_relaxed);
+    }
+}
+
+/********************************************************************************
+ * @brief Claims the writer word for the calling writer after the fast path 
+ *        failed, in the same way as a three-state futex mutex.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ * @param state
+ *        The state of the writer word observed by the fast path.
+ * @param spins
+ *        Reference to the number of spin iterations performed so far.
+ ********************************************************************************/
+static void rw_semaphore_claim_writer(struct rw_semaphore* self, uint32_t state, uint16_t* spins) {
+    while (state != RW_SEMAPHORE_WRITER_CONTENDED && *spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+        backoff_pause((*spins)++);
+        state = RW_SEMAPHORE_NO_WRITER;
+        if (atomic_compare_exchange_weak_explicit(&self->writer, &state, RW_SEMAPHORE_WRITER,
+                                                  memory_order_seq_cst, memory_order_relaxed)) {
+            return;
+        }
+    }
+    while (atomic_exchange_explicit(&self->writer, RW_SEMAPHORE_WRITER_CONTENDED, memory_order_seq_cst)
+           != RW_SEMAPHORE_NO_WRITER) {
+        futex_wait(&self->writer, RW_SEMAPHORE_WRITER_CONTENDED);
+    }
+}
+
+/********************************************************************************
+ * @brief Indicates if no reader holds the semaphore.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ * @return
+ *        True if all reader slots are empty, else false.
+ ********************************************************************************/
+static inline bool rw_semaphore_no_readers(struct rw_semaphore* self) {
+    for (uint16_t i = 0; i < RW_SEMAPHORE_NUM_SLOTS; ++i) {
+        if (atomic_load_explicit(&self->slots[i].num_readers, memory_order_seq_cst)) return false;
+    }
+    return true;
+}
+
+/********************************************************************************
+ * @brief Releases the writer word and wakes all threads parked on it.
+ * 
+ * @param self
+ *        Reference to the reader-writer semaphore.
+ ********************************************************************************/
+static inline void rw_semaphore_release_writer(struct rw_semaphore* self) {
+    if (atomic_exchange_explicit(&self->writer, RW_SEMAPHORE_NO_WRITER, memory_order_seq_cst)
+        == RW_SEMAPHORE_WRITER_CONTENDED) {
+        futex_wake(&self->writer, INT_MAX);
+    }
+}
+
+/********************************************************************************
+ * @note 1. We allocate memory for a new semaphore, aligned to a cache line
+ *          since the reader slots are. If the allocation fails, we return a
+ *          nullptr.
+ *       2. We initialize all reader slots as empty and no writer. If the 
+ *          instrumentation is enabled, the statistics are created, and the
+ *          semaphore is named in the lock-order graph.
+ *       3. We return a reference to the reader-writer semaphore.
+ ********************************************************************************/
+struct rw_semaphore* rw_semaphore_new(const char* name) {
+    struct rw_semaphore* self = (struct rw_semaphore*)aligned_alloc(SYNC_CACHE_LINE_SIZE, 
+                                                                    sizeof(struct rw_semaphore));
+    if (!self) return 0;
+    for (uint16_t i = 0; i < RW_SEMAPHORE_NUM_SLOTS; ++i) {
+        atomic_init(&self->slots[i].num_readers, 0);
+    }
+    atomic_init(&self->writer, RW_SEMAPHORE_NO_WRITER);
+    atomic_init(&self->drain_seq, 0);
+    self->stats = sync_stats_new(name ? name : "rw_semaphore");
+    sync_lockdep_register(self, name ? name : "rw_semaphore");
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. Deallocates the heap allocated memory, including the statistics,
+ *          and removes the semaphore from the lock-order graph.
+ *       2. Sets the semaphore pointer to null via the double pointer.
+ ********************************************************************************/
+void rw_semaphore_delete(struct rw_semaphore** self) {
+    if (*self) {
+        sync_lockdep_forget(*self);
+        sync_stats_delete((*self)->stats);
+    }
+    free(*self);
+    *self = 0;
+}
+
+/********************************************************************************
+ * @note 1. We try to enter the reader slot of the calling thread. On the fast
+ *          path, this is the only write to shared memory.
+ *       2. Else a writer holds or waits for the semaphore, so we wait until
+ *          the writer is done and retry. Writers are thereby preferred.
+ *       3. We record the acquisition in the statistics. The acquisition is 
+ *          recorded in the lock-order graph before we wait.
+ ********************************************************************************/
+void rw_semaphore_take_read(struct rw_semaphore* self) {
+    sync_lockdep_acquire(self, true);
+    struct rw_semaphore_slot* slot = rw_semaphore_slot_of(self);
+    if (rw_semaphore_enter(self, slot)) {
+        sync_stats_acquired(self->stats, 0, 0);
+        return;
+    }
+    const uint64_t wait_start = sync_stats_now();
+    sync_stats_wait_begin(self->stats);
+    uint16_t spins = 0;
+    do {
+        rw_semaphore_wait_for_writer(self, &spins);
+    } while (!rw_semaphore_enter(self, slot));
+    sync_stats_wait_end(self->stats);
+    sync_stats_acquired(self->stats, wait_start, spins);
+}
+
+/********************************************************************************
+ * @note 1. We try to enter the reader slot of the calling thread once.
+ ********************************************************************************/
+bool rw_semaphore_try_take_read(struct rw_semaphore* self) {
+    if (!rw_semaphore_enter(self, rw_semaphore_slot_of(self))) return false;
+    sync_stats_acquired(self->stats, 0, 0);
+    sync_lockdep_acquire(self, false);
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. We leave the reader slot of the calling thread, which wakes an
+ *          active writer waiting for the readers to leave.
+ ********************************************************************************/
+void rw_semaphore_release_read(struct rw_semaphore* self) {
+    sync_stats_released(self->stats);
+    sync_lockdep_release(self);
+    rw_semaphore_leave(self, rw_semaphore_slot_of(self));
+}
+
+/********************************************************************************
+ * @note 1. We claim the writer word, via a single compare-and-swap if no other
+ *          writer is active. From now on, new readers wait for us.
+ *       2. We wait for the readers to leave, slot by slot. We spin with 
+ *          exponential backoff for a bounded number of iterations, then park
+ *          on the drain sequence. The sequence is read before the slot, so a
+ *          reader leaving in between makes the wait return immediately.
+ *       3. We record the acquisition in the statistics. The acquisition is 
+ *          recorded in the lock-order graph before we wait.
+ ********************************************************************************/
+void rw_semaphore_take_write(struct rw_semaphore* self) {
+    sync_lockdep_acquire(self, true);
+    uint32_t state = RW_SEMAPHORE_NO_WRITER;
+    uint16_t spins = 0;
+    uint64_t wait_start = 0;
+    if (!atomic_compare_exchange_strong_explicit(&self->writer, &state, RW_SEMAPHORE_WRITER,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        wait_start = sync_stats_now();
+        sync_stats_wait_begin(self->stats);
+        rw_semaphore_claim_writer(self, state, &spins);
+    }
+    for (uint16_t i = 0; i < RW_SEMAPHORE_NUM_SLOTS; ++i) {
+        while (atomic_load_explicit(&self->slots[i].num_readers, memory_order_seq_cst)) {
+            if (!wait_start) {
+                wait_start = sync_stats_now();
+                sync_stats_wait_begin(self->stats);
+            }
+            if (spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+                backoff_pause(spins++);
+                continue;
+            }
+            const uint32_t seq = atomic_load_explicit(&self->drain_seq, memory_order_seq_cst);
+            if (atomic_load_explicit(&self->slots[i].num_readers, memory_order_seq_cst)) {
+                futex_wait(&self->drain_seq, seq);
+            }
+        }
+    }
+    if (wait_start) sync_stats_wait_end(self->stats);
+    sync_stats_acquired(self->stats, wait_start, spins);
+}
+
+/********************************************************************************
+ * @note 1. We try to claim the writer word via a single compare-and-swap.
+ *       2. If any reader holds the semaphore, we release the writer word again
+ *          (waking readers that saw us in the meantime) and return false.
+ ********************************************************************************/
+bool rw_semaphore_try_take_write(struct rw_semaphore* self) {
+    uint32_t state = RW_SEMAPHORE_NO_WRITER;
+    if (!atomic_compare_exchange_strong_explicit(&self->writer, &state, RW_SEMAPHORE_WRITER,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return false;
+    }
+    if (!rw_semaphore_no_readers(self)) {
+        rw_semaphore_release_writer(self);
+        return false;
+    }
+    sync_stats_acquired(self->stats, 0, 0);
+    sync_lockdep_acquire(self, false);
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. We release the writer word (sequential consistency makes our writes
+ *          visible to the next reader or writer) and wake all threads parked 
+ *          on it, both readers and writers.
+ ********************************************************************************/
+void rw_semaphore_release_write(struct rw_semaphore* self) {
+    sync_stats_released(self->stats);
+    sync_lockdep_release(self);
+    rw_semaphore_release_writer(self);
+}
+
+/********************************************************************************
+ * @note 1. We read the statistics of the semaphore, if any.
+ ********************************************************************************/
+bool rw_semaphore_stats(const struct rw_semaphore* self, struct sync_stats_snapshot* snapshot) {
+    return sync_stats_read(self->stats, snapshot);
+}
+
+/********************************************************************************
+ * @brief Provides the number of nodes combining specified number of arrivals.
+ * 
+ * @param num_arrivals
+ *        The number of arrivals.
+ * @return
+ *        The number of nodes, at least 1.
+ ********************************************************************************/
+static inline uint32_t barrier_num_nodes_at(const uint32_t num_arrivals) {
+    return num_arrivals > BARRIER_FAN_IN ? (num_arrivals + BARRIER_FAN_IN - 1) / BARRIER_FAN_IN : 1;
+}
+
+/********************************************************************************
+ * @note 1. If an invalid number of threads was specified, we return a nullptr.
+ *       2. We count the nodes of the combining tree, level by level from the
+ *          leaves up to the root, and allocate the barrier and the nodes, both
+ *          aligned to a cache line. If any memory allocation fails, we return 
+ *          a nullptr.
+ *       3. We initialize the nodes level by level. Each node expects up to
+ *          BARRIER_FAN_IN arrivals, the last node of a level the remainder.
+ *          Node i of a level has node i / BARRIER_FAN_IN of the next level as
+ *          parent.
+ *       4. We initialize the barrier in phase 0.
+ ********************************************************************************/
+struct barrier* barrier_new(const uint32_t num_threads, void (*completion)(void* context), void* context) {
+    if (num_threads == 0) return 0;
+    uint32_t num_nodes = barrier_num_nodes_at(num_threads);
+    uint32_t total = num_nodes;
+    while (num_nodes > 1) {
+        num_nodes = barrier_num_nodes_at(num_nodes);
+        total += num_nodes;
+    }
+    struct barrier* self = (struct barrier*)aligned_alloc(SYNC_CACHE_LINE_SIZE, sizeof(struct barrier));
+    if (!self) return 0;
+    self->nodes = (struct barrier_node*)aligned_alloc(SYNC_CACHE_LINE_SIZE, total * sizeof(struct barrier_node));
+    if (!self->nodes) {
+        free(self);
+        return 0;
+    }
+    uint32_t offset = 0, num_arrivals = num_threads;
+    num_nodes = self->num_leaves = barrier_num_nodes_at(num_threads);
+    while (1) {
+        for (uint32_t i = 0; i < num_nodes; ++i) {
+            struct barrier_node* node = &self->nodes[offset + i];
+            const uint32_t remaining = num_arrivals - i * BARRIER_FAN_IN;
+            atomic_init(&node->count, 0);
+            node->expected = remaining < BARRIER_FAN_IN ? remaining : BARRIER_FAN_IN;
+            node->parent = num_nodes == 1 ? BARRIER_NO_PARENT : offset + num_nodes + i / BARRIER_FAN_IN;
+        }
+        if (num_nodes == 1) break;
+        offset += num_nodes;
+        num_arrivals = num_nodes;
+        num_nodes = barrier_num_nodes_at(num_nodes);
+    }
+    atomic_init(&self->phase, 0);
+    atomic_init(&self->num_parked, 0);
+    self->completion = completion;
+    self->context = context;
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. Deallocates the nodes and the barrier.
+ *       2. Sets the barrier pointer to null via the double pointer.
+ ********************************************************************************/
+void barrier_delete(struct barrier** self) {
+    if (*self) free((*self)->nodes);
+    free(*self);
+    *self = 0;
+}
+
+/********************************************************************************
+ * @brief Arrives at the combining tree of referenced barrier in specified 
+ *        phase.
+ * 
+ * @note 1. We start at the leaf the calling thread is assigned to, round robin
+ *          on first use. If the leaf is full in this phase, we try the next 
+ *          one, which terminates since the leaves together expect exactly one
+ *          arrival per thread.
+ *       2. We join the leaf via compare-and-swap, so that a full leaf is never
+ *          overfilled. Unless we are the last to arrive at it, we are done.
+ *       3. Else we arrive at each parent in turn, where exactly one arrival per
+ *          child occurs, so a fetch_add suffices. The last arrival at the root
+ *          completes the phase. All counters are updated with acquire-release
+ *          ordering, so the completing thread observes the writes of all 
+ *          threads before they arrived.
+ * 
+ * @param self
+ *        Reference to the barrier.
+ * @param phase
+ *        The current phase.
+ * @return
+ *        True if the calling thread completed the root, else false.
+ ********************************************************************************/
+static bool barrier_arrive(struct barrier* self, const uint32_t phase) {
+    if (barrier_thread_index == UINT32_MAX) {
+        barrier_thread_index = atomic_fetch_add_explicit(&barrier_num_threads, 1, memory_order_relaxed);
+    }
+    uint32_t index = barrier_thread_index % self->num_leaves;
+    while (1) {
+        struct barrier_node* leaf = &self->nodes[index];
+        const uint32_t base = phase * leaf->expected;
+        uint32_t count = atomic_load_explicit(&leaf->count, memory_order_relaxed);
+        while (count - base < leaf->expected) {
+            if (atomic_compare_exchange_weak_explicit(&leaf->count, &count, count + 1, memory_order_acq_rel,
+                                                      memory_order_relaxed)) {
+                if (count + 1 - base != leaf->expected) return false;
+                for (uint32_t parent = leaf->parent; parent != BARRIER_NO_PARENT; parent = self->nodes[parent].parent) {
+                    struct barrier_node* node = &self->nodes[parent];
+                    const uint32_t arrived = atomic_fetch_add_explicit(&node->count, 1, memory_order_acq_rel) + 1;
+                    if (arrived - phase * node->expected != node->expected) return false;
+                }
+                return true;
+            }
+        }
+        index = index + 1 < self->num_leaves ? index + 1 : 0;
+    }
+}
+
+/********************************************************************************
+ * @note 1. We read the phase before arriving; it cannot advance until we have
+ *          arrived.
+ *       2. If we completed the phase, we run the completion function, if any,
+ *          and advance the phase. If any thread is parked, all of them are 
+ *          woken by a single broadcast. The phase and the parked counter are 
+ *          accessed with sequential consistency, so a thread about to park 
+ *          either observes the new phase or is observed as parked.
+ *       3. Else we wait until the phase advances, spinning with exponential
+ *          backoff for a bounded number of iterations before we park on it.
+ ********************************************************************************/
+bool barrier_arrive_and_wait(struct barrier* self) {
+    const uint32_t phase = atomic_load_explicit(&self->phase, memory_order_acquire);
+    if (barrier_arrive(self, phase)) {
+        if (self->completion) self->completion(self->context);
+        atomic_store_explicit(&self->phase, phase + 1, memory_order_seq_cst);
+        if (atomic_load_explicit(&self->num_parked, memory_order_seq_cst) > 0) {
+            futex_wake(&self->phase, INT_MAX);
+        }
+        return true;
+    }
+    uint16_t spins = 0;
+    while (atomic_load_explicit(&self->phase, memory_order_acquire) == phase) {
+        if (spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+            backoff_pause(spins++);
+        } else {
+            atomic_fetch_add_explicit(&self->num_parked, 1, memory_order_seq_cst);
+            if (atomic_load_explicit(&self->phase, memory_order_seq_cst) == phase) futex_wait(&self->phase, phase);
+            atomic_fetch_sub_explicit(&self->num_parked, 1, memory_order_relaxed);
+        }
+    }
+    return false;
+}
+
+/********************************************************************************
+ * @note 1. We return the number of completed phases.
+ ********************************************************************************/
+uint32_t barrier_phase(const struct barrier* self) {
+    return atomic_load_explicit(&self->phase, memory_order_acquire);
+}
+
+/********************************************************************************
+ * @note 1. Allocates memory for the latch. If the memory allocation failed, we
+ *          return a nullptr.
+ *       2. We initialize the counter to specified count.
+ ********************************************************************************/
+struct latch* latch_new(const uint32_t count) {
+    struct latch* self = (struct latch*)malloc(sizeof(struct latch));
+    if (!self) return 0;
+    atomic_init(&self->count, count);
+    atomic_init(&self->num_parked, 0);
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. Deallocates the latch.
+ *       2. Sets the latch pointer to null via the double pointer.
+ ********************************************************************************/
+void latch_delete(struct latch** self) {
+    free(*self);
+    *self = 0;
+}
+
+/********************************************************************************
+ * @note 1. We subtract from the counter via compare-and-swap, so that it never
+ *          underflows. If num exceeds the counter, we return false.
+ *       2. If the counter reached zero and any thread is parked, all of them 
+ *          are woken by a single broadcast, see barrier_arrive_and_wait.
+ ********************************************************************************/
+bool latch_count_down(struct latch* self, const uint32_t num) {
+    uint32_t count = atomic_load_explicit(&self->count, memory_order_relaxed);
+    do {
+        if (num > count) return false;
+    } while (!atomic_compare_exchange_weak_explicit(&self->count, &count, count - num, memory_order_seq_cst,
+                                                    memory_order_relaxed));
+    if (count == num && atomic_load_explicit(&self->num_parked, memory_order_seq_cst) > 0) {
+        futex_wake(&self->count, INT_MAX);
+    }
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. We check whether the counter is zero.
+ ********************************************************************************/
+bool latch_try_wait(const struct latch* self) {
+    return atomic_load_explicit(&self->count, memory_order_acquire) == 0;
+}
+
+/********************************************************************************
+ * @note 1. As long as the counter isn't zero, we spin with exponential backoff 
+ *          for a bounded number of iterations, then park on the counter.
+ ********************************************************************************/
+void latch_wait(struct latch* self) {
+    uint16_t spins = 0;
+    uint32_t count = atomic_load_explicit(&self->count, memory_order_acquire);
+    while (count != 0) {
+        if (spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+            backoff_pause(spins++);
+        } else {
+            atomic_fetch_add_explicit(&self->num_parked, 1, memory_order_seq_cst);
+            count = atomic_load_explicit(&self->count, memory_order_seq_cst);
+            if (count != 0) futex_wait(&self->count, count);
+            atomic_fetch_sub_explicit(&self->num_parked, 1, memory_order_relaxed);
+        }
+        count = atomic_load_explicit(&self->count, memory_order_acquire);
+    }
+}
+
+/********************************************************************************
+ * @note 1. We decrement the counter. If num exceeds it, we return false 
+ *          without waiting.
+ *       2. We wait until the counter reaches zero.
+ ********************************************************************************/
+bool latch_arrive_and_wait(struct latch* self, const uint32_t num) {
+    if (!latch_count_down(self, num)) return false;
+    latch_wait(self);
+    return true;
+}
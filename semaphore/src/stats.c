@@ -0,0 +1,375 @@
+/********************************************************************************
+ * @brief Implementation details for the instrumentation of the
+ *        synchronization primitives.
+ ********************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <sync/stats.h>
+
+/********************************************************************************
+ * @note 1. We sum up the histogram and compute the rank of the percentile.
+ *       2. We walk through the buckets until the cumulative count reaches the
+ *          rank, and return the upper bound of that bucket, i.e. 2^(n + 1) ns.
+ ********************************************************************************/
+uint64_t sync_stats_percentile(const uint64_t* histogram, const double percentile) {
+    uint64_t total = 0;
+    for (uint16_t i = 0; i < SYNC_STATS_NUM_BUCKETS; ++i) {
+        total += histogram[i];
+    }
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)((double)total * percentile / 100.0 + 0.5);
+    if (rank == 0) rank = 1;
+    if (rank > total) rank = total;
+    uint64_t cumulative = 0;
+    for (uint16_t i = 0; i < SYNC_STATS_NUM_BUCKETS; ++i) {
+        cumulative += histogram[i];
+        if (cumulative >= rank) return (uint64_t)1 << (i + 1);
+    }
+    return (uint64_t)1 << SYNC_STATS_NUM_BUCKETS;
+}
+
+#ifdef SYNC_STATS
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sync/cache_line.h>
+
+/********************************************************************************
+ * @brief The maximum number of acquisitions per thread whose hold time is
+ *        tracked at the same time. If a thread holds more primitives, the
+ *        oldest acquisition is no longer tracked.
+ ********************************************************************************/
+#define SYNC_STATS_MAX_HELD 16
+
+/********************************************************************************
+ * @brief Counters of a primitive updated by the threads assigned to the shard.
+ *        Each shard is placed on a cache line of its own.
+ *
+ * @param num_acquisitions
+ *        The number of acquisitions.
+ * @param num_contended
+ *        The number of contended acquisitions.
+ * @param num_spins
+ *        The number of spin iterations.
+ * @param num_elided
+ *        The number of elided acquisitions.
+ * @param num_elision_aborts
+ *        The number of aborted transactions of elided acquisitions.
+ * @param wait_time_ns
+ *        Histogram of the wait times of contended acquisitions.
+ * @param hold_time_ns
+ *        Histogram of the hold times.
+ ********************************************************************************/
+struct sync_stats_shard {
+    SYNC_CACHE_ALIGNED _Atomic uint64_t num_acquisitions;
+    _Atomic uint64_t num_contended;
+    _Atomic uint64_t num_spins;
+    _Atomic uint64_t num_elided;
+    _Atomic uint64_t num_elision_aborts;
+    _Atomic uint64_t wait_time_ns[SYNC_STATS_NUM_BUCKETS];
+    _Atomic uint64_t hold_time_ns[SYNC_STATS_NUM_BUCKETS];
+};
+
+/********************************************************************************
+ * @brief Statistics of a synchronization primitive.
+ *
+ * @param shards
+ *        The per-thread counter shards.
+ * @param num_waiters
+ *        The number of threads currently waiting for the primitive.
+ * @param max_waiters
+ *        The highest number of threads waiting at the same time.
+ * @param name
+ *        The name of the primitive.
+ * @param previous
+ *        The previous statistics in the registry.
+ * @param next
+ *        The next statistics in the registry.
+ ********************************************************************************/
+struct sync_stats {
+    struct sync_stats_shard shards[SYNC_STATS_NUM_SHARDS];
+    SYNC_CACHE_ALIGNED _Atomic uint32_t num_waiters;
+    _Atomic uint32_t max_waiters;
+    char name[SYNC_STATS_NAME_SIZE];
+    struct sync_stats* previous;
+    struct sync_stats* next;
+};
+
+/********************************************************************************
+ * @brief An acquisition whose hold time is tracked by the acquiring thread.
+ *
+ * @param stats
+ *        The statistics of the acquired primitive.
+ * @param since
+ *        Timestamp of the acquisition.
+ ********************************************************************************/
+struct sync_stats_held {
+    const struct sync_stats* stats;
+    uint64_t since;
+};
+
+/********************************************************************************
+ * @brief Registry of all statistics, protected by a mutex. The registry is
+ *        only accessed when statistics are created, deleted or dumped.
+ ********************************************************************************/
+static pthread_mutex_t sync_stats_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct sync_stats* sync_stats_registry = 0;
+
+/********************************************************************************
+ * @brief Counter used to assign counter shards to threads round robin.
+ ********************************************************************************/
+static _Atomic uint32_t sync_stats_num_threads = 0;
+
+/********************************************************************************
+ * @brief The counter shard index of the calling thread, assigned on first use.
+ ********************************************************************************/
+static _Thread_local uint32_t sync_stats_thread_shard = UINT32_MAX;
+
+/********************************************************************************
+ * @brief The acquisitions of the calling thread whose hold time is tracked.
+ ********************************************************************************/
+static _Thread_local struct sync_stats_held sync_stats_held[SYNC_STATS_MAX_HELD];
+static _Thread_local uint16_t sync_stats_num_held = 0;
+
+/********************************************************************************
+ * @brief Provides the counter shard of the calling thread.
+ *
+ * @param self
+ *        Reference to the statistics.
+ * @return
+ *        A reference to the counter shard of the calling thread.
+ ********************************************************************************/
+static inline struct sync_stats_shard* sync_stats_shard(struct sync_stats* self) {
+    if (sync_stats_thread_shard == UINT32_MAX) {
+        sync_stats_thread_shard = atomic_fetch_add_explicit(&sync_stats_num_threads, 1, memory_order_relaxed)
+                                  % SYNC_STATS_NUM_SHARDS;
+    }
+    return &self->shards[sync_stats_thread_shard];
+}
+
+/********************************************************************************
+ * @brief Provides the histogram bucket of specified duration.
+ *
+ * @param duration_ns
+ *        The duration in ns.
+ * @return
+ *        The index of the bucket, i.e. floor(log2(duration_ns)).
+ ********************************************************************************/
+static inline uint16_t sync_stats_bucket(const uint64_t duration_ns) {
+    if (duration_ns < 2) return 0;
+    const uint16_t bucket = (uint16_t)(63 - __builtin_clzll(duration_ns));
+    return bucket < SYNC_STATS_NUM_BUCKETS ? bucket : SYNC_STATS_NUM_BUCKETS - 1;
+}
+
+/********************************************************************************
+ * @note 1. We allocate the statistics aligned to a cache line, since the
+ *          counter shards must not share cache lines with other data.
+ *       2. We initialize the statistics and add them to the registry.
+ ********************************************************************************/
+struct sync_stats* sync_stats_new(const char* name) {
+    struct sync_stats* self = (struct sync_stats*)aligned_alloc(SYNC_CACHE_LINE_SIZE, sizeof(struct sync_stats));
+    if (!self) return 0;
+    memset(self, 0, sizeof(struct sync_stats));
+    strncpy(self->name, name, SYNC_STATS_NAME_SIZE - 1);
+    pthread_mutex_lock(&sync_stats_registry_lock);
+    self->next = sync_stats_registry;
+    if (sync_stats_registry) sync_stats_registry->previous = self;
+    sync_stats_registry = self;
+    pthread_mutex_unlock(&sync_stats_registry_lock);
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. We remove the statistics from the registry before deallocating
+ *          them, so that a concurrent dump never reads deallocated memory.
+ ********************************************************************************/
+void sync_stats_delete(struct sync_stats* self) {
+    if (!self) return;
+    pthread_mutex_lock(&sync_stats_registry_lock);
+    if (self->previous) self->previous->next = self->next;
+    else sync_stats_registry = self->next;
+    if (self->next) self->next->previous = self->previous;
+    pthread_mutex_unlock(&sync_stats_registry_lock);
+    free(self);
+}
+
+/********************************************************************************
+ * @note 1. We read the monotonic clock, which is served without a system call
+ *          on Linux.
+ ********************************************************************************/
+uint64_t sync_stats_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/********************************************************************************
+ * @note 1. We increment the number of waiters and raise the maximum if the
+ *          new number of waiters exceeds it. This is only done on the
+ *          contended path, where the thread is about to wait anyway.
+ ********************************************************************************/
+void sync_stats_wait_begin(struct sync_stats* self) {
+    if (!self) return;
+    const uint32_t num_waiters = atomic_fetch_add_explicit(&self->num_waiters, 1, memory_order_relaxed) + 1;
+    uint32_t max_waiters = atomic_load_explicit(&self->max_waiters, memory_order_relaxed);
+    while (num_waiters > max_waiters &&
+           !atomic_compare_exchange_weak_explicit(&self->max_waiters, &max_waiters, num_waiters,
+                                                  memory_order_relaxed, memory_order_relaxed));
+}
+
+/********************************************************************************
+ * @note 1. We decrement the number of waiters.
+ ********************************************************************************/
+void sync_stats_wait_end(struct sync_stats* self) {
+    if (!self) return;
+    atomic_fetch_sub_explicit(&self->num_waiters, 1, memory_order_relaxed);
+}
+
+/********************************************************************************
+ * @note 1. We update the counters of the calling thread's shard.
+ *       2. If the acquisition was contended, we record the wait time.
+ *       3. We remember the acquisition to measure its hold time on release.
+ *          If the calling thread already tracks the maximum number of
+ *          acquisitions, we stop tracking the oldest one.
+ ********************************************************************************/
+void sync_stats_acquired(struct sync_stats* self, const uint64_t wait_start, const uint32_t num_spins) {
+    if (!self) return;
+    struct sync_stats_shard* shard = sync_stats_shard(self);
+    const uint64_t now = sync_stats_now();
+    atomic_fetch_add_explicit(&shard->num_acquisitions, 1, memory_order_relaxed);
+    if (wait_start) {
+        atomic_fetch_add_explicit(&shard->num_contended, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&shard->num_spins, num_spins, memory_order_relaxed);
+        atomic_fetch_add_explicit(&shard->wait_time_ns[sync_stats_bucket(now - wait_start)], 1,
+                                  memory_order_relaxed);
+    }
+    if (sync_stats_num_held == SYNC_STATS_MAX_HELD) {
+        memmove(&sync_stats_held[0], &sync_stats_held[1], sizeof(struct sync_stats_held) * (SYNC_STATS_MAX_HELD - 1));
+        sync_stats_num_held--;
+    }
+    sync_stats_held[sync_stats_num_held].stats = self;
+    sync_stats_held[sync_stats_num_held].since = now;
+    sync_stats_num_held++;
+}
+
+/********************************************************************************
+ * @note 1. We search for the latest acquisition of the primitive by the calling
+ *          thread. If none is found, the primitive was acquired by another
+ *          thread and no hold time is recorded.
+ *       2. Else we record the hold time and stop tracking the acquisition.
+ ********************************************************************************/
+void sync_stats_released(struct sync_stats* self) {
+    if (!self) return;
+    for (uint16_t i = sync_stats_num_held; i > 0; --i) {
+        if (sync_stats_held[i - 1].stats == self) {
+            const uint64_t hold_time = sync_stats_now() - sync_stats_held[i - 1].since;
+            atomic_fetch_add_explicit(&sync_stats_shard(self)->hold_time_ns[sync_stats_bucket(hold_time)], 1,
+                                      memory_order_relaxed);
+            memmove(&sync_stats_held[i - 1], &sync_stats_held[i],
+                    sizeof(struct sync_stats_held) * (sync_stats_num_held - i));
+            sync_stats_num_held--;
+            return;
+        }
+    }
+}
+
+/********************************************************************************
+ * @note 1. We count the acquisition in the shard of the calling thread. Its
+ *          hold time isn't tracked, since the transaction has already ended.
+ ********************************************************************************/
+void sync_stats_elided(struct sync_stats* self) {
+    if (!self) return;
+    struct sync_stats_shard* shard = sync_stats_shard(self);
+    atomic_fetch_add_explicit(&shard->num_acquisitions, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shard->num_elided, 1, memory_order_relaxed);
+}
+
+/********************************************************************************
+ * @note 1. We count the abort in the shard of the calling thread.
+ ********************************************************************************/
+void sync_stats_elision_aborted(struct sync_stats* self) {
+    if (!self) return;
+    atomic_fetch_add_explicit(&sync_stats_shard(self)->num_elision_aborts, 1, memory_order_relaxed);
+}
+
+/********************************************************************************
+ * @note 1. We copy the name and the waiter maximum.
+ *       2. We sum up the counters of all shards. The counters are read without
+ *          stopping the threads, so the snapshot is not an atomic cut, but each
+ *          counter is exact at some point during the read.
+ ********************************************************************************/
+bool sync_stats_read(const struct sync_stats* self, struct sync_stats_snapshot* snapshot) {
+    if (!self) return false;
+    memset(snapshot, 0, sizeof(struct sync_stats_snapshot));
+    memcpy(snapshot->name, self->name, SYNC_STATS_NAME_SIZE);
+    snapshot->max_waiters = atomic_load_explicit(&self->max_waiters, memory_order_relaxed);
+    for (uint16_t i = 0; i < SYNC_STATS_NUM_SHARDS; ++i) {
+        const struct sync_stats_shard* shard = &self->shards[i];
+        snapshot->num_acquisitions += atomic_load_explicit(&shard->num_acquisitions, memory_order_relaxed);
+        snapshot->num_contended += atomic_load_explicit(&shard->num_contended, memory_order_relaxed);
+        snapshot->num_spins += atomic_load_explicit(&shard->num_spins, memory_order_relaxed);
+        snapshot->num_elided += atomic_load_explicit(&shard->num_elided, memory_order_relaxed);
+        snapshot->num_elision_aborts += atomic_load_explicit(&shard->num_elision_aborts, memory_order_relaxed);
+        for (uint16_t j = 0; j < SYNC_STATS_NUM_BUCKETS; ++j) {
+            snapshot->wait_time_ns[j] += atomic_load_explicit(&shard->wait_time_ns[j], memory_order_relaxed);
+            snapshot->hold_time_ns[j] += atomic_load_explicit(&shard->hold_time_ns[j], memory_order_relaxed);
+        }
+    }
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. We walk through the registry while holding its lock, so that no
+ *          statistics are deleted during the dump.
+ *       2. We print one line per primitive that has been acquired, where the
+ *          percentiles are upper bounds given by the histogram buckets. The
+ *          elision counters are only appended if any acquisition was elided
+ *          or aborted.
+ ********************************************************************************/
+void sync_stats_dump(FILE* stream) {
+    pthread_mutex_lock(&sync_stats_registry_lock);
+    for (const struct sync_stats* self = sync_stats_registry; self; self = self->next) {
+        struct sync_stats_snapshot snapshot;
+        sync_stats_read(self, &snapshot);
+        if (snapshot.num_acquisitions == 0) continue;
+        fprintf(stream, "%-24s acquisitions=%llu contended=%llu spins=%llu max_waiters=%u "
+                        "wait_p50<=%lluns wait_p99<=%lluns hold_p50<=%lluns hold_p99<=%lluns",
+                snapshot.name,
+                (unsigned long long)snapshot.num_acquisitions,
+                (unsigned long long)snapshot.num_contended,
+                (unsigned long long)snapshot.num_spins,
+                snapshot.max_waiters,
+                (unsigned long long)sync_stats_percentile(snapshot.wait_time_ns, 50.0),
+                (unsigned long long)sync_stats_percentile(snapshot.wait_time_ns, 99.0),
+                (unsigned long long)sync_stats_percentile(snapshot.hold_time_ns, 50.0),
+                (unsigned long long)sync_stats_percentile(snapshot.hold_time_ns, 99.0));
+        if (snapshot.num_elided || snapshot.num_elision_aborts) {
+            fprintf(stream, " elided=%llu elision_aborts=%llu", (unsigned long long)snapshot.num_elided,
+                    (unsigned long long)snapshot.num_elision_aborts);
+        }
+        fputc('\n', stream);
+    }
+    pthread_mutex_unlock(&sync_stats_registry_lock);
+}
+
+#else
+
+/********************************************************************************
+ * @note 1. The instrumentation is disabled, no statistics are available.
+ ********************************************************************************/
+bool sync_stats_read(const struct sync_stats* self, struct sync_stats_snapshot* snapshot) {
+    (void)self;
+    (void)snapshot;
+    return false;
+}
+
+/********************************************************************************
+ * @note 1. The instrumentation is disabled, we print a note about how to
+ *          enable it.
+ ********************************************************************************/
+void sync_stats_dump(FILE* stream) {
+    fprintf(stream, "Instrumentation disabled, build with SYNC_ENABLE_STATS=ON to enable it.\n");
+}
+
+#endif /* SYNC_STATS */
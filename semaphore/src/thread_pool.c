@@ -0,0 +1,532 @@
+/********************************************************************************
+ * @brief Implementation details for thread pools in C.
+ ********************************************************************************/
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sync/thread_pool.h>
+#include "futex.h"
+
+/********************************************************************************
+ * @brief Task of a thread pool, copied into the shared queue as is.
+ *
+ * @param function
+ *        The function to run.
+ * @param arg
+ *        The argument passed to the function.
+ ********************************************************************************/
+struct thread_pool_task {
+    void (*function)(void* arg);
+    void* arg;
+};
+
+/********************************************************************************
+ * @brief Slot of a deque. The members are atomic, so that a thief racing with
+ *        the owner never reads a torn value; a thief only keeps the task if
+ *        it wins the top index, in which case the slot wasn't overwritten.
+ *
+ * @param function
+ *        The function to run.
+ * @param arg
+ *        The argument passed to the function.
+ ********************************************************************************/
+struct thread_pool_slot {
+    void (*_Atomic function)(void* arg);
+    void* _Atomic arg;
+};
+
+/********************************************************************************
+ * @brief Worker of a thread pool, which owns a fixed-size Chase-Lev deque. The
+ *        owner pushes and pops at the bottom, other workers steal at the top.
+ *
+ * @param top
+ *        Index of the oldest task, on a cache line of its own.
+ * @param bottom
+ *        Index past the newest task, on a cache line of its own.
+ * @param slots
+ *        The tasks of the deque.
+ * @param pool
+ *        The thread pool of the worker.
+ * @param thread
+ *        The worker thread.
+ * @param rng
+ *        State of the victim selection.
+ ********************************************************************************/
+struct thread_pool_worker {
+    SYNC_CACHE_ALIGNED _Atomic int64_t top;
+    SYNC_CACHE_ALIGNED _Atomic int64_t bottom;
+    struct thread_pool_slot slots[THREAD_POOL_DEQUE_CAPACITY];
+    struct thread_pool* pool;
+    pthread_t thread;
+    uint32_t rng;
+};
+
+/********************************************************************************
+ * @brief Structure for implementing thread pools in C. The structure is
+ *        private in this file.
+ *
+ * @param queue
+ *        The queue of tasks submitted by other threads than the workers.
+ * @param workers
+ *        The workers and their deques.
+ * @param wake_sem
+ *        Counting semaphore the idle workers are parked on, all resources
+ *        reserved at start. Each release wakes one worker.
+ * @param wake_sem_storage
+ *        Inline storage of the wake semaphore.
+ * @param num_threads
+ *        The number of worker threads.
+ * @param running
+ *        Cleared when the thread pool is deleted.
+ * @param num_sleeping
+ *        The number of parking workers whose registration is not claimed by a
+ *        submitter yet.
+ * @param num_pending
+ *        The number of submitted tasks that have not returned yet. Threads
+ *        waiting for the pool to become idle are parked on it.
+ * @param num_idle_waiters
+ *        The number of threads parked until the pool becomes idle.
+ ********************************************************************************/
+struct thread_pool {
+    struct mpmc_queue* queue;
+    struct thread_pool_worker* workers;
+    struct counting_semaphore* wake_sem;
+    struct counting_semaphore_storage wake_sem_storage;
+    uint16_t num_threads;
+    _Atomic bool running;
+    SYNC_CACHE_ALIGNED _Atomic uint32_t num_sleeping;
+    SYNC_CACHE_ALIGNED _Atomic uint32_t num_pending;
+    _Atomic uint32_t num_idle_waiters;
+};
+
+/********************************************************************************
+ * @brief The worker of the calling thread, nullptr if it isn't a worker.
+ ********************************************************************************/
+static _Thread_local struct thread_pool_worker* thread_pool_current_worker = 0;
+
+/********************************************************************************
+ * @brief Pushes specified task onto the bottom of the deque of referenced
+ *        worker. Only called by the owner.
+ *
+ * @param self
+ *        Reference to the worker.
+ * @param task
+ *        Reference to the task.
+ * @return
+ *        True if the task was pushed, false if the deque is full.
+ ********************************************************************************/
+static bool thread_pool_deque_push(struct thread_pool_worker* self, const struct thread_pool_task* task) {
+    const int64_t b = atomic_load_explicit(&self->bottom, memory_order_relaxed);
+    const int64_t t = atomic_load_explicit(&self->top, memory_order_acquire);
+    if (b - t >= (int64_t)THREAD_POOL_DEQUE_CAPACITY) return false;
+    struct thread_pool_slot* slot = &self->slots[b & (THREAD_POOL_DEQUE_CAPACITY - 1)];
+    atomic_store_explicit(&slot->arg, task->arg, memory_order_relaxed);
+    atomic_store_explicit(&slot->function, task->function, memory_order_release);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&self->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+/********************************************************************************
+ * @brief Pops the newest task from the bottom of the deque of referenced
+ *        worker. Only called by the owner.
+ *
+ * @note  If a single task is left, the owner races with the thieves for it via
+ *        the top index. Either way the bottom index is restored, so that the
+ *        deque is left empty.
+ *
+ * @param self
+ *        Reference to the worker.
+ * @param task
+ *        Reference to the task to fill.
+ * @return
+ *        True if a task was popped, false if the deque is empty.
+ ********************************************************************************/
+static bool thread_pool_deque_pop(struct thread_pool_worker* self, struct thread_pool_task* task) {
+    const int64_t b = atomic_load_explicit(&self->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&self->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&self->top, memory_order_relaxed);
+    if (t > b) {
+        atomic_store_explicit(&self->bottom, b + 1, memory_order_relaxed);
+        return false;
+    }
+    struct thread_pool_slot* slot = &self->slots[b & (THREAD_POOL_DEQUE_CAPACITY - 1)];
+    task->function = atomic_load_explicit(&slot->function, memory_order_relaxed);
+    task->arg = atomic_load_explicit(&slot->arg, memory_order_relaxed);
+    if (t < b) return true;
+    const bool won = atomic_compare_exchange_strong_explicit(&self->top, &t, t + 1,
+                                                             memory_order_seq_cst, memory_order_relaxed);
+    atomic_store_explicit(&self->bottom, b + 1, memory_order_relaxed);
+    return won;
+}
+
+/********************************************************************************
+ * @brief Steals the oldest task from the top of the deque of referenced
+ *        worker.
+ *
+ * @param self
+ *        Reference to the worker.
+ * @param task
+ *        Reference to the task to fill.
+ * @return
+ *        True if a task was stolen, false if the deque is empty or if another
+ *        thread took the task first.
+ ********************************************************************************/
+static bool thread_pool_deque_steal(struct thread_pool_worker* self, struct thread_pool_task* task) {
+    int64_t t = atomic_load_explicit(&self->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    const int64_t b = atomic_load_explicit(&self->bottom, memory_order_acquire);
+    if (t >= b) return false;
+    struct thread_pool_slot* slot = &self->slots[t & (THREAD_POOL_DEQUE_CAPACITY - 1)];
+    task->function = atomic_load_explicit(&slot->function, memory_order_acquire);
+    task->arg = atomic_load_explicit(&slot->arg, memory_order_relaxed);
+    return atomic_compare_exchange_strong_explicit(&self->top, &t, t + 1,
+                                                   memory_order_seq_cst, memory_order_relaxed);
+}
+
+/********************************************************************************
+ * @brief Indicates if any task is queued in referenced thread pool.
+ *
+ * @param self
+ *        Reference to the thread pool.
+ * @return
+ *        True if the shared queue or any deque holds a task, else false.
+ ********************************************************************************/
+static bool thread_pool_has_work(struct thread_pool* self) {
+    if (mpmc_queue_size(self->queue) != 0) return true;
+    for (uint16_t i = 0; i < self->num_threads; ++i) {
+        if (atomic_load_explicit(&self->workers[i].bottom, memory_order_seq_cst) >
+            atomic_load_explicit(&self->workers[i].top, memory_order_seq_cst)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/********************************************************************************
+ * @brief Wakes a parked worker of referenced thread pool, if any.
+ *
+ * @note  The fence orders the preceding push before the check of the sleeping
+ *        workers. Together with the fence of the worker, either we see the
+ *        worker, or the worker sees the pushed task. We claim a registration
+ *        before we release the semaphore once.
+ *
+ * @param self
+ *        Reference to the thread pool.
+ ********************************************************************************/
+static void thread_pool_wake(struct thread_pool* self) {
+    atomic_thread_fence(memory_order_seq_cst);
+    uint32_t num_parked = atomic_load_explicit(&self->num_sleeping, memory_order_relaxed);
+    while (num_parked > 0) {
+        if (atomic_compare_exchange_weak_explicit(&self->num_sleeping, &num_parked, num_parked - 1,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            counting_semaphore_release(self->wake_sem);
+            return;
+        }
+    }
+}
+
+/********************************************************************************
+ * @brief Parks the calling worker of referenced thread pool on the wake
+ *        semaphore.
+ *
+ * @note 1. We register as sleeping before we check for tasks for the last
+ *          time, so a submitter either sees the registration or we see the
+ *          task. If no task is queued and the pool is running, we park.
+ *       2. Else we cancel the wait by withdrawing a registration. If all
+ *          registrations are claimed, a submitter is about to release the
+ *          semaphore for us, so we consume that resource to keep both counts
+ *          equal.
+ *
+ * @param self
+ *        Reference to the thread pool.
+ ********************************************************************************/
+static void thread_pool_park(struct thread_pool* self) {
+    atomic_fetch_add_explicit(&self->num_sleeping, 1, memory_order_seq_cst);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&self->running, memory_order_seq_cst) && !thread_pool_has_work(self)) {
+        counting_semaphore_take(self->wake_sem);
+        return;
+    }
+    uint32_t num_parked = atomic_load_explicit(&self->num_sleeping, memory_order_relaxed);
+    while (num_parked > 0) {
+        if (atomic_compare_exchange_weak_explicit(&self->num_sleeping, &num_parked, num_parked - 1,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            return;
+        }
+    }
+    counting_semaphore_take(self->wake_sem);
+}
+
+/********************************************************************************
+ * @brief Records that a task has returned. If it was the last pending task,
+ *        threads waiting for the pool to become idle are woken.
+ *
+ * @param self
+ *        Reference to the thread pool.
+ ********************************************************************************/
+static inline void thread_pool_complete(struct thread_pool* self) {
+    if (atomic_fetch_sub_explicit(&self->num_pending, 1, memory_order_seq_cst) == 1 &&
+        atomic_load_explicit(&self->num_idle_waiters, memory_order_seq_cst)) {
+        futex_wake(&self->num_pending, INT_MAX);
+    }
+}
+
+/********************************************************************************
+ * @brief Searches a task for referenced worker.
+ *
+ * @note 1. We pop the newest task of our own deque.
+ *       2. Else we dequeue a task from the shared queue.
+ *       3. Else we try to steal the oldest task of every other worker,
+ *          starting at a random victim, so that thieves spread out.
+ *
+ * @param self
+ *        Reference to the worker.
+ * @param task
+ *        Reference to the task to fill.
+ * @return
+ *        True if a task was found, else false.
+ ********************************************************************************/
+static bool thread_pool_find(struct thread_pool_worker* self, struct thread_pool_task* task) {
+    struct thread_pool* pool = self->pool;
+    if (thread_pool_deque_pop(self, task) || mpmc_queue_try_pop(pool->queue, task)) return true;
+    self->rng ^= self->rng << 13;
+    self->rng ^= self->rng >> 17;
+    self->rng ^= self->rng << 5;
+    for (uint16_t i = 0; i < pool->num_threads; ++i) {
+        struct thread_pool_worker* victim = &pool->workers[(self->rng + i) % pool->num_threads];
+        if (victim != self && thread_pool_deque_steal(victim, task)) return true;
+    }
+    return false;
+}
+
+/********************************************************************************
+ * @brief Runs a worker thread of the thread pool.
+ *
+ * @note 1. As long as tasks can be found, we run them one by one.
+ *       2. If the thread pool is being deleted, we return once no task is
+ *          left. The running flag is read before the tasks are searched, so
+ *          tasks submitted before the deletion are never lost.
+ *       3. Else we spin with exponential backoff for a bounded number of
+ *          iterations, then we park on the wake semaphore.
+ *
+ * @param arg
+ *        Reference to the worker.
+ * @return
+ *        A nullptr.
+ ********************************************************************************/
+static void* thread_pool_run(void* arg) {
+    struct thread_pool_worker* self = (struct thread_pool_worker*)arg;
+    struct thread_pool_task task;
+    uint16_t spins = 0;
+    thread_pool_current_worker = self;
+    while (1) {
+        const bool stopping = !atomic_load_explicit(&self->pool->running, memory_order_acquire);
+        if (thread_pool_find(self, &task)) {
+            task.function(task.arg);
+            thread_pool_complete(self->pool);
+            spins = 0;
+            continue;
+        }
+        if (stopping) break;
+        if (spins < BACKOFF_SPIN_LIMIT_DEFAULT) {
+            backoff_pause(spins++);
+            continue;
+        }
+        thread_pool_park(self->pool);
+    }
+    thread_pool_current_worker = 0;
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Pins the worker created with specified thread attributes to the CPU
+ *        of specified index among the CPUs the process may run on (round 
+ *        robin). The affinity is set in the attributes, so the worker runs on
+ *        its CPU from the start and touches its deque and stack there, on the
+ *        memory of its NUMA node. Failures are ignored.
+ *
+ * @param attributes
+ *        Reference to the attributes the worker thread is created with.
+ * @param index
+ *        The index of the worker.
+ ********************************************************************************/
+static void thread_pool_pin(pthread_attr_t* attributes, const uint16_t index) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) return;
+    int target = index % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_attr_setaffinity_np(attributes, sizeof(set), &set);
+            return;
+        }
+    }
+}
+
+/********************************************************************************
+ * @brief Deallocates referenced thread pool and its members.
+ *
+ * @param self
+ *        Reference to the thread pool.
+ ********************************************************************************/
+static void thread_pool_free(struct thread_pool* self) {
+    mpmc_queue_delete(&self->queue);
+    if (self->wake_sem) counting_semaphore_destroy(self->wake_sem);
+    free(self->workers);
+    free(self);
+}
+
+/********************************************************************************
+ * @brief Stops and joins the first specified number of worker threads and
+ *        deallocates referenced thread pool.
+ *
+ * @note  All registrations of parking workers are claimed at once and the
+ *        semaphore is released as many times. Workers registering later see
+ *        the cleared running flag and cancel their wait.
+ *
+ * @param self
+ *        Reference to the thread pool.
+ * @param num_started
+ *        The number of worker threads that were started.
+ ********************************************************************************/
+static void thread_pool_stop(struct thread_pool* self, const uint16_t num_started) {
+    atomic_store_explicit(&self->running, false, memory_order_seq_cst);
+    const uint32_t num_parked = atomic_exchange_explicit(&self->num_sleeping, 0, memory_order_seq_cst);
+    if (num_parked) counting_semaphore_release_n(self->wake_sem, (uint16_t)num_parked);
+    for (uint16_t i = 0; i < num_started; ++i) {
+        pthread_join(self->workers[i].thread, 0);
+    }
+    thread_pool_free(self);
+}
+
+/********************************************************************************
+ * @brief Provides the lowest power of two not less than specified number.
+ *
+ * @param num
+ *        The number.
+ * @return
+ *        The power of two, at least 2.
+ ********************************************************************************/
+static inline uint32_t thread_pool_round_up(const uint32_t num) {
+    uint32_t power = 2;
+    while (power < num && power < (UINT32_C(1) << 31)) power <<= 1;
+    return power;
+}
+
+/********************************************************************************
+ * @note 1. We allocate the thread pool and the workers, aligned to a cache
+ *          line, and the shared queue, and we initialize the wake semaphore
+ *          inline. Zero-initialized options select the defaults. If any
+ *          allocation fails, we return a nullptr.
+ *       2. We reserve all resources of the wake semaphore, so that workers
+ *          park on it until a submitter releases it.
+ *       3. We start the worker threads, pinned via their thread attributes if
+ *          requested. If a thread cannot be created, we stop the threads 
+ *          started so far and return a nullptr.
+ ********************************************************************************/
+struct thread_pool* thread_pool_new(const struct thread_pool_options* options) {
+    struct thread_pool* self = (struct thread_pool*)aligned_alloc(SYNC_CACHE_LINE_SIZE, sizeof(struct thread_pool));
+    if (!self) return 0;
+    const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    const struct counting_semaphore_options sem_options = {SEMAPHORE_WAIT_PARK, 0, "thread_pool", SEMAPHORE_FAIR_NONE};
+    self->num_threads = options && options->num_threads ? options->num_threads :
+                        (uint16_t)(num_cpus > 0 && num_cpus < UINT16_MAX ? num_cpus : 1);
+    self->queue = mpmc_queue_new(thread_pool_round_up(options && options->capacity ?
+                                                      options->capacity : THREAD_POOL_CAPACITY_DEFAULT),
+                                 sizeof(struct thread_pool_task));
+    self->workers = (struct thread_pool_worker*)aligned_alloc(SYNC_CACHE_LINE_SIZE,
+                                                              self->num_threads * sizeof(struct thread_pool_worker));
+    self->wake_sem = counting_semaphore_init(&self->wake_sem_storage, self->num_threads, &sem_options);
+    if (!self->queue || !self->workers || !self->wake_sem) {
+        thread_pool_free(self);
+        return 0;
+    }
+    counting_semaphore_take_n(self->wake_sem, self->num_threads);
+    atomic_init(&self->running, true);
+    atomic_init(&self->num_sleeping, 0);
+    atomic_init(&self->num_pending, 0);
+    atomic_init(&self->num_idle_waiters, 0);
+    for (uint16_t i = 0; i < self->num_threads; ++i) {
+        struct thread_pool_worker* worker = &self->workers[i];
+        atomic_init(&worker->top, 0);
+        atomic_init(&worker->bottom, 0);
+        worker->pool = self;
+        worker->rng = i + 1U;
+    }
+    for (uint16_t i = 0; i < self->num_threads; ++i) {
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        if (options && options->pin_threads) thread_pool_pin(&attributes, i);
+        const int result = pthread_create(&self->workers[i].thread, &attributes, thread_pool_run, &self->workers[i]);
+        pthread_attr_destroy(&attributes);
+        if (result != 0) {
+            thread_pool_stop(self, i);
+            return 0;
+        }
+    }
+    return self;
+}
+
+/********************************************************************************
+ * @note 1. We clear the running flag and wake all parked workers, which run
+ *          the remaining tasks before they return.
+ *       2. We join the workers and deallocate the thread pool.
+ *       3. Sets the thread pool pointer to null via the double pointer.
+ ********************************************************************************/
+void thread_pool_delete(struct thread_pool** self) {
+    if (*self) thread_pool_stop(*self, (*self)->num_threads);
+    *self = 0;
+}
+
+/********************************************************************************
+ * @note 1. If no function was specified, we return false.
+ *       2. We register the task as pending. If we are a worker of the pool, we
+ *          push the task onto our own deque.
+ *       3. Else, or if the deque is full, we enqueue the task in the shared
+ *          queue. While the queue is full, we wake a worker and spin with
+ *          exponential backoff.
+ *       4. We wake a parked worker, if any.
+ ********************************************************************************/
+bool thread_pool_submit(struct thread_pool* self, void (*task)(void* arg), void* arg) {
+    if (!task) return false;
+    const struct thread_pool_task entry = {task, arg};
+    struct thread_pool_worker* worker = thread_pool_current_worker;
+    atomic_fetch_add_explicit(&self->num_pending, 1, memory_order_relaxed);
+    if (!worker || worker->pool != self || !thread_pool_deque_push(worker, &entry)) {
+        uint16_t spins = 0;
+        while (!mpmc_queue_try_push(self->queue, &entry)) {
+            thread_pool_wake(self);
+            backoff_pause(spins);
+            if (spins < UINT16_MAX) spins++;
+        }
+    }
+    thread_pool_wake(self);
+    return true;
+}
+
+/********************************************************************************
+ * @note 1. We register as an idle waiter and park as long as any task is
+ *          pending. The counters are accessed with sequential consistency, so
+ *          the wake-up of the last task cannot be missed.
+ ********************************************************************************/
+void thread_pool_wait_idle(struct thread_pool* self) {
+    atomic_fetch_add_explicit(&self->num_idle_waiters, 1, memory_order_seq_cst);
+    uint32_t pending;
+    while ((pending = atomic_load_explicit(&self->num_pending, memory_order_seq_cst)) != 0) {
+        futex_wait(&self->num_pending, pending);
+    }
+    atomic_fetch_sub_explicit(&self->num_idle_waiters, 1, memory_order_relaxed);
+}
+
+/********************************************************************************
+ * @note 1. We return the number of worker threads.
+ ********************************************************************************/
+uint16_t thread_pool_num_threads(const struct thread_pool* self) {
+    return self->num_threads;
+}
@@ -0,0 +1,41 @@
+/********************************************************************************
+ * @brief Assertions shared by the tests of the synchronization primitives. A
+ *        failed assertion prints its location and terminates the test with a
+ *        non-zero exit code, so that a failure in any thread fails the test.
+ ********************************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/********************************************************************************
+ * @brief Terminates the test if specified condition doesn't hold.
+ *
+ * @param condition
+ *        The condition to check.
+ ********************************************************************************/
+#define TEST_ASSERT(condition) do {                                                 \
+    if (!(condition)) {                                                             \
+        fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__,       \
+                #condition);                                                        \
+        exit(1);                                                                    \
+    }                                                                               \
+} while (0)
+
+/********************************************************************************
+ * @brief Terminates the test if specified values differ.
+ *
+ * @param actual
+ *        The value produced by the test.
+ * @param expected
+ *        The expected value.
+ ********************************************************************************/
+#define TEST_ASSERT_EQUAL(actual, expected) do {                                    \
+    const long long test_actual_ = (long long)(actual);                            \
+    const long long test_expected_ = (long long)(expected);                        \
+    if (test_actual_ != test_expected_) {                                           \
+        fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__,   \
+                #actual, test_actual_, test_expected_);                             \
+        exit(1);                                                                    \
+    }                                                                               \
+} while (0)
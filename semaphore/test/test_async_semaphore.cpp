@@ -0,0 +1,200 @@
+/********************************************************************************
+ * @brief Test of the coroutine-aware counting semaphore. Verifies that
+ *            - suspended coroutines are resumed in FIFO order when resumed
+ *              inline by the releasing thread.
+ *            - a resource released to a waiter that isn't pushed yet is handed
+ *              over once the waiter is pushed, and the release doesn't wait.
+ *            - no more than the available resources are held at any time by
+ *              coroutines resumed on a thread pool, that a single resource
+ *              excludes all other coroutines, such that data written by one
+ *              holder is visible to the next, and that every coroutine
+ *              completes and all resources are available again afterwards.
+ ********************************************************************************/
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+#include <sync/async_semaphore.h>
+#include <sync/thread_pool.h>
+#include "test.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief Coroutine type starting eagerly and destroying its frame once done.
+ ********************************************************************************/
+struct detached_task {
+    struct promise_type {
+        detached_task get_return_object(void) noexcept { return {}; }
+        std::suspend_never initial_suspend(void) noexcept { return {}; }
+        std::suspend_never final_suspend(void) noexcept { return {}; }
+        void return_void(void) noexcept {}
+        void unhandled_exception(void) noexcept { std::terminate(); }
+    };
+};
+
+/********************************************************************************
+ * @brief The number of coroutines of the tests.
+ ********************************************************************************/
+constexpr uint32_t num_coroutines{1000};
+
+/********************************************************************************
+ * @brief The number of acquisitions of each coroutine of the thread pool test.
+ ********************************************************************************/
+constexpr uint32_t num_takes_per_coroutine{50};
+
+/********************************************************************************
+ * @brief Takes the semaphore once, records the order of the resumption and
+ *        releases the semaphore.
+ *
+ * @param sem
+ *        Reference to the semaphore.
+ * @param id
+ *        The index of the coroutine.
+ * @param order
+ *        Reference to the indices in order of acquisition.
+ ********************************************************************************/
+detached_task TakeInOrder(async_counting_semaphore<2>& sem, const uint32_t id, std::vector<uint32_t>& order) {
+    co_await sem.take();
+    order.push_back(id);
+    sem.release();
+}
+
+/********************************************************************************
+ * @brief Awaiter taking the semaphore, which releases the semaphore after the
+ *        resource was found unavailable but before the coroutine is suspended.
+ ********************************************************************************/
+struct ReleaseBeforeSuspend {
+    bool await_ready(void) noexcept { return take.await_ready(); }
+    void await_suspend(const std::coroutine_handle<> handle) noexcept {
+        sem.release();
+        take.await_suspend(handle);
+    }
+    void await_resume(void) noexcept { take.await_resume(); }
+
+    async_counting_semaphore<1>& sem;             /* The semaphore. */
+    async_counting_semaphore<1>::awaiter take;    /* The awaiter of the take. */
+};
+
+/********************************************************************************
+ * @brief Takes the held semaphore, whose resource is released before the
+ *        coroutine is suspended, and releases it.
+ *
+ * @param sem
+ *        Reference to the semaphore.
+ * @param num_done
+ *        Reference to the number of completed coroutines.
+ ********************************************************************************/
+detached_task TakeReleasedLate(async_counting_semaphore<1>& sem, uint32_t& num_done) {
+    co_await ReleaseBeforeSuspend{sem, sem.take()};
+    num_done++;
+    sem.release();
+}
+
+/********************************************************************************
+ * @brief Takes both semaphores repeatedly, resumed on the thread pool,
+ *        verifying the number of holders.
+ *
+ * @param pool
+ *        Reference to the thread pool resuming the coroutine.
+ * @param sem
+ *        Reference to the semaphore with several resources.
+ * @param mutex
+ *        Reference to the semaphore with a single resource.
+ * @param num_inside
+ *        Reference to the number of holders of the semaphore.
+ * @param num_takes
+ *        Reference to the counter guarded by the single resource.
+ * @param num_done
+ *        Reference to the number of completed coroutines.
+ ********************************************************************************/
+detached_task TakeOnPool(thread_pool<4096>& pool, async_counting_semaphore<3>& sem, async_counting_semaphore<1>& mutex,
+                         std::atomic<uint32_t>& num_inside, uint32_t& num_takes, std::atomic<uint32_t>& num_done) {
+    for (uint32_t i{}; i < num_takes_per_coroutine; ++i) {
+        co_await sem.take(pool);
+        TEST_ASSERT(num_inside.fetch_add(1) < 3);
+        num_inside.fetch_sub(1);
+        sem.release();
+
+        co_await mutex.take(pool);
+        num_takes++;
+        mutex.release();
+    }
+    num_done.fetch_add(1);
+}
+
+/********************************************************************************
+ * @brief Suspends coroutines on a semaphore whose resources are held and
+ *        verifies that they are resumed in the order they were suspended.
+ ********************************************************************************/
+void TestFifoOrder(void) {
+    async_counting_semaphore<2> sem{"test_async_semaphore"};
+    TEST_ASSERT(sem.try_take() && sem.try_take());
+    TEST_ASSERT(!sem.try_take());
+    std::vector<uint32_t> order{};
+    for (uint32_t id{}; id < num_coroutines; ++id) TakeInOrder(sem, id, order);
+    TEST_ASSERT(order.empty());
+    TEST_ASSERT_EQUAL(sem.num_available_resources(), 0);
+    sem.release();
+    sem.release();
+    TEST_ASSERT_EQUAL(order.size(), num_coroutines);
+    for (uint32_t id{}; id < num_coroutines; ++id) TEST_ASSERT_EQUAL(order[id], id);
+    TEST_ASSERT_EQUAL(sem.num_available_resources(), 2);
+}
+
+/********************************************************************************
+ * @brief Releases the resource of a semaphore while a coroutine is about to be
+ *        suspended on it, and verifies that the coroutine receives it.
+ ********************************************************************************/
+void TestLateWaiter(void) {
+    async_counting_semaphore<1> sem{"test_async_semaphore"};
+    uint32_t num_done{};
+    for (uint32_t i{}; i < num_coroutines; ++i) {
+        TEST_ASSERT(sem.try_take());
+        TakeReleasedLate(sem, num_done);
+        TEST_ASSERT_EQUAL(num_done, i + 1);
+        TEST_ASSERT_EQUAL(sem.num_available_resources(), 1);
+    }
+}
+
+/********************************************************************************
+ * @brief Starts coroutines from several threads, which are resumed on a
+ *        thread pool, and verifies the holders of the semaphores.
+ ********************************************************************************/
+void TestThreadPool(void) {
+    async_counting_semaphore<3> sem{"test_async_semaphore"};
+    async_counting_semaphore<1> mutex{"test_async_mutex"};
+    std::atomic<uint32_t> num_inside{}, num_done{};
+    uint32_t num_takes{};
+    {
+        thread_pool<4096> pool{4};
+        std::vector<std::thread> threads{};
+        for (uint32_t i{}; i < 4; ++i) {
+            threads.emplace_back([&]() {
+                for (uint32_t j{}; j < num_coroutines / 4; ++j) {
+                    TakeOnPool(pool, sem, mutex, num_inside, num_takes, num_done);
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        while (num_done.load() < num_coroutines) std::this_thread::yield();
+        pool.wait_idle();
+    }
+    TEST_ASSERT_EQUAL(num_done.load(), num_coroutines);
+    TEST_ASSERT_EQUAL(num_takes, num_coroutines * num_takes_per_coroutine);
+    TEST_ASSERT_EQUAL(sem.num_available_resources(), 3);
+    TEST_ASSERT_EQUAL(mutex.num_available_resources(), 1);
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the FIFO test, the late waiter test and the thread pool test.
+ ********************************************************************************/
+int main(void) {
+    TestFifoOrder();
+    TestLateWaiter();
+    TestThreadPool();
+    return 0;
+}
@@ -0,0 +1,133 @@
+/********************************************************************************
+ * @brief Test of the barrier and the latch in C. Verifies that
+ *            - no thread leaves a barrier phase before all threads have
+ *              arrived, that the completion function runs once per phase
+ *              while the other threads wait, and that writes made before the
+ *              arrival are visible to all threads after the phase.
+ *            - no thread leaves a latch before the counter has reached zero,
+ *              and that writes made before the count down are visible to all
+ *              threads released by the latch.
+ ********************************************************************************/
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sync/semaphore.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of threads arriving at the barrier and the latch.
+ ********************************************************************************/
+#define NUM_THREADS 6U
+
+/********************************************************************************
+ * @brief The number of barrier phases.
+ ********************************************************************************/
+#define NUM_PHASES 500U
+
+/********************************************************************************
+ * @brief The barrier and the latch under test.
+ ********************************************************************************/
+static struct barrier* phase_barrier = 0;
+static struct latch* start_latch = 0;
+
+/********************************************************************************
+ * @brief The phase each thread has written last, before arriving.
+ ********************************************************************************/
+static _Atomic uint32_t arrived_phase[NUM_THREADS];
+
+/********************************************************************************
+ * @brief The number of runs of the completion function and the number of
+ *        threads the barrier reported as completing a phase.
+ ********************************************************************************/
+static uint32_t num_completions = 0;
+static _Atomic uint32_t num_serial_threads = 0;
+
+/********************************************************************************
+ * @brief Data written non-atomically by each thread before the latch.
+ ********************************************************************************/
+static bool ready[NUM_THREADS];
+
+/********************************************************************************
+ * @brief Completion function of the barrier, verifying that all threads have
+ *        arrived in the phase being completed.
+ ********************************************************************************/
+static void complete_phase(void* context) {
+    uint32_t* completions = (uint32_t*)context;
+    ++*completions;
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) {
+        TEST_ASSERT_EQUAL(atomic_load_explicit(&arrived_phase[i], memory_order_relaxed), *completions);
+    }
+}
+
+/********************************************************************************
+ * @brief Arrives at the barrier in each phase, verifying that the phase was
+ *        completed by all threads.
+ ********************************************************************************/
+static void* run_phases(void* arg) {
+    const uint32_t index = (uint32_t)(uintptr_t)arg;
+    for (uint32_t phase = 1; phase <= NUM_PHASES; ++phase) {
+        atomic_store_explicit(&arrived_phase[index], phase, memory_order_relaxed);
+        if (barrier_arrive_and_wait(phase_barrier)) atomic_fetch_add(&num_serial_threads, 1);
+        for (uint32_t i = 0; i < NUM_THREADS; ++i) {
+            TEST_ASSERT(atomic_load_explicit(&arrived_phase[i], memory_order_relaxed) >= phase);
+        }
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Marks the calling thread as ready and waits for the others at the
+ *        latch.
+ ********************************************************************************/
+static void* arrive_at_latch(void* arg) {
+    const uint32_t index = (uint32_t)(uintptr_t)arg;
+    ready[index] = true;
+    TEST_ASSERT(latch_arrive_and_wait(start_latch, 1));
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) TEST_ASSERT(ready[i]);
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Waits at the latch without counting down.
+ ********************************************************************************/
+static void* wait_at_latch(void* arg) {
+    (void)arg;
+    latch_wait(start_latch);
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) TEST_ASSERT(ready[i]);
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs the barrier test and the latch test.
+ ********************************************************************************/
+int main(void) {
+    TEST_ASSERT(barrier_new(0, 0, 0) == 0);
+    phase_barrier = barrier_new(NUM_THREADS, complete_phase, &num_completions);
+    TEST_ASSERT(phase_barrier != 0);
+    pthread_t threads[2 * NUM_THREADS];
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) {
+        TEST_ASSERT(pthread_create(&threads[i], 0, run_phases, (void*)(uintptr_t)i) == 0);
+    }
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) pthread_join(threads[i], 0);
+    TEST_ASSERT_EQUAL(num_completions, NUM_PHASES);
+    TEST_ASSERT_EQUAL(atomic_load(&num_serial_threads), NUM_PHASES);
+    TEST_ASSERT_EQUAL(barrier_phase(phase_barrier), NUM_PHASES);
+    barrier_delete(&phase_barrier);
+    TEST_ASSERT(phase_barrier == 0);
+
+    start_latch = latch_new(NUM_THREADS);
+    TEST_ASSERT(start_latch != 0);
+    TEST_ASSERT(!latch_try_wait(start_latch));
+    TEST_ASSERT(!latch_count_down(start_latch, NUM_THREADS + 1));
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) {
+        TEST_ASSERT(pthread_create(&threads[i], 0, arrive_at_latch, (void*)(uintptr_t)i) == 0);
+        TEST_ASSERT(pthread_create(&threads[NUM_THREADS + i], 0, wait_at_latch, 0) == 0);
+    }
+    for (uint32_t i = 0; i < 2 * NUM_THREADS; ++i) pthread_join(threads[i], 0);
+    TEST_ASSERT(latch_try_wait(start_latch));
+    TEST_ASSERT(!latch_count_down(start_latch, 1));
+    latch_delete(&start_latch);
+    TEST_ASSERT(start_latch == 0);
+    return 0;
+}
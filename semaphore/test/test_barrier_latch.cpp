@@ -0,0 +1,108 @@
+/********************************************************************************
+ * @brief Test of the barrier and the latch in C++. Verifies that
+ *            - no thread leaves a barrier phase before all threads have
+ *              arrived, that the completion function runs once per phase
+ *              while the other threads wait, and that writes made before the
+ *              arrival are visible to all threads after the phase.
+ *            - no thread leaves a latch before the counter has reached zero,
+ *              and that writes made before the count down are visible to all
+ *              threads released by the latch.
+ ********************************************************************************/
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <sync/semaphore.h>
+#include "test.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief The number of threads arriving at the barrier and the latch.
+ ********************************************************************************/
+constexpr uint32_t num_threads{6};
+
+/********************************************************************************
+ * @brief The number of barrier phases.
+ ********************************************************************************/
+constexpr uint32_t num_phases{500};
+
+/********************************************************************************
+ * @brief The phase each thread has written last, before arriving.
+ ********************************************************************************/
+std::atomic<uint32_t> arrived_phase[num_threads]{};
+
+/********************************************************************************
+ * @brief Completion function of the barrier, verifying that all threads have
+ *        arrived in the phase being completed.
+ ********************************************************************************/
+struct phase_check {
+    uint32_t* num_completions;
+
+    void operator()(void) noexcept {
+        ++*num_completions;
+        for (const auto& phase : arrived_phase) {
+            TEST_ASSERT_EQUAL(phase.load(std::memory_order_relaxed), *num_completions);
+        }
+    }
+};
+
+/********************************************************************************
+ * @brief Runs the threads through the phases of a barrier.
+ ********************************************************************************/
+void TestBarrier(void) {
+    uint32_t num_completions{};
+    std::atomic<uint32_t> num_serial_threads{};
+    barrier<phase_check> phases{num_threads, phase_check{&num_completions}};
+    std::vector<std::thread> threads{};
+    for (uint32_t i{}; i < num_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            for (uint32_t phase{1}; phase <= num_phases; ++phase) {
+                arrived_phase[i].store(phase, std::memory_order_relaxed);
+                if (phases.arrive_and_wait()) num_serial_threads.fetch_add(1);
+                for (const auto& arrived : arrived_phase) {
+                    TEST_ASSERT(arrived.load(std::memory_order_relaxed) >= phase);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    TEST_ASSERT_EQUAL(num_completions, num_phases);
+    TEST_ASSERT_EQUAL(num_serial_threads.load(), num_phases);
+    TEST_ASSERT_EQUAL(phases.phase(), num_phases);
+}
+
+/********************************************************************************
+ * @brief Releases counting and waiting threads via a latch.
+ ********************************************************************************/
+void TestLatch(void) {
+    latch start{num_threads};
+    bool ready[num_threads]{};
+    TEST_ASSERT(!start.try_wait());
+    TEST_ASSERT(!start.count_down(num_threads + 1));
+    std::vector<std::thread> threads{};
+    for (uint32_t i{}; i < num_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            ready[i] = true;
+            TEST_ASSERT(start.arrive_and_wait());
+            for (const auto flag : ready) TEST_ASSERT(flag);
+        });
+        threads.emplace_back([&]() {
+            start.wait();
+            for (const auto flag : ready) TEST_ASSERT(flag);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    TEST_ASSERT(start.try_wait());
+    TEST_ASSERT(!start.count_down());
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the barrier test and the latch test.
+ ********************************************************************************/
+int main(void) {
+    TestBarrier();
+    TestLatch();
+    return 0;
+}
@@ -0,0 +1,239 @@
+/********************************************************************************
+ * @brief Test of the binary semaphores. Verifies that
+ *            - a binary semaphore excludes all other threads, such that data
+ *              written by one holder is visible to the next, while threads
+ *              contend for semaphores sharing a bitmap word.
+ *            - semaphores reserved together via a mask exclude threads that
+ *              reserve them one at a time, also if the mask spans several 
+ *              shards and the other threads take the IDs in reverse order,
+ *              which would deadlock if the mask was not reserved all at once.
+ *            - the semaphores are independent of each other, also across the 
+ *              boundaries of shards, so that all of them can be held at once.
+ *            - invalid semaphore identifiers and masks are rejected.
+ ********************************************************************************/
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sync/semaphore.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of threads contending for the semaphores.
+ ********************************************************************************/
+#define NUM_THREADS 6U
+
+/********************************************************************************
+ * @brief The number of semaphores the threads contend for.
+ ********************************************************************************/
+#define NUM_IDS 4U
+
+/********************************************************************************
+ * @brief The number of reservations of each thread.
+ ********************************************************************************/
+#define NUM_TAKES_PER_THREAD 50000U
+
+/********************************************************************************
+ * @brief The lower of the IDs reserved via a mask spanning two shards.
+ ********************************************************************************/
+#define SHARDED_ID_LOW 20U
+
+/********************************************************************************
+ * @brief The higher of the IDs reserved via a mask spanning two shards.
+ ********************************************************************************/
+#define SHARDED_ID_HIGH 39U
+
+/********************************************************************************
+ * @brief The number of holders of each semaphore.
+ ********************************************************************************/
+static _Atomic uint32_t num_inside[BINARY_SEMAPHORE_LIMIT];
+
+/********************************************************************************
+ * @brief Counters incremented non-atomically by the holders of each semaphore.
+ ********************************************************************************/
+static uint32_t num_takes[BINARY_SEMAPHORE_LIMIT];
+
+/********************************************************************************
+ * @brief Records that the calling thread holds semaphore with specified ID,
+ *        verifying that no other thread holds it.
+ ********************************************************************************/
+static void enter(const uint16_t id) {
+    TEST_ASSERT_EQUAL(atomic_fetch_add(&num_inside[id], 1), 0);
+    num_takes[id]++;
+}
+
+/********************************************************************************
+ * @brief Records that the calling thread no longer holds semaphore with 
+ *        specified ID.
+ ********************************************************************************/
+static void leave(const uint16_t id) {
+    atomic_fetch_sub(&num_inside[id], 1);
+}
+
+/********************************************************************************
+ * @brief Starts a thread per index running specified function, waits for all 
+ *        of them and clears the counters afterwards.
+ *
+ * @param function
+ *        The function run by each thread, which is passed the thread index.
+ * @param expected_takes
+ *        The expected number of reservations of each of the specified IDs.
+ * @param ids
+ *        The IDs whose number of reservations to verify.
+ * @param num_ids
+ *        The number of IDs.
+ ********************************************************************************/
+static void run_threads(void* (*function)(void*), const uint32_t expected_takes, const uint16_t* ids,
+                        const uint32_t num_ids) {
+    pthread_t threads[NUM_THREADS];
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) {
+        TEST_ASSERT(pthread_create(&threads[i], 0, function, (void*)(uintptr_t)i) == 0);
+    }
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) pthread_join(threads[i], 0);
+    for (uint32_t i = 0; i < num_ids; ++i) {
+        TEST_ASSERT_EQUAL(num_takes[ids[i]], expected_takes);
+        num_takes[ids[i]] = 0;
+    }
+}
+
+/********************************************************************************
+ * @brief Reserves the semaphores round robin, verifying that each semaphore
+ *        has a single holder.
+ ********************************************************************************/
+static void* take_ids(void* arg) {
+    const uint32_t index = (uint32_t)(uintptr_t)arg;
+    for (uint32_t i = 0; i < NUM_TAKES_PER_THREAD; ++i) {
+        const uint16_t id = (uint16_t)((i + index) % NUM_IDS);
+        TEST_ASSERT(binary_semaphore_take(id));
+        enter(id);
+        leave(id);
+        TEST_ASSERT(binary_semaphore_release(id));
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Reserves all semaphores at once via a mask in threads with an even 
+ *        index and one at a time round robin in the other threads.
+ ********************************************************************************/
+static void* take_mask_or_ids(void* arg) {
+    const uint32_t index = (uint32_t)(uintptr_t)arg;
+    const uint32_t mask = (1U << NUM_IDS) - 1U;
+    for (uint32_t i = 0; i < NUM_TAKES_PER_THREAD; ++i) {
+        if (index % 2 == 0) {
+            TEST_ASSERT(binary_semaphore_take_mask(0, mask));
+            for (uint16_t id = 0; id < NUM_IDS; ++id) enter(id);
+            for (uint16_t id = 0; id < NUM_IDS; ++id) leave(id);
+            TEST_ASSERT(binary_semaphore_release_mask(0, mask));
+        } else {
+            const uint16_t id = (uint16_t)((i + index) % NUM_IDS);
+            TEST_ASSERT(binary_semaphore_take(id));
+            enter(id);
+            leave(id);
+            TEST_ASSERT(binary_semaphore_release(id));
+        }
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Reserves two semaphores of different shards via a mask in threads 
+ *        with an even index, and one at a time, higher ID first, in the other
+ *        threads.
+ ********************************************************************************/
+static void* take_sharded_mask_or_ids(void* arg) {
+    const uint32_t index = (uint32_t)(uintptr_t)arg;
+    const uint32_t mask = (1U << 0) | (1U << (SHARDED_ID_HIGH - SHARDED_ID_LOW));
+    for (uint32_t i = 0; i < NUM_TAKES_PER_THREAD; ++i) {
+        if (index % 2 == 0) {
+            TEST_ASSERT(binary_semaphore_take_mask(SHARDED_ID_LOW, mask));
+        } else {
+            TEST_ASSERT(binary_semaphore_take(SHARDED_ID_HIGH));
+            TEST_ASSERT(binary_semaphore_take(SHARDED_ID_LOW));
+        }
+        enter(SHARDED_ID_LOW);
+        enter(SHARDED_ID_HIGH);
+        leave(SHARDED_ID_HIGH);
+        leave(SHARDED_ID_LOW);
+        if (index % 2 == 0) {
+            TEST_ASSERT(binary_semaphore_release_mask(SHARDED_ID_LOW, mask));
+        } else {
+            TEST_ASSERT(binary_semaphore_release(SHARDED_ID_LOW));
+            TEST_ASSERT(binary_semaphore_release(SHARDED_ID_HIGH));
+        }
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs the threads reserving semaphores of a single shard, with and 
+ *        without masks, and verifies the number of reservations.
+ ********************************************************************************/
+static void test_exclusion(void) {
+    const uint16_t ids[NUM_IDS] = {0, 1, 2, 3};
+    run_threads(take_ids, NUM_THREADS * NUM_TAKES_PER_THREAD / NUM_IDS, ids, NUM_IDS);
+    run_threads(take_mask_or_ids, NUM_THREADS / 2 * NUM_TAKES_PER_THREAD * 5 / NUM_IDS, ids, NUM_IDS);
+}
+
+/********************************************************************************
+ * @brief Runs the threads reserving semaphores of different shards, which 
+ *        completes only if the mask is reserved all-or-nothing.
+ ********************************************************************************/
+static void test_sharded_mask(void) {
+    const uint16_t ids[] = {SHARDED_ID_LOW, SHARDED_ID_HIGH};
+    run_threads(take_sharded_mask_or_ids, NUM_THREADS * NUM_TAKES_PER_THREAD, ids, 2);
+}
+
+/********************************************************************************
+ * @brief Holds semaphores next to and across shard boundaries at once, which
+ *        would block the calling thread if reserving one semaphore affected
+ *        another, and finally holds all semaphores at once.
+ ********************************************************************************/
+static void test_independence(void) {
+    const uint16_t held_id = BINARY_SEMAPHORE_IDS_PER_SHARD;
+    TEST_ASSERT(binary_semaphore_take(held_id));
+    TEST_ASSERT(binary_semaphore_take(held_id - 1));
+    TEST_ASSERT(binary_semaphore_take(held_id + 1));
+    TEST_ASSERT(binary_semaphore_take(BINARY_SEMAPHORE_ID_MAX));
+    TEST_ASSERT(binary_semaphore_release(held_id - 1));
+    TEST_ASSERT(binary_semaphore_release(held_id + 1));
+    TEST_ASSERT(binary_semaphore_release(BINARY_SEMAPHORE_ID_MAX));
+    TEST_ASSERT(binary_semaphore_take_mask(held_id - 1, ~0U << 2));
+    TEST_ASSERT(binary_semaphore_release_mask(held_id - 1, ~0U << 2));
+    TEST_ASSERT(binary_semaphore_release(held_id));
+
+    for (uint32_t id = 0; id < BINARY_SEMAPHORE_LIMIT; ++id) TEST_ASSERT(binary_semaphore_take((uint16_t)id));
+    for (uint32_t id = 0; id < BINARY_SEMAPHORE_LIMIT; ++id) TEST_ASSERT(binary_semaphore_release((uint16_t)id));
+    for (uint32_t id = 0; id < BINARY_SEMAPHORE_LIMIT; id += BINARY_SEMAPHORE_IDS_PER_SHARD) {
+        TEST_ASSERT(binary_semaphore_take_mask((uint16_t)id, ~0U));
+    }
+    for (uint32_t id = 0; id < BINARY_SEMAPHORE_LIMIT; id += BINARY_SEMAPHORE_IDS_PER_SHARD) {
+        TEST_ASSERT(binary_semaphore_release_mask((uint16_t)id, ~0U));
+    }
+}
+
+/********************************************************************************
+ * @brief Verifies that invalid semaphore identifiers are rejected.
+ ********************************************************************************/
+static void test_invalid_ids(void) {
+    TEST_ASSERT(!binary_semaphore_take(BINARY_SEMAPHORE_LIMIT));
+    TEST_ASSERT(!binary_semaphore_release(BINARY_SEMAPHORE_LIMIT));
+    TEST_ASSERT(binary_semaphore_take(BINARY_SEMAPHORE_ID_MAX));
+    TEST_ASSERT(binary_semaphore_release(BINARY_SEMAPHORE_ID_MAX));
+    TEST_ASSERT(!binary_semaphore_take_mask(0, 0));
+    TEST_ASSERT(!binary_semaphore_release_mask(0, 0));
+    TEST_ASSERT(!binary_semaphore_take_mask(BINARY_SEMAPHORE_ID_MAX, 3U));
+    TEST_ASSERT(!binary_semaphore_release_mask(BINARY_SEMAPHORE_ID_MAX, 3U));
+    TEST_ASSERT(binary_semaphore_take_mask(BINARY_SEMAPHORE_ID_MAX, 1U));
+    TEST_ASSERT(binary_semaphore_release_mask(BINARY_SEMAPHORE_ID_MAX, 1U));
+}
+
+/********************************************************************************
+ * @brief Runs the tests of the binary semaphores.
+ ********************************************************************************/
+int main(void) {
+    test_exclusion();
+    test_sharded_mask();
+    test_independence();
+    test_invalid_ids();
+    return 0;
+}
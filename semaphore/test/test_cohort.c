@@ -0,0 +1,106 @@
+/********************************************************************************
+ * @brief Test of the cohort mutex in C, run for several handoff limits.
+ *        Verifies that
+ *            - the mutex excludes all other threads, such that data written by
+ *              one owner is visible to the next, also when the global lock is
+ *              passed on within a node instead of being unlocked.
+ *            - the mutex can't be locked without waiting while it is owned.
+ ********************************************************************************/
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sync/cohort.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of threads locking the mutex.
+ ********************************************************************************/
+#define NUM_THREADS 6U
+
+/********************************************************************************
+ * @brief The number of acquisitions of each thread.
+ ********************************************************************************/
+#define NUM_LOCKS_PER_THREAD 50000U
+
+/********************************************************************************
+ * @brief State of a test run.
+ *
+ * @param mutex
+ *        The mutex under test.
+ * @param num_inside
+ *        The number of owners of the mutex.
+ * @param num_locks
+ *        Counter incremented non-atomically by each owner of the mutex.
+ ********************************************************************************/
+struct test_run {
+    struct cohort_mutex* mutex;
+    _Atomic uint32_t num_inside;
+    uint32_t num_locks;
+};
+
+/********************************************************************************
+ * @brief Locks and unlocks the mutex of specified test run repeatedly,
+ *        verifying that it has a single owner meanwhile.
+ ********************************************************************************/
+static void* lock_mutex(void* arg) {
+    struct test_run* run = (struct test_run*)arg;
+    for (uint32_t i = 0; i < NUM_LOCKS_PER_THREAD; ++i) {
+        if (i % 8 == 0) {
+            while (!cohort_mutex_try_lock(run->mutex)) sched_yield();
+        } else {
+            cohort_mutex_lock(run->mutex);
+        }
+        TEST_ASSERT_EQUAL(atomic_fetch_add(&run->num_inside, 1), 0);
+        run->num_locks++;
+        atomic_fetch_sub(&run->num_inside, 1);
+        cohort_mutex_unlock(run->mutex);
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Tries to lock the mutex of specified test run, which is owned by
+ *        another thread.
+ ********************************************************************************/
+static void* try_lock_owned(void* arg) {
+    struct test_run* run = (struct test_run*)arg;
+    TEST_ASSERT(!cohort_mutex_try_lock(run->mutex));
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs the threads against a cohort mutex with specified handoff limit.
+ *
+ * @param handoff_limit
+ *        The handoff limit of the mutex, 0 selects the default.
+ ********************************************************************************/
+static void run_test(const uint16_t handoff_limit) {
+    struct test_run run = {cohort_mutex_new("test_cohort", handoff_limit), 0, 0};
+    TEST_ASSERT(run.mutex != 0);
+    pthread_t threads[NUM_THREADS];
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) TEST_ASSERT(pthread_create(&threads[i], 0, lock_mutex, &run) == 0);
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) pthread_join(threads[i], 0);
+    TEST_ASSERT_EQUAL(run.num_locks, NUM_THREADS * NUM_LOCKS_PER_THREAD);
+
+    cohort_mutex_lock(run.mutex);
+    TEST_ASSERT(pthread_create(&threads[0], 0, try_lock_owned, &run) == 0);
+    pthread_join(threads[0], 0);
+    cohort_mutex_unlock(run.mutex);
+    TEST_ASSERT(cohort_mutex_try_lock(run.mutex));
+    cohort_mutex_unlock(run.mutex);
+
+    cohort_mutex_delete(&run.mutex);
+    TEST_ASSERT(run.mutex == 0);
+}
+
+/********************************************************************************
+ * @brief Runs the test with the default handoff limit, with a single handoff
+ *        in a row and with a short handoff limit.
+ ********************************************************************************/
+int main(void) {
+    run_test(0);
+    run_test(1);
+    run_test(4);
+    return 0;
+}
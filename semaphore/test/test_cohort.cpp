@@ -0,0 +1,82 @@
+/********************************************************************************
+ * @brief Test of the cohort mutex in C++, run for several handoff limits.
+ *        Verifies that
+ *            - the mutex excludes all other threads, such that data written by
+ *              one owner is visible to the next, while threads lock it via
+ *              std::lock_guard and without waiting, also when the global lock
+ *              is passed on within a node instead of being unlocked.
+ *            - the mutex can't be locked without waiting while it is owned.
+ ********************************************************************************/
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sync/cohort.h>
+#include "test.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief The number of threads locking the mutex.
+ ********************************************************************************/
+constexpr uint32_t num_threads{6};
+
+/********************************************************************************
+ * @brief The number of acquisitions of each thread.
+ ********************************************************************************/
+constexpr uint32_t num_locks_per_thread{50000};
+
+/********************************************************************************
+ * @brief Runs the threads against a cohort mutex with specified handoff limit.
+ *
+ * @param handoff_limit
+ *        The handoff limit of the mutex.
+ ********************************************************************************/
+void RunTest(const uint16_t handoff_limit) {
+    cohort_mutex mutex{"test_cohort", handoff_limit};
+    std::atomic<uint32_t> num_inside{};
+    uint32_t num_locks{};
+    const auto critical_section{[&]() {
+        TEST_ASSERT_EQUAL(num_inside.fetch_add(1), 0);
+        num_locks++;
+        num_inside.fetch_sub(1);
+    }};
+    std::vector<std::thread> threads{};
+    for (uint32_t i{}; i < num_threads; ++i) {
+        threads.emplace_back([&]() {
+            for (uint32_t j{}; j < num_locks_per_thread; ++j) {
+                if (j % 8 == 0) {
+                    while (!mutex.try_lock()) std::this_thread::yield();
+                    critical_section();
+                    mutex.unlock();
+                } else {
+                    std::lock_guard<cohort_mutex> lock{mutex};
+                    critical_section();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    TEST_ASSERT_EQUAL(num_locks, num_threads * num_locks_per_thread);
+
+    mutex.lock();
+    std::thread{[&mutex]() { TEST_ASSERT(!mutex.try_lock()); }}.join();
+    mutex.unlock();
+    TEST_ASSERT(mutex.try_lock());
+    mutex.unlock();
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the test with the default handoff limit, without passing the
+ *        global lock on, with a single handoff in a row and with a short 
+ *        handoff limit.
+ ********************************************************************************/
+int main(void) {
+    RunTest(COHORT_MUTEX_HANDOFF_LIMIT);
+    RunTest(0);
+    RunTest(1);
+    RunTest(4);
+    return 0;
+}
@@ -0,0 +1,91 @@
+/********************************************************************************
+ * @brief Test of the sharded counter in C. Threads increment a counter
+ *        concurrently, also more threads than the counter has slots, while it
+ *        is read, which verifies that
+ *            - no increment is lost, also if several threads share a slot.
+ *            - reads made meanwhile never decrease and never exceed the
+ *              number of increments made so far.
+ *            - a reset counter reads zero.
+ ********************************************************************************/
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sync/counter.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of threads incrementing the counter.
+ ********************************************************************************/
+#define NUM_THREADS 6U
+
+/********************************************************************************
+ * @brief The number of increments of each thread.
+ ********************************************************************************/
+#define NUM_INCREMENTS_PER_THREAD 200000U
+
+/********************************************************************************
+ * @brief The value each thread adds to the counter after its increments.
+ ********************************************************************************/
+#define ADDED_VALUE 1000U
+
+/********************************************************************************
+ * @brief The counter under test.
+ ********************************************************************************/
+static struct sharded_counter* counter = 0;
+
+/********************************************************************************
+ * @brief The number of threads that have finished incrementing the counter.
+ ********************************************************************************/
+static _Atomic uint32_t num_done = 0;
+
+/********************************************************************************
+ * @brief Increments the counter, then adds ADDED_VALUE at once.
+ ********************************************************************************/
+static void* increment(void* arg) {
+    (void)arg;
+    for (uint32_t i = 0; i < NUM_INCREMENTS_PER_THREAD; ++i) sharded_counter_increment(counter);
+    sharded_counter_add(counter, ADDED_VALUE);
+    atomic_fetch_add(&num_done, 1);
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs the threads against a counter with specified number of slots,
+ *        reading the counter until the threads are done.
+ ********************************************************************************/
+static void run_test(const uint16_t num_slots) {
+    const uint64_t total = (uint64_t)NUM_THREADS * (NUM_INCREMENTS_PER_THREAD + ADDED_VALUE);
+    counter = sharded_counter_new(num_slots);
+    TEST_ASSERT(counter != 0);
+    TEST_ASSERT_EQUAL(sharded_counter_read(counter), 0);
+    atomic_store(&num_done, 0);
+    pthread_t threads[NUM_THREADS];
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) TEST_ASSERT(pthread_create(&threads[i], 0, increment, 0) == 0);
+    uint64_t previous = 0;
+    while (atomic_load(&num_done) < NUM_THREADS) {
+        const uint64_t value = sharded_counter_read(counter);
+        TEST_ASSERT(value >= previous && value <= total);
+        previous = value;
+    }
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) pthread_join(threads[i], 0);
+
+    TEST_ASSERT_EQUAL(sharded_counter_read(counter), total);
+    sharded_counter_reset(counter);
+    TEST_ASSERT_EQUAL(sharded_counter_read(counter), 0);
+    sharded_counter_increment(counter);
+    TEST_ASSERT_EQUAL(sharded_counter_read(counter), 1);
+    sharded_counter_delete(&counter);
+    TEST_ASSERT(counter == 0);
+}
+
+/********************************************************************************
+ * @brief Runs the test with the default number of slots, a single slot and
+ *        fewer slots than threads.
+ ********************************************************************************/
+int main(void) {
+    run_test(0);
+    run_test(1);
+    run_test(3);
+    return 0;
+}
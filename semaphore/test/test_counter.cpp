@@ -0,0 +1,88 @@
+/********************************************************************************
+ * @brief Test of the sharded counter in C++. Threads increment a counter
+ *        concurrently, also more threads than the counter has slots, while it
+ *        is read, which verifies that
+ *            - no increment is lost, also if several threads share a slot.
+ *            - reads made meanwhile never decrease and never exceed the
+ *              number of increments made so far.
+ *            - a reset counter reads zero.
+ ********************************************************************************/
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <sync/counter.h>
+#include "test.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief The number of threads incrementing the counter.
+ ********************************************************************************/
+constexpr uint32_t num_threads{6};
+
+/********************************************************************************
+ * @brief The number of increments of each thread.
+ ********************************************************************************/
+constexpr uint32_t num_increments_per_thread{200000};
+
+/********************************************************************************
+ * @brief The value each thread adds to the counter after its increments.
+ ********************************************************************************/
+constexpr uint32_t added_value{1000};
+
+/********************************************************************************
+ * @brief Runs the threads against a counter of specified type, reading the
+ *        counter until the threads are done.
+ *
+ * @tparam T
+ *         The type of the counter.
+ * @tparam num_slots
+ *         The number of slots of the counter.
+ ********************************************************************************/
+template <typename T, uint16_t num_slots>
+void RunTest(void) {
+    constexpr T total{static_cast<T>(num_threads * (num_increments_per_thread + added_value))};
+    sharded_counter<T, num_slots> counter{};
+    TEST_ASSERT_EQUAL(counter.read(), 0);
+    std::atomic<uint32_t> num_done{};
+    std::vector<std::thread> threads{};
+    for (uint32_t i{}; i < num_threads; ++i) {
+        threads.emplace_back([&]() {
+            for (uint32_t j{}; j < num_increments_per_thread; ++j) {
+                if (j % 2 == 0) {
+                    ++counter;
+                } else {
+                    counter.add();
+                }
+            }
+            counter.add(added_value);
+            num_done.fetch_add(1);
+        });
+    }
+    T previous{};
+    while (num_done.load() < num_threads) {
+        const auto value{counter.read()};
+        TEST_ASSERT(value >= previous && value <= total);
+        previous = value;
+    }
+    for (auto& thread : threads) thread.join();
+
+    TEST_ASSERT_EQUAL(counter.read(), total);
+    counter.reset();
+    TEST_ASSERT_EQUAL(counter.read(), 0);
+    ++counter;
+    TEST_ASSERT_EQUAL(counter.read(), 1);
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the test with the default type and number of slots, a single
+ *        slot and fewer slots than threads.
+ ********************************************************************************/
+int main(void) {
+    RunTest<uint64_t, SHARDED_COUNTER_NUM_SLOTS>();
+    RunTest<uint64_t, 1>();
+    RunTest<uint32_t, 3>();
+    return 0;
+}
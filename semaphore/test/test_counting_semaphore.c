@@ -0,0 +1,442 @@
+/********************************************************************************
+ * @brief Test of the counting semaphore in C, run for each fairness mode and
+ *        wait policy. Threads take and release one or more resources 
+ *        concurrently, which verifies that
+ *            - no more than the available resources are held at any time, and
+ *              that a single resource excludes all other threads, such that
+ *              data written by one holder is visible to the next.
+ *            - all resources are available again once the threads are done,
+ *              i.e. no resource is lost or released twice.
+ *            - releasing more resources than reserved fails, even if several
+ *              threads do so at once, and leaves the semaphore unchanged.
+ *            - in the fairness modes, queued threads reserve the resources in
+ *              the order they were queued, and reservations without waiting
+ *              fail while threads are queued.
+ *            - in the priority mode, queued real-time threads reserve the
+ *              resources in order of their priority, if the process may create
+ *              real-time threads.
+ *            - in the pollable mode, the file descriptor is readable exactly
+ *              while resources are available, also after failed releases.
+ *            - in the caching mode, resources can be released by other threads
+ *              than the ones that took them, while releasing resources that
+ *              were never taken fails even if they are cached, and the caching
+ *              mode cannot be combined with the fairness or pollable modes.
+ ********************************************************************************/
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include <sync/semaphore.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of threads taking the semaphore.
+ ********************************************************************************/
+#define NUM_THREADS 6U
+
+/********************************************************************************
+ * @brief The number of acquisitions of each thread.
+ ********************************************************************************/
+#define NUM_TAKES_PER_THREAD 20000U
+
+/********************************************************************************
+ * @brief The number of threads queued by the fairness test.
+ ********************************************************************************/
+#define NUM_QUEUED_THREADS 4U
+
+/********************************************************************************
+ * @brief State of a test run.
+ *
+ * @param sem
+ *        The semaphore under test.
+ * @param num_resources
+ *        The number of resources of the semaphore.
+ * @param max_take
+ *        The maximum number of resources taken at once.
+ * @param num_inside
+ *        The number of resources held by the threads.
+ * @param num_takes
+ *        Counter incremented non-atomically by each holder of the semaphore,
+ *        only used if the semaphore has a single resource.
+ ********************************************************************************/
+struct test_run {
+    struct counting_semaphore* sem;
+    uint16_t num_resources;
+    uint16_t max_take;
+    _Atomic uint32_t num_inside;
+    uint32_t num_takes;
+};
+
+/********************************************************************************
+ * @brief Takes and releases the semaphore of specified test run repeatedly,
+ *        verifying the number of resources held meanwhile.
+ ********************************************************************************/
+static void* take_resources(void* arg) {
+    struct test_run* run = (struct test_run*)arg;
+    const uint32_t seed = (uint32_t)(uintptr_t)pthread_self();
+    for (uint32_t i = 0; i < NUM_TAKES_PER_THREAD; ++i) {
+        const uint16_t num = (uint16_t)(1 + (i + seed) % run->max_take);
+        if (num == 1 && i % 4 == 0) {
+            counting_semaphore_take(run->sem);
+        } else if (i % 8 == 1) {
+            while (!counting_semaphore_try_take_n(run->sem, num)) sched_yield();
+        } else {
+            TEST_ASSERT(counting_semaphore_take_n(run->sem, num));
+        }
+        TEST_ASSERT(atomic_fetch_add(&run->num_inside, num) + num <= run->num_resources);
+        if (run->num_resources == 1) run->num_takes++;
+        atomic_fetch_sub(&run->num_inside, num);
+        if (num == 1 && i % 4 == 0) {
+            counting_semaphore_release(run->sem);
+        } else {
+            TEST_ASSERT(counting_semaphore_release_n(run->sem, num));
+        }
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Takes all resources of the semaphore of specified test run at once,
+ *        so that the other threads have to wait for a full semaphore.
+ ********************************************************************************/
+static void* take_all_resources(void* arg) {
+    struct test_run* run = (struct test_run*)arg;
+    for (uint32_t i = 0; i < NUM_TAKES_PER_THREAD / 100; ++i) {
+        TEST_ASSERT(counting_semaphore_take_n(run->sem, run->num_resources));
+        TEST_ASSERT_EQUAL(atomic_fetch_add(&run->num_inside, run->num_resources), 0);
+        atomic_fetch_sub(&run->num_inside, run->num_resources);
+        TEST_ASSERT(counting_semaphore_release_n(run->sem, run->num_resources));
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Releases resources of the semaphore of specified test run that were
+ *        never taken, each of which has to fail.
+ ********************************************************************************/
+static void* release_untaken(void* arg) {
+    struct test_run* run = (struct test_run*)arg;
+    for (uint32_t i = 0; i < NUM_TAKES_PER_THREAD; ++i) TEST_ASSERT(!counting_semaphore_release_n(run->sem, 1));
+    return 0;
+}
+
+/********************************************************************************
+ * @brief State of the fairness test.
+ *
+ * @param sem
+ *        The semaphore under test.
+ * @param order
+ *        The indices of the queued threads in the order they reserved the
+ *        semaphore.
+ * @param num_served
+ *        The number of queued threads that have reserved the semaphore.
+ ********************************************************************************/
+struct fairness_run {
+    struct counting_semaphore* sem;
+    uint32_t order[NUM_QUEUED_THREADS];
+    uint32_t num_served;
+};
+
+/********************************************************************************
+ * @brief Blocks the calling thread for specified time in milliseconds.
+ ********************************************************************************/
+static void delay_ms(const long time_ms) {
+    const struct timespec delay = {time_ms / 1000, (time_ms % 1000) * 1000000L};
+    nanosleep(&delay, 0);
+}
+
+/********************************************************************************
+ * @brief Argument of a queued thread, which refers to the fairness test state.
+ *
+ * @param run
+ *        Reference to the state of the fairness test.
+ * @param index
+ *        The index of the thread in the queue.
+ ********************************************************************************/
+struct queued_thread {
+    struct fairness_run* run;
+    uint32_t index;
+};
+
+/********************************************************************************
+ * @brief Reserves both resources of the semaphore of the fairness test and
+ *        records the order.
+ ********************************************************************************/
+static void* take_queued(void* arg) {
+    struct queued_thread* self = (struct queued_thread*)arg;
+    TEST_ASSERT(counting_semaphore_take_n(self->run->sem, 2));
+    self->run->order[self->run->num_served++] = self->index;
+    TEST_ASSERT(counting_semaphore_release_n(self->run->sem, 2));
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Queues threads one after another on a semaphore with two resources, 
+ *        one of which is held, and verifies that a single resource can't be 
+ *        reserved past the queued threads and that they reserve the resources
+ *        in the order they were queued.
+ *
+ * @param options
+ *        Reference to the creation-time options, selecting a fairness mode.
+ ********************************************************************************/
+static void test_fifo_order(const struct counting_semaphore_options* options) {
+    struct fairness_run run = {counting_semaphore_new(2, options), {0}, 0};
+    TEST_ASSERT(run.sem != 0);
+    counting_semaphore_take(run.sem);
+    pthread_t threads[NUM_QUEUED_THREADS];
+    struct queued_thread args[NUM_QUEUED_THREADS];
+    for (uint32_t i = 0; i < NUM_QUEUED_THREADS; ++i) {
+        args[i].run = &run;
+        args[i].index = i;
+        TEST_ASSERT(pthread_create(&threads[i], 0, take_queued, &args[i]) == 0);
+        delay_ms(20);
+    }
+    TEST_ASSERT(!counting_semaphore_try_take_n(run.sem, 1));
+    TEST_ASSERT(counting_semaphore_release_n(run.sem, 1));
+    for (uint32_t i = 0; i < NUM_QUEUED_THREADS; ++i) pthread_join(threads[i], 0);
+    TEST_ASSERT_EQUAL(run.num_served, NUM_QUEUED_THREADS);
+    for (uint32_t i = 0; i < NUM_QUEUED_THREADS; ++i) TEST_ASSERT_EQUAL(run.order[i], i);
+    counting_semaphore_delete(&run.sem);
+}
+
+/********************************************************************************
+ * @brief Queues threads of different real-time priorities one after another
+ *        on a semaphore with two resources, one of which is held, and verifies
+ *        that they reserve the resources in order of their priority. The test
+ *        is skipped if the process may not create real-time threads.
+ ********************************************************************************/
+static void test_priority_order(void) {
+    const int priorities[NUM_QUEUED_THREADS] = {10, 30, 20, 0};
+    const uint32_t expected_order[NUM_QUEUED_THREADS] = {1, 2, 0, 3};
+    struct counting_semaphore_options options = {0};
+    options.fairness = SEMAPHORE_FAIR_PRIORITY;
+    struct fairness_run run = {counting_semaphore_new(2, &options), {0}, 0};
+    TEST_ASSERT(run.sem != 0);
+    counting_semaphore_take(run.sem);
+    pthread_t threads[NUM_QUEUED_THREADS];
+    struct queued_thread args[NUM_QUEUED_THREADS];
+    uint32_t num_threads = 0;
+    for (; num_threads < NUM_QUEUED_THREADS; ++num_threads) {
+        args[num_threads].run = &run;
+        args[num_threads].index = num_threads;
+        pthread_attr_t attributes;
+        TEST_ASSERT(pthread_attr_init(&attributes) == 0);
+        if (priorities[num_threads]) {
+            const struct sched_param parameters = {.sched_priority = priorities[num_threads]};
+            TEST_ASSERT(pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED) == 0);
+            TEST_ASSERT(pthread_attr_setschedpolicy(&attributes, SCHED_FIFO) == 0);
+            TEST_ASSERT(pthread_attr_setschedparam(&attributes, &parameters) == 0);
+        }
+        const int error = pthread_create(&threads[num_threads], &attributes, take_queued, &args[num_threads]);
+        pthread_attr_destroy(&attributes);
+        if (error == EPERM) break;
+        TEST_ASSERT(error == 0);
+        delay_ms(20);
+    }
+    TEST_ASSERT(counting_semaphore_release_n(run.sem, 1));
+    for (uint32_t i = 0; i < num_threads; ++i) pthread_join(threads[i], 0);
+    TEST_ASSERT_EQUAL(run.num_served, num_threads);
+    if (num_threads == NUM_QUEUED_THREADS) {
+        for (uint32_t i = 0; i < NUM_QUEUED_THREADS; ++i) TEST_ASSERT_EQUAL(run.order[i], expected_order[i]);
+    } else {
+        fprintf(stderr, "Skipped the priority order, real-time threads aren't permitted.\n");
+    }
+    counting_semaphore_delete(&run.sem);
+}
+
+/********************************************************************************
+ * @brief Indicates if the file descriptor of specified semaphore is readable,
+ *        without waiting.
+ ********************************************************************************/
+static bool is_readable(const struct counting_semaphore* sem) {
+    struct pollfd fd = {counting_semaphore_fd(sem), POLLIN, 0};
+    TEST_ASSERT(poll(&fd, 1, 0) >= 0);
+    return (fd.revents & POLLIN) != 0;
+}
+
+/********************************************************************************
+ * @brief Verifies that the file descriptor of a pollable semaphore is readable
+ *        while resources are available and wakes a poll once a resource is
+ *        released, and that other semaphores have no file descriptor.
+ *
+ * @param options
+ *        Reference to the creation-time options, selecting the pollable mode.
+ ********************************************************************************/
+static void test_readiness(const struct counting_semaphore_options* options) {
+    struct counting_semaphore* sem = counting_semaphore_new(2, 0);
+    TEST_ASSERT(sem != 0);
+    TEST_ASSERT_EQUAL(counting_semaphore_fd(sem), -1);
+    counting_semaphore_delete(&sem);
+
+    sem = counting_semaphore_new(2, options);
+    TEST_ASSERT(sem != 0);
+    TEST_ASSERT(counting_semaphore_fd(sem) >= 0);
+    TEST_ASSERT(is_readable(sem));
+    TEST_ASSERT(counting_semaphore_try_take_n(sem, 1));
+    TEST_ASSERT(is_readable(sem));
+    TEST_ASSERT(counting_semaphore_take_n(sem, 1));
+    TEST_ASSERT(!is_readable(sem));
+    TEST_ASSERT(!counting_semaphore_release_n(sem, 3));
+    TEST_ASSERT(!is_readable(sem));
+    TEST_ASSERT(counting_semaphore_release_n(sem, 1));
+    struct pollfd fd = {counting_semaphore_fd(sem), POLLIN, 0};
+    TEST_ASSERT_EQUAL(poll(&fd, 1, 1000), 1);
+    TEST_ASSERT(counting_semaphore_try_take_n(sem, 1));
+    TEST_ASSERT(!is_readable(sem));
+    counting_semaphore_release(sem);
+    counting_semaphore_release(sem);
+    TEST_ASSERT(is_readable(sem));
+    TEST_ASSERT(counting_semaphore_try_take_n(sem, 2));
+    TEST_ASSERT(!is_readable(sem));
+    TEST_ASSERT(counting_semaphore_release_n(sem, 2));
+    counting_semaphore_delete(&sem);
+}
+
+/********************************************************************************
+ * @brief Takes a resource of specified semaphore, which a thread other than
+ *        the main thread uses a cache slot of its own for.
+ ********************************************************************************/
+static void* take_one(void* arg) {
+    TEST_ASSERT(counting_semaphore_try_take_n((struct counting_semaphore*)arg, 1));
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Releases two resources of specified semaphore.
+ ********************************************************************************/
+static void* release_two(void* arg) {
+    TEST_ASSERT(counting_semaphore_release_n((struct counting_semaphore*)arg, 2));
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs specified function on a thread of its own and waits for it.
+ ********************************************************************************/
+static void run_thread(void* (*function)(void*), void* arg) {
+    pthread_t thread;
+    TEST_ASSERT(pthread_create(&thread, 0, function, arg) == 0);
+    pthread_join(thread, 0);
+}
+
+/********************************************************************************
+ * @brief Takes resources of a caching semaphore on two threads and releases
+ *        them at once on a third, then verifies that resources that were never
+ *        taken can't be released while others are cached.
+ *
+ * @param options
+ *        Reference to the creation-time options, which select the caching.
+ ********************************************************************************/
+static void test_cache_slots(const struct counting_semaphore_options* options) {
+    struct counting_semaphore* sem = counting_semaphore_new(16, options);
+    TEST_ASSERT(sem != 0);
+    run_thread(take_one, sem);
+    run_thread(take_one, sem);
+    TEST_ASSERT_EQUAL(counting_semaphore_num_reserved(sem), 2);
+    run_thread(release_two, sem);
+    TEST_ASSERT_EQUAL(counting_semaphore_num_reserved(sem), 0);
+    TEST_ASSERT(!counting_semaphore_release_n(sem, 2));
+
+    TEST_ASSERT(counting_semaphore_take_n(sem, 1));
+    TEST_ASSERT_EQUAL(counting_semaphore_num_reserved(sem), 1);
+    TEST_ASSERT(!counting_semaphore_release_n(sem, 2));
+    TEST_ASSERT_EQUAL(counting_semaphore_num_reserved(sem), 1);
+    TEST_ASSERT(counting_semaphore_release_n(sem, 1));
+    TEST_ASSERT(!counting_semaphore_release_n(sem, 1));
+    TEST_ASSERT(counting_semaphore_try_take_n(sem, 16));
+    TEST_ASSERT(!counting_semaphore_try_take_n(sem, 1));
+    TEST_ASSERT(counting_semaphore_release_n(sem, 16));
+    counting_semaphore_delete(&sem);
+}
+
+/********************************************************************************
+ * @brief Runs the threads against a semaphore created with specified options.
+ *
+ * @param num_resources
+ *        The number of resources of the semaphore.
+ * @param max_take
+ *        The maximum number of resources taken at once.
+ * @param options
+ *        Reference to the creation-time options.
+ ********************************************************************************/
+static void run_test(const uint16_t num_resources, const uint16_t max_take,
+                     const struct counting_semaphore_options* options) {
+    struct test_run run = {counting_semaphore_new(num_resources, options), num_resources, max_take, 0, 0};
+    TEST_ASSERT(run.sem != 0);
+    pthread_t threads[NUM_THREADS + 1];
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) TEST_ASSERT(pthread_create(&threads[i], 0, take_resources, &run) == 0);
+    TEST_ASSERT(pthread_create(&threads[NUM_THREADS], 0, take_all_resources, &run) == 0);
+    for (uint32_t i = 0; i <= NUM_THREADS; ++i) pthread_join(threads[i], 0);
+
+    if (num_resources == 1) TEST_ASSERT_EQUAL(run.num_takes, NUM_THREADS * NUM_TAKES_PER_THREAD);
+    TEST_ASSERT_EQUAL(counting_semaphore_num_reserved(run.sem), 0);
+    TEST_ASSERT_EQUAL(counting_semaphore_num_available(run.sem), num_resources);
+
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) TEST_ASSERT(pthread_create(&threads[i], 0, release_untaken, &run) == 0);
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) pthread_join(threads[i], 0);
+    TEST_ASSERT_EQUAL(counting_semaphore_num_reserved(run.sem), 0);
+    TEST_ASSERT(counting_semaphore_try_take_n(run.sem, num_resources));
+    TEST_ASSERT(!counting_semaphore_try_take_n(run.sem, 1));
+    TEST_ASSERT(!counting_semaphore_release_n(run.sem, (uint16_t)(num_resources + 1)));
+    TEST_ASSERT(counting_semaphore_release_n(run.sem, num_resources));
+    TEST_ASSERT(!counting_semaphore_take_n(run.sem, 0));
+    TEST_ASSERT(!counting_semaphore_take_n(run.sem, (uint16_t)(num_resources + 1)));
+    if (counting_semaphore_fd(run.sem) >= 0) {
+        TEST_ASSERT(is_readable(run.sem));
+        TEST_ASSERT(counting_semaphore_try_take_n(run.sem, num_resources));
+        TEST_ASSERT(!is_readable(run.sem));
+        TEST_ASSERT(counting_semaphore_release_n(run.sem, num_resources));
+    }
+    counting_semaphore_delete(&run.sem);
+    TEST_ASSERT(run.sem == 0);
+}
+
+/********************************************************************************
+ * @brief Runs the test for each mode of the counting semaphore.
+ ********************************************************************************/
+int main(void) {
+    TEST_ASSERT(counting_semaphore_new(0, 0) == 0);
+    const enum semaphore_fairness fairness_modes[] = {
+        SEMAPHORE_FAIR_NONE, SEMAPHORE_FAIR_TICKET, SEMAPHORE_FAIR_QUEUE, SEMAPHORE_FAIR_PRIORITY,
+    };
+    const enum semaphore_wait_policy wait_policies[] = {
+        SEMAPHORE_WAIT_ADAPTIVE, SEMAPHORE_WAIT_SPIN, SEMAPHORE_WAIT_PARK,
+    };
+    for (uint32_t f = 0; f < sizeof(fairness_modes) / sizeof(fairness_modes[0]); ++f) {
+        for (uint32_t w = 0; w < sizeof(wait_policies) / sizeof(wait_policies[0]); ++w) {
+            struct counting_semaphore_options options = {0};
+            options.fairness = fairness_modes[f];
+            options.wait_policy = wait_policies[w];
+            run_test(1, 1, &options);
+            run_test(3, 2, &options);
+            if (options.fairness != SEMAPHORE_FAIR_NONE && options.wait_policy != SEMAPHORE_WAIT_SPIN) {
+                test_fifo_order(&options);
+            }
+        }
+    }
+    test_priority_order();
+    struct counting_semaphore_options short_spin = {0};
+    short_spin.spin_limit = 1;
+    run_test(1, 1, &short_spin);
+    struct counting_semaphore_options pollable = {0};
+    pollable.pollable = true;
+    run_test(1, 1, &pollable);
+    run_test(3, 2, &pollable);
+    test_readiness(&pollable);
+    pollable.fairness = SEMAPHORE_FAIR_TICKET;
+    run_test(3, 2, &pollable);
+    struct counting_semaphore_options cached = {0};
+    cached.cache_batch = 4;
+    run_test(64, 3, &cached);
+    test_cache_slots(&cached);
+    cached.wait_policy = SEMAPHORE_WAIT_PARK;
+    run_test(64, 3, &cached);
+    cached.pollable = true;
+    TEST_ASSERT(counting_semaphore_new(64, &cached) == 0);
+    cached.pollable = false;
+    cached.fairness = SEMAPHORE_FAIR_TICKET;
+    TEST_ASSERT(counting_semaphore_new(64, &cached) == 0);
+    return 0;
+}
@@ -0,0 +1,192 @@
+/********************************************************************************
+ * @brief Test of the counting semaphore in C++, run for each wait policy and
+ *        fairness mode.
+ *        Threads take and release one or more resources concurrently,
+ *        blocking, without waiting and with a timeout, which verifies that
+ *            - no more than the available resources are held at any time, and
+ *              that a single resource excludes all other threads, such that
+ *              data written by one holder is visible to the next.
+ *            - all resources are available again once the threads are done,
+ *              i.e. no resource is lost or released twice.
+ *            - releasing more resources than reserved fails, even if several
+ *              threads do so at once, and leaves the semaphore unchanged.
+ *            - in the fairness modes, queued threads reserve the resources in
+ *              the order they were queued, and reservations without waiting
+ *              fail while threads are queued.
+ *            - waits with a timeout fail once the timeout has expired, and
+ *              succeed if a resource is released in time.
+ ********************************************************************************/
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <sync/semaphore.h>
+#include "test.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief The number of threads taking the semaphore.
+ ********************************************************************************/
+constexpr uint32_t num_threads{6};
+
+/********************************************************************************
+ * @brief The number of acquisitions of each thread.
+ ********************************************************************************/
+constexpr uint32_t num_takes_per_thread{20000};
+
+/********************************************************************************
+ * @brief The number of threads queued by the fairness test.
+ ********************************************************************************/
+constexpr uint32_t num_queued_threads{4};
+
+/********************************************************************************
+ * @brief Runs the threads against a semaphore of specified type.
+ *
+ * @tparam num_resources
+ *         The number of resources of the semaphore.
+ * @tparam wait_policy
+ *         The wait policy of the semaphore.
+ * @param max_take
+ *        The maximum number of resources taken at once.
+ ********************************************************************************/
+template <uint16_t num_resources, typename wait_policy>
+void RunTest(const uint16_t max_take) {
+    counting_semaphore<num_resources, wait_policy> sem{"test_counting_semaphore"};
+    std::atomic<uint32_t> num_inside{};
+    uint32_t num_takes{};
+    std::vector<std::thread> threads{};
+    for (uint32_t i{}; i < num_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            for (uint32_t j{}; j < num_takes_per_thread; ++j) {
+                const auto num{static_cast<uint16_t>(1 + (i + j) % max_take)};
+                if (j % 16 == 0) {
+                    TEST_ASSERT(sem.take_for(std::chrono::seconds(60), num));
+                } else if (j % 8 == 0) {
+                    while (!sem.try_take(num)) std::this_thread::yield();
+                } else {
+                    TEST_ASSERT(sem.take(num));
+                }
+                TEST_ASSERT(num_inside.fetch_add(num) + num <= num_resources);
+                if (num_resources == 1) num_takes++;
+                num_inside.fetch_sub(num);
+                TEST_ASSERT(sem.release(num));
+            }
+        });
+    }
+    threads.emplace_back([&]() {
+        for (uint32_t j{}; j < num_takes_per_thread / 100; ++j) {
+            TEST_ASSERT(sem.take(num_resources));
+            TEST_ASSERT_EQUAL(num_inside.fetch_add(num_resources), 0);
+            num_inside.fetch_sub(num_resources);
+            TEST_ASSERT(sem.release(num_resources));
+        }
+    });
+    for (auto& thread : threads) thread.join();
+
+    if (num_resources == 1) TEST_ASSERT_EQUAL(num_takes, num_threads * num_takes_per_thread);
+    TEST_ASSERT_EQUAL(sem.num_reserved_resources(), 0);
+    TEST_ASSERT_EQUAL(sem.num_available_resources(), num_resources);
+
+    threads.clear();
+    for (uint32_t i{}; i < num_threads; ++i) {
+        threads.emplace_back([&]() {
+            for (uint32_t j{}; j < num_takes_per_thread; ++j) TEST_ASSERT(!sem.release());
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    TEST_ASSERT_EQUAL(sem.num_reserved_resources(), 0);
+    TEST_ASSERT(sem.try_take(num_resources));
+    TEST_ASSERT(!sem.try_take());
+    TEST_ASSERT(!sem.release(num_resources + 1));
+    TEST_ASSERT(sem.release(num_resources));
+}
+
+/********************************************************************************
+ * @brief Runs the test with a single and with several resources.
+ *
+ * @tparam wait_policy
+ *         The wait policy of the semaphore.
+ ********************************************************************************/
+template <typename wait_policy>
+void RunTests(void) {
+    RunTest<1, wait_policy>(1);
+    RunTest<3, wait_policy>(2);
+}
+
+/********************************************************************************
+ * @brief Queues threads one after another on a fair semaphore with two 
+ *        resources, one of which is held, and verifies that a single resource 
+ *        can't be reserved past the queued threads and that they reserve the
+ *        resources in the order they were queued.
+ *
+ * @tparam wait_policy
+ *         The fair wait policy of the semaphore.
+ ********************************************************************************/
+template <typename wait_policy>
+void TestFifoOrder(void) {
+    counting_semaphore<2, wait_policy> sem{"test_counting_semaphore"};
+    std::vector<uint32_t> order{};
+    std::vector<std::thread> threads{};
+    TEST_ASSERT(sem.take());
+    for (uint32_t i{}; i < num_queued_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            TEST_ASSERT(sem.take(2));
+            order.push_back(i);
+            TEST_ASSERT(sem.release(2));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    TEST_ASSERT(!sem.try_take());
+    TEST_ASSERT(sem.release());
+    for (auto& thread : threads) thread.join();
+    TEST_ASSERT_EQUAL(order.size(), num_queued_threads);
+    for (uint32_t i{}; i < num_queued_threads; ++i) TEST_ASSERT_EQUAL(order[i], i);
+}
+
+/********************************************************************************
+ * @brief Waits with timeouts on a semaphore whose resource is held.
+ ********************************************************************************/
+void TestTimeouts(void) {
+    using namespace std::chrono;
+    counting_semaphore<1> sem{"test_counting_semaphore"};
+    TEST_ASSERT(sem.try_take());
+    TEST_ASSERT(!sem.try_take());
+
+    auto start{steady_clock::now()};
+    TEST_ASSERT(!sem.take_for(milliseconds(20)));
+    TEST_ASSERT(steady_clock::now() - start >= milliseconds(20));
+    start = steady_clock::now();
+    TEST_ASSERT(!sem.take_until(start + milliseconds(20)));
+    TEST_ASSERT(steady_clock::now() - start >= milliseconds(20));
+
+    std::thread releaser{[&sem]() {
+        std::this_thread::sleep_for(milliseconds(10));
+        TEST_ASSERT(sem.release());
+    }};
+    TEST_ASSERT(sem.take_for(seconds(60)));
+    releaser.join();
+    TEST_ASSERT_EQUAL(sem.num_available_resources(), 0);
+    TEST_ASSERT(sem.release());
+    TEST_ASSERT(sem.take_until(steady_clock::now()));
+    TEST_ASSERT(sem.release());
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the test for each wait policy and fairness mode, the fairness
+ *        test and the timeout test.
+ ********************************************************************************/
+int main(void) {
+    RunTests<semaphore_wait_adaptive<>>();
+    RunTests<semaphore_wait_adaptive<1>>();
+    RunTests<semaphore_wait_spin>();
+    RunTests<semaphore_wait_park>();
+    RunTests<semaphore_fair_ticket<>>();
+    RunTests<semaphore_fair_queue<>>();
+    TestFifoOrder<semaphore_fair_ticket<>>();
+    TestFifoOrder<semaphore_fair_queue<>>();
+    TestTimeouts();
+    return 0;
+}
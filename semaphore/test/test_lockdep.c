@@ -0,0 +1,191 @@
+/********************************************************************************
+ * @brief Test of the lock-order checker in C. If the checker is compiled in
+ *        (SYNC_ENABLE_LOCKDEP), verifies that
+ *            - acquiring two primitives in both orders, by different threads,
+ *              is reported once, naming both primitives, and that a cycle of
+ *              three primitives is reported as well.
+ *            - reservations that never block add no edges.
+ *            - a deleted primitive forgets its edges, so that a new primitive
+ *              at the same address doesn't inherit them.
+ *        Else verifies that nothing is reported.
+ ********************************************************************************/
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sync/lockdep.h>
+#include <sync/mutex.h>
+#include <sync/semaphore.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The IDs of the binary semaphores of the test.
+ ********************************************************************************/
+#define FIRST_SEM_ID  (uint16_t)(1)
+#define SECOND_SEM_ID (uint16_t)(2)
+
+/********************************************************************************
+ * @brief The maximum size of the captured reports.
+ ********************************************************************************/
+#define REPORT_SIZE 65536U
+
+/********************************************************************************
+ * @brief The mutexes of the cycle test.
+ ********************************************************************************/
+static struct sync_mutex* mutexes[3];
+
+/********************************************************************************
+ * @brief The reports written to stderr, captured in a file.
+ ********************************************************************************/
+static char report[REPORT_SIZE];
+
+/********************************************************************************
+ * @brief Provides the number of inversions expected after specified number of
+ *        inversions was made, which is 0 if the checker is disabled.
+ ********************************************************************************/
+static inline uint32_t expected_inversions(const uint32_t num_inversions) {
+    return SYNC_LOCKDEP_ENABLED ? num_inversions : 0;
+}
+
+/********************************************************************************
+ * @brief Takes the binary semaphores in the order given by specified argument
+ *        and releases them.
+ ********************************************************************************/
+static void* take_in_order(void* arg) {
+    const bool reverse = arg != 0;
+    TEST_ASSERT(binary_semaphore_take(reverse ? SECOND_SEM_ID : FIRST_SEM_ID));
+    TEST_ASSERT(binary_semaphore_take(reverse ? FIRST_SEM_ID : SECOND_SEM_ID));
+    TEST_ASSERT(binary_semaphore_release(reverse ? FIRST_SEM_ID : SECOND_SEM_ID));
+    TEST_ASSERT(binary_semaphore_release(reverse ? SECOND_SEM_ID : FIRST_SEM_ID));
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs specified function on a thread of its own and waits for it.
+ ********************************************************************************/
+static void run_thread(void* (*function)(void*), void* arg) {
+    pthread_t thread;
+    TEST_ASSERT(pthread_create(&thread, 0, function, arg) == 0);
+    pthread_join(thread, 0);
+}
+
+/********************************************************************************
+ * @brief Locks the mutex of specified index and then the next one of the
+ *        cycle, and unlocks both.
+ ********************************************************************************/
+static void* lock_pair(void* arg) {
+    const uintptr_t index = (uintptr_t)arg;
+    sync_mutex_lock(mutexes[index]);
+    sync_mutex_lock(mutexes[(index + 1) % 3]);
+    TEST_ASSERT(sync_mutex_unlock(mutexes[(index + 1) % 3]));
+    TEST_ASSERT(sync_mutex_unlock(mutexes[index]));
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Takes the binary semaphores in both orders and verifies that the
+ *        inversion is reported once.
+ ********************************************************************************/
+static void test_inversion(void) {
+    run_thread(take_in_order, 0);
+    TEST_ASSERT_EQUAL(sync_lockdep_num_inversions(), 0);
+    run_thread(take_in_order, (void*)1);
+    TEST_ASSERT_EQUAL(sync_lockdep_num_inversions(), expected_inversions(1));
+    run_thread(take_in_order, (void*)1);
+    run_thread(take_in_order, 0);
+    TEST_ASSERT_EQUAL(sync_lockdep_num_inversions(), expected_inversions(1));
+}
+
+/********************************************************************************
+ * @brief Locks three mutexes pairwise in a cycle and verifies that the edge
+ *        closing the cycle is reported.
+ ********************************************************************************/
+static void test_cycle(void) {
+    const char* names[3] = {"test_lockdep_a", "test_lockdep_b", "test_lockdep_c"};
+    for (uint32_t i = 0; i < 3; ++i) TEST_ASSERT((mutexes[i] = sync_mutex_new(names[i])) != 0);
+    run_thread(lock_pair, (void*)0);
+    run_thread(lock_pair, (void*)1);
+    TEST_ASSERT_EQUAL(sync_lockdep_num_inversions(), expected_inversions(1));
+    run_thread(lock_pair, (void*)2);
+    TEST_ASSERT_EQUAL(sync_lockdep_num_inversions(), expected_inversions(2));
+    for (uint32_t i = 0; i < 3; ++i) sync_mutex_delete(&mutexes[i]);
+}
+
+/********************************************************************************
+ * @brief Reserves a semaphore and a mutex in both orders, one of them without
+ *        blocking each time, and verifies that nothing is reported.
+ ********************************************************************************/
+static void test_try_lock(void) {
+    struct sync_mutex* mutex = sync_mutex_new("test_lockdep_try");
+    struct counting_semaphore* sem = counting_semaphore_new(1, 0);
+    TEST_ASSERT(mutex != 0 && sem != 0);
+    counting_semaphore_take(sem);
+    TEST_ASSERT(sync_mutex_try_lock(mutex));
+    TEST_ASSERT(sync_mutex_unlock(mutex));
+    counting_semaphore_release(sem);
+    sync_mutex_lock(mutex);
+    TEST_ASSERT(counting_semaphore_try_take_n(sem, 1));
+    counting_semaphore_release(sem);
+    TEST_ASSERT(sync_mutex_unlock(mutex));
+    TEST_ASSERT_EQUAL(sync_lockdep_num_inversions(), expected_inversions(2));
+    counting_semaphore_delete(&sem);
+    sync_mutex_delete(&mutex);
+}
+
+/********************************************************************************
+ * @brief Locks two mutexes in one order, deletes them and locks two new ones
+ *        in the other order, and verifies that nothing is reported.
+ ********************************************************************************/
+static void test_forget(void) {
+    for (uint32_t order = 0; order < 2; ++order) {
+        struct sync_mutex* first = sync_mutex_new("test_lockdep_first");
+        struct sync_mutex* second = sync_mutex_new("test_lockdep_second");
+        TEST_ASSERT(first != 0 && second != 0);
+        sync_mutex_lock(order ? second : first);
+        sync_mutex_lock(order ? first : second);
+        TEST_ASSERT(sync_mutex_unlock(order ? first : second));
+        TEST_ASSERT(sync_mutex_unlock(order ? second : first));
+        sync_mutex_delete(&second);
+        sync_mutex_delete(&first);
+    }
+    TEST_ASSERT_EQUAL(sync_lockdep_num_inversions(), expected_inversions(2));
+}
+
+/********************************************************************************
+ * @brief Captures stderr in a temporary file, runs the tests and verifies the
+ *        captured reports.
+ ********************************************************************************/
+int main(void) {
+    char path[] = "/tmp/test_lockdep_XXXXXX";
+    const int capture = mkstemp(path);
+    TEST_ASSERT(capture >= 0);
+    TEST_ASSERT(unlink(path) == 0);
+    fflush(stderr);
+    const int saved_stderr = dup(STDERR_FILENO);
+    TEST_ASSERT(saved_stderr >= 0 && dup2(capture, STDERR_FILENO) == STDERR_FILENO);
+
+    test_inversion();
+    test_cycle();
+    test_try_lock();
+    test_forget();
+
+    fflush(stderr);
+    TEST_ASSERT(dup2(saved_stderr, STDERR_FILENO) == STDERR_FILENO);
+    const ssize_t size = pread(capture, report, REPORT_SIZE - 1, 0);
+    TEST_ASSERT(size >= 0);
+    report[size] = '\0';
+    if (SYNC_LOCKDEP_ENABLED) {
+        TEST_ASSERT(strstr(report, "lock-order inversion") != 0);
+        TEST_ASSERT(strstr(report, "acquiring test_lockdep_a while holding test_lockdep_c") != 0);
+        TEST_ASSERT(strstr(report, "test_lockdep_b acquired while holding test_lockdep_a") != 0);
+        TEST_ASSERT(strstr(report, "test_lockdep_c acquired while holding test_lockdep_b") != 0);
+        TEST_ASSERT(strstr(report, "test_lockdep_try") == 0);
+        TEST_ASSERT(strstr(report, "test_lockdep_first") == 0);
+    } else {
+        TEST_ASSERT_EQUAL(size, 0);
+    }
+    close(capture);
+    close(saved_stderr);
+    return 0;
+}
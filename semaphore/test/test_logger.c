@@ -0,0 +1,166 @@
+/********************************************************************************
+ * @brief Test of the asynchronous logger. Several threads log numbered records
+ *        into a temporary file, which verifies that
+ *            - with the blocking overflow policy, every record is written
+ *              exactly once, the records of each thread in the order they
+ *              were logged, even though the queue is much smaller than the
+ *              number of records.
+ *            - all records logged before a flush are written once it returns.
+ *            - with the dropping overflow policy, every record is either
+ *              written or counted as dropped.
+ ********************************************************************************/
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sync/logger.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of logging threads.
+ ********************************************************************************/
+#define NUM_THREADS 6U
+
+/********************************************************************************
+ * @brief The number of records logged by each thread.
+ ********************************************************************************/
+#define NUM_RECORDS_PER_THREAD 20000U
+
+/********************************************************************************
+ * @brief The number of records the queue of the logger can hold.
+ ********************************************************************************/
+#define QUEUE_CAPACITY 64U
+
+/********************************************************************************
+ * @brief The logger under test.
+ ********************************************************************************/
+static struct async_logger* logger = 0;
+
+/********************************************************************************
+ * @brief The number of records each thread failed to enqueue.
+ ********************************************************************************/
+static uint32_t num_rejected[NUM_THREADS];
+
+/********************************************************************************
+ * @brief Logs numbered records tagged with the index of the calling thread.
+ ********************************************************************************/
+static void* log_records(void* arg) {
+    const uint32_t index = (uint32_t)(uintptr_t)arg;
+    for (uint32_t i = 0; i < NUM_RECORDS_PER_THREAD; ++i) {
+        if (!async_logger_printf(logger, "%u %u\n", index, i)) num_rejected[index]++;
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief The path of the temporary file the records are written to.
+ ********************************************************************************/
+static char path[] = "/tmp/test_logger_XXXXXX";
+
+/********************************************************************************
+ * @brief Creates an empty temporary file and runs the logging threads against
+ *        a new logger appending to it, created with specified overflow policy.
+ *
+ * @return
+ *        The file descriptor of the temporary file, to be closed once the
+ *        logger is deleted.
+ ********************************************************************************/
+static int run_threads(const enum async_logger_overflow_policy overflow_policy) {
+    strcpy(path, "/tmp/test_logger_XXXXXX");
+    const int temporary_fd = mkstemp(path);
+    TEST_ASSERT(temporary_fd >= 0);
+    const int fd = open(path, O_WRONLY | O_APPEND);
+    TEST_ASSERT(fd >= 0);
+    close(temporary_fd);
+    const struct async_logger_options options = {fd, QUEUE_CAPACITY, 1, overflow_policy};
+    logger = async_logger_new(&options);
+    TEST_ASSERT(logger != 0);
+    memset(num_rejected, 0, sizeof(num_rejected));
+    pthread_t threads[NUM_THREADS];
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) {
+        TEST_ASSERT(pthread_create(&threads[i], 0, log_records, (void*)(uintptr_t)i) == 0);
+    }
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) pthread_join(threads[i], 0);
+    return fd;
+}
+
+/********************************************************************************
+ * @brief Reads the records of the temporary file, verifying their format and
+ *        that the records of each thread are in the order they were logged.
+ *
+ * @param complete
+ *        True if no record may be missing, i.e. the records of each thread
+ *        have to be numbered consecutively.
+ * @return
+ *        The number of records in the file.
+ ********************************************************************************/
+static uint32_t read_records(const bool complete) {
+    FILE* file = fopen(path, "r");
+    TEST_ASSERT(file != 0);
+    uint32_t next[NUM_THREADS] = {0};
+    uint32_t num_records = 0;
+    uint32_t index = 0;
+    uint32_t number = 0;
+    while (fscanf(file, "%u %u\n", &index, &number) == 2) {
+        TEST_ASSERT(index < NUM_THREADS);
+        if (complete) {
+            TEST_ASSERT_EQUAL(number, next[index]);
+        } else {
+            TEST_ASSERT(number >= next[index]);
+        }
+        next[index] = number + 1;
+        num_records++;
+    }
+    TEST_ASSERT(feof(file));
+    fclose(file);
+    return num_records;
+}
+
+/********************************************************************************
+ * @brief Logs with the blocking overflow policy and verifies that all records
+ *        are written, after the flush as well as after the deletion.
+ ********************************************************************************/
+static void test_block(void) {
+    const int fd = run_threads(ASYNC_LOGGER_OVERFLOW_BLOCK);
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) TEST_ASSERT_EQUAL(num_rejected[i], 0);
+    async_logger_flush(logger);
+    TEST_ASSERT_EQUAL(read_records(true), NUM_THREADS * NUM_RECORDS_PER_THREAD);
+    TEST_ASSERT_EQUAL(async_logger_num_dropped(logger), 0);
+
+    char text[32];
+    const int length = snprintf(text, sizeof(text), "0 %u\n", NUM_RECORDS_PER_THREAD);
+    TEST_ASSERT(async_logger_write(logger, text, (size_t)length));
+    async_logger_delete(&logger);
+    TEST_ASSERT(logger == 0);
+    TEST_ASSERT_EQUAL(read_records(true), NUM_THREADS * NUM_RECORDS_PER_THREAD + 1);
+    close(fd);
+    unlink(path);
+}
+
+/********************************************************************************
+ * @brief Logs with the dropping overflow policy and verifies that every record
+ *        is either written or dropped.
+ ********************************************************************************/
+static void test_drop(void) {
+    const int fd = run_threads(ASYNC_LOGGER_OVERFLOW_DROP);
+    uint32_t total_rejected = 0;
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) total_rejected += num_rejected[i];
+    TEST_ASSERT_EQUAL(async_logger_num_dropped(logger), total_rejected);
+    async_logger_delete(&logger);
+    TEST_ASSERT_EQUAL(read_records(false) + total_rejected, NUM_THREADS * NUM_RECORDS_PER_THREAD);
+    close(fd);
+    unlink(path);
+}
+
+/********************************************************************************
+ * @brief Runs the tests of the asynchronous logger.
+ ********************************************************************************/
+int main(void) {
+    test_block();
+    test_drop();
+    return 0;
+}
@@ -0,0 +1,146 @@
+/********************************************************************************
+ * @brief Test of the mutex in C, run for the plain and the priority-inheritance
+ *        mutex. Verifies that
+ *            - the mutex excludes all other threads, such that data written by
+ *              one owner is visible to the next, while threads lock it both
+ *              blocking and without waiting.
+ *            - only the owner of the mutex can unlock it.
+ *            - a forked child owns the mutexes it locks, i.e. it doesn't reuse
+ *              the thread ID of its parent.
+ ********************************************************************************/
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sync/mutex.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of threads locking the mutex.
+ ********************************************************************************/
+#define NUM_THREADS 6U
+
+/********************************************************************************
+ * @brief The number of acquisitions of each thread.
+ ********************************************************************************/
+#define NUM_LOCKS_PER_THREAD 50000U
+
+/********************************************************************************
+ * @brief State of a test run.
+ *
+ * @param mutex
+ *        The mutex under test.
+ * @param num_inside
+ *        The number of owners of the mutex.
+ * @param num_locks
+ *        Counter incremented non-atomically by each owner of the mutex.
+ ********************************************************************************/
+struct test_run {
+    struct sync_mutex* mutex;
+    _Atomic uint32_t num_inside;
+    uint32_t num_locks;
+};
+
+/********************************************************************************
+ * @brief Locks and unlocks the mutex of specified test run repeatedly,
+ *        verifying that it has a single owner meanwhile.
+ ********************************************************************************/
+static void* lock_mutex(void* arg) {
+    struct test_run* run = (struct test_run*)arg;
+    for (uint32_t i = 0; i < NUM_LOCKS_PER_THREAD; ++i) {
+        if (i % 8 == 0) {
+            while (!sync_mutex_try_lock(run->mutex)) sched_yield();
+        } else {
+            sync_mutex_lock(run->mutex);
+        }
+        TEST_ASSERT(sync_mutex_is_owner(run->mutex));
+        TEST_ASSERT_EQUAL(atomic_fetch_add(&run->num_inside, 1), 0);
+        run->num_locks++;
+        atomic_fetch_sub(&run->num_inside, 1);
+        TEST_ASSERT(sync_mutex_unlock(run->mutex));
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Tries to lock and unlock the mutex of specified test run, which is
+ *        owned by another thread.
+ ********************************************************************************/
+static void* steal_mutex(void* arg) {
+    struct test_run* run = (struct test_run*)arg;
+    TEST_ASSERT(!sync_mutex_is_owner(run->mutex));
+    TEST_ASSERT(!sync_mutex_try_lock(run->mutex));
+    TEST_ASSERT(!sync_mutex_unlock(run->mutex));
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs the threads against a mutex and verifies the ownership checks.
+ *
+ * @param create
+ *        The function creating the mutex.
+ ********************************************************************************/
+static void run_test(struct sync_mutex* (*create)(const char* name)) {
+    struct test_run run = {create("test_mutex"), 0, 0};
+    TEST_ASSERT(run.mutex != 0);
+    pthread_t threads[NUM_THREADS];
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) TEST_ASSERT(pthread_create(&threads[i], 0, lock_mutex, &run) == 0);
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) pthread_join(threads[i], 0);
+    TEST_ASSERT_EQUAL(run.num_locks, NUM_THREADS * NUM_LOCKS_PER_THREAD);
+
+    TEST_ASSERT(!sync_mutex_is_owner(run.mutex));
+    TEST_ASSERT(!sync_mutex_unlock(run.mutex));
+    sync_mutex_lock(run.mutex);
+    TEST_ASSERT(pthread_create(&threads[0], 0, steal_mutex, &run) == 0);
+    pthread_join(threads[0], 0);
+    TEST_ASSERT(sync_mutex_unlock(run.mutex));
+    TEST_ASSERT(sync_mutex_try_lock(run.mutex));
+    TEST_ASSERT(sync_mutex_unlock(run.mutex));
+
+    sync_mutex_delete(&run.mutex);
+    TEST_ASSERT(run.mutex == 0);
+}
+
+/********************************************************************************
+ * @brief Locks a mutex, forks a child which locks a mutex of its own, and
+ *        verifies the ownership in both processes.
+ *
+ * @param create
+ *        The function creating the mutex.
+ ********************************************************************************/
+static void test_fork(struct sync_mutex* (*create)(const char* name)) {
+    struct sync_mutex* mutex = create("test_mutex");
+    TEST_ASSERT(mutex != 0);
+    sync_mutex_lock(mutex);
+    const pid_t child = fork();
+    TEST_ASSERT(child >= 0);
+    if (child == 0) {
+        struct sync_mutex* own = create("test_mutex");
+        TEST_ASSERT(own != 0);
+        sync_mutex_lock(own);
+        TEST_ASSERT(sync_mutex_is_owner(own));
+        TEST_ASSERT(sync_mutex_unlock(own));
+        TEST_ASSERT(!sync_mutex_is_owner(mutex));
+        sync_mutex_delete(&own);
+        _exit(0);
+    }
+    int status = 0;
+    TEST_ASSERT(waitpid(child, &status, 0) == child);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    TEST_ASSERT(sync_mutex_is_owner(mutex));
+    TEST_ASSERT(sync_mutex_unlock(mutex));
+    sync_mutex_delete(&mutex);
+}
+
+/********************************************************************************
+ * @brief Runs the tests for the plain and the priority-inheritance mutex.
+ ********************************************************************************/
+int main(void) {
+    run_test(sync_mutex_new);
+    run_test(sync_mutex_new_pi);
+    test_fork(sync_mutex_new);
+    test_fork(sync_mutex_new_pi);
+    return 0;
+}
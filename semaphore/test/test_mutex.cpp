@@ -0,0 +1,134 @@
+/********************************************************************************
+ * @brief Test of the mutex in C++, run for the plain and the
+ *        priority-inheritance mutex. Verifies that
+ *            - the mutex excludes all other threads, such that data written by
+ *              one owner is visible to the next, while threads lock it via
+ *              std::lock_guard, std::unique_lock and without waiting.
+ *            - only the owner of the mutex can unlock it.
+ *            - a forked child owns the priority-inheritance mutexes it locks,
+ *              i.e. it doesn't reuse the cached thread ID of its parent.
+ ********************************************************************************/
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sync/mutex.h>
+#include "test.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief The number of threads locking the mutex.
+ ********************************************************************************/
+constexpr uint32_t num_threads{6};
+
+/********************************************************************************
+ * @brief The number of acquisitions of each thread.
+ ********************************************************************************/
+constexpr uint32_t num_locks_per_thread{50000};
+
+/********************************************************************************
+ * @brief Runs the threads against a mutex, verifying that it has a single
+ *        owner at any time.
+ *
+ * @tparam mutex_type
+ *         The type of the mutex.
+ ********************************************************************************/
+template <typename mutex_type>
+void TestExclusion(void) {
+    mutex_type mutex{"test_mutex"};
+    std::atomic<uint32_t> num_inside{};
+    uint32_t num_locks{};
+    const auto critical_section{[&]() {
+        TEST_ASSERT(mutex.is_owner());
+        TEST_ASSERT_EQUAL(num_inside.fetch_add(1), 0);
+        num_locks++;
+        num_inside.fetch_sub(1);
+    }};
+    std::vector<std::thread> threads{};
+    for (uint32_t i{}; i < num_threads; ++i) {
+        threads.emplace_back([&]() {
+            for (uint32_t j{}; j < num_locks_per_thread; ++j) {
+                if (j % 8 == 0) {
+                    while (!mutex.try_lock()) std::this_thread::yield();
+                    critical_section();
+                    TEST_ASSERT(mutex.unlock());
+                } else if (j % 2 == 0) {
+                    std::unique_lock<mutex_type> lock{mutex};
+                    critical_section();
+                } else {
+                    std::lock_guard<mutex_type> lock{mutex};
+                    critical_section();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    TEST_ASSERT_EQUAL(num_locks, num_threads * num_locks_per_thread);
+}
+
+/********************************************************************************
+ * @brief Verifies that a thread not owning the mutex can neither lock nor
+ *        unlock it.
+ *
+ * @tparam mutex_type
+ *         The type of the mutex.
+ ********************************************************************************/
+template <typename mutex_type>
+void TestOwnership(void) {
+    mutex_type mutex{"test_mutex"};
+    TEST_ASSERT(!mutex.is_owner());
+    TEST_ASSERT(!mutex.unlock());
+    mutex.lock();
+    TEST_ASSERT(mutex.is_owner());
+    std::thread{[&mutex]() {
+        TEST_ASSERT(!mutex.is_owner());
+        TEST_ASSERT(!mutex.try_lock());
+        TEST_ASSERT(!mutex.unlock());
+    }}.join();
+    TEST_ASSERT(mutex.unlock());
+    TEST_ASSERT(mutex.try_lock());
+    TEST_ASSERT(mutex.unlock());
+}
+
+/********************************************************************************
+ * @brief Locks a priority-inheritance mutex, forks a child which locks a mutex
+ *        of its own, and verifies the ownership in both processes.
+ ********************************************************************************/
+void TestFork(void) {
+    sync_pi_mutex mutex{"test_mutex"};
+    mutex.lock();
+    const pid_t child{fork()};
+    TEST_ASSERT(child >= 0);
+    if (child == 0) {
+        {
+            sync_pi_mutex own{"test_mutex"};
+            own.lock();
+            TEST_ASSERT(own.is_owner());
+            TEST_ASSERT(own.unlock());
+            TEST_ASSERT(!mutex.is_owner());
+        }
+        _exit(0);
+    }
+    int status{};
+    TEST_ASSERT(waitpid(child, &status, 0) == child);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    TEST_ASSERT(mutex.is_owner());
+    TEST_ASSERT(mutex.unlock());
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the tests for the plain and the priority-inheritance mutex.
+ ********************************************************************************/
+int main(void) {
+    TestExclusion<sync_mutex>();
+    TestExclusion<sync_pi_mutex>();
+    TestOwnership<sync_mutex>();
+    TestOwnership<sync_pi_mutex>();
+    TestFork();
+    return 0;
+}
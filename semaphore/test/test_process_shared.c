@@ -0,0 +1,291 @@
+/********************************************************************************
+ * @brief Test of the process-shared primitives in C, i.e. the binary semaphore
+ *        bank, the process-shared counting semaphore and the shared mutex,
+ *        placed in memory shared by forked processes. Verifies that
+ *            - the primitives exclude the threads of all processes, such that
+ *              data written by one holder is visible to the next, also for
+ *              masks spanning two shards of the bank.
+ *            - invalid banks, identifiers and masks as well as options that
+ *              can't be shared are rejected.
+ *            - a parked thread takes over the shared mutex of an owner process
+ *              that was killed and reports it, and that the mutex keeps
+ *              working if marked consistent and becomes unrecoverable if not,
+ *              also for threads parked on it meanwhile.
+ ********************************************************************************/
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sync/cache_line.h>
+#include <sync/mutex.h>
+#include <sync/semaphore.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of forked processes, next to the parent process.
+ ********************************************************************************/
+#define NUM_CHILDREN 3U
+
+/********************************************************************************
+ * @brief The number of threads of each process.
+ ********************************************************************************/
+#define NUM_THREADS_PER_PROCESS 2U
+
+/********************************************************************************
+ * @brief The number of acquisitions of each thread.
+ ********************************************************************************/
+#define NUM_TAKES_PER_THREAD 20000U
+
+/********************************************************************************
+ * @brief The number of semaphores of the bank.
+ ********************************************************************************/
+#define NUM_BANK_SEMAPHORES 64U
+
+/********************************************************************************
+ * @brief The first ID of the mask taken from the bank, so that the mask spans
+ *        the first two shards.
+ ********************************************************************************/
+#define MASK_FIRST_ID 30U
+
+/********************************************************************************
+ * @brief The number of resources of the counting semaphore.
+ ********************************************************************************/
+#define NUM_RESOURCES 2U
+
+/********************************************************************************
+ * @brief Region shared by all processes.
+ *
+ * @param bank
+ *        Memory of the binary semaphore bank.
+ * @param mutex
+ *        Memory of the shared mutex.
+ * @param sem
+ *        Storage of the counting semaphore.
+ * @param num_locks
+ *        Counter incremented non-atomically by each owner of the mutex.
+ * @param num_mask_takes
+ *        Counter incremented non-atomically by each holder of the mask.
+ * @param num_inside
+ *        The number of holders of the counting semaphore.
+ * @param is_locked
+ *        Set by a child once it locked the mutex.
+ ********************************************************************************/
+struct shared_region {
+    SYNC_CACHE_ALIGNED unsigned char bank[1024];
+    SYNC_CACHE_ALIGNED unsigned char mutex[256];
+    struct counting_semaphore_storage sem;
+    uint32_t num_locks;
+    uint32_t num_mask_takes;
+    _Atomic uint32_t num_inside;
+    _Atomic bool is_locked;
+};
+
+/********************************************************************************
+ * @brief The region, mapped before the processes are forked.
+ ********************************************************************************/
+static struct shared_region* region = 0;
+
+/********************************************************************************
+ * @brief Takes and releases the primitives of the region repeatedly, verifying
+ *        the number of holders meanwhile.
+ ********************************************************************************/
+static void* use_primitives(void* arg) {
+    (void)arg;
+    struct sync_shared_mutex* mutex = sync_shared_mutex_from_memory(region->mutex);
+    struct binary_semaphore_bank* bank = binary_semaphore_bank_from_memory(region->bank);
+    struct counting_semaphore* sem = counting_semaphore_from_storage(&region->sem);
+    for (uint32_t i = 0; i < NUM_TAKES_PER_THREAD; ++i) {
+        TEST_ASSERT_EQUAL(sync_shared_mutex_lock(mutex), SYNC_MUTEX_ACQUIRED);
+        region->num_locks++;
+        TEST_ASSERT(sync_shared_mutex_unlock(mutex));
+
+        TEST_ASSERT(binary_semaphore_bank_take_mask(bank, MASK_FIRST_ID, 0x7));
+        region->num_mask_takes++;
+        TEST_ASSERT(binary_semaphore_bank_release_mask(bank, MASK_FIRST_ID, 0x7));
+
+        counting_semaphore_take(sem);
+        TEST_ASSERT(atomic_fetch_add(&region->num_inside, 1) < NUM_RESOURCES);
+        atomic_fetch_sub(&region->num_inside, 1);
+        counting_semaphore_release(sem);
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs the threads of the calling process.
+ ********************************************************************************/
+static void run_threads(void) {
+    pthread_t threads[NUM_THREADS_PER_PROCESS];
+    for (uint32_t i = 0; i < NUM_THREADS_PER_PROCESS; ++i) {
+        TEST_ASSERT(pthread_create(&threads[i], 0, use_primitives, 0) == 0);
+    }
+    for (uint32_t i = 0; i < NUM_THREADS_PER_PROCESS; ++i) pthread_join(threads[i], 0);
+}
+
+/********************************************************************************
+ * @brief Waits for specified child process and verifies that it succeeded.
+ ********************************************************************************/
+static void wait_child(const pid_t child) {
+    int status = 0;
+    TEST_ASSERT(waitpid(child, &status, 0) == child);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+/********************************************************************************
+ * @brief Forks a child process that locks the shared mutex and keeps it until
+ *        it is killed.
+ *
+ * @return
+ *        The process ID of the child, once it owns the mutex.
+ ********************************************************************************/
+static pid_t fork_owner(void) {
+    atomic_store(&region->is_locked, false);
+    const pid_t child = fork();
+    TEST_ASSERT(child >= 0);
+    if (child == 0) {
+        sync_shared_mutex_lock(sync_shared_mutex_from_memory(region->mutex));
+        atomic_store(&region->is_locked, true);
+        while (1) pause();
+    }
+    while (!atomic_load(&region->is_locked)) usleep(1000);
+    return child;
+}
+
+/********************************************************************************
+ * @brief Kills specified child process and reaps it.
+ ********************************************************************************/
+static void kill_child(const pid_t child) {
+    TEST_ASSERT(kill(child, SIGKILL) == 0);
+    int status = 0;
+    TEST_ASSERT(waitpid(child, &status, 0) == child);
+    TEST_ASSERT(WIFSIGNALED(status));
+}
+
+/********************************************************************************
+ * @brief Locks the shared mutex while its owner is alive and verifies that
+ *        its death is reported.
+ ********************************************************************************/
+static void* lock_owned(void* arg) {
+    (void)arg;
+    struct sync_shared_mutex* mutex = sync_shared_mutex_from_memory(region->mutex);
+    TEST_ASSERT_EQUAL(sync_shared_mutex_lock(mutex), SYNC_MUTEX_OWNER_DIED);
+    TEST_ASSERT(sync_shared_mutex_consistent(mutex));
+    TEST_ASSERT(!sync_shared_mutex_consistent(mutex));
+    TEST_ASSERT(sync_shared_mutex_unlock(mutex));
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Locks the shared mutex while it is owned by a thread that recovered
+ *        it and unlocks it without marking it consistent.
+ ********************************************************************************/
+static void* lock_abandoned(void* arg) {
+    (void)arg;
+    struct sync_shared_mutex* mutex = sync_shared_mutex_from_memory(region->mutex);
+    TEST_ASSERT_EQUAL(sync_shared_mutex_lock(mutex), SYNC_MUTEX_NOT_RECOVERABLE);
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Verifies the validation of the bank and of the semaphore options.
+ ********************************************************************************/
+static void test_validation(void) {
+    TEST_ASSERT(binary_semaphore_bank_size(NUM_BANK_SEMAPHORES) <= sizeof(region->bank));
+    TEST_ASSERT(binary_semaphore_bank_init(region->bank, 0) == 0);
+    TEST_ASSERT(binary_semaphore_bank_init(region->bank + 8, NUM_BANK_SEMAPHORES) == 0);
+    struct binary_semaphore_bank* bank = binary_semaphore_bank_init(region->bank, NUM_BANK_SEMAPHORES);
+    TEST_ASSERT(bank == binary_semaphore_bank_from_memory(region->bank));
+    TEST_ASSERT(!binary_semaphore_bank_take(bank, NUM_BANK_SEMAPHORES));
+    TEST_ASSERT(!binary_semaphore_bank_release(bank, NUM_BANK_SEMAPHORES));
+    TEST_ASSERT(!binary_semaphore_bank_take_mask(bank, MASK_FIRST_ID, 0));
+    TEST_ASSERT(!binary_semaphore_bank_take_mask(bank, NUM_BANK_SEMAPHORES - 1, 0x3));
+    TEST_ASSERT(binary_semaphore_bank_take(bank, NUM_BANK_SEMAPHORES - 1));
+    TEST_ASSERT(binary_semaphore_bank_release(bank, NUM_BANK_SEMAPHORES - 1));
+
+    struct counting_semaphore_options options = {0};
+    options.process_shared = true;
+    options.fairness = SEMAPHORE_FAIR_QUEUE;
+    TEST_ASSERT(counting_semaphore_init(&region->sem, NUM_RESOURCES, &options) == 0);
+    options.fairness = SEMAPHORE_FAIR_NONE;
+    options.pollable = true;
+    TEST_ASSERT(counting_semaphore_init(&region->sem, NUM_RESOURCES, &options) == 0);
+    options.pollable = false;
+    options.fairness = SEMAPHORE_FAIR_TICKET;
+    TEST_ASSERT(counting_semaphore_init(&region->sem, NUM_RESOURCES, &options) == counting_semaphore_from_storage(&region->sem));
+}
+
+/********************************************************************************
+ * @brief Runs the threads of all processes against the primitives.
+ ********************************************************************************/
+static void test_sharing(void) {
+    pid_t children[NUM_CHILDREN];
+    for (uint32_t i = 0; i < NUM_CHILDREN; ++i) {
+        children[i] = fork();
+        TEST_ASSERT(children[i] >= 0);
+        if (children[i] == 0) {
+            run_threads();
+            _exit(0);
+        }
+    }
+    run_threads();
+    for (uint32_t i = 0; i < NUM_CHILDREN; ++i) wait_child(children[i]);
+    const uint32_t num_takes = (NUM_CHILDREN + 1) * NUM_THREADS_PER_PROCESS * NUM_TAKES_PER_THREAD;
+    TEST_ASSERT_EQUAL(region->num_locks, num_takes);
+    TEST_ASSERT_EQUAL(region->num_mask_takes, num_takes);
+    struct counting_semaphore* sem = counting_semaphore_from_storage(&region->sem);
+    TEST_ASSERT_EQUAL(counting_semaphore_num_available(sem), NUM_RESOURCES);
+    TEST_ASSERT(counting_semaphore_try_take_n(sem, NUM_RESOURCES));
+    TEST_ASSERT(counting_semaphore_release_n(sem, NUM_RESOURCES));
+}
+
+/********************************************************************************
+ * @brief Kills owners of the shared mutex, once while a thread is parked on
+ *        the mutex and once while it is unlocked, and verifies the recovery.
+ ********************************************************************************/
+static void test_owner_died(void) {
+    struct sync_shared_mutex* mutex = sync_shared_mutex_from_memory(region->mutex);
+    pid_t child = fork_owner();
+    TEST_ASSERT_EQUAL(sync_shared_mutex_try_lock(mutex), SYNC_MUTEX_BUSY);
+    TEST_ASSERT(!sync_shared_mutex_unlock(mutex));
+    pthread_t thread;
+    TEST_ASSERT(pthread_create(&thread, 0, lock_owned, 0) == 0);
+    usleep(20000);
+    kill_child(child);
+    pthread_join(thread, 0);
+    TEST_ASSERT_EQUAL(sync_shared_mutex_lock(mutex), SYNC_MUTEX_ACQUIRED);
+    TEST_ASSERT(!sync_shared_mutex_consistent(mutex));
+    TEST_ASSERT(sync_shared_mutex_unlock(mutex));
+
+    child = fork_owner();
+    kill_child(child);
+    TEST_ASSERT_EQUAL(sync_shared_mutex_try_lock(mutex), SYNC_MUTEX_OWNER_DIED);
+    pthread_t threads[NUM_THREADS_PER_PROCESS + 1];
+    for (uint32_t i = 0; i <= NUM_THREADS_PER_PROCESS; ++i) {
+        TEST_ASSERT(pthread_create(&threads[i], 0, lock_abandoned, 0) == 0);
+    }
+    usleep(20000);
+    TEST_ASSERT(sync_shared_mutex_unlock(mutex));
+    for (uint32_t i = 0; i <= NUM_THREADS_PER_PROCESS; ++i) pthread_join(threads[i], 0);
+    TEST_ASSERT_EQUAL(sync_shared_mutex_lock(mutex), SYNC_MUTEX_NOT_RECOVERABLE);
+    TEST_ASSERT_EQUAL(sync_shared_mutex_try_lock(mutex), SYNC_MUTEX_NOT_RECOVERABLE);
+}
+
+/********************************************************************************
+ * @brief Maps the shared region, initializes the primitives and runs the tests.
+ ********************************************************************************/
+int main(void) {
+    region = (struct shared_region*)mmap(0, sizeof(struct shared_region), PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    TEST_ASSERT(region != MAP_FAILED);
+    TEST_ASSERT(sync_shared_mutex_size() <= sizeof(region->mutex));
+    TEST_ASSERT(sync_shared_mutex_init(region->mutex) == sync_shared_mutex_from_memory(region->mutex));
+    test_validation();
+    test_sharing();
+    test_owner_died();
+    counting_semaphore_destroy(counting_semaphore_from_storage(&region->sem));
+    TEST_ASSERT(munmap(region, sizeof(struct shared_region)) == 0);
+    return 0;
+}
@@ -0,0 +1,131 @@
+/********************************************************************************
+ * @brief Test of the MPMC queue in C. Several producers push unique items
+ *        through a small queue to several consumers, which verifies that no
+ *        item is lost or popped twice, that the items of each producer are
+ *        popped in FIFO order and that the whole element written by the
+ *        producer is visible to the consumer.
+ ********************************************************************************/
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sync/queue.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of producer and consumer threads respectively.
+ ********************************************************************************/
+#define NUM_THREADS 4U
+
+/********************************************************************************
+ * @brief The number of items pushed by each producer.
+ ********************************************************************************/
+#define NUM_ITEMS_PER_PRODUCER 50000U
+
+/********************************************************************************
+ * @brief Item passed through the queue.
+ *
+ * @param producer
+ *        The index of the producer.
+ * @param seq
+ *        The sequence number of the item among the items of its producer.
+ * @param check
+ *        Value derived from the other members, so that a partially visible
+ *        element is detected.
+ ********************************************************************************/
+struct item {
+    uint32_t producer;
+    uint32_t seq;
+    uint64_t check;
+};
+
+/********************************************************************************
+ * @brief The queue under test, small enough to be full and empty frequently.
+ ********************************************************************************/
+static struct mpmc_queue* queue = 0;
+
+/********************************************************************************
+ * @brief The number of times each item was popped.
+ ********************************************************************************/
+static _Atomic uint8_t num_pops[NUM_THREADS][NUM_ITEMS_PER_PRODUCER];
+
+/********************************************************************************
+ * @brief The number of items popped by all consumers.
+ ********************************************************************************/
+static _Atomic uint32_t num_popped = 0;
+
+/********************************************************************************
+ * @brief Provides the check value of specified item.
+ ********************************************************************************/
+static inline uint64_t item_check(const uint32_t producer, const uint32_t seq) {
+    return ((uint64_t)producer << 32 | seq) * 0x9E3779B97F4A7C15ULL;
+}
+
+/********************************************************************************
+ * @brief Pushes the items of the producer of specified index.
+ ********************************************************************************/
+static void* produce(void* arg) {
+    const uint32_t producer = (uint32_t)(uintptr_t)arg;
+    for (uint32_t seq = 0; seq < NUM_ITEMS_PER_PRODUCER; ++seq) {
+        const struct item item = {producer, seq, item_check(producer, seq)};
+        while (!mpmc_queue_try_push(queue, &item)) sched_yield();
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Pops items until all items have been popped, recording each item and
+ *        verifying the order per producer.
+ ********************************************************************************/
+static void* consume(void* arg) {
+    (void)arg;
+    int64_t last_seq[NUM_THREADS];
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) last_seq[i] = -1;
+    while (atomic_load(&num_popped) < NUM_THREADS * NUM_ITEMS_PER_PRODUCER) {
+        struct item item;
+        if (!mpmc_queue_try_pop(queue, &item)) {
+            sched_yield();
+            continue;
+        }
+        TEST_ASSERT(item.producer < NUM_THREADS && item.seq < NUM_ITEMS_PER_PRODUCER);
+        TEST_ASSERT(item.check == item_check(item.producer, item.seq));
+        TEST_ASSERT(item.seq > last_seq[item.producer]);
+        last_seq[item.producer] = item.seq;
+        atomic_fetch_add(&num_pops[item.producer][item.seq], 1);
+        atomic_fetch_add(&num_popped, 1);
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs the producers and consumers and verifies that each item was
+ *        popped exactly once.
+ ********************************************************************************/
+int main(void) {
+    TEST_ASSERT(mpmc_queue_new(3, sizeof(struct item)) == 0);
+    queue = mpmc_queue_new(16, sizeof(struct item));
+    TEST_ASSERT(queue != 0);
+    TEST_ASSERT_EQUAL(mpmc_queue_capacity(queue), 16);
+
+    pthread_t producers[NUM_THREADS], consumers[NUM_THREADS];
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) {
+        TEST_ASSERT(pthread_create(&producers[i], 0, produce, (void*)(uintptr_t)i) == 0);
+        TEST_ASSERT(pthread_create(&consumers[i], 0, consume, 0) == 0);
+    }
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) {
+        pthread_join(producers[i], 0);
+        pthread_join(consumers[i], 0);
+    }
+
+    for (uint32_t producer = 0; producer < NUM_THREADS; ++producer) {
+        for (uint32_t seq = 0; seq < NUM_ITEMS_PER_PRODUCER; ++seq) {
+            TEST_ASSERT_EQUAL(num_pops[producer][seq], 1);
+        }
+    }
+    TEST_ASSERT_EQUAL(mpmc_queue_size(queue), 0);
+    struct item item;
+    TEST_ASSERT(!mpmc_queue_try_pop(queue, &item));
+    mpmc_queue_delete(&queue);
+    TEST_ASSERT(queue == 0);
+    return 0;
+}
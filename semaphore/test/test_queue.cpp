@@ -0,0 +1,97 @@
+/********************************************************************************
+ * @brief Test of the MPMC queue in C++. Several producers move unique items
+ *        through a small queue to several consumers, which verifies that no
+ *        item is lost or popped twice, that the items of each producer are
+ *        popped in FIFO order and that an element constructed by a producer
+ *        is completely visible to the consumer.
+ ********************************************************************************/
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <sync/queue.h>
+#include "test.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief The number of producer and consumer threads respectively.
+ ********************************************************************************/
+constexpr uint32_t num_threads{4};
+
+/********************************************************************************
+ * @brief The number of items pushed by each producer.
+ ********************************************************************************/
+constexpr uint32_t num_items_per_producer{50000};
+
+/********************************************************************************
+ * @brief Item passed through the queue by unique pointer, so that the queue
+ *        moves an element which owns memory.
+ *
+ * @param producer
+ *        The index of the producer.
+ * @param seq
+ *        The sequence number of the item among the items of its producer.
+ * @param check
+ *        Value derived from the other members, so that a partially visible
+ *        element is detected.
+ ********************************************************************************/
+struct item {
+    uint32_t producer;
+    uint32_t seq;
+    uint64_t check;
+};
+
+/********************************************************************************
+ * @brief Provides the check value of specified item.
+ ********************************************************************************/
+constexpr uint64_t CheckOf(const uint32_t producer, const uint32_t seq) {
+    return (static_cast<uint64_t>(producer) << 32 | seq) * 0x9E3779B97F4A7C15ULL;
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the producers and consumers and verifies that each item was
+ *        popped exactly once.
+ ********************************************************************************/
+int main(void) {
+    mpmc_queue<std::unique_ptr<item>, 16> queue{};
+    TEST_ASSERT_EQUAL(queue.max_size(), 16);
+    std::unique_ptr<std::atomic<uint8_t>[]> num_pops{new std::atomic<uint8_t>[num_threads * num_items_per_producer]{}};
+    std::atomic<uint32_t> num_popped{};
+
+    std::vector<std::thread> threads{};
+    for (uint32_t i{}; i < num_threads; ++i) {
+        threads.emplace_back([&queue, i]() {
+            for (uint32_t seq{}; seq < num_items_per_producer; ++seq) {
+                auto element{std::make_unique<item>(item{i, seq, CheckOf(i, seq)})};
+                while (!queue.try_push(std::move(element))) std::this_thread::yield();
+            }
+        });
+        threads.emplace_back([&queue, &num_pops, &num_popped]() {
+            int64_t last_seq[num_threads];
+            for (auto& seq : last_seq) seq = -1;
+            while (num_popped.load() < num_threads * num_items_per_producer) {
+                std::unique_ptr<item> element{};
+                if (!queue.try_pop(element)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                TEST_ASSERT(element && element->producer < num_threads && element->seq < num_items_per_producer);
+                TEST_ASSERT(element->check == CheckOf(element->producer, element->seq));
+                TEST_ASSERT(element->seq > last_seq[element->producer]);
+                last_seq[element->producer] = element->seq;
+                num_pops[element->producer * num_items_per_producer + element->seq].fetch_add(1);
+                num_popped.fetch_add(1);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    for (uint32_t i{}; i < num_threads * num_items_per_producer; ++i) TEST_ASSERT_EQUAL(num_pops[i].load(), 1);
+    TEST_ASSERT_EQUAL(queue.size(), 0);
+    std::unique_ptr<item> element{};
+    TEST_ASSERT(!queue.try_pop(element));
+    return 0;
+}
@@ -0,0 +1,131 @@
+/********************************************************************************
+ * @brief Test of the resource pool in C, run for several wait policies.
+ *        Verifies that
+ *            - each object is used by a single thread at a time, such that data
+ *              written by one user is visible to the next, while threads
+ *              acquire objects both blocking and without waiting.
+ *            - an object can't be acquired while all objects are in use.
+ *            - objects not belonging to the pool and objects released twice
+ *              are rejected, and leave the free-list intact.
+ ********************************************************************************/
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sync/resource_pool.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of objects of the pool.
+ ********************************************************************************/
+#define NUM_OBJECTS 3U
+
+/********************************************************************************
+ * @brief The number of threads acquiring objects.
+ ********************************************************************************/
+#define NUM_THREADS 6U
+
+/********************************************************************************
+ * @brief The number of acquisitions of each thread.
+ ********************************************************************************/
+#define NUM_ACQUISITIONS_PER_THREAD 50000U
+
+/********************************************************************************
+ * @brief Object of the pool.
+ *
+ * @param num_users
+ *        The number of threads using the object.
+ * @param num_uses
+ *        Counter incremented non-atomically by each user of the object.
+ ********************************************************************************/
+struct test_object {
+    _Atomic uint32_t num_users;
+    uint32_t num_uses;
+};
+
+/********************************************************************************
+ * @brief The pool under test.
+ ********************************************************************************/
+static struct resource_pool* pool = 0;
+
+/********************************************************************************
+ * @brief Acquires and releases objects of the pool repeatedly, verifying that
+ *        each has a single user meanwhile.
+ ********************************************************************************/
+static void* use_objects(void* arg) {
+    (void)arg;
+    for (uint32_t i = 0; i < NUM_ACQUISITIONS_PER_THREAD; ++i) {
+        struct test_object* object = 0;
+        if (i % 8 == 0) {
+            while (!(object = (struct test_object*)resource_pool_try_acquire(pool))) sched_yield();
+        } else {
+            object = (struct test_object*)resource_pool_acquire(pool);
+        }
+        TEST_ASSERT_EQUAL(atomic_fetch_add(&object->num_users, 1), 0);
+        object->num_uses++;
+        atomic_fetch_sub(&object->num_users, 1);
+        TEST_ASSERT(resource_pool_release(pool, object));
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs the threads against a pool with specified semaphore options.
+ *
+ * @param options
+ *        Reference to the options of the semaphore, nullptr selects the
+ *        defaults.
+ ********************************************************************************/
+static void run_test(const struct counting_semaphore_options* options) {
+    pool = resource_pool_new(NUM_OBJECTS, sizeof(struct test_object), options);
+    TEST_ASSERT(pool != 0);
+    TEST_ASSERT_EQUAL(resource_pool_num_available(pool), NUM_OBJECTS);
+    pthread_t threads[NUM_THREADS];
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) TEST_ASSERT(pthread_create(&threads[i], 0, use_objects, 0) == 0);
+    for (uint32_t i = 0; i < NUM_THREADS; ++i) pthread_join(threads[i], 0);
+
+    struct test_object* objects[NUM_OBJECTS];
+    uint32_t num_uses = 0;
+    for (uint32_t i = 0; i < NUM_OBJECTS; ++i) {
+        objects[i] = (struct test_object*)resource_pool_try_acquire(pool);
+        TEST_ASSERT(objects[i] != 0);
+        for (uint32_t j = 0; j < i; ++j) TEST_ASSERT(objects[i] != objects[j]);
+        num_uses += objects[i]->num_uses;
+    }
+    TEST_ASSERT_EQUAL(num_uses, NUM_THREADS * NUM_ACQUISITIONS_PER_THREAD);
+    TEST_ASSERT_EQUAL(resource_pool_num_available(pool), 0);
+    TEST_ASSERT(resource_pool_try_acquire(pool) == 0);
+
+    TEST_ASSERT(!resource_pool_release(pool, (unsigned char*)objects[0] + 1));
+    TEST_ASSERT(!resource_pool_release(pool, &num_uses));
+    TEST_ASSERT(resource_pool_release(pool, objects[0]));
+    TEST_ASSERT(!resource_pool_release(pool, objects[0]));
+    TEST_ASSERT_EQUAL(resource_pool_num_available(pool), 1);
+    TEST_ASSERT(resource_pool_acquire(pool) == objects[0]);
+    TEST_ASSERT(resource_pool_try_acquire(pool) == 0);
+    for (uint32_t i = 0; i < NUM_OBJECTS; ++i) TEST_ASSERT(resource_pool_release(pool, objects[i]));
+    TEST_ASSERT_EQUAL(resource_pool_num_available(pool), NUM_OBJECTS);
+
+    resource_pool_delete(&pool);
+    TEST_ASSERT(pool == 0);
+}
+
+/********************************************************************************
+ * @brief Runs the test with the default options and each wait policy, and
+ *        verifies that invalid pools are rejected.
+ ********************************************************************************/
+int main(void) {
+    TEST_ASSERT(resource_pool_new(0, sizeof(struct test_object), 0) == 0);
+    TEST_ASSERT(resource_pool_new(RESOURCE_POOL_NIL, sizeof(struct test_object), 0) == 0);
+    TEST_ASSERT(resource_pool_new(NUM_OBJECTS, 0, 0) == 0);
+    run_test(0);
+    const enum semaphore_wait_policy wait_policies[] = {
+        SEMAPHORE_WAIT_ADAPTIVE, SEMAPHORE_WAIT_SPIN, SEMAPHORE_WAIT_PARK,
+    };
+    for (uint32_t w = 0; w < sizeof(wait_policies) / sizeof(wait_policies[0]); ++w) {
+        struct counting_semaphore_options options = {0};
+        options.wait_policy = wait_policies[w];
+        run_test(&options);
+    }
+    return 0;
+}
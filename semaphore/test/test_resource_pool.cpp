@@ -0,0 +1,109 @@
+/********************************************************************************
+ * @brief Test of the resource pool in C++, run for several wait policies.
+ *        Verifies that
+ *            - each object is used by a single thread at a time, such that data
+ *              written by one user is visible to the next, while threads
+ *              acquire objects blocking, without waiting and with a timeout.
+ *            - an object can't be acquired while all objects are in use.
+ *            - objects not belonging to the pool and objects released twice
+ *              are rejected, and leave the free-list intact.
+ ********************************************************************************/
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <sync/resource_pool.h>
+#include "test.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief The number of objects of the pool.
+ ********************************************************************************/
+constexpr uint16_t num_objects{3};
+
+/********************************************************************************
+ * @brief The number of threads acquiring objects.
+ ********************************************************************************/
+constexpr uint32_t num_threads{6};
+
+/********************************************************************************
+ * @brief The number of acquisitions of each thread.
+ ********************************************************************************/
+constexpr uint32_t num_acquisitions_per_thread{50000};
+
+/********************************************************************************
+ * @brief Object of the pool.
+ ********************************************************************************/
+struct TestObject {
+    std::atomic<uint32_t> num_users{};  /* The number of threads using the object. */
+    uint32_t num_uses{};                /* Incremented non-atomically by each user. */
+};
+
+/********************************************************************************
+ * @brief Runs the threads against a pool with specified wait policy.
+ *
+ * @tparam wait_policy
+ *         The wait policy of the pool.
+ ********************************************************************************/
+template <typename wait_policy>
+void RunTest(void) {
+    resource_pool<TestObject, num_objects, wait_policy> pool{"test_resource_pool"};
+    TEST_ASSERT_EQUAL(pool.num_available(), num_objects);
+    std::vector<std::thread> threads{};
+    for (uint32_t i{}; i < num_threads; ++i) {
+        threads.emplace_back([&pool]() {
+            for (uint32_t j{}; j < num_acquisitions_per_thread; ++j) {
+                TestObject* object{};
+                if (j % 8 == 0) {
+                    while (!(object = pool.try_acquire())) std::this_thread::yield();
+                } else if (j % 8 == 1) {
+                    while (!(object = pool.try_acquire_for(std::chrono::milliseconds(1)))) {}
+                } else {
+                    object = pool.acquire();
+                }
+                TEST_ASSERT_EQUAL(object->num_users.fetch_add(1), 0);
+                object->num_uses++;
+                object->num_users.fetch_sub(1);
+                TEST_ASSERT(pool.release(object));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    TestObject* objects[num_objects]{};
+    uint32_t num_uses{};
+    for (uint16_t i{}; i < num_objects; ++i) {
+        objects[i] = pool.try_acquire();
+        TEST_ASSERT(objects[i] != nullptr);
+        for (uint16_t j{}; j < i; ++j) TEST_ASSERT(objects[i] != objects[j]);
+        num_uses += objects[i]->num_uses;
+    }
+    TEST_ASSERT_EQUAL(num_uses, num_threads * num_acquisitions_per_thread);
+    TEST_ASSERT_EQUAL(pool.num_available(), 0);
+    TEST_ASSERT(pool.try_acquire() == nullptr);
+    TEST_ASSERT(pool.try_acquire_for(std::chrono::milliseconds(5)) == nullptr);
+
+    TestObject other{};
+    TEST_ASSERT(!pool.release(&other));
+    TEST_ASSERT(!pool.release(reinterpret_cast<TestObject*>(reinterpret_cast<char*>(objects[0]) + 4)));
+    TEST_ASSERT(pool.release(objects[0]));
+    TEST_ASSERT(!pool.release(objects[0]));
+    TEST_ASSERT_EQUAL(pool.num_available(), 1);
+    TEST_ASSERT(pool.acquire() == objects[0]);
+    TEST_ASSERT(pool.try_acquire() == nullptr);
+    for (auto object : objects) TEST_ASSERT(pool.release(object));
+    TEST_ASSERT_EQUAL(pool.num_available(), num_objects);
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the test with each wait policy.
+ ********************************************************************************/
+int main(void) {
+    RunTest<semaphore_wait_adaptive<>>();
+    RunTest<semaphore_wait_spin>();
+    RunTest<semaphore_wait_park>();
+    return 0;
+}
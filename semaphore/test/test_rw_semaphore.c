@@ -0,0 +1,194 @@
+/********************************************************************************
+ * @brief Test of the reader-writer semaphore in C. Verifies that
+ *            - writers exclude each other and all readers, while readers may
+ *              share the semaphore, and that data written by a writer is
+ *              visible to subsequent readers and writers.
+ *            - writers are preferred: once a writer waits for the readers to
+ *              leave, new readers wait until the writer has released the
+ *              semaphore.
+ ********************************************************************************/
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <sync/semaphore.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of reader and writer threads of the exclusion test.
+ ********************************************************************************/
+#define NUM_READERS 6U
+#define NUM_WRITERS 2U
+
+/********************************************************************************
+ * @brief The number of acquisitions of each reader and writer.
+ ********************************************************************************/
+#define NUM_READS_PER_READER 100000U
+#define NUM_WRITES_PER_WRITER 20000U
+
+/********************************************************************************
+ * @brief The semaphore under test.
+ ********************************************************************************/
+static struct rw_semaphore* sem = 0;
+
+/********************************************************************************
+ * @brief The number of readers and writers holding the semaphore.
+ ********************************************************************************/
+static _Atomic uint32_t num_readers_inside = 0;
+static _Atomic uint32_t num_writers_inside = 0;
+
+/********************************************************************************
+ * @brief Data written non-atomically by the writers, whose members are always
+ *        equal outside of a write section.
+ ********************************************************************************/
+static uint64_t shared_a = 0;
+static uint64_t shared_b = 0;
+
+/********************************************************************************
+ * @brief Blocks the calling thread for specified time in milliseconds.
+ ********************************************************************************/
+static void delay_ms(const long time_ms) {
+    const struct timespec delay = {time_ms / 1000, (time_ms % 1000) * 1000000L};
+    nanosleep(&delay, 0);
+}
+
+/********************************************************************************
+ * @brief Takes the semaphore for reading repeatedly, verifying that no writer
+ *        is inside and that the shared data is consistent.
+ ********************************************************************************/
+static void* read_shared(void* arg) {
+    (void)arg;
+    for (uint32_t i = 0; i < NUM_READS_PER_READER; ++i) {
+        if (i % 4 == 0) {
+            while (!rw_semaphore_try_take_read(sem)) sched_yield();
+        } else {
+            rw_semaphore_take_read(sem);
+        }
+        atomic_fetch_add(&num_readers_inside, 1);
+        TEST_ASSERT_EQUAL(atomic_load(&num_writers_inside), 0);
+        TEST_ASSERT(shared_a == shared_b);
+        atomic_fetch_sub(&num_readers_inside, 1);
+        rw_semaphore_release_read(sem);
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Takes the semaphore for writing repeatedly, verifying that nobody
+ *        else is inside, and updates the shared data.
+ ********************************************************************************/
+static void* write_shared(void* arg) {
+    (void)arg;
+    for (uint32_t i = 0; i < NUM_WRITES_PER_WRITER; ++i) {
+        if (i % 4 == 0) {
+            while (!rw_semaphore_try_take_write(sem)) sched_yield();
+        } else {
+            rw_semaphore_take_write(sem);
+        }
+        TEST_ASSERT_EQUAL(atomic_fetch_add(&num_writers_inside, 1), 0);
+        TEST_ASSERT_EQUAL(atomic_load(&num_readers_inside), 0);
+        TEST_ASSERT(shared_a == shared_b);
+        shared_a++;
+        shared_b++;
+        atomic_fetch_sub(&num_writers_inside, 1);
+        rw_semaphore_release_write(sem);
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief State of the writer preference test.
+ *
+ * @param reader_holds
+ *        Set by the first reader once it holds the semaphore.
+ * @param release_reader
+ *        Set to make the first reader release the semaphore.
+ * @param writer_done
+ *        Set by the writer once it held the semaphore.
+ * @param late_reader_done
+ *        Set by the late reader once it held the semaphore.
+ ********************************************************************************/
+static _Atomic bool reader_holds = false;
+static _Atomic bool release_reader = false;
+static _Atomic bool writer_done = false;
+static _Atomic bool late_reader_done = false;
+
+/********************************************************************************
+ * @brief Holds the semaphore for reading until told to release it.
+ ********************************************************************************/
+static void* hold_read(void* arg) {
+    (void)arg;
+    rw_semaphore_take_read(sem);
+    atomic_store(&reader_holds, true);
+    while (!atomic_load(&release_reader)) delay_ms(1);
+    rw_semaphore_release_read(sem);
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Takes the semaphore for writing while the first reader holds it.
+ ********************************************************************************/
+static void* take_write(void* arg) {
+    (void)arg;
+    rw_semaphore_take_write(sem);
+    TEST_ASSERT(!atomic_load(&late_reader_done));
+    delay_ms(10);
+    atomic_store(&writer_done, true);
+    rw_semaphore_release_write(sem);
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Takes the semaphore for reading while the writer waits.
+ ********************************************************************************/
+static void* take_late_read(void* arg) {
+    (void)arg;
+    rw_semaphore_take_read(sem);
+    TEST_ASSERT(atomic_load(&writer_done));
+    atomic_store(&late_reader_done, true);
+    rw_semaphore_release_read(sem);
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs the exclusion test and the writer preference test.
+ ********************************************************************************/
+int main(void) {
+    sem = rw_semaphore_new("test_rw_semaphore");
+    TEST_ASSERT(sem != 0);
+
+    pthread_t threads[NUM_READERS + NUM_WRITERS];
+    for (uint32_t i = 0; i < NUM_READERS; ++i) TEST_ASSERT(pthread_create(&threads[i], 0, read_shared, 0) == 0);
+    for (uint32_t i = NUM_READERS; i < NUM_READERS + NUM_WRITERS; ++i) {
+        TEST_ASSERT(pthread_create(&threads[i], 0, write_shared, 0) == 0);
+    }
+    for (uint32_t i = 0; i < NUM_READERS + NUM_WRITERS; ++i) pthread_join(threads[i], 0);
+    TEST_ASSERT_EQUAL(shared_a, NUM_WRITERS * NUM_WRITES_PER_WRITER);
+    TEST_ASSERT_EQUAL(shared_b, NUM_WRITERS * NUM_WRITES_PER_WRITER);
+
+    pthread_t reader, writer, late_reader;
+    TEST_ASSERT(pthread_create(&reader, 0, hold_read, 0) == 0);
+    while (!atomic_load(&reader_holds)) delay_ms(1);
+    TEST_ASSERT(!rw_semaphore_try_take_write(sem));
+    TEST_ASSERT(pthread_create(&writer, 0, take_write, 0) == 0);
+    uint32_t num_polls = 0;
+    while (rw_semaphore_try_take_read(sem)) {
+        rw_semaphore_release_read(sem);
+        TEST_ASSERT(++num_polls < 10000);
+        delay_ms(1);
+    }
+    TEST_ASSERT(pthread_create(&late_reader, 0, take_late_read, 0) == 0);
+    delay_ms(20);
+    TEST_ASSERT(!atomic_load(&late_reader_done) && !atomic_load(&writer_done));
+    atomic_store(&release_reader, true);
+    pthread_join(reader, 0);
+    pthread_join(writer, 0);
+    pthread_join(late_reader, 0);
+    TEST_ASSERT(atomic_load(&writer_done) && atomic_load(&late_reader_done));
+
+    rw_semaphore_delete(&sem);
+    TEST_ASSERT(sem == 0);
+    return 0;
+}
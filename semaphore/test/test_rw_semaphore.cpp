@@ -0,0 +1,145 @@
+/********************************************************************************
+ * @brief Test of the reader-writer semaphore in C++. Verifies that
+ *            - writers exclude each other and all readers, while readers may
+ *              share the semaphore, and that data written by a writer is
+ *              visible to subsequent readers and writers.
+ *            - writers are preferred: once a writer waits for the readers to
+ *              leave, new readers wait until the writer has released the
+ *              semaphore.
+ ********************************************************************************/
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <sync/semaphore.h>
+#include "test.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief The number of reader and writer threads of the exclusion test.
+ ********************************************************************************/
+constexpr uint32_t num_readers{6};
+constexpr uint32_t num_writers{2};
+
+/********************************************************************************
+ * @brief The number of acquisitions of each reader and writer.
+ ********************************************************************************/
+constexpr uint32_t num_reads_per_reader{100000};
+constexpr uint32_t num_writes_per_writer{20000};
+
+/********************************************************************************
+ * @brief Blocks the calling thread for specified time in milliseconds.
+ ********************************************************************************/
+inline void Delay_ms(const uint32_t time_ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(time_ms));
+}
+
+/********************************************************************************
+ * @brief Runs readers and writers concurrently, verifying that writers are
+ *        alone inside and that the shared data is consistent.
+ *
+ * @param sem
+ *        Reference to the semaphore under test.
+ ********************************************************************************/
+void TestExclusion(rw_semaphore& sem) {
+    std::atomic<uint32_t> num_readers_inside{}, num_writers_inside{};
+    uint64_t shared_a{}, shared_b{};
+    std::vector<std::thread> threads{};
+    for (uint32_t i{}; i < num_readers; ++i) {
+        threads.emplace_back([&]() {
+            for (uint32_t j{}; j < num_reads_per_reader; ++j) {
+                if (j % 4 == 0) {
+                    while (!sem.try_take_read()) std::this_thread::yield();
+                } else {
+                    sem.take_read();
+                }
+                num_readers_inside.fetch_add(1);
+                TEST_ASSERT_EQUAL(num_writers_inside.load(), 0);
+                TEST_ASSERT(shared_a == shared_b);
+                num_readers_inside.fetch_sub(1);
+                sem.release_read();
+            }
+        });
+    }
+    for (uint32_t i{}; i < num_writers; ++i) {
+        threads.emplace_back([&]() {
+            for (uint32_t j{}; j < num_writes_per_writer; ++j) {
+                if (j % 4 == 0) {
+                    while (!sem.try_take_write()) std::this_thread::yield();
+                } else {
+                    sem.take_write();
+                }
+                TEST_ASSERT_EQUAL(num_writers_inside.fetch_add(1), 0);
+                TEST_ASSERT_EQUAL(num_readers_inside.load(), 0);
+                TEST_ASSERT(shared_a == shared_b);
+                shared_a++;
+                shared_b++;
+                num_writers_inside.fetch_sub(1);
+                sem.release_write();
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    TEST_ASSERT_EQUAL(shared_a, num_writers * num_writes_per_writer);
+    TEST_ASSERT_EQUAL(shared_b, num_writers * num_writes_per_writer);
+}
+
+/********************************************************************************
+ * @brief Makes a writer wait for a reader, then verifies that a reader
+ *        arriving after the writer is only admitted once the writer is done.
+ *
+ * @param sem
+ *        Reference to the semaphore under test.
+ ********************************************************************************/
+void TestWriterPreference(rw_semaphore& sem) {
+    std::atomic<bool> reader_holds{}, release_reader{}, writer_done{}, late_reader_done{};
+    std::thread reader{[&]() {
+        sem.take_read();
+        reader_holds.store(true);
+        while (!release_reader.load()) Delay_ms(1);
+        sem.release_read();
+    }};
+    while (!reader_holds.load()) Delay_ms(1);
+    TEST_ASSERT(!sem.try_take_write());
+
+    std::thread writer{[&]() {
+        sem.take_write();
+        TEST_ASSERT(!late_reader_done.load());
+        Delay_ms(10);
+        writer_done.store(true);
+        sem.release_write();
+    }};
+    uint32_t num_polls{};
+    while (sem.try_take_read()) {
+        sem.release_read();
+        TEST_ASSERT(++num_polls < 10000);
+        Delay_ms(1);
+    }
+
+    std::thread late_reader{[&]() {
+        sem.take_read();
+        TEST_ASSERT(writer_done.load());
+        late_reader_done.store(true);
+        sem.release_read();
+    }};
+    Delay_ms(20);
+    TEST_ASSERT(!late_reader_done.load() && !writer_done.load());
+    release_reader.store(true);
+    reader.join();
+    writer.join();
+    late_reader.join();
+    TEST_ASSERT(writer_done.load() && late_reader_done.load());
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the exclusion test and the writer preference test.
+ ********************************************************************************/
+int main(void) {
+    rw_semaphore sem{"test_rw_semaphore"};
+    TestExclusion(sem);
+    TestWriterPreference(sem);
+    return 0;
+}
@@ -0,0 +1,108 @@
+/********************************************************************************
+ * @brief Test of the seqlock in C. Two writers increment all members of the
+ *        value in place, while readers load it concurrently. Verifies that
+ *        readers never observe a torn value or a value older than one they
+ *        have already observed, that the writers exclude each other and that
+ *        data written before a write section ends is visible to readers that
+ *        have loaded the value of that section.
+ ********************************************************************************/
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sync/seqlock.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of reader and writer threads.
+ ********************************************************************************/
+#define NUM_READERS 3U
+#define NUM_WRITERS 2U
+
+/********************************************************************************
+ * @brief The number of write sections of each writer.
+ ********************************************************************************/
+#define NUM_WRITES_PER_WRITER 100000U
+
+/********************************************************************************
+ * @brief Value protected by the seqlock, whose members are always equal
+ *        outside of a write section.
+ ********************************************************************************/
+struct point {
+    uint64_t x;
+    uint64_t y;
+    uint64_t z;
+};
+
+/********************************************************************************
+ * @brief The seqlock under test.
+ ********************************************************************************/
+static SEQLOCK(struct point) position = SEQLOCK_INIT({0, 0, 0});
+
+/********************************************************************************
+ * @brief Data written outside of the seqlock value within each write section,
+ *        indexed by the value the section writes.
+ ********************************************************************************/
+static uint64_t published[NUM_WRITERS * NUM_WRITES_PER_WRITER + 1];
+
+/********************************************************************************
+ * @brief Set once all writers have finished.
+ ********************************************************************************/
+static _Atomic bool writers_done = false;
+
+/********************************************************************************
+ * @brief Loads the value until the writers are done, verifying each load.
+ ********************************************************************************/
+static void* read_position(void* arg) {
+    (void)arg;
+    uint64_t last = 0;
+    while (!atomic_load(&writers_done)) {
+        struct point point;
+        SEQLOCK_LOAD(&position, &point);
+        TEST_ASSERT(point.x == point.y && point.y == point.z);
+        TEST_ASSERT(point.x >= last);
+        TEST_ASSERT(point.x == 0 || published[point.x] == point.x);
+        last = point.x;
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Increments the value in place.
+ ********************************************************************************/
+static void* write_position(void* arg) {
+    (void)arg;
+    for (uint32_t i = 0; i < NUM_WRITES_PER_WRITER; ++i) {
+        SEQLOCK_WRITE_BEGIN(&position);
+        const uint64_t next = position.value.x + 1;
+        published[next] = next;
+        position.value.x = next;
+        position.value.y = next;
+        position.value.z = next;
+        SEQLOCK_WRITE_END(&position);
+    }
+    return 0;
+}
+
+/********************************************************************************
+ * @brief Runs the readers and writers and verifies the final value.
+ ********************************************************************************/
+int main(void) {
+    pthread_t readers[NUM_READERS], writers[NUM_WRITERS];
+    for (uint32_t i = 0; i < NUM_READERS; ++i) TEST_ASSERT(pthread_create(&readers[i], 0, read_position, 0) == 0);
+    for (uint32_t i = 0; i < NUM_WRITERS; ++i) TEST_ASSERT(pthread_create(&writers[i], 0, write_position, 0) == 0);
+    for (uint32_t i = 0; i < NUM_WRITERS; ++i) pthread_join(writers[i], 0);
+    atomic_store(&writers_done, true);
+    for (uint32_t i = 0; i < NUM_READERS; ++i) pthread_join(readers[i], 0);
+
+    struct point point;
+    SEQLOCK_LOAD(&position, &point);
+    TEST_ASSERT_EQUAL(point.x, NUM_WRITERS * NUM_WRITES_PER_WRITER);
+    TEST_ASSERT(point.y == point.x && point.z == point.x);
+
+    const struct point origin = {0, 0, 0};
+    SEQLOCK_STORE(&position, &origin);
+    SEQLOCK_LOAD(&position, &point);
+    TEST_ASSERT(point.x == 0 && point.y == 0 && point.z == 0);
+    return 0;
+}
@@ -0,0 +1,93 @@
+/********************************************************************************
+ * @brief Test of the seqlock in C++. Two writers increment all members of the
+ *        value in place, while readers load it concurrently. Verifies that
+ *        readers never observe a torn value or a value older than one they
+ *        have already observed, that the writers exclude each other and that
+ *        data written within a write section is visible to readers that have
+ *        loaded the value of that section.
+ ********************************************************************************/
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <sync/seqlock.h>
+#include "test.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief The number of reader and writer threads.
+ ********************************************************************************/
+constexpr uint32_t num_readers{3};
+constexpr uint32_t num_writers{2};
+
+/********************************************************************************
+ * @brief The number of write sections of each writer.
+ ********************************************************************************/
+constexpr uint32_t num_writes_per_writer{100000};
+
+/********************************************************************************
+ * @brief Value protected by the seqlock, whose members are always equal
+ *        outside of a write section.
+ ********************************************************************************/
+struct point {
+    uint64_t x;
+    uint64_t y;
+    uint64_t z;
+};
+
+/********************************************************************************
+ * @brief The seqlock under test.
+ ********************************************************************************/
+seqlock<point> position{};
+
+/********************************************************************************
+ * @brief Data written outside of the seqlock value within each write section,
+ *        indexed by the value the section writes.
+ ********************************************************************************/
+std::unique_ptr<uint64_t[]> published{new uint64_t[num_writers * num_writes_per_writer + 1]{}};
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the readers and writers and verifies the final value.
+ ********************************************************************************/
+int main(void) {
+    std::atomic<bool> writers_done{};
+    std::vector<std::thread> readers{}, writers{};
+    for (uint32_t i{}; i < num_readers; ++i) {
+        readers.emplace_back([&writers_done]() {
+            uint64_t last{};
+            while (!writers_done.load()) {
+                const auto p{position.load()};
+                TEST_ASSERT(p.x == p.y && p.y == p.z);
+                TEST_ASSERT(p.x >= last);
+                TEST_ASSERT(p.x == 0 || published[p.x] == p.x);
+                last = p.x;
+            }
+        });
+    }
+    for (uint32_t i{}; i < num_writers; ++i) {
+        writers.emplace_back([]() {
+            for (uint32_t j{}; j < num_writes_per_writer; ++j) {
+                position.update([](point& p) {
+                    const auto next{p.x + 1};
+                    published[next] = next;
+                    p = point{next, next, next};
+                });
+            }
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    writers_done.store(true);
+    for (auto& reader : readers) reader.join();
+
+    auto p{position.load()};
+    TEST_ASSERT_EQUAL(p.x, num_writers * num_writes_per_writer);
+    TEST_ASSERT(p.y == p.x && p.z == p.x);
+
+    position.store(point{});
+    p = position.load();
+    TEST_ASSERT(p.x == 0 && p.y == 0 && p.z == 0);
+    return 0;
+}
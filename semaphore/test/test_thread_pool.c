@@ -0,0 +1,199 @@
+/********************************************************************************
+ * @brief Test of the work-stealing thread pool in C. Verifies that
+ *            - each task submitted from outside the pool runs exactly once,
+ *              also while the shared queue is full, and that the data written
+ *              by the submitter before the submission is visible to the task.
+ *            - the same holds for tasks that recursively submit a binary tree
+ *              of tasks from the workers, so that the owners push onto and
+ *              pop from their deques while idle workers steal from them.
+ *            - deleting the pool runs the tasks submitted so far.
+ *            - pinned workers run on a single CPU the process may run on.
+ ********************************************************************************/
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sync/thread_pool.h>
+#include "test.h"
+
+/********************************************************************************
+ * @brief The number of tasks submitted per round.
+ ********************************************************************************/
+#define NUM_TASKS 20000U
+
+/********************************************************************************
+ * @brief The number of tasks of the tree, i.e. a complete tree of 16 levels.
+ ********************************************************************************/
+#define NUM_TREE_TASKS ((1U << 16) - 1U)
+
+/********************************************************************************
+ * @brief The number of times the tasks are submitted.
+ ********************************************************************************/
+#define NUM_ROUNDS 4U
+
+/********************************************************************************
+ * @brief The thread pool under test.
+ ********************************************************************************/
+static struct thread_pool* pool = 0;
+
+/********************************************************************************
+ * @brief The number of times each task has run.
+ ********************************************************************************/
+static _Atomic uint32_t num_runs[NUM_TREE_TASKS];
+
+/********************************************************************************
+ * @brief Data written non-atomically by the submitter of each task before it
+ *        is submitted, and checked by the task.
+ ********************************************************************************/
+static uint64_t payload[NUM_TREE_TASKS];
+
+/********************************************************************************
+ * @brief The round in progress, written before the tasks are submitted.
+ ********************************************************************************/
+static uint32_t round_number = 0;
+
+/********************************************************************************
+ * @brief The CPUs the process may run on.
+ ********************************************************************************/
+static cpu_set_t allowed_cpus;
+
+/********************************************************************************
+ * @brief Provides the payload written for specified task in specified round.
+ ********************************************************************************/
+static inline uint64_t payload_of(const uint32_t task, const uint32_t round) {
+    return ((uint64_t)round << 32 | task) * 0x9E3779B97F4A7C15ULL;
+}
+
+/********************************************************************************
+ * @brief Runs the task of specified index.
+ ********************************************************************************/
+static void run_task(void* arg) {
+    const uint32_t task = (uint32_t)(uintptr_t)arg;
+    TEST_ASSERT(payload[task] == payload_of(task, round_number));
+    atomic_fetch_add_explicit(&num_runs[task], 1, memory_order_relaxed);
+}
+
+/********************************************************************************
+ * @brief Runs the task of the tree of specified index and submits its children.
+ ********************************************************************************/
+static void run_tree_task(void* arg) {
+    run_task(arg);
+    const uint32_t task = (uint32_t)(uintptr_t)arg;
+    for (uint32_t child = 2 * task + 1; child <= 2 * task + 2 && child < NUM_TREE_TASKS; ++child) {
+        payload[child] = payload_of(child, round_number);
+        TEST_ASSERT(thread_pool_submit(pool, run_tree_task, (void*)(uintptr_t)child));
+    }
+}
+
+/********************************************************************************
+ * @brief Verifies that the calling worker is pinned to a single permitted CPU.
+ ********************************************************************************/
+static void check_pinned(void* arg) {
+    (void)arg;
+    cpu_set_t cpus;
+    TEST_ASSERT(sched_getaffinity(0, sizeof(cpus), &cpus) == 0);
+    TEST_ASSERT_EQUAL(CPU_COUNT(&cpus), 1);
+    cpu_set_t permitted;
+    CPU_AND(&permitted, &cpus, &allowed_cpus);
+    TEST_ASSERT_EQUAL(CPU_COUNT(&permitted), 1);
+}
+
+/********************************************************************************
+ * @brief Submits all tasks for specified round.
+ ********************************************************************************/
+static void submit_round(const uint32_t round) {
+    round_number = round;
+    for (uint32_t task = 0; task < NUM_TASKS; ++task) {
+        payload[task] = payload_of(task, round);
+        TEST_ASSERT(thread_pool_submit(pool, run_task, (void*)(uintptr_t)task));
+    }
+}
+
+/********************************************************************************
+ * @brief Submits the tasks several times through a small shared queue and
+ *        verifies that each task ran once per round, then submits them once
+ *        more and deletes the pool right away.
+ ********************************************************************************/
+static void test_submit(void) {
+    const struct thread_pool_options options = {4, 8, false};
+    pool = thread_pool_new(&options);
+    TEST_ASSERT(pool != 0);
+    TEST_ASSERT_EQUAL(thread_pool_num_threads(pool), 4);
+    TEST_ASSERT(!thread_pool_submit(pool, 0, 0));
+
+    for (uint32_t round = 1; round <= NUM_ROUNDS; ++round) {
+        submit_round(round);
+        thread_pool_wait_idle(pool);
+        for (uint32_t task = 0; task < NUM_TASKS; ++task) {
+            TEST_ASSERT_EQUAL(atomic_load_explicit(&num_runs[task], memory_order_relaxed), round);
+        }
+    }
+    submit_round(NUM_ROUNDS + 1);
+    thread_pool_delete(&pool);
+    TEST_ASSERT(pool == 0);
+    for (uint32_t task = 0; task < NUM_TASKS; ++task) {
+        TEST_ASSERT_EQUAL(atomic_load_explicit(&num_runs[task], memory_order_relaxed), NUM_ROUNDS + 1);
+    }
+}
+
+/********************************************************************************
+ * @brief Runs the tree several times through a small shared queue and verifies
+ *        that each task ran once per round, then runs it once more and deletes
+ *        the pool right away.
+ ********************************************************************************/
+static void test_tree(void) {
+    const struct thread_pool_options options = {4, 8, false};
+    pool = thread_pool_new(&options);
+    TEST_ASSERT(pool != 0);
+    for (uint32_t task = 0; task < NUM_TREE_TASKS; ++task) atomic_store(&num_runs[task], 0);
+
+    for (uint32_t round = 1; round <= NUM_ROUNDS + 1; ++round) {
+        round_number = round;
+        payload[0] = payload_of(0, round);
+        TEST_ASSERT(thread_pool_submit(pool, run_tree_task, 0));
+        if (round > NUM_ROUNDS) break;
+        thread_pool_wait_idle(pool);
+        for (uint32_t task = 0; task < NUM_TREE_TASKS; ++task) {
+            TEST_ASSERT_EQUAL(atomic_load_explicit(&num_runs[task], memory_order_relaxed), round);
+        }
+    }
+    thread_pool_delete(&pool);
+    for (uint32_t task = 0; task < NUM_TREE_TASKS; ++task) {
+        TEST_ASSERT_EQUAL(atomic_load_explicit(&num_runs[task], memory_order_relaxed), NUM_ROUNDS + 1);
+    }
+}
+
+/********************************************************************************
+ * @brief Runs tasks on pinned workers, more workers than the process may use
+ *        CPUs, and verifies the affinity of each.
+ ********************************************************************************/
+static void test_pinning(void) {
+    TEST_ASSERT(sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus) == 0);
+    const struct thread_pool_options options = {(uint16_t)(CPU_COUNT(&allowed_cpus) + 2), 0, true};
+    pool = thread_pool_new(&options);
+    TEST_ASSERT(pool != 0);
+    for (uint32_t i = 0; i < 1000; ++i) TEST_ASSERT(thread_pool_submit(pool, check_pinned, 0));
+    thread_pool_delete(&pool);
+}
+
+/********************************************************************************
+ * @brief Verifies that the default pool has a worker per online CPU.
+ ********************************************************************************/
+static void test_defaults(void) {
+    pool = thread_pool_new(0);
+    TEST_ASSERT(pool != 0);
+    TEST_ASSERT_EQUAL(thread_pool_num_threads(pool), sysconf(_SC_NPROCESSORS_ONLN));
+    thread_pool_delete(&pool);
+}
+
+/********************************************************************************
+ * @brief Runs the tests of the thread pool.
+ ********************************************************************************/
+int main(void) {
+    test_submit();
+    test_tree();
+    test_pinning();
+    test_defaults();
+    return 0;
+}
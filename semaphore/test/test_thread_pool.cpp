@@ -0,0 +1,164 @@
+/********************************************************************************
+ * @brief Test of the work-stealing thread pool in C++. Verifies that
+ *            - each task submitted from outside the pool runs exactly once,
+ *              also while the shared queue is full, and that the state
+ *              captured by each task is visible where it runs.
+ *            - the same holds for tasks that recursively submit a binary tree
+ *              of tasks from the workers, so that the owners push onto and
+ *              pop from their deques while idle workers steal from them.
+ *            - deleting the pool runs the tasks submitted so far.
+ *            - pinned workers run on a single CPU the process may run on.
+ ********************************************************************************/
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <sched.h>
+#include <sync/thread_pool.h>
+#include "test.h"
+
+namespace {
+
+/********************************************************************************
+ * @brief The number of tasks submitted per round.
+ ********************************************************************************/
+constexpr uint32_t num_tasks{20000};
+
+/********************************************************************************
+ * @brief The number of tasks of the tree, i.e. a complete tree of 16 levels.
+ ********************************************************************************/
+constexpr uint32_t num_tree_tasks{(1U << 16) - 1U};
+
+/********************************************************************************
+ * @brief The number of times the tasks are submitted.
+ ********************************************************************************/
+constexpr uint32_t num_rounds{4};
+
+/********************************************************************************
+ * @brief The number of times each task has run.
+ ********************************************************************************/
+std::unique_ptr<std::atomic<uint32_t>[]> num_runs{new std::atomic<uint32_t>[num_tree_tasks]{}};
+
+/********************************************************************************
+ * @brief Submits all tasks to specified pool, passing each task a value it can
+ *        verify.
+ *
+ * @param pool
+ *        Reference to the thread pool.
+ ********************************************************************************/
+template <typename pool_type>
+void SubmitTasks(pool_type& pool) {
+    for (uint32_t task{}; task < num_tasks; ++task) {
+        pool.submit([task, check = task * 0x9E3779B97F4A7C15ULL]() {
+            TEST_ASSERT(check == task * 0x9E3779B97F4A7C15ULL);
+            num_runs[task].fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+}
+
+/********************************************************************************
+ * @brief Runs the task of the tree of specified index and submits its
+ *        children, passing each child a value it can verify.
+ *
+ * @param pool
+ *        Reference to the thread pool.
+ * @param task
+ *        The index of the task.
+ * @param check
+ *        The value the parent derived from the index of the task.
+ ********************************************************************************/
+template <typename pool_type>
+void RunTreeTask(pool_type& pool, const uint32_t task, const uint64_t check) {
+    TEST_ASSERT(check == task * 0x9E3779B97F4A7C15ULL);
+    num_runs[task].fetch_add(1, std::memory_order_relaxed);
+    for (uint32_t child{2 * task + 1}; child <= 2 * task + 2 && child < num_tree_tasks; ++child) {
+        pool.submit([&pool, child, check = child * 0x9E3779B97F4A7C15ULL]() { RunTreeTask(pool, child, check); });
+    }
+}
+
+/********************************************************************************
+ * @brief Submits the tasks several times through a small shared queue and
+ *        verifies that each task ran once per round, then submits them once
+ *        more and deletes the pool right away.
+ ********************************************************************************/
+void TestSubmit(void) {
+    {
+        thread_pool<8> pool{4};
+        TEST_ASSERT_EQUAL(pool.num_threads(), 4);
+        for (uint32_t round{1}; round <= num_rounds; ++round) {
+            SubmitTasks(pool);
+            pool.wait_idle();
+            for (uint32_t task{}; task < num_tasks; ++task) {
+                TEST_ASSERT_EQUAL(num_runs[task].load(std::memory_order_relaxed), round);
+            }
+        }
+        SubmitTasks(pool);
+    }
+    for (uint32_t task{}; task < num_tasks; ++task) {
+        TEST_ASSERT_EQUAL(num_runs[task].load(std::memory_order_relaxed), num_rounds + 1);
+    }
+}
+
+/********************************************************************************
+ * @brief Runs the tree several times through a small shared queue and verifies
+ *        that each task ran once per round, then runs it once more and deletes
+ *        the pool right away.
+ ********************************************************************************/
+void TestTree(void) {
+    for (uint32_t task{}; task < num_tree_tasks; ++task) num_runs[task].store(0);
+    {
+        thread_pool<8> pool{4};
+        for (uint32_t round{1}; round <= num_rounds; ++round) {
+            pool.submit([&pool]() { RunTreeTask(pool, 0, 0); });
+            pool.wait_idle();
+            for (uint32_t task{}; task < num_tree_tasks; ++task) {
+                TEST_ASSERT_EQUAL(num_runs[task].load(std::memory_order_relaxed), round);
+            }
+        }
+        pool.submit([&pool]() { RunTreeTask(pool, 0, 0); });
+    }
+    for (uint32_t task{}; task < num_tree_tasks; ++task) {
+        TEST_ASSERT_EQUAL(num_runs[task].load(std::memory_order_relaxed), num_rounds + 1);
+    }
+}
+
+/********************************************************************************
+ * @brief Runs tasks on pinned workers, more workers than the process may use
+ *        CPUs, and verifies the affinity of each.
+ ********************************************************************************/
+void TestPinning(void) {
+    cpu_set_t allowed;
+    TEST_ASSERT(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+    thread_pool<> pool{static_cast<uint16_t>(CPU_COUNT(&allowed) + 2), true};
+    for (uint32_t i{}; i < 1000; ++i) {
+        pool.submit([&allowed]() {
+            cpu_set_t cpus;
+            TEST_ASSERT(sched_getaffinity(0, sizeof(cpus), &cpus) == 0);
+            TEST_ASSERT_EQUAL(CPU_COUNT(&cpus), 1);
+            cpu_set_t permitted;
+            CPU_AND(&permitted, &cpus, &allowed);
+            TEST_ASSERT_EQUAL(CPU_COUNT(&permitted), 1);
+        });
+    }
+    pool.wait_idle();
+}
+
+/********************************************************************************
+ * @brief Verifies that the default pool has a worker per hardware thread.
+ ********************************************************************************/
+void TestDefaults(void) {
+    thread_pool<> pool{};
+    TEST_ASSERT_EQUAL(pool.num_threads(), std::thread::hardware_concurrency());
+}
+} /* namespace */
+
+/********************************************************************************
+ * @brief Runs the tests of the thread pool.
+ ********************************************************************************/
+int main(void) {
+    TestSubmit();
+    TestTree();
+    TestPinning();
+    TestDefaults();
+    return 0;
+}